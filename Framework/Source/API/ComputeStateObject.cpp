@@ -40,6 +40,11 @@ namespace Falcor
         return b;
     }
 
+    size_t ComputeStateObject::Desc::getHash() const
+    {
+        return std::hash<const void*>()(mpProgram.get()) ^ (std::hash<const void*>()(mpRootSignature.get()) << 1);
+    }
+
     ComputeStateObject::~ComputeStateObject()
     {
         gpDevice->releaseResource(mApiHandle);
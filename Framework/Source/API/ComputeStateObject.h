@@ -49,6 +49,7 @@ namespace Falcor
             Desc& setProgramVersion(ProgramVersion::SharedConstPtr pProgram) { mpProgram = pProgram; return *this; }
             ProgramVersion::SharedConstPtr getProgramVersion() const { return mpProgram; }
             bool operator==(const Desc& other) const;
+            size_t getHash() const;
         private:
             friend class ComputeStateObject;
             ProgramVersion::SharedConstPtr mpProgram;
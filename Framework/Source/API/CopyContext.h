@@ -26,9 +26,11 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <functional>
 #include "API/Resource.h"
 #ifdef FALCOR_LOW_LEVEL_API
 #include "API/LowLevel/LowLevelContextData.h"
+#include "API/LowLevel/UploadHeap.h"
 #endif
 
 namespace Falcor
@@ -41,6 +43,15 @@ namespace Falcor
     public:
         using SharedPtr = std::shared_ptr<CopyContext>;
         using SharedConstPtr = std::shared_ptr<const CopyContext>;
+
+        /** Writes one row of a subresource into the upload buffer
+            \param[in] depthSlice The depth slice of the row. Always 0, except for 3D textures
+            \param[in] row The row index inside the slice. For compressed formats, this is a row of blocks
+            \param[out] pDst The destination. rowSize bytes should be written
+            \param[in] rowSize The size of the row in bytes
+        */
+        using RowWriter = std::function<void(uint32_t depthSlice, uint32_t row, uint8_t* pDst, size_t rowSize)>;
+
         virtual ~CopyContext();
 
         static SharedPtr create();
@@ -48,6 +59,13 @@ namespace Falcor
         void updateTexture(const Texture* pTexture, const void* pData);
         void updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const void* pData);
         void updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData);
+
+        /** Update a subresource by writing its rows straight into the upload buffer. Use it to avoid staging the data in a temporary buffer, for example when the rows need to be reordered
+            \param[in] pTexture The texture to update
+            \param[in] subresourceIndex The subresource to update
+            \param[in] writeRow Called once for every row of the subresource
+        */
+        void updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const RowWriter& writeRow);
         std::vector<uint8> readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
 
         /** Reset
@@ -90,7 +108,7 @@ namespace Falcor
 
         /** Override the low-level context data with a user provided object
         */
-        void setLowLevelContextData(LowLevelContextData::SharedPtr pLowLevelData) { mpLowLevelData = pLowLevelData; }
+        void setLowLevelContextData(LowLevelContextData::SharedPtr pLowLevelData) { mpLowLevelData = pLowLevelData; mpUploadHeap = nullptr; }
 #endif
     protected:
         void bindDescriptorHeaps();
@@ -98,6 +116,11 @@ namespace Falcor
         bool mCommandsPending = false;
 #ifdef FALCOR_LOW_LEVEL_API
         LowLevelContextData::SharedPtr mpLowLevelData;
+
+        /** Staging memory for the update*() functions. Created on first use, since it's tracked by the low-level data's fence
+        */
+        UploadHeap::Allocation allocateUploadData(size_t size, size_t alignment);
+        UploadHeap::SharedPtr mpUploadHeap;
 #endif
     };
 }
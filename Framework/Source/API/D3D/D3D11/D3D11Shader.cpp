@@ -129,9 +129,10 @@ namespace Falcor
     create_shader(GeometryShaderHandle, createGeometryShader, CreateGeometryShader);
     create_shader(ComputeShaderHandle, createComputeShader, CreateComputeShader);
         
-    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType type, std::string& log)
+    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType type, std::string& log, const unordered_string_set& includeList)
     {
         SharedPtr pShader = SharedPtr(new Shader(type));
+        pShader->setIncludeList(includeList);
 
         // Compile the shader
         DxShaderData* pData = (DxShaderData*)pShader->mpPrivateData;
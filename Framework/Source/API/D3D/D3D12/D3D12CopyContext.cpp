@@ -34,6 +34,8 @@
 
 namespace Falcor
 {
+    static const size_t kUploadHeapPageSize = 1024 * 1024 * 2;
+
     CopyContext::~CopyContext() = default;
 
     CopyContext::SharedPtr CopyContext::create()
@@ -56,6 +58,15 @@ namespace Falcor
         bindDescriptorHeaps();
     }
 
+    UploadHeap::Allocation CopyContext::allocateUploadData(size_t size, size_t alignment)
+    {
+        if (mpUploadHeap == nullptr)
+        {
+            mpUploadHeap = UploadHeap::create(kUploadHeapPageSize, mpLowLevelData->getFence());
+        }
+        return mpUploadHeap->allocate(size, alignment);
+    }
+
     void copySubresourceData(const D3D12_SUBRESOURCE_DATA& srcData, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& dstFootprint, uint8_t* pDstStart, uint64_t rowSize, uint64_t rowsToCopy)
     {
         const uint8_t* pSrc = (uint8_t*)srcData.pData;
@@ -105,15 +116,12 @@ namespace Falcor
         }
 
         mCommandsPending = true;
-        // Allocate a buffer on the upload heap
-        Buffer::SharedPtr pUploadBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
-        pUploadBuffer->updateData(pData, offset, size);
-        ID3D12ResourcePtr pResource = pUploadBuffer->getApiHandle();
+        // Stage the data in the upload heap
+        UploadHeap::Allocation upload = allocateUploadData(size, 1);
+        memcpy(upload.pData, pData, size);
 
         resourceBarrier(pBuffer, Resource::State::CopyDest);
-
-        offset = pUploadBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
-        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), 0, pResource, offset, size);
+        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), offset, upload.pResourceHandle, upload.offset, size);
     }
 
     void CopyContext::updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData)
@@ -133,14 +141,9 @@ namespace Falcor
         uint64_t size;
         pDevice->GetCopyableFootprints(&texDesc, firstSubresource, subresourceCount, 0, footprint.data(), rowCount.data(), rowSize.data(), &size);
 
-        // Allocate a buffer on the upload heap
-        Buffer::SharedPtr pBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
-        // Map the buffer
-        uint8_t* pDst = (uint8_t*)pBuffer->map(Buffer::MapType::WriteDiscard);
-        ID3D12ResourcePtr pResource = pBuffer->getApiHandle();
-
-        // Get the offset from the beginning of the resource
-        uint64_t offset = pBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
+        // Allocate the staging memory from the upload heap
+        UploadHeap::Allocation upload = allocateUploadData((size_t)size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        uint8_t* pDst = upload.pData;
 
         resourceBarrier(pTexture, Resource::State::CopyDest);
 
@@ -158,14 +161,12 @@ namespace Falcor
             pSrc = (uint8_t*)pSrc + footprint[s].Footprint.Depth * src.SlicePitch;
 
             // Dispatch a command
-            footprint[s].Offset += offset;
+            footprint[s].Offset += upload.offset;
             uint32_t subresource = s + firstSubresource;
             D3D12_TEXTURE_COPY_LOCATION dstLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresource };
-            D3D12_TEXTURE_COPY_LOCATION srcLoc = { pResource, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint[s] };
+            D3D12_TEXTURE_COPY_LOCATION srcLoc = { upload.pResourceHandle, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint[s] };
             mpLowLevelData->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
         }
-
-        pBuffer->unmap();
     }
 
     void CopyContext::updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const void* pData)
@@ -174,6 +175,39 @@ namespace Falcor
         updateTextureSubresources(pTexture, subresourceIndex, 1, pData);
     }
 
+    void CopyContext::updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const RowWriter& writeRow)
+    {
+        mCommandsPending = true;
+
+        // Get the footprint
+        D3D12_RESOURCE_DESC texDesc = pTexture->getApiHandle()->GetDesc();
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        uint32_t rowCount;
+        uint64_t rowSize;
+        uint64_t size;
+        gpDevice->getApiHandle()->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &rowCount, &rowSize, &size);
+
+        // Allocate the staging memory from the upload heap and let the caller fill it
+        UploadHeap::Allocation upload = allocateUploadData((size_t)size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        uint8_t* pDst = upload.pData + footprint.Offset;
+
+        resourceBarrier(pTexture, Resource::State::CopyDest);
+
+        for (uint32_t z = 0; z < footprint.Footprint.Depth; z++)
+        {
+            uint8_t* pDstSlice = pDst + rowCount * footprint.Footprint.RowPitch * z;
+            for (uint32_t y = 0; y < rowCount; y++)
+            {
+                writeRow(z, y, pDstSlice + footprint.Footprint.RowPitch * y, (size_t)rowSize);
+            }
+        }
+
+        footprint.Offset += upload.offset;
+        D3D12_TEXTURE_COPY_LOCATION dstLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
+        D3D12_TEXTURE_COPY_LOCATION srcLoc = { upload.pResourceHandle, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
+        mpLowLevelData->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+    }
+
     std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
     {
         //Get footprint
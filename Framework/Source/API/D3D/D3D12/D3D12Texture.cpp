@@ -246,8 +246,22 @@ namespace Falcor
 
     uint32_t Texture::getMipLevelDataSize(uint32_t mipLevel) const
     {
-        UNSUPPORTED_IN_D3D12("Texture::getMipLevelDataSize");
-        return 0;
+        if(mipLevel >= mMipLevels)
+        {
+            logError("Texture::getMipLevelDataSize() - Requested mip level " + std::to_string(mipLevel) + " is out-of-bound. Texture has " + std::to_string(mMipLevels) + " mip-levels.");
+            return 0;
+        }
+
+        uint32_t width = max(1U, mWidth >> mipLevel);
+        uint32_t height = max(1U, mHeight >> mipLevel);
+        uint32_t depth = max(1U, mDepth >> mipLevel);
+
+        // Compressed formats store whole blocks, even if the mip-level is smaller than a block
+        uint32_t blockWidth = getFormatWidthCompressionRatio(mFormat);
+        uint32_t blockHeight = getFormatHeightCompressionRatio(mFormat);
+        uint32_t widthInBlocks = (width + blockWidth - 1) / blockWidth;
+        uint32_t heightInBlocks = (height + blockHeight - 1) / blockHeight;
+        return widthInBlocks * heightInBlocks * depth * getFormatBytesPerBlock(mFormat);
     }
 
     void Texture::compress2DTexture()
@@ -0,0 +1,81 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "API/LowLevel/UploadHeap.h"
+#include "API/Buffer.h"
+#include "API/Device.h"
+#include "API/D3D/D3D12/D3D12Resource.h"
+
+namespace Falcor
+{
+    ID3D12ResourcePtr createBuffer(Buffer::State initState, size_t size, const D3D12_HEAP_PROPERTIES& heapProps, Buffer::BindFlags bindFlags);
+
+    static ID3D12ResourcePtr createUploadBuffer(size_t size, uint8_t*& pData)
+    {
+        ID3D12ResourcePtr pResource = createBuffer(Buffer::State::GenericRead, size, kUploadHeapProps, Buffer::BindFlags::None);
+        D3D12_RANGE readRange = {};
+        d3d_call(pResource->Map(0, &readRange, (void**)&pData));
+        return pResource;
+    }
+
+    UploadHeap::SharedPtr UploadHeap::create(size_t pageSize, GpuFence::SharedPtr pFence)
+    {
+        return SharedPtr(new UploadHeap(pageSize, pFence));
+    }
+
+    UploadHeap::UploadHeap(size_t pageSize, GpuFence::SharedPtr pFence) : mpFence(pFence), mAllocator(pageSize, pFence.get(),
+        [](size_t size)
+        {
+            UploadBuffer buffer;
+            buffer.pResourceHandle = createUploadBuffer(size, buffer.pData);
+            buffer.gpuAddress = buffer.pResourceHandle->GetGPUVirtualAddress();
+            return buffer;
+        },
+        [](UploadBuffer& buffer)
+        {
+            // The GPU might still be copying from the buffer when the heap is destroyed, so let the device release it
+            gpDevice->releaseResource(buffer.pResourceHandle);
+            buffer.pResourceHandle = nullptr;
+        })
+    {
+    }
+
+    UploadHeap::Allocation UploadHeap::allocate(size_t size, size_t alignment)
+    {
+        Allocation alloc;
+        auto range = mAllocator.allocate(size, alignment);
+        if (range.pPage)
+        {
+            alloc.pResourceHandle = range.pPage->pResourceHandle;
+            alloc.gpuAddress = range.pPage->gpuAddress + range.offset;
+            alloc.pData = range.pPage->pData + range.offset;
+            alloc.offset = range.offset;
+        }
+        return alloc;
+    }
+}
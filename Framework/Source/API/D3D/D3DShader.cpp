@@ -28,6 +28,8 @@
 #include "Framework.h"
 #include <vector>
 #include "API/Shader.h"
+#include "API/ShaderCache.h"
+#include "Utils/CpuTimer.h"
 
 namespace Falcor
 {
@@ -71,6 +73,23 @@ namespace Falcor
         flags |= D3DCOMPILE_DEBUG;
 #endif
 
+        // Look for a previous compilation of the same source. The blob contains the reflection data, so there's nothing else to store
+        ShaderCache* pCache = ShaderCache::getActive();
+        uint64_t cacheKey = 0;
+        if(pCache)
+        {
+            cacheKey = ShaderCache::computeKey(source, getTargetString(mType), flags);
+            std::vector<uint8_t> cachedBlob;
+            if(pCache->load(cacheKey, source, cachedBlob))
+            {
+                ID3DBlobPtr pBlob;
+                d3d_call(D3DCreateBlob(cachedBlob.size(), &pBlob));
+                memcpy(pBlob->GetBufferPointer(), cachedBlob.data(), cachedBlob.size());
+                return pBlob;
+            }
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
         HRESULT hr = D3DCompile(source.c_str(), source.size(), nullptr, nullptr, nullptr, kEntryPoint, getTargetString(mType), flags, 0, &pCode, &pErrors);
         if(FAILED(hr))
         {
@@ -78,6 +97,10 @@ namespace Falcor
             return nullptr;
         }
 
+        if(pCache)
+        {
+            pCache->store(cacheKey, source, mIncludeList, pCode->GetBufferPointer(), pCode->GetBufferSize(), CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()));
+        }
         return pCode;
     }
 
@@ -150,9 +173,10 @@ namespace Falcor
         return pReflection;
     }
 
-    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType type, std::string& log)
+    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType type, std::string& log, const unordered_string_set& includeList)
     {
         SharedPtr pShader = SharedPtr(new Shader(type));
+        pShader->setIncludeList(includeList);
         return pShader->init(shaderString, log) ? pShader : nullptr;
     }
 
@@ -31,6 +31,7 @@
 #include "BlendState.h"
 #include "Vao.h"
 #include "Device.h"
+#include <mutex>
 
 namespace Falcor
 {
@@ -38,8 +39,28 @@ namespace Falcor
     RasterizerState::SharedPtr GraphicsStateObject::spDefaultRasterizerState;
     DepthStencilState::SharedPtr GraphicsStateObject::spDefaultDepthStencilState;
 
+    // State objects can be created and hashed on the TaskQueue, see StateObjectCache::prewarm()
+    void GraphicsStateObject::createDefaultStates()
+    {
+        static std::once_flag sCreated;
+        std::call_once(sCreated, []()
+        {
+            spDefaultBlendState = BlendState::create(BlendState::Desc());
+            spDefaultDepthStencilState = DepthStencilState::create(DepthStencilState::Desc());
+            spDefaultRasterizerState = RasterizerState::create(RasterizerState::Desc());
+        });
+    }
+
+    // A null state means the default state
+    template<typename StatePtr>
+    static bool isSameState(const StatePtr& pA, const StatePtr& pB, const StatePtr& pDefault)
+    {
+        return (pA ? pA : pDefault) == (pB ? pB : pDefault);
+    }
+
     bool GraphicsStateObject::Desc::operator==(const GraphicsStateObject::Desc& other) const
     {
+        createDefaultStates();
         bool b = true;
         b = b && (mpLayout                  == other.mpLayout);
         b = b && (mFboDesc                  == other.mFboDesc);
@@ -48,35 +69,40 @@ namespace Falcor
         b = b && (mpRootSignature           == other.mpRootSignature);
         b = b && (mPrimType                 == other.mPrimType);
         b = b && (mSinglePassStereoEnabled  == other.mSinglePassStereoEnabled);
+        b = b && isSameState(mpRasterizerState, other.mpRasterizerState, spDefaultRasterizerState);
+        b = b && isSameState(mpBlendState, other.mpBlendState, spDefaultBlendState);
+        b = b && isSameState(mpDepthStencilState, other.mpDepthStencilState, spDefaultDepthStencilState);
+        return b;
+    }
 
-        if (mpRasterizerState)
-        {
-            b = b && (mpRasterizerState == other.mpRasterizerState);
-        }
-        else
-        {
-            b == b && (other.mpRasterizerState == nullptr || other.mpRasterizerState == spDefaultRasterizerState);
-        }
+    static void hashCombine(size_t& hash, size_t value)
+    {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
 
-        if (mpBlendState)
-        {
-            b = b && (mpBlendState == other.mpBlendState);
-        }
-        else
-        {
-            b == b && (other.mpBlendState == nullptr || other.mpBlendState == spDefaultBlendState);
-        }
+    template<typename StatePtr>
+    static size_t hashState(const StatePtr& pState, const StatePtr& pDefault)
+    {
+        return std::hash<const void*>()((pState == pDefault) ? nullptr : pState.get());
+    }
 
-        if (mpDepthStencilState)
-        {
-            b = b && (mpDepthStencilState == other.mpDepthStencilState);
-        }
-        else
+    size_t GraphicsStateObject::Desc::getHash() const
+    {
+        createDefaultStates();
+        size_t hash = std::hash<const void*>()(mpProgram.get());
+        hashCombine(hash, std::hash<const void*>()(mpLayout.get()));
+        hashCombine(hash, std::hash<const void*>()(mpRootSignature.get()));
+        hashCombine(hash, hashState(mpRasterizerState, spDefaultRasterizerState));
+        hashCombine(hash, hashState(mpBlendState, spDefaultBlendState));
+        hashCombine(hash, hashState(mpDepthStencilState, spDefaultDepthStencilState));
+        hashCombine(hash, mSampleMask);
+        hashCombine(hash, (size_t)mPrimType | ((size_t)mSinglePassStereoEnabled << 8));
+        for (uint32_t i = 0; i < Fbo::getMaxColorTargetCount(); i++)
         {
-            b == b && (other.mpDepthStencilState == nullptr || other.mpDepthStencilState == spDefaultDepthStencilState);
+            hashCombine(hash, (size_t)mFboDesc.getColorTargetFormat(i) | ((size_t)mFboDesc.isColorTargetUav(i) << 16));
         }
-
-        return b;
+        hashCombine(hash, (size_t)mFboDesc.getDepthStencilFormat() | ((size_t)mFboDesc.isDepthStencilUav() << 16) | ((size_t)mFboDesc.getSampleCount() << 24));
+        return hash;
     }
 
     GraphicsStateObject::~GraphicsStateObject()
@@ -86,13 +112,7 @@ namespace Falcor
 
     GraphicsStateObject::SharedPtr GraphicsStateObject::create(const Desc& desc)
     {
-        if (spDefaultBlendState == nullptr)
-        {
-            // Create default objects
-            spDefaultBlendState = BlendState::create(BlendState::Desc());
-            spDefaultDepthStencilState = DepthStencilState::create(DepthStencilState::Desc());
-            spDefaultRasterizerState = RasterizerState::create(RasterizerState::Desc());
-        }
+        createDefaultStates();
 
         SharedPtr pState = SharedPtr(new GraphicsStateObject(desc));
 
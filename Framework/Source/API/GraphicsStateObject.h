@@ -85,6 +85,10 @@ namespace Falcor
             bool getSinglePassStereoEnabled() const { return mSinglePassStereoEnabled; }
 
             bool operator==(const Desc& other) const;
+
+            /** Get a hash of the descriptor, consistent with operator==. A null state and the matching default state hash the same.
+            */
+            size_t getHash() const;
         private:
             friend class GraphicsStateObject;
             VertexLayout::SharedConstPtr mpLayout;
@@ -113,6 +117,7 @@ namespace Falcor
         static BlendState::SharedPtr spDefaultBlendState;
         static RasterizerState::SharedPtr spDefaultRasterizerState;
         static DepthStencilState::SharedPtr spDefaultDepthStencilState;
+        static void createDefaultStates();
 
         bool apiInit();
     };
@@ -0,0 +1,226 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <queue>
+#include <memory>
+#include <functional>
+#include "RingAllocator.h"
+
+namespace Falcor
+{
+    /** A growable set of fence-tracked RingAllocator pages. Requests which are larger than a page get a dedicated buffer instead.
+        The allocator only implements the paging policy. The memory is owned by PageType objects, which are created and released through callbacks. UploadHeap uses it with upload buffers and GpuFence, unit-tests can use a CPU-only fence instead.
+        When no page has room the allocator grows by a page. Pages beyond the first kRetainedPageCount are released once they have been idle for kIdlePageFenceCount fence signals. Dedicated buffers are released once the fence passes.
+    */
+    template<typename FenceType, typename PageType>
+    class PagedRingAllocator
+    {
+    public:
+        using CreateFunc = std::function<PageType(size_t size)>;
+        using ReleaseFunc = std::function<void(PageType& page)>;
+
+        struct Allocation
+        {
+            const PageType* pPage = nullptr;    ///< The page or dedicated buffer which holds the allocation. nullptr if the allocation failed
+            size_t offset = 0;                  ///< The offset of the allocation from the start of the page
+        };
+
+        /** The number of pages which are never released, even when idle
+        */
+        static const uint32_t kRetainedPageCount = 2;
+
+        /** The number of fence signals a page beyond kRetainedPageCount can go without allocations before it is released
+        */
+        static const uint64_t kIdlePageFenceCount = 64;
+
+        /** Constructor. Creates the first page.
+            \param[in] pageSize The size of each page in bytes
+            \param[in] pFence The fence used to track the allocations. The allocator doesn't take ownership of it
+            \param[in] createFunc Creates a page or a dedicated buffer of the requested size
+            \param[in] releaseFunc Releases a page or a dedicated buffer. It's only called once the fence passed the page's allocations, except in the destructor
+        */
+        PagedRingAllocator(size_t pageSize, const FenceType* pFence, CreateFunc createFunc, ReleaseFunc releaseFunc) : mPageSize(pageSize), mpFence(pFence), mCreateFunc(createFunc), mReleaseFunc(releaseFunc)
+        {
+            mPages.push_back(createPage());
+        }
+
+        ~PagedRingAllocator()
+        {
+            for (auto& pPage : mPages)
+            {
+                mReleaseFunc(pPage->data);
+            }
+
+            while (mDedicatedBuffers.size())
+            {
+                mReleaseFunc(mDedicatedBuffers.front().data);
+                mDedicatedBuffers.pop();
+            }
+        }
+
+        /** Allocate a range. The range is valid until the fence passes its current CPU value
+        */
+        Allocation allocate(size_t size, size_t alignment = 1)
+        {
+            // Recycle whatever the GPU is done with. This also retires dedicated buffers and idle pages, which would otherwise only happen when the active page runs out of space
+            releaseCompleted();
+
+            if (size > mPageSize)
+            {
+                return allocateDedicated(size);
+            }
+
+            Allocation alloc = suballocate(mPages[mActivePage].get(), size, alignment);
+            if (alloc.pPage)
+            {
+                return alloc;
+            }
+
+            // The active page is full, look for another page with enough room
+            for (size_t i = 0; i < mPages.size(); i++)
+            {
+                size_t pageIndex = (mActivePage + i) % mPages.size();
+                alloc = suballocate(mPages[pageIndex].get(), size, alignment);
+                if (alloc.pPage)
+                {
+                    mActivePage = pageIndex;
+                    return alloc;
+                }
+            }
+
+            // Everything is in-flight, grow
+            mPages.push_back(createPage());
+            mActivePage = mPages.size() - 1;
+            return suballocate(mPages[mActivePage].get(), size, alignment);
+        }
+
+        /** Recycle the memory the GPU is done with, and release idle pages and completed dedicated buffers. Called automatically by allocate()
+        */
+        void releaseCompleted()
+        {
+            // Nothing can be recycled until the GPU makes progress. This keeps the per-allocation cost down to a single fence query
+            uint64_t gpuValue = mpFence->getGpuValue();
+            if (gpuValue == mLastGpuValue)
+            {
+                return;
+            }
+            mLastGpuValue = gpuValue;
+
+            for (auto& pPage : mPages)
+            {
+                pPage->ring.releaseCompleted();
+            }
+
+            while (mDedicatedBuffers.size() && mDedicatedBuffers.front().fenceValue < gpuValue)
+            {
+                mReleaseFunc(mDedicatedBuffers.front().data);
+                mDedicatedBuffers.pop();
+            }
+
+            releaseIdlePages(gpuValue);
+        }
+
+        size_t getPageSize() const { return mPageSize; }
+        uint32_t getPageCount() const { return (uint32_t)mPages.size(); }
+        uint32_t getDedicatedBufferCount() const { return (uint32_t)mDedicatedBuffers.size(); }
+
+        /** Get the page allocations are tried first
+        */
+        const PageType& getActivePage() const { return mPages[mActivePage]->data; }
+
+    private:
+        struct Page
+        {
+            Page(size_t size, const FenceType* pFence) : ring(size, pFence) {}
+            RingAllocator<FenceType> ring;
+            PageType data;
+            uint64_t lastFenceValue = 0;    ///< The fence's CPU value at the time of the last allocation from the page
+        };
+
+        struct DedicatedBuffer
+        {
+            uint64_t fenceValue;
+            PageType data;
+        };
+
+        std::unique_ptr<Page> createPage() const
+        {
+            std::unique_ptr<Page> pPage = std::make_unique<Page>(mPageSize, mpFence);
+            pPage->data = mCreateFunc(mPageSize);
+            return pPage;
+        }
+
+        Allocation allocateDedicated(size_t size)
+        {
+            mDedicatedBuffers.push({ mpFence->getCpuValue(), mCreateFunc(size) });
+            Allocation alloc;
+            alloc.pPage = &mDedicatedBuffers.back().data;
+            return alloc;
+        }
+
+        Allocation suballocate(Page* pPage, size_t size, size_t alignment)
+        {
+            Allocation alloc;
+            size_t offset = pPage->ring.allocate(size, alignment);
+            if (offset != RingAllocator<FenceType>::kInvalidOffset)
+            {
+                alloc.pPage = &pPage->data;
+                alloc.offset = offset;
+                pPage->lastFenceValue = mpFence->getCpuValue();
+            }
+            return alloc;
+        }
+
+        void releaseIdlePages(uint64_t gpuValue)
+        {
+            for (size_t i = mPages.size(); i-- > kRetainedPageCount;)
+            {
+                Page* pPage = mPages[i].get();
+                if (pPage->ring.getUsedSize() == 0 && gpuValue > pPage->lastFenceValue + kIdlePageFenceCount)
+                {
+                    mReleaseFunc(pPage->data);
+                    mPages.erase(mPages.begin() + i);
+                    if (mActivePage >= i)
+                    {
+                        mActivePage = (mActivePage > i) ? mActivePage - 1 : 0;
+                    }
+                }
+            }
+        }
+
+        size_t mPageSize;
+        const FenceType* mpFence;
+        CreateFunc mCreateFunc;
+        ReleaseFunc mReleaseFunc;
+        std::vector<std::unique_ptr<Page>> mPages;
+        size_t mActivePage = 0;
+        uint64_t mLastGpuValue = 0;
+        std::queue<DedicatedBuffer> mDedicatedBuffers;
+    };
+}
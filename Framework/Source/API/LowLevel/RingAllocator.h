@@ -0,0 +1,157 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <deque>
+
+namespace Falcor
+{
+    /** Fence-tracked linear allocator over a fixed-size ring.
+        The allocator only manages offsets, it doesn't own any memory. Allocations are tagged with the fence's CPU value at the time of the allocation, and the range is recycled once the fence's GPU value passes that value.
+        FenceType should provide getCpuValue() and getGpuValue(). It's usually GpuFence, unit-tests can use a CPU-only fence instead
+    */
+    template<typename FenceType>
+    class RingAllocator
+    {
+    public:
+        static const size_t kInvalidOffset = size_t(-1);
+
+        /** Constructor
+            \param[in] capacity The size of the ring in bytes
+            \param[in] pFence The fence used to track the allocations. The allocator doesn't take ownership of it
+        */
+        RingAllocator(size_t capacity, const FenceType* pFence) : mCapacity(capacity), mpFence(pFence) {}
+
+        /** Allocate a range from the ring. The range is valid until the fence passes its current CPU value
+            \param[in] size The size of the allocation in bytes
+            \param[in] alignment The required alignment of the returned offset
+            \return The offset of the allocation from the start of the ring, or kInvalidOffset if the ring doesn't have enough contiguous free space
+        */
+        size_t allocate(size_t size, size_t alignment = 1)
+        {
+            if (size == 0 || size > mCapacity || (mUsedSize > 0 && mHead == mTail))
+            {
+                return kInvalidOffset;
+            }
+
+            size_t offset = align_to(alignment, mHead);
+            if (mHead >= mTail)
+            {
+                // The free space is [head, capacity) followed by [0, tail). If it doesn't fit at the end, wrap around and waste the rest of the ring
+                if (offset + size > mCapacity)
+                {
+                    if (size > mTail)
+                    {
+                        return kInvalidOffset;
+                    }
+                    offset = 0;
+                    mWrapCount++;
+                }
+            }
+            else if (offset + size > mTail)
+            {
+                return kInvalidOffset;
+            }
+
+            size_t end = offset + size;
+            size_t consumed = (offset >= mHead) ? (end - mHead) : (mCapacity - mHead + end);
+            mHead = (end == mCapacity) ? 0 : end;
+            mUsedSize += consumed;
+            mPayloadSize += size;
+
+            // Allocations made before the next signal retire together, so they can share a single block
+            uint64_t fenceValue = mpFence->getCpuValue();
+            if (mBlocks.size() && mBlocks.back().fenceValue == fenceValue)
+            {
+                mBlocks.back().end = mHead;
+                mBlocks.back().size += consumed;
+                mBlocks.back().payload += size;
+            }
+            else
+            {
+                mBlocks.push_back({ fenceValue, mHead, consumed, size });
+            }
+            return offset;
+        }
+
+        /** Recycle all the ranges the GPU is done with
+        */
+        void releaseCompleted()
+        {
+            uint64_t gpuValue = mpFence->getGpuValue();
+            while (mBlocks.size() && mBlocks.front().fenceValue < gpuValue)
+            {
+                const Block& block = mBlocks.front();
+                mTail = block.end;
+                mUsedSize -= block.size;
+                mPayloadSize -= block.payload;
+                mBlocks.pop_front();
+            }
+
+            // Once the ring is empty we can restart from the beginning, which saves a wrap-around
+            if (mBlocks.empty())
+            {
+                mHead = 0;
+                mTail = 0;
+            }
+        }
+
+        /** Get the size of the ring in bytes
+        */
+        size_t getCapacity() const { return mCapacity; }
+
+        /** Get the number of bytes that are not available for allocation. This includes alignment and wrap-around padding
+        */
+        size_t getUsedSize() const { return mUsedSize; }
+
+        /** Get the number of bytes the user actually requested for the ranges which are still in-flight
+        */
+        size_t getPayloadSize() const { return mPayloadSize; }
+
+        /** Get the number of times the allocator wrapped around to the start of the ring
+        */
+        uint64_t getWrapCount() const { return mWrapCount; }
+
+    private:
+        struct Block
+        {
+            uint64_t fenceValue;
+            size_t end;
+            size_t size;
+            size_t payload;
+        };
+
+        size_t mCapacity;
+        const FenceType* mpFence;
+        size_t mHead = 0;
+        size_t mTail = 0;
+        size_t mUsedSize = 0;
+        size_t mPayloadSize = 0;
+        uint64_t mWrapCount = 0;
+        std::deque<Block> mBlocks;
+    };
+}
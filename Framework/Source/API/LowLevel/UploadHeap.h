@@ -0,0 +1,84 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#ifdef FALCOR_LOW_LEVEL_API
+#include "GpuFence.h"
+#include "PagedRingAllocator.h"
+
+namespace Falcor
+{
+    /** Staging memory for CPU->GPU copies.
+        The heap is made of persistently mapped upload-heap pages, managed by a PagedRingAllocator tracked by the owning context's fence. Ranges are recycled as soon as the GPU is done copying from them.
+        When no page has room the heap grows by a page. Pages beyond the first PagedRingAllocator::kRetainedPageCount are released once they have been idle for a while, so a burst of uploads doesn't pin memory forever.
+        Requests which are larger than a page get a dedicated buffer which is released once the fence passes
+    */
+    class UploadHeap
+    {
+    public:
+        using SharedPtr = std::shared_ptr<UploadHeap>;
+        using SharedConstPtr = std::shared_ptr<const UploadHeap>;
+
+        struct Allocation
+        {
+            ResourceHandle pResourceHandle = nullptr;
+            GpuAddress gpuAddress = 0;
+            uint8_t* pData = nullptr;
+            uint64_t offset = 0;        ///< The offset of the allocation from the start of the resource
+        };
+
+        /** Create a new heap
+            \param[in] pageSize The size of each page in bytes
+            \param[in] pFence The fence of the command queue which consumes the allocations
+        */
+        static SharedPtr create(size_t pageSize, GpuFence::SharedPtr pFence);
+
+        /** Allocate staging memory. The memory is valid until the fence passes its current CPU value
+        */
+        Allocation allocate(size_t size, size_t alignment = 1);
+
+        /** Recycle the memory the GPU is done with, and release idle pages. Called automatically by allocate()
+        */
+        void releaseCompleted() { mAllocator.releaseCompleted(); }
+
+        size_t getPageSize() const { return mAllocator.getPageSize(); }
+        uint32_t getPageCount() const { return mAllocator.getPageCount(); }
+    private:
+        struct UploadBuffer
+        {
+            ResourceHandle pResourceHandle = nullptr;
+            GpuAddress gpuAddress = 0;
+            uint8_t* pData = nullptr;
+        };
+
+        UploadHeap(size_t pageSize, GpuFence::SharedPtr pFence);
+
+        GpuFence::SharedPtr mpFence;
+        PagedRingAllocator<GpuFence, UploadBuffer> mAllocator;
+    };
+}
+#endif // FALCOR_LOW_LEVEL_API
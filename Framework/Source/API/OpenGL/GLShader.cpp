@@ -76,9 +76,10 @@ namespace Falcor
         safe_delete(pEnum);
     }
 
-    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType shaderType, std::string& log)
+    Shader::SharedPtr Shader::create(const std::string& shaderString, ShaderType shaderType, std::string& log, const unordered_string_set& includeList)
     {
         auto pShader = SharedPtr(new Shader(shaderType));
+        pShader->setIncludeList(includeList);
 
         uint32_t apiHandle = pShader->getApiHandle<uint32_t>();
 
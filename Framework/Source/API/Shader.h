@@ -41,14 +41,16 @@ namespace Falcor
         using SharedPtr = std::shared_ptr<Shader>;
         using SharedConstPtr = std::shared_ptr<const Shader>;
         using ApiHandle = ShaderHandle;
+        using unordered_string_set = std::unordered_set<std::string>;
 
         /** create a shader object
             \param[in] shaderString String containing the shader code.
             \param[in] Type The Type of the shader
             \param[out] log This string will contain the error log message in case shader compilation failed
+            \param[in] includeList Optional. The files included by the shader. Used to validate cached compilation results
             \return If success, a new shader object, otherwise nullptr
         */
-        static SharedPtr create(const std::string& shaderString, ShaderType Type, std::string& log);
+        static SharedPtr create(const std::string& shaderString, ShaderType Type, std::string& log, const unordered_string_set& includeList = unordered_string_set());
         virtual ~Shader();
 
         /** Get the API handle.
@@ -59,7 +61,6 @@ namespace Falcor
         */
         ShaderType getType() const { return mType; }
 
-        using unordered_string_set = std::unordered_set<std::string>;
         /** Set the included file list
         */
         void setIncludeList(const unordered_string_set& includeList) { mIncludeList = includeList; }
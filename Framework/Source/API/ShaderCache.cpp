@@ -0,0 +1,221 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ShaderCache.h"
+#include "Utils/OS.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/BinaryFileStream.h"
+#include <thread>
+#include <mutex>
+#include <cstdio>
+
+namespace Falcor
+{
+    static const uint32_t kEntryMagic = 0x43485346; // 'FSHC'
+    static const uint32_t kEntryVersion = 1;
+    static const char* kEntryExtension = ".shc";
+
+    static ShaderCache::SharedPtr spActiveCache;
+    static std::once_flag sActiveCacheInitFlag;
+
+    static uint64_t hashBytes(const void* pData, size_t size, uint64_t hash)
+    {
+        // 64-bit FNV-1a. It's stable across runs and compilers, which is all we need for file names
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    static const uint64_t kHashBasis = 0xcbf29ce484222325ull;
+    static const uint64_t kValidationBasis = 0x84222325cbf29ce4ull;
+
+    ShaderCache::SharedPtr ShaderCache::create(const std::string& directory)
+    {
+        if (isDirectoryExists(directory) == false && createDirectory(directory) == false)
+        {
+            logWarning("ShaderCache::create() - can't create the cache directory " + directory);
+            return nullptr;
+        }
+        return SharedPtr(new ShaderCache(directory));
+    }
+
+    ShaderCache* ShaderCache::getActive()
+    {
+        // Shaders are compiled on the thread pool, so the default cache can be created from several threads at once
+        std::call_once(sActiveCacheInitFlag, []()
+        {
+#if _ENABLE_SHADER_CACHE
+            spActiveCache = create(getExecutableDirectory() + "/ShaderCache");
+#endif
+        });
+        return spActiveCache.get();
+    }
+
+    void ShaderCache::setActive(const SharedPtr& pCache)
+    {
+        // Make sure the default cache isn't created later on and replaces this one
+        std::call_once(sActiveCacheInitFlag, []() {});
+        spActiveCache = pCache;
+    }
+
+    uint64_t ShaderCache::computeKey(const std::string& source, const std::string& target, uint32_t flags)
+    {
+        uint64_t hash = hashBytes(target.c_str(), target.size(), kHashBasis);
+        hash = hashBytes(&flags, sizeof(flags), hash);
+        return hashBytes(source.c_str(), source.size(), hash);
+    }
+
+    std::string ShaderCache::getEntryPath(uint64_t key) const
+    {
+        char name[17];
+        snprintf(name, arraysize(name), "%016llx", (unsigned long long)key);
+        return mDirectory + "/" + name + kEntryExtension;
+    }
+
+    bool ShaderCache::load(uint64_t key, const std::string& source, std::vector<uint8_t>& blob)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        const std::string path = getEntryPath(key);
+        bool valid = false;
+        float compileTime = 0;
+
+        if (doesFileExist(path))
+        {
+            BinaryFileStream stream(path, BinaryFileStream::Mode::Read);
+            uint32_t magic = 0, version = 0;
+            uint64_t sourceHash = 0, sourceSize = 0;
+            stream >> magic >> version >> sourceHash >> sourceSize >> compileTime;
+
+            // The key is a 64-bit hash, so make sure it's really the same source
+            valid = stream.isGood() && (magic == kEntryMagic) && (version == kEntryVersion);
+            valid = valid && (sourceSize == source.size()) && (sourceHash == hashBytes(source.c_str(), source.size(), kValidationBasis));
+
+            // Check that none of the included files changed since the entry was written
+            uint32_t includeCount = 0;
+            stream >> includeCount;
+            for (uint32_t i = 0; valid && i < includeCount; i++)
+            {
+                uint32_t length = 0;
+                stream >> length;
+                std::string include(length, '\0');
+                stream.read(&include[0], length);
+                int64_t time = 0;
+                stream >> time;
+                valid = stream.isGood() && (time == (int64_t)getFileModifiedTime(include));
+            }
+
+            if (valid)
+            {
+                uint64_t blobSize = 0;
+                stream >> blobSize;
+                blob.resize((size_t)blobSize);
+                stream.read(blob.data(), blob.size());
+                valid = stream.isGood() && blobSize > 0;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats.loadTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        if (valid)
+        {
+            mStats.hitCount++;
+            mStats.savedTime += compileTime;
+        }
+        else
+        {
+            mStats.missCount++;
+        }
+        return valid;
+    }
+
+    void ShaderCache::store(uint64_t key, const std::string& source, const Shader::unordered_string_set& includeList, const void* pBlob, size_t size, float compileTime)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mStatsMutex);
+            mStats.compileTime += compileTime;
+        }
+
+        // Write to a temporary file first, so that a concurrent load never sees a partial entry
+        const std::string path = getEntryPath(key);
+        const std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            BinaryFileStream stream(tempPath, BinaryFileStream::Mode::Write);
+            uint64_t sourceHash = hashBytes(source.c_str(), source.size(), kValidationBasis);
+            stream << kEntryMagic << kEntryVersion << sourceHash << (uint64_t)source.size() << compileTime;
+            stream << (uint32_t)includeList.size();
+            for (const auto& include : includeList)
+            {
+                stream << (uint32_t)include.size();
+                stream.write(include.c_str(), include.size());
+                stream << (int64_t)getFileModifiedTime(include);
+            }
+            stream << (uint64_t)size;
+            stream.write(pBlob, size);
+
+            if (stream.isGood() == false)
+            {
+                stream.remove();
+                logWarning("ShaderCache::store() - failed writing cache entry " + path);
+                return;
+            }
+        }
+
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            // Another thread stored the same entry
+            std::remove(tempPath.c_str());
+        }
+    }
+
+    void ShaderCache::clear()
+    {
+        std::vector<std::string> entries;
+        enumerateFiles(mDirectory + "/*" + kEntryExtension, entries);
+        for (const auto& entry : entries)
+        {
+            std::remove((mDirectory + "/" + entry).c_str());
+        }
+    }
+
+    ShaderCache::Stats ShaderCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        return mStats;
+    }
+
+    void ShaderCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats = Stats();
+    }
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include "API/Shader.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk cache of compiled shader blobs.\n
+        Entries are content-addressed - the key is a hash of the preprocessed shader source (which already contains the define list), the target profile and the compiler flags.
+        Each entry also records the timestamps of the files included by the shader, and an entry is ignored if one of them was modified since the entry was written.\n
+        For D3D, the compiled blob contains the reflection data, so a cache hit skips the compiler completely.
+    */
+    class ShaderCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ShaderCache>;
+        using SharedConstPtr = std::shared_ptr<const ShaderCache>;
+
+        /** Cache statistics
+        */
+        struct Stats
+        {
+            uint32_t hitCount = 0;      ///< Number of shaders loaded from the cache
+            uint32_t missCount = 0;     ///< Number of shaders which had to be compiled
+            float loadTime = 0;         ///< Time spent loading entries, in milliseconds
+            float compileTime = 0;      ///< Time spent compiling shaders which were not found in the cache, in milliseconds
+            float savedTime = 0;        ///< Compilation time of the entries which were loaded from the cache, as recorded when they were created, in milliseconds
+        };
+
+        /** Create a new cache object.
+            \param[in] directory The directory to store the entries in. Will be created if it doesn't exist
+            \return A new object, or nullptr if the directory can't be created
+        */
+        static SharedPtr create(const std::string& directory);
+
+        /** Get the cache used when compiling shaders. If _ENABLE_SHADER_CACHE is set, a cache in the executable directory is created on first use
+            \return The active cache, or nullptr if caching is disabled
+        */
+        static ShaderCache* getActive();
+
+        /** Set the cache used when compiling shaders. Must not be called while programs are being compiled on other threads
+            \param[in] pCache The cache to use. Pass nullptr to disable caching
+        */
+        static void setActive(const SharedPtr& pCache);
+
+        /** Compute the key of a shader
+            \param[in] source The preprocessed shader source
+            \param[in] target The target profile
+            \param[in] flags The compiler flags
+        */
+        static uint64_t computeKey(const std::string& source, const std::string& target, uint32_t flags);
+
+        /** Load a compiled shader.
+            \param[in] key The shader key, created by computeKey()
+            \param[in] source The preprocessed shader source. Used to detect key collisions
+            \param[out] blob On success, the compiled shader
+            \return true if a valid entry was found, otherwise false
+        */
+        bool load(uint64_t key, const std::string& source, std::vector<uint8_t>& blob);
+
+        /** Store a compiled shader.
+            \param[in] key The shader key, created by computeKey()
+            \param[in] source The preprocessed shader source
+            \param[in] includeList The files included by the shader. Their timestamps are used to validate the entry
+            \param[in] pBlob The compiled shader
+            \param[in] size The size of the compiled shader in bytes
+            \param[in] compileTime How long it took to compile the shader, in milliseconds
+        */
+        void store(uint64_t key, const std::string& source, const Shader::unordered_string_set& includeList, const void* pBlob, size_t size, float compileTime);
+
+        /** Remove all the entries from the cache directory
+        */
+        void clear();
+
+        /** Get the statistics since the cache was created or the last call to resetStats()
+        */
+        Stats getStats() const;
+
+        /** Reset the statistics
+        */
+        void resetStats();
+
+        /** Get the cache directory
+        */
+        const std::string& getDirectory() const { return mDirectory; }
+
+    private:
+        ShaderCache(const std::string& directory) : mDirectory(directory) {}
+        std::string getEntryPath(uint64_t key) const;
+
+        std::string mDirectory;
+        mutable std::mutex mStatsMutex;
+        Stats mStats;
+    };
+}
@@ -85,6 +85,7 @@ namespace Falcor
     {
         Buffer::init(nullptr);
         mData.assign(mSize, 0);
+        markDirty(0, mSize);
     }
 
     size_t VariablesBuffer::getVariableOffset(const std::string& varName) const
@@ -96,7 +97,7 @@ namespace Falcor
 
     void VariablesBuffer::uploadToGPU(size_t offset, size_t size) const
     {
-        if(mDirty == false)
+        if(mDirtyBegin >= mDirtyEnd)
         {
             return;
         }
@@ -112,8 +113,21 @@ namespace Falcor
             return;
         }
 
-        updateData(mData.data(), offset, size);
-        mDirty = false;
+        // Mapping a CPU-writable buffer renames it, so the entire range has to be written. Otherwise, only upload what changed
+        size_t first = offset;
+        size_t last = offset + size;
+        if(mCpuAccess != CpuAccess::Write)
+        {
+            first = std::max(first, mDirtyBegin);
+            last = std::min(last, mDirtyEnd);
+        }
+
+        if(first < last)
+        {
+            updateData(mData.data() + first, first, last - first);
+        }
+        mDirtyBegin = -1;
+        mDirtyEnd = 0;
     }
 
     template<typename VarType>
@@ -200,9 +214,9 @@ namespace Falcor
         verify_element_index();
         if(checkVariableByOffset<VarType>(offset, 1, mpReflector.get()))
         {
-            const uint8_t* pVar = mData.data() + offset + elementIndex * mElementSize;
-            *(VarType*)pVar = value;
-            mDirty = true;
+            size_t dstOffset = offset + elementIndex * mElementSize;
+            *(VarType*)(mData.data() + dstOffset) = value;
+            markDirty(dstOffset, sizeof(VarType));
         }
     }
 
@@ -298,13 +312,13 @@ namespace Falcor
         verify_element_index();
         if(checkVariableByOffset<VarType>(offset, count, mpReflector.get()))
         {
-            const uint8_t* pVar = mData.data() + offset;
-            VarType* pData = (VarType*)pVar + elementIndex * mElementSize;
+            size_t dstOffset = offset + elementIndex * mElementSize;
+            VarType* pData = (VarType*)(mData.data() + dstOffset);
             for(size_t i = 0; i < count; i++)
             {
                 pData[i] = pValue[i];
             }
-            mDirty = true;
+            markDirty(dstOffset, sizeof(VarType) * count);
         }
     }
 
@@ -405,7 +419,26 @@ namespace Falcor
             return;
         }
         memcpy(mData.data() + offset, pSrc, size);
-        mDirty = true;
+        markDirty(offset, size);
+    }
+
+    void VariablesBuffer::setLayoutData(const VariablesBufferLayout* pLayout, const void* pSrc, size_t elementIndex)
+    {
+        verify_element_index();
+        if((_LOG_ENABLED != 0) && (pLayout->getDstEnd() > mElementSize))
+        {
+            logError("Error when setting layout data to buffer \"" + mpReflector->getName() + "\". The layout is larger than the buffer element. Ignoring call.");
+            return;
+        }
+
+        const uint8_t* pSrcData = (const uint8_t*)pSrc;
+        uint8_t* pDstData = mData.data() + elementIndex * mElementSize;
+        for(size_t i = 0; i < pLayout->getRangeCount(); i++)
+        {
+            const auto& range = pLayout->getRange(i);
+            memcpy(pDstData + range.dstOffset, pSrcData + range.srcOffset, range.size);
+        }
+        markDirty(elementIndex * mElementSize + pLayout->getDstBegin(), pLayout->getDstEnd() - pLayout->getDstBegin());
     }
 
     bool checkResourceDimension(const Texture* pTexture, const ProgramReflection::Resource* pResourceDesc, const std::string& name, const std::string& bufferName)
@@ -560,7 +593,7 @@ namespace Falcor
 
         if(bOK)
         {
-            mDirty = true;
+            markDirty(offset, sizeof(uint64_t));
             setTextureInternal(offset, pTexture, pSampler);
         }
     }
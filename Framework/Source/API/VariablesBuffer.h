@@ -30,6 +30,7 @@
 #include "ProgramReflection.h"
 #include "Texture.h"
 #include "Buffer.h"
+#include "VariablesBufferLayout.h"
 #include "Graphics/Program.h"
 #include "API/LowLevel/DescriptorHeap.h"
 
@@ -53,6 +54,7 @@ namespace Falcor
         virtual ~VariablesBuffer() = 0;
 
         /** Apply the changes to the actual GPU buffer.
+        Only the range which was modified since the last upload is copied. Buffers which are renamed on update (CPU-writable buffers) upload the entire requested range, since the new copy must be complete.
         Note that it is possible to use this function to update only part of the GPU copy of the buffer. This might lead to inconsistencies between the GPU and CPU buffer, so make sure you know what you are doing.
         \param[in] offset Offset into the buffer to write to
         \param[in] size   Number of bytes to upload. If this value is -1, will update the [Offset, EndOfBuffer] range.
@@ -71,6 +73,14 @@ namespace Falcor
         */
         void setBlob(const void* pSrc, size_t offset, size_t size);
 
+        /** Set a struct into the buffer using a compiled binding layout.\n
+        All the variable lookups were done when the layout was created, so this is a plain copy of the layout ranges. Use it for data which is set every frame.
+        \param[in] pLayout The layout. Must be created from the same reflection object as the buffer
+        \param[in] pSrc Pointer to the source struct. Must contain at least pLayout->getRequiredSrcSize() bytes
+        \param[in] elementIndex Optional. The index of the element to write into
+        */
+        void setLayoutData(const VariablesBufferLayout* pLayout, const void* pSrc, size_t elementIndex = 0);
+
         /** Get a variable offset inside the buffer. See notes about naming in the VariablesBuffer class description. Constant name can be provided with an implicit array-index, similar to VariablesBuffer#SetVariableArray.
         */
         size_t getVariableOffset(const std::string& varName) const;
@@ -102,9 +112,18 @@ namespace Falcor
 
         void setTextureInternal(size_t offset, const Texture* pTexture, const Sampler* pSampler);
 
+        /** Extend the range which will be uploaded on the next call to uploadToGPU()
+        */
+        void markDirty(size_t offset, size_t size)
+        {
+            mDirtyBegin = std::min(mDirtyBegin, offset);
+            mDirtyEnd = std::max(mDirtyEnd, offset + size);
+        }
+
         ProgramReflection::BufferReflection::SharedConstPtr mpReflector;
         std::vector<uint8_t> mData;
-        mutable bool mDirty = true;
+        mutable size_t mDirtyBegin = -1;
+        mutable size_t mDirtyEnd = 0;
         size_t mElementCount;
         size_t mElementSize;
     };
@@ -0,0 +1,101 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VariablesBufferLayout.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    VariablesBufferLayout::SharedPtr VariablesBufferLayout::create(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::vector<Field>& fields, size_t baseOffset)
+    {
+        if(pReflector == nullptr)
+        {
+            logError("VariablesBufferLayout::create() - reflection object is null");
+            return nullptr;
+        }
+
+        std::vector<Range> ranges;
+        ranges.reserve(fields.size());
+        for(const auto& field : fields)
+        {
+            size_t offset;
+            const auto* pVar = pReflector->getVariableData(field.name, offset, true);
+            if(pVar == nullptr || offset == ProgramReflection::kInvalidLocation)
+            {
+                logError("VariablesBufferLayout::create() - can't find variable \"" + field.name + "\" in buffer \"" + pReflector->getName() + "\"");
+                return nullptr;
+            }
+
+            offset += baseOffset;
+            if(offset + field.size > pReflector->getRequiredSize())
+            {
+                logError("VariablesBufferLayout::create() - field \"" + field.name + "\" is out-of-bound of buffer \"" + pReflector->getName() + "\"");
+                return nullptr;
+            }
+            ranges.push_back({field.srcOffset, offset, field.size});
+        }
+
+        // Sort the ranges by their source offset, so that adjacent fields can be merged
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {return a.srcOffset < b.srcOffset; });
+
+        SharedPtr pLayout = SharedPtr(new VariablesBufferLayout(pReflector));
+        for(const auto& r : ranges)
+        {
+            pLayout->addRange(r.srcOffset, r.dstOffset, r.size);
+        }
+        return pLayout;
+    }
+
+    VariablesBufferLayout::SharedPtr VariablesBufferLayout::create(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& firstVarName, size_t size)
+    {
+        return create(pReflector, {{firstVarName, 0, size}});
+    }
+
+    void VariablesBufferLayout::addRange(size_t srcOffset, size_t dstOffset, size_t size)
+    {
+        if(size == 0)
+        {
+            return;
+        }
+
+        mDstBegin = std::min(mDstBegin, dstOffset);
+        mDstEnd = std::max(mDstEnd, dstOffset + size);
+        mSrcSize = std::max(mSrcSize, srcOffset + size);
+
+        if(mRanges.size())
+        {
+            Range& last = mRanges.back();
+            if((last.srcOffset + last.size == srcOffset) && (last.dstOffset + last.size == dstOffset))
+            {
+                last.size += size;
+                return;
+            }
+        }
+        mRanges.push_back({srcOffset, dstOffset, size});
+    }
+}
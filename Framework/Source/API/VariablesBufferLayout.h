@@ -0,0 +1,114 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "ProgramReflection.h"
+
+namespace Falcor
+{
+    /** A compiled binding layout. Maps fields of a CPU-side struct onto variables of a buffer described by a BufferReflection.\n
+        The variable names are resolved once, when the layout is created. Setting the struct into a buffer using VariablesBuffer#setLayoutData() is then a
+        plain copy of the resolved ranges, without any string building or reflection lookups. Fields which are contiguous both in the struct and in the buffer
+        are merged into a single range, so a struct which matches the shader declaration is written with a single memcpy.\n
+        A layout can be used with any buffer created from the same reflection object.
+    */
+    class VariablesBufferLayout
+    {
+    public:
+        using SharedPtr = std::shared_ptr<VariablesBufferLayout>;
+        using SharedConstPtr = std::shared_ptr<const VariablesBufferLayout>;
+
+        /** Describes a single field of the source struct
+        */
+        struct Field
+        {
+            std::string name;   ///< The variable name inside the buffer. See the naming rules in the VariablesBuffer class description
+            size_t srcOffset;   ///< Byte offset of the field inside the source struct
+            size_t size;        ///< Number of bytes to copy
+        };
+
+        /** A resolved copy range
+        */
+        struct Range
+        {
+            size_t srcOffset;   ///< Byte offset inside the source struct
+            size_t dstOffset;   ///< Byte offset inside a buffer element
+            size_t size;        ///< Number of bytes
+        };
+
+        /** Create a new layout.
+            \param[in] pReflector The reflection object of the buffers the layout will be used with
+            \param[in] fields List of fields to resolve
+            \param[in] baseOffset Optional. Added to all the destination offsets. Useful when a struct is set into an array element
+            \return A new object, or nullptr if one of the fields can't be found in the buffer or is out-of-bound. In that case an error will be logged
+        */
+        static SharedPtr create(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::vector<Field>& fields, size_t baseOffset = 0);
+
+        /** Create a layout which copies a contiguous block of data to a variable. This is the common case of a CPU struct which matches the shader declaration.
+            \param[in] pReflector The reflection object of the buffers the layout will be used with
+            \param[in] firstVarName The name of the first variable of the struct in the buffer
+            \param[in] size The size of the struct in bytes
+            \return A new object, or nullptr if the variable can't be found in the buffer or the struct is out-of-bound. In that case an error will be logged
+        */
+        static SharedPtr create(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& firstVarName, size_t size);
+
+        /** Get the reflection object the layout was created with
+        */
+        const ProgramReflection::BufferReflection::SharedConstPtr& getBufferReflector() const { return mpReflector; }
+
+        /** Get the number of copy ranges
+        */
+        size_t getRangeCount() const { return mRanges.size(); }
+
+        /** Get a copy range
+        */
+        const Range& getRange(size_t index) const { return mRanges[index]; }
+
+        /** Get the first byte inside the buffer element which is written by the layout
+        */
+        size_t getDstBegin() const { return mDstBegin; }
+
+        /** Get the end of the range inside the buffer element which is written by the layout (one byte past the last written byte)
+        */
+        size_t getDstEnd() const { return mDstEnd; }
+
+        /** Get the size of the source struct required by the layout
+        */
+        size_t getRequiredSrcSize() const { return mSrcSize; }
+    private:
+        VariablesBufferLayout(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector) : mpReflector(pReflector) {}
+        void addRange(size_t srcOffset, size_t dstOffset, size_t size);
+
+        ProgramReflection::BufferReflection::SharedConstPtr mpReflector;
+        std::vector<Range> mRanges;
+        size_t mDstBegin = -1;
+        size_t mDstEnd = 0;
+        size_t mSrcSize = 0;
+    };
+}
@@ -184,6 +184,9 @@ namespace Falcor
             pProg->removeDefine("HAS_TEXCRD");
             pProg->removeDefine("HAS_COLORS");
             pProg->removeDefine("HAS_LIGHTMAP_UV");
+            pProg->removeDefine("QUANTIZED_POSITIONS");
+            pProg->removeDefine("PACKED_NORMALS");
+            pProg->removeDefine("PACKED_BITANGENTS");
 
             for (const auto& l : mpBufferLayouts)
             {
@@ -203,6 +206,20 @@ namespace Falcor
                         {
                             pProg->addDefine("HAS_COLORS");
                         }
+
+                        // Quantized attributes, see VertexQuantization
+                        if (l->getElementShaderLocation(i) == VERTEX_POSITION_LOC && l->getElementFormat(i) == ResourceFormat::RGBA16Unorm)
+                        {
+                            pProg->addDefine("QUANTIZED_POSITIONS");
+                        }
+                        if (l->getElementShaderLocation(i) == VERTEX_NORMAL_LOC && l->getElementFormat(i) == ResourceFormat::RGB10A2Unorm)
+                        {
+                            pProg->addDefine("PACKED_NORMALS");
+                        }
+                        if (l->getElementShaderLocation(i) == VERTEX_BITANGENT_LOC && l->getElementFormat(i) == ResourceFormat::RGB10A2Unorm)
+                        {
+                            pProg->addDefine("PACKED_BITANGENTS");
+                        }
                     }
                 }
             }
@@ -365,6 +365,21 @@ struct LightData
     MaterialData    material;                                     ///< Emissive material of the geometry mesh
 };
 
+/**
+    This stores the description of the light cluster grid, see LightClusters.h
+*/
+struct LightClusterData
+{
+    uint32_t        tilesX             DEFAULTS(16);              ///< Number of clusters along the screen's x axis
+    uint32_t        tilesY             DEFAULTS(8);               ///< Number of clusters along the screen's y axis
+    uint32_t        slices             DEFAULTS(24);              ///< Number of clusters along the view depth. The slices are exponentially distributed between the near and the far planes
+    uint32_t        globalLightCount   DEFAULTS(0);               ///< Number of lights which affect every cluster. They are stored first in the light buffer
+    float           nearZ              DEFAULTS(0.1f);            ///< View depth of the first slice
+    float           sliceScale         DEFAULTS(1.f);             ///< slice = log(depth / nearZ) * sliceScale
+    uint32_t        lightCount         DEFAULTS(0);               ///< Total number of lights in the light buffer
+    float           pad;
+};
+
 /*******************************************************************
                     Shared material routines
 *******************************************************************/
@@ -45,33 +45,163 @@ cbuffer InternalPerFrameCB : register(b10)
     uint32_t gLightsCount;
     vec3 pad;
     LightData gLights[MAX_LIGHT_SOURCES];
+    LightClusterData gLightClusterGrid;     // Unbounded light count, see getLightClusterIndex()
 };
 
 cbuffer InternalPerMeshCB : register(b11)
 {
-    mat4 gWorldMat[64]; // If the mesh has bones, these are the bones matrices
-    mat3 gWorldInvTransposeMat[64]; // Per-instance matrices for transforming normals
     uint32_t gDrawId[64]; // Zero-based order/ID of Mesh Instances drawn per SceneRenderer::renderScene call.
     uint32_t gMeshId;
+    uint4 gInstanceTransformId[16]; // Per-instance slot in gInstanceTransforms, or the first bone in gBonePalette for skinned meshes. 4 instances per element
+    vec3 gPositionScale;            // Transform from quantized positions to object space. See Mesh::getPositionScale()
+    vec3 gPositionOffset;
 };
 
+// The world and normal matrices of all the mesh instances in the scene. See SceneTransformBuffer::InstanceTransform
+ByteAddressBuffer gInstanceTransforms;
+
+#define INSTANCE_TRANSFORM_SIZE 112
+
+uint getInstanceTransformId(uint instanceID)
+{
+    return gInstanceTransformId[instanceID >> 2][instanceID & 3];
+}
+
+// The matrices are stored column-major
+mat4 getInstanceWorldMat(uint instanceID)
+{
+    uint offset = getInstanceTransformId(instanceID) * INSTANCE_TRANSFORM_SIZE;
+    float4 c0 = asfloat(gInstanceTransforms.Load4(offset));
+    float4 c1 = asfloat(gInstanceTransforms.Load4(offset + 16));
+    float4 c2 = asfloat(gInstanceTransforms.Load4(offset + 32));
+    float4 c3 = asfloat(gInstanceTransforms.Load4(offset + 48));
+    return transpose(float4x4(c0, c1, c2, c3));
+}
+
+mat3 getInstanceWorldInvTransposeMat(uint instanceID)
+{
+    uint offset = getInstanceTransformId(instanceID) * INSTANCE_TRANSFORM_SIZE + 64;
+    float3 c0 = asfloat(gInstanceTransforms.Load3(offset));
+    float3 c1 = asfloat(gInstanceTransforms.Load3(offset + 16));
+    float3 c2 = asfloat(gInstanceTransforms.Load3(offset + 32));
+    return transpose(float3x3(c0, c1, c2));
+}
+
+// The bone matrices of all the skinned model instances, with the instance transforms applied. See SceneBonePalette
+ByteAddressBuffer gBonePalette;
+
+// The normal matrices of the bones, in the same layout
+ByteAddressBuffer gBoneNormalPalette;
+
+#define BONE_TRANSFORM_SIZE 48
+
+// The matrices are stored as 3 rows, the last row is (0, 0, 0, 1)
+mat4 loadBoneMat(uint boneIndex)
+{
+    uint offset = boneIndex * BONE_TRANSFORM_SIZE;
+    float4 r0 = asfloat(gBonePalette.Load4(offset));
+    float4 r1 = asfloat(gBonePalette.Load4(offset + 16));
+    float4 r2 = asfloat(gBonePalette.Load4(offset + 32));
+    return float4x4(r0, r1, r2, float4(0, 0, 0, 1));
+}
+
+mat3 loadBoneNormalMat(uint boneIndex)
+{
+    uint offset = boneIndex * BONE_TRANSFORM_SIZE;
+    float3 r0 = asfloat(gBoneNormalPalette.Load3(offset));
+    float3 r1 = asfloat(gBoneNormalPalette.Load3(offset + 16));
+    float3 r2 = asfloat(gBoneNormalPalette.Load3(offset + 32));
+    return float3x3(r0, r1, r2);
+}
+
+// The scene's lights, LIGHT_DATA_SIZE bytes each. The material isn't stored. See LightClusters::getLightBuffer()
+ByteAddressBuffer gClusterLights;
+
+// A uint2(first, count) range per cluster, followed by the light indices of all the clusters
+ByteAddressBuffer gLightClusters;
+
+#define LIGHT_DATA_SIZE 176
+
+// The material is left uninitialized, none of the light evaluation routines use it
+LightData loadClusterLight(uint lightIndex)
+{
+    uint offset = lightIndex * LIGHT_DATA_SIZE;
+    LightData light;
+    float4 v = asfloat(gClusterLights.Load4(offset));
+    light.worldPos = v.xyz;
+    light.type = asuint(v.w);
+    v = asfloat(gClusterLights.Load4(offset + 16));
+    light.worldDir = v.xyz;
+    light.openingAngle = v.w;
+    v = asfloat(gClusterLights.Load4(offset + 32));
+    light.intensity = v.xyz;
+    light.cosOpeningAngle = v.w;
+    v = asfloat(gClusterLights.Load4(offset + 48));
+    light.aabbMin = v.xyz;
+    light.penumbraAngle = v.w;
+    v = asfloat(gClusterLights.Load4(offset + 64));
+    light.aabbMax = v.xyz;
+    light.surfaceArea = v.w;
+    v = asfloat(gClusterLights.Load4(offset + 80));
+    light.tangent = v.xyz;
+    light.numIndices = asuint(v.w);
+    v = asfloat(gClusterLights.Load4(offset + 96));
+    light.bitangent = v.xyz;
+    light.pad = v.w;
+    float4 c0 = asfloat(gClusterLights.Load4(offset + 112));
+    float4 c1 = asfloat(gClusterLights.Load4(offset + 128));
+    float4 c2 = asfloat(gClusterLights.Load4(offset + 144));
+    float4 c3 = asfloat(gClusterLights.Load4(offset + 160));
+    light.transMat = transpose(float4x4(c0, c1, c2, c3));
+    return light;
+}
+
+/** Find the cluster containing a world-space position. evalSceneLights() in Shading.h does the following:
+        for(uint i = 0; i < gLightClusterGrid.globalLightCount; i++) { evalMaterial(shAttr, loadClusterLight(i), ...); }
+        uint2 range = getLightClusterRange(getLightClusterIndex(posW));
+        for(uint i = 0; i < range.y; i++) { evalMaterial(shAttr, loadClusterLight(getLightClusterLightIndex(range.x + i)), ...); }
+*/
+uint getLightClusterIndex(float3 posW)
+{
+    float4 posH = mul(gCam.viewProjMat, float4(posW, 1));
+    float2 ndc = posH.xy / posH.w;
+    uint x = min(uint(saturate(ndc.x * 0.5 + 0.5) * gLightClusterGrid.tilesX), gLightClusterGrid.tilesX - 1);
+    uint y = min(uint(saturate(ndc.y * 0.5 + 0.5) * gLightClusterGrid.tilesY), gLightClusterGrid.tilesY - 1);
+    float depth = -mul(gCam.viewMat, float4(posW, 1)).z;
+    uint slice = uint(clamp(log(depth / gLightClusterGrid.nearZ) * gLightClusterGrid.sliceScale, 0, gLightClusterGrid.slices - 1));
+    return x + gLightClusterGrid.tilesX * (y + gLightClusterGrid.tilesY * slice);
+}
+
+uint2 getLightClusterRange(uint cluster)
+{
+    return gLightClusters.Load2(cluster * 8);
+}
+
+uint getLightClusterLightIndex(uint index)
+{
+    uint clusterCount = gLightClusterGrid.tilesX * gLightClusterGrid.tilesY * gLightClusterGrid.slices;
+    return gLightClusters.Load((clusterCount * 2 + index) * 4);
+}
+
 #ifdef _VERTEX_BLENDING
-mat4 getBlendedWorldMat(vec4 weights, uint4 ids)
+mat4 getBlendedWorldMat(vec4 weights, uint4 ids, uint instanceID)
 {
-    mat4 worldMat = gWorldMat[ids.x] * weights.x;
-    worldMat += gWorldMat[ids.y] * weights.y;
-    worldMat += gWorldMat[ids.z] * weights.z;
-    worldMat += gWorldMat[ids.w] * weights.w;
+    uint firstBone = getInstanceTransformId(instanceID);
+    mat4 worldMat = loadBoneMat(firstBone + ids.x) * weights.x;
+    worldMat += loadBoneMat(firstBone + ids.y) * weights.y;
+    worldMat += loadBoneMat(firstBone + ids.z) * weights.z;
+    worldMat += loadBoneMat(firstBone + ids.w) * weights.w;
 
     return worldMat;
 }
 
-mat3 getBlendedInvTransposeWorldMat(vec4 weights, uint4 ids)
+mat3 getBlendedInvTransposeWorldMat(vec4 weights, uint4 ids, uint instanceID)
 {
-    mat3 mat = gWorldInvTransposeMat[ids.x] * weights.x;
-    mat += gWorldInvTransposeMat[ids.y] * weights.y;
-    mat += gWorldInvTransposeMat[ids.z] * weights.z;
-    mat += gWorldInvTransposeMat[ids.w] * weights.w;
+    uint firstBone = getInstanceTransformId(instanceID);
+    mat3 mat = loadBoneNormalMat(firstBone + ids.x) * weights.x;
+    mat += loadBoneNormalMat(firstBone + ids.y) * weights.y;
+    mat += loadBoneNormalMat(firstBone + ids.z) * weights.z;
+    mat += loadBoneNormalMat(firstBone + ids.w) * weights.w;
 
     return mat;
 }
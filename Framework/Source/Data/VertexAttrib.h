@@ -93,12 +93,40 @@ struct VS_OUT
 #endif
 };
 
+// Decode the vertex attributes. The model importers can quantize them, see VertexQuantization.h
+float4 getVertexPosition(VS_IN vIn)
+{
+#ifdef QUANTIZED_POSITIONS
+    return float4(vIn.pos.xyz * gPositionScale + gPositionOffset, 1);
+#else
+    return vIn.pos;
+#endif
+}
+
+float3 getVertexNormal(VS_IN vIn)
+{
+#ifdef PACKED_NORMALS
+    return vIn.normal * 2 - 1;
+#else
+    return vIn.normal;
+#endif
+}
+
+float3 getVertexBitangent(VS_IN vIn)
+{
+#ifdef PACKED_BITANGENTS
+    return vIn.bitangent * 2 - 1;
+#else
+    return vIn.bitangent;
+#endif
+}
+
 float4x4 getWorldMat(VS_IN vIn)
 {
 #ifdef _VERTEX_BLENDING
-    float4x4 worldMat = getBlendedWorldMat(vIn.boneWeights, vIn.boneIds);
+    float4x4 worldMat = getBlendedWorldMat(vIn.boneWeights, vIn.boneIds, vIn.instanceID);
 #else
-    float4x4 worldMat = gWorldMat[vIn.instanceID];
+    float4x4 worldMat = getInstanceWorldMat(vIn.instanceID);
 #endif
     return worldMat;
 }
@@ -106,9 +134,9 @@ float4x4 getWorldMat(VS_IN vIn)
 float3x3 getWorldInvTransposeMat(VS_IN vIn)
 {
 #ifdef _VERTEX_BLENDING
-    float3x3 worldInvTransposeMat = getBlendedInvTransposeWorldMat(vIn.boneWeights, vIn.boneIds);
+    float3x3 worldInvTransposeMat = getBlendedInvTransposeWorldMat(vIn.boneWeights, vIn.boneIds, vIn.instanceID);
 #else
-    float3x3 worldInvTransposeMat = gWorldInvTransposeMat[vIn.instanceID];
+    float3x3 worldInvTransposeMat = getInstanceWorldInvTransposeMat(vIn.instanceID);
 #endif
     return worldInvTransposeMat;
 }
@@ -117,7 +145,7 @@ VS_OUT defaultVS(VS_IN vIn)
 {
     VS_OUT vOut;
     float4x4 worldMat = getWorldMat(vIn);
-    float4 posW = mul(worldMat, vIn.pos);
+    float4 posW = mul(worldMat, getVertexPosition(vIn));
     vOut.posW = posW.xyz;
     vOut.posH = mul(gCam.viewProjMat, posW);
 
@@ -133,8 +161,8 @@ VS_OUT defaultVS(VS_IN vIn)
     vOut.colorV = 0;
 #endif
 
-    vOut.normalW = mul(getWorldInvTransposeMat(vIn), vIn.normal).xyz;
-    vOut.bitangentW = mul((float3x3)worldMat, vIn.bitangent).xyz;
+    vOut.normalW = mul(getWorldInvTransposeMat(vIn), getVertexNormal(vIn)).xyz;
+    vOut.bitangentW = mul((float3x3)worldMat, getVertexBitangent(vIn)).xyz;
     vOut.prevPosH = mul(gCam.prevViewProjMat, posW);
 
 #ifdef _SINGLE_PASS_STEREO
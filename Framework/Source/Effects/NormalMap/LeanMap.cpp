@@ -29,22 +29,200 @@
 #include "LeanMap.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Scene/Scene.h"
+#include "Graphics/TextureHelper.h"
 #include "API/Device.h"
+#include "Utils/OS.h"
+#include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include <immintrin.h>
 
 namespace Falcor
 {
-    Texture::SharedPtr LeanMap::createFromNormalMap(const Falcor::Texture* pNormalMap)
+    namespace
     {
-        uint32_t texW = pNormalMap->getWidth();
-        uint32_t texH = pNormalMap->getHeight();
+        const float kEpsilon = 1e-3f;
+        const uint32_t kTexelsPerChunk = 1 << 16;
 
-        std::vector<vec4> leanData;
+        /** Channel order and color space of the supported normal map formats
+        */
+        template<ResourceFormat format> struct NormalMapFormat;
+        template<> struct NormalMapFormat<ResourceFormat::RGBA8Unorm>     { static const uint32_t kRed = 0; static const uint32_t kBlue = 2; static const bool kSrgb = false; };
+        template<> struct NormalMapFormat<ResourceFormat::BGRA8Unorm>     { static const uint32_t kRed = 2; static const uint32_t kBlue = 0; static const bool kSrgb = false; };
+        template<> struct NormalMapFormat<ResourceFormat::BGRX8Unorm>     { static const uint32_t kRed = 2; static const uint32_t kBlue = 0; static const bool kSrgb = false; };
+        template<> struct NormalMapFormat<ResourceFormat::RGBA8UnormSrgb> { static const uint32_t kRed = 0; static const uint32_t kBlue = 2; static const bool kSrgb = true; };
+        template<> struct NormalMapFormat<ResourceFormat::BGRA8UnormSrgb> { static const uint32_t kRed = 2; static const uint32_t kBlue = 0; static const bool kSrgb = true; };
 
-        leanData.resize(texW * texH);
+        /** Decoded channel values, indexed by the 8-bit texel value. Computed the same way as the reference implementation, so that the results match bit for bit
+        */
+        struct DecodeTable
+        {
+            float values[256];
 
-        uint32_t normalMapDataSize = pNormalMap->getMipLevelDataSize(0);
-        auto normalMapData = gpDevice->getRenderContext()->readTextureSubresource(pNormalMap, 0);
+            DecodeTable(bool srgb)
+            {
+                const float oneBy255 = 1.0f / 255.0f;
+                for(uint32_t i = 0; i < 256; i++)
+                {
+                    values[i] = srgb ? clamp(SRGBToLinear(oneBy255 * (float)i), 0.0f, 1.0f) : clamp(oneBy255 * (float)i, 0.0f, 1.0f);
+                }
+            }
+        };
+
+        const DecodeTable& getDecodeTable(bool srgb)
+        {
+            static const DecodeTable kLinear(false);
+            static const DecodeTable kSrgb(true);
+            return srgb ? kSrgb : kLinear;
+        }
+
+        // Same operations, in the same order, as the SIMD path below and the reference implementation
+        vec4 computeLeanTexel(const vec3& tn)
+        {
+            vec3 n = tn * 2.f - vec3(1.f);
+            n.z = max(n.z, kEpsilon);
+            n = normalize(n);
+
+            vec2 b = vec2(n.x, n.y) / max(n.z, kEpsilon);
+            vec2 m = b * b;
+            return vec4(b.x * 0.5f + 0.5f, b.y * 0.5f + 0.5f, m.x, m.y);
+        }
+
+        /** Decode 4 texels into channel vectors
+        */
+        template<ResourceFormat format>
+        void decodeTexels(const uint8_t* pTexels, const float* pTable, __m128& r, __m128& g, __m128& b)
+        {
+            using Format = NormalMapFormat<format>;
+            if(Format::kSrgb)
+            {
+                // sRGB decoding isn't worth doing in SIMD, look up the 12 values
+                r = _mm_setr_ps(pTable[pTexels[Format::kRed]], pTable[pTexels[4 + Format::kRed]], pTable[pTexels[8 + Format::kRed]], pTable[pTexels[12 + Format::kRed]]);
+                g = _mm_setr_ps(pTable[pTexels[1]], pTable[pTexels[5]], pTable[pTexels[9]], pTable[pTexels[13]]);
+                b = _mm_setr_ps(pTable[pTexels[Format::kBlue]], pTable[pTexels[4 + Format::kBlue]], pTable[pTexels[8 + Format::kBlue]], pTable[pTexels[12 + Format::kBlue]]);
+            }
+            else
+            {
+                // Widen the bytes to 32-bit integers, one texel per register, then transpose into channels
+                const __m128i zero = _mm_setzero_si128();
+                __m128i bytes = _mm_loadu_si128((const __m128i*)pTexels);
+                __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+                __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+                __m128 t0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+                __m128 t1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+                __m128 t2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+                __m128 t3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+                _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+
+                const __m128 oneBy255 = _mm_set1_ps(1.0f / 255.0f);
+                const __m128 zeroF = _mm_setzero_ps();
+                const __m128 one = _mm_set1_ps(1.0f);
+                __m128 channels[3] = { t0, t1, t2 };
+                r = _mm_min_ps(_mm_max_ps(_mm_mul_ps(oneBy255, channels[Format::kRed]), zeroF), one);
+                g = _mm_min_ps(_mm_max_ps(_mm_mul_ps(oneBy255, channels[1]), zeroF), one);
+                b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(oneBy255, channels[Format::kBlue]), zeroF), one);
+            }
+        }
+
+        template<ResourceFormat format>
+        void computeLeanRows(const uint8_t* pNormalMap, uint32_t width, uint32_t firstRow, uint32_t lastRow, vec4* pLeanData)
+        {
+            using Format = NormalMapFormat<format>;
+            const float* pTable = getDecodeTable(Format::kSrgb).values;
+
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 two = _mm_set1_ps(2.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 epsilon = _mm_set1_ps(kEpsilon);
+
+            for(uint32_t y = firstRow; y < lastRow; y++)
+            {
+                const uint8_t* pRow = pNormalMap + (size_t)y * width * 4;
+                vec4* pLeanRow = pLeanData + (size_t)y * width;
+
+                uint32_t x = 0;
+                for(; x + 4 <= width; x += 4)
+                {
+                    __m128 nx, ny, nz;
+                    decodeTexels<format>(pRow + x * 4, pTable, nx, ny, nz);
+
+                    // Unpack and normalize
+                    nx = _mm_sub_ps(_mm_mul_ps(nx, two), one);
+                    ny = _mm_sub_ps(_mm_mul_ps(ny, two), one);
+                    nz = _mm_max_ps(_mm_sub_ps(_mm_mul_ps(nz, two), one), epsilon);
+                    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+                    __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+                    nx = _mm_mul_ps(nx, invLength);
+                    ny = _mm_mul_ps(ny, invLength);
+                    nz = _mm_max_ps(_mm_mul_ps(nz, invLength), epsilon);
+
+                    // The first and second moments in slope space
+                    __m128 bx = _mm_div_ps(nx, nz);
+                    __m128 by = _mm_div_ps(ny, nz);
+                    __m128 c0 = _mm_add_ps(_mm_mul_ps(bx, half), half);
+                    __m128 c1 = _mm_add_ps(_mm_mul_ps(by, half), half);
+                    __m128 c2 = _mm_mul_ps(bx, bx);
+                    __m128 c3 = _mm_mul_ps(by, by);
+
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                    float* pOut = (float*)(pLeanRow + x);
+                    _mm_storeu_ps(pOut, c0);
+                    _mm_storeu_ps(pOut + 4, c1);
+                    _mm_storeu_ps(pOut + 8, c2);
+                    _mm_storeu_ps(pOut + 12, c3);
+                }
+
+                for(; x < width; x++)
+                {
+                    const uint8_t* pTexel = pRow + x * 4;
+                    vec3 tn(pTable[pTexel[Format::kRed]], pTable[pTexel[1]], pTable[pTexel[Format::kBlue]]);
+                    pLeanRow[x] = computeLeanTexel(tn);
+                }
+            }
+        }
+
+        template<ResourceFormat format>
+        void computeLeanDataParallel(uint32_t width, uint32_t height, const uint8_t* pNormalMap, vec4* pLeanData, ThreadPool* pPool)
+        {
+            const uint32_t rowsPerChunk = std::max(1u, kTexelsPerChunk / std::max(1u, width));
+            pPool->parallelFor(height, rowsPerChunk, [=](uint32_t first, uint32_t last)
+            {
+                computeLeanRows<format>(pNormalMap, width, first, last, pLeanData);
+            });
+        }
+    }
+
+    bool LeanMap::computeLeanData(ResourceFormat format, uint32_t width, uint32_t height, const uint8_t* pNormalMap, vec4* pLeanData, ThreadPool* pPool)
+    {
+        if(pPool == nullptr)
+        {
+            pPool = ThreadPool::getDefault();
+        }
+
+        switch(format)
+        {
+        case ResourceFormat::RGBA8Unorm:
+            computeLeanDataParallel<ResourceFormat::RGBA8Unorm>(width, height, pNormalMap, pLeanData, pPool);
+            return true;
+        case ResourceFormat::BGRA8Unorm:
+            computeLeanDataParallel<ResourceFormat::BGRA8Unorm>(width, height, pNormalMap, pLeanData, pPool);
+            return true;
+        case ResourceFormat::BGRX8Unorm:
+            computeLeanDataParallel<ResourceFormat::BGRX8Unorm>(width, height, pNormalMap, pLeanData, pPool);
+            return true;
+        case ResourceFormat::RGBA8UnormSrgb:
+            computeLeanDataParallel<ResourceFormat::RGBA8UnormSrgb>(width, height, pNormalMap, pLeanData, pPool);
+            return true;
+        case ResourceFormat::BGRA8UnormSrgb:
+            computeLeanDataParallel<ResourceFormat::BGRA8UnormSrgb>(width, height, pNormalMap, pLeanData, pPool);
+            return true;
+        default:
+            logError("Can't generate LEAN map. Unsupported normal map format.");
+            return false;
+        }
+    }
 
+    bool LeanMap::computeLeanDataReference(ResourceFormat format, uint32_t texW, uint32_t texH, const uint8_t* normalMapData, vec4* leanData)
+    {
         const float oneBy255 = 1.0f / 255.0f;
         for(auto y = 0u; y < texH; y++)
         {
@@ -53,7 +231,7 @@ namespace Falcor
                 auto texIdx = (x + y * texW);
                 vec3 tn;
 
-                switch(pNormalMap->getFormat())
+                switch(format)
                 {
                 case ResourceFormat::RGBA8Unorm:
                 {
@@ -82,7 +260,7 @@ namespace Falcor
                 } break;
                 default: 
                     logError("Can't generate LEAN map. Unsupported normal map format.");
-                    return nullptr;
+                    return false;
                 };
 
                 // Unpack
@@ -98,12 +276,55 @@ namespace Falcor
                 leanData[texIdx] = vec4(b.x*0.5f + 0.5f, b.y*0.5f + 0.5f, m.x, m.y);
             }
         }
+        return true;
+    }
+
+    Texture::SharedPtr LeanMap::createFromNormalMap(const Falcor::Texture* pNormalMap, ThreadPool* pPool)
+    {
+        uint32_t texW = pNormalMap->getWidth();
+        uint32_t texH = pNormalMap->getHeight();
+
+        std::vector<vec4> leanData(texW * texH);
+        auto normalMapData = gpDevice->getRenderContext()->readTextureSubresource(pNormalMap, 0);
+        if(computeLeanData(pNormalMap->getFormat(), texW, texH, normalMapData.data(), leanData.data(), pPool) == false)
+        {
+            return nullptr;
+        }
 
         Texture::SharedPtr pTex = Texture::create2D(texW, texH, ResourceFormat::RGBA32Float, 1, Texture::kMaxPossible, leanData.data());
         return pTex;
     }
 
-    bool LeanMap::createLeanMap(const Material* pMaterial)
+    Texture::SharedPtr LeanMap::createFromNormalMapFile(const std::string& filename, bool isSrgb, ThreadPool* pPool)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError("Can't generate LEAN map. Can't find normal map file " + filename);
+            return nullptr;
+        }
+
+        // Same decoding and orientation as createTextureFromFile()
+        Bitmap::UniqueConstPtr pBitmap = loadBitmapForTexture(fullpath);
+        if(pBitmap == nullptr)
+        {
+            return nullptr;
+        }
+        ResourceFormat format = isSrgb ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat();
+
+        uint32_t texW = pBitmap->getWidth();
+        uint32_t texH = pBitmap->getHeight();
+        std::vector<vec4> leanData(texW * texH);
+        if(computeLeanData(format, texW, texH, pBitmap->getData(), leanData.data(), pPool) == false)
+        {
+            return nullptr;
+        }
+
+        Texture::SharedPtr pTex = Texture::create2D(texW, texH, ResourceFormat::RGBA32Float, 1, Texture::kMaxPossible, leanData.data());
+        return pTex;
+    }
+
+    bool LeanMap::createLeanMap(const Material* pMaterial, bool useSourceFile)
     {
         uint32_t materialID = pMaterial->getId();
 
@@ -116,13 +337,25 @@ namespace Falcor
         const Texture* pNormalMap = pMaterial->getNormalMap().get();
         if(pNormalMap)
         {
-            mpLeanMaps[materialID] = createFromNormalMap(pNormalMap);
+            Texture::SharedPtr pLeanMap;
+            std::string fullpath;
+            if(useSourceFile && findFileInDataDirectories(pNormalMap->getSourceFilename(), fullpath) && hasSuffix(fullpath, ".dds", false) == false)
+            {
+                pLeanMap = createFromNormalMapFile(fullpath, isSrgbFormat(pNormalMap->getFormat()));
+            }
+
+            // The file might not decode to the texture's dimensions, for example when the texture was replaced by a baked one
+            if(pLeanMap == nullptr || pLeanMap->getWidth() != pNormalMap->getWidth() || pLeanMap->getHeight() != pNormalMap->getHeight())
+            {
+                pLeanMap = createFromNormalMap(pNormalMap);
+            }
+            mpLeanMaps[materialID] = pLeanMap;
             mShaderArraySize = max(materialID + 1, mShaderArraySize);
         }
         return true;
     }
 
-    LeanMap::UniquePtr LeanMap::create(const Scene* pScene)
+    LeanMap::UniquePtr LeanMap::create(const Scene* pScene, bool useSourceFiles)
     {
         UniquePtr pLeanMaps = UniquePtr(new LeanMap);
 
@@ -130,7 +363,7 @@ namespace Falcor
         for(uint32_t i = 0; i < pScene->getMaterialCount(); i++)
         {
             const Material* pMaterial = pScene->getMaterial(i).get();
-            if(pLeanMaps->createLeanMap(pMaterial) == false)
+            if(pLeanMaps->createLeanMap(pMaterial, useSourceFiles) == false)
             {
                 return nullptr;
             }
@@ -143,7 +376,7 @@ namespace Falcor
             for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
             {
                 const Material* pMaterial = pModel->getMesh(meshID)->getMaterial().get();
-                if(pLeanMaps->createLeanMap(pMaterial) == false)
+                if(pLeanMaps->createLeanMap(pMaterial, useSourceFiles) == false)
                 {
                     return nullptr;
                 }
@@ -37,13 +37,46 @@ namespace Falcor
     class Material;
     class ProgramVars;
     class Sampler;
+    class ThreadPool;
 
     class LeanMap
     {
     public:
         using UniquePtr = std::unique_ptr<LeanMap>;
-        static UniquePtr create(const Falcor::Scene* pScene);
-        static Falcor::Texture::SharedPtr createFromNormalMap(const Falcor::Texture* pNormalMap);
+
+        /** Create the LEAN maps of all the materials in a scene
+            \param[in] pScene The scene
+            \param[in] useSourceFiles Decode the normal maps from their source files on the CPU when possible, instead of reading them back from the GPU
+        */
+        static UniquePtr create(const Falcor::Scene* pScene, bool useSourceFiles = false);
+
+        /** Create a LEAN map from a normal map texture. The normal map is read back from the GPU
+            \param[in] pNormalMap The normal map
+            \param[in] pPool The thread pool which processes the rows. nullptr selects ThreadPool::getDefault()
+        */
+        static Falcor::Texture::SharedPtr createFromNormalMap(const Falcor::Texture* pNormalMap, ThreadPool* pPool = nullptr);
+
+        /** Create a LEAN map from a normal map file. The file is decoded on the CPU, there's no GPU readback. The result matches createFromNormalMap() with a texture loaded from the same file
+            \param[in] filename The normal map file. Loader will look for it in the data directories
+            \param[in] isSrgb Interpret the file as sRGB data, like createTextureFromFile() with loadAsSrgb
+            \param[in] pPool The thread pool which processes the rows. nullptr selects ThreadPool::getDefault()
+        */
+        static Falcor::Texture::SharedPtr createFromNormalMapFile(const std::string& filename, bool isSrgb = false, ThreadPool* pPool = nullptr);
+
+        /** Compute the LEAN map texels of a normal map
+            \param[in] format The normal map format. RGBA8Unorm, BGRA8Unorm, BGRX8Unorm and their sRGB variants are supported
+            \param[in] width The width of the normal map
+            \param[in] height The height of the normal map
+            \param[in] pNormalMap The normal map texels, with tightly packed rows
+            \param[out] pLeanData width * height LEAN map texels
+            \param[in] pPool The thread pool which processes the rows. nullptr selects ThreadPool::getDefault()
+            \return false if the format isn't supported
+        */
+        static bool computeLeanData(ResourceFormat format, uint32_t width, uint32_t height, const uint8_t* pNormalMap, glm::vec4* pLeanData, ThreadPool* pPool = nullptr);
+
+        /** The original scalar implementation of computeLeanData(). Used to validate the optimized version
+        */
+        static bool computeLeanDataReference(ResourceFormat format, uint32_t width, uint32_t height, const uint8_t* pNormalMap, glm::vec4* pLeanData);
 
         Falcor::Texture* getLeanMap(uint32_t sceneMaterialID) { return mpLeanMaps[sceneMaterialID].get(); }
         void setIntoProgramVars(ProgramVars* pVars, const std::string& texName) const;
@@ -51,7 +84,7 @@ namespace Falcor
         uint32_t getRequiredLeanMapShaderArraySize() const { return mShaderArraySize; }
     private:
         LeanMap() = default;
-        bool createLeanMap(const Falcor::Material* pMaterial);
+        bool createLeanMap(const Falcor::Material* pMaterial, bool useSourceFile);
         std::map<uint32_t, Falcor::Texture::SharedPtr> mpLeanMaps;
         uint32_t mShaderArraySize = 0;
     };
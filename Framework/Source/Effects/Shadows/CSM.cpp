@@ -37,6 +37,7 @@ namespace Falcor
     const char* kDepthPassVSFile = "Effects/ShadowPass.vs.hlsl";
     const char* kDepthPassGsFile = "Effects/ShadowPass.gs.hlsl";
     const char* kDepthPassFsFile = "Effects/ShadowPass.ps.hlsl";
+    const Program::Define kTestAlphaDefine = Program::createDefine("TEST_ALPHA");
 
     const Gui::DropdownList kFilterList = {
         { (uint32_t)CsmFilterPoint, "Point" },
@@ -79,11 +80,11 @@ namespace Falcor
                 float alphaThreshold = currentData.pMaterial->getAlphaThreshold();
                 currentData.pContext->getGraphicsVars()->getConstantBuffer(1u)->setBlob(&alphaThreshold, 0u, sizeof(float));
                 currentData.pContext->getGraphicsVars()->setSrv(0u, currentData.pMaterial->getAlphaMap()->getSRV());
-                currentData.pContext->getGraphicsState()->getProgram()->addDefine("TEST_ALPHA");
+                currentData.pContext->getGraphicsState()->getProgram()->addDefine(kTestAlphaDefine);
             }
             else
             {
-                currentData.pContext->getGraphicsState()->getProgram()->removeDefine("TEST_ALPHA");
+                currentData.pContext->getGraphicsState()->getProgram()->removeDefine(kTestAlphaDefine);
             }
             
             return true;
@@ -155,6 +156,10 @@ namespace Falcor
         mCsmData.cascadeCount = cascadeCount;
         GraphicsProgram::SharedPtr pProg = GraphicsProgram::createFromFile(kDepthPassVSFile, "");
         pProg->addDefine("_APPLY_PROJECTION");
+        Program::DefineList skinnedDef;
+        skinnedDef.add("_APPLY_PROJECTION");
+        skinnedDef.add("_VERTEX_BLENDING");
+        pProg->prewarm({ skinnedDef });
         mDepthPass.pState = GraphicsState::create();
         mDepthPass.pState->setProgram(pProg);
         mDepthPass.pGraphicsVars = GraphicsVars::create(pProg->getActiveVersion()->getReflector());
@@ -257,6 +262,15 @@ namespace Falcor
 
         // Create the shadows program
         GraphicsProgram::SharedPtr pProg = GraphicsProgram::createFromFile(kDepthPassVSFile, kDepthPassFsFile, kDepthPassGsFile, "", "", progDef);
+
+        // The scene renderer toggles alpha-testing and vertex-blending per material/mesh. Compile these versions in the background so they don't stall the first frame which uses them
+        std::vector<Program::DefineList> permutations(3, progDef);
+        permutations[0].remove("TEST_ALPHA");
+        permutations[1].add("_VERTEX_BLENDING");
+        permutations[2].remove("TEST_ALPHA");
+        permutations[2].add("_VERTEX_BLENDING");
+        pProg->prewarm(permutations);
+
         mShadowPass.pState = GraphicsState::create();
         mShadowPass.pState->setProgram(pProg);
         mShadowPass.pState->setDepthStencilState(nullptr);
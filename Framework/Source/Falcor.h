@@ -54,9 +54,11 @@
 #include "API/RenderContext.h"
 #include "API/Sampler.h"
 #include "API/Shader.h"
+#include "API/ShaderCache.h"
 #include "API/StructuredBuffer.h"
 #include "API/Texture.h"
 #include "API/ConstantBuffer.h"
+#include "API/VariablesBufferLayout.h"
 #include "API/VAO.h"
 #include "API/VertexLayout.h"
 #include "API/Window.h"
@@ -69,6 +71,8 @@
 #include "API/LowLevel/DescriptorTable.h"
 #include "API/LowLevel/FencedPool.h"
 #include "API/LowLevel/GpuFence.h"
+#include "API/LowLevel/PagedRingAllocator.h"
+#include "API/LowLevel/RingAllocator.h"
 #include "API/LowLevel/RootSignature.h"
 #endif //FALCOR_D3D12 || defined FALCOR_VULKAN
 
@@ -77,6 +81,8 @@
 #include "Graphics/Camera/CameraController.h"
 #include "Graphics/GraphicsState.h"
 #include "Graphics/FullScreenPass.h"
+#include "Graphics/TextureBaker.h"
+#include "Graphics/TextureCache.h"
 #include "Graphics/TextureHelper.h"
 #include "Graphics/Light.h"
 #include "Graphics/Program.h"
@@ -95,6 +101,9 @@
 #include "Graphics/Model/Mesh.h"
 #include "Graphics/Model/Model.h"
 #include "Graphics/Model/ModelRenderer.h"
+#include "Graphics/Model/TangentSpace.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include "Graphics/Model/VertexQuantization.h"
 
 // Scene
 #include "Graphics/Scene/Scene.h"
@@ -122,6 +131,9 @@
 #include "Utils/Profiler.h"
 #include "Utils/StringUtils.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/BinaryFileReader.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/TaskQueue.h"
 #include "Utils/Video/VideoEncoder.h"
 #include "Utils/Video/VideoEncoderUI.h"
 #include "Utils/Video/VideoDecoder.h"
@@ -31,6 +31,7 @@
 #include "utils/AABB.h"
 #include "Utils/math/FalcorMath.h"
 #include "API/ConstantBuffer.h"
+#include <immintrin.h>
 
 namespace Falcor
 {
@@ -194,6 +195,102 @@ namespace Falcor
         return !isInside;
     }
 
+    // The project isn't built with /arch:AVX. The AVX intrinsics are still available, so the path is selected at runtime.
+    bool Camera::sAvxCulling = isAvxSupported();
+
+    void Camera::setAvxCullingEnabled(bool enable)
+    {
+        sAvxCulling = enable && isAvxSupported();
+    }
+
+    void Camera::cullBoxes(const BoundingBoxSoA& boxes, uint8_t* pVisibleMask) const
+    {
+        cullBoxes(boxes, 0, boxes.size(), pVisibleMask);
+    }
+
+    void Camera::cullBoxes(const BoundingBoxSoA& boxes, uint32_t first, uint32_t count, uint8_t* pVisibleMask) const
+    {
+        calculateCameraParameters();
+        assert(first + count <= boxes.size());
+
+        const float* pCenterX = boxes.centerX.data() + first;
+        const float* pCenterY = boxes.centerY.data() + first;
+        const float* pCenterZ = boxes.centerZ.data() + first;
+        const float* pExtentX = boxes.extentX.data() + first;
+        const float* pExtentY = boxes.extentY.data() + first;
+        const float* pExtentZ = boxes.extentZ.data() + first;
+
+        // Same math and evaluation order as isObjectCulled(), so both paths return identical results
+        uint32_t i = 0;
+        const bool useAvx = sAvxCulling;
+        for (; useAvx && i + 8 <= count; i += 8)
+        {
+            const __m256 centerX = _mm256_loadu_ps(pCenterX + i);
+            const __m256 centerY = _mm256_loadu_ps(pCenterY + i);
+            const __m256 centerZ = _mm256_loadu_ps(pCenterZ + i);
+            const __m256 extentX = _mm256_loadu_ps(pExtentX + i);
+            const __m256 extentY = _mm256_loadu_ps(pExtentY + i);
+            const __m256 extentZ = _mm256_loadu_ps(pExtentZ + i);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int plane = 0; plane < 6; plane++)
+            {
+                const auto& p = mFrustumPlanes[plane];
+                const __m256 x = _mm256_add_ps(centerX, _mm256_mul_ps(extentX, _mm256_set1_ps(p.sign.x)));
+                const __m256 y = _mm256_add_ps(centerY, _mm256_mul_ps(extentY, _mm256_set1_ps(p.sign.y)));
+                const __m256 z = _mm256_add_ps(centerZ, _mm256_mul_ps(extentZ, _mm256_set1_ps(p.sign.z)));
+                __m256 dr = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.xyz.x)), _mm256_mul_ps(y, _mm256_set1_ps(p.xyz.y)));
+                dr = _mm256_add_ps(dr, _mm256_mul_ps(z, _mm256_set1_ps(p.xyz.z)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dr, _mm256_set1_ps(p.negW), _CMP_GT_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(inside);
+            for (uint32_t lane = 0; lane < 8; lane++)
+            {
+                pVisibleMask[i + lane] = (uint8_t)((mask >> lane) & 1);
+            }
+        }
+        if (useAvx)
+        {
+            // Avoid the AVX-SSE transition penalty in the SSE loop below
+            _mm256_zeroupper();
+        }
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 centerX = _mm_loadu_ps(pCenterX + i);
+            const __m128 centerY = _mm_loadu_ps(pCenterY + i);
+            const __m128 centerZ = _mm_loadu_ps(pCenterZ + i);
+            const __m128 extentX = _mm_loadu_ps(pExtentX + i);
+            const __m128 extentY = _mm_loadu_ps(pExtentY + i);
+            const __m128 extentZ = _mm_loadu_ps(pExtentZ + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int plane = 0; plane < 6; plane++)
+            {
+                const auto& p = mFrustumPlanes[plane];
+                const __m128 x = _mm_add_ps(centerX, _mm_mul_ps(extentX, _mm_set1_ps(p.sign.x)));
+                const __m128 y = _mm_add_ps(centerY, _mm_mul_ps(extentY, _mm_set1_ps(p.sign.y)));
+                const __m128 z = _mm_add_ps(centerZ, _mm_mul_ps(extentZ, _mm_set1_ps(p.sign.z)));
+                __m128 dr = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.xyz.x)), _mm_mul_ps(y, _mm_set1_ps(p.xyz.y)));
+                dr = _mm_add_ps(dr, _mm_mul_ps(z, _mm_set1_ps(p.xyz.z)));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(dr, _mm_set1_ps(p.negW)));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                pVisibleMask[i + lane] = (uint8_t)((mask >> lane) & 1);
+            }
+        }
+
+        // Remainder
+        for (; i < count; i++)
+        {
+            pVisibleMask[i] = isObjectCulled(boxes.get(first + i)) ? 0 : 1;
+        }
+    }
+
     void Camera::setRightEyeMatrices(const glm::mat4& view, const glm::mat4& proj)
     {
         mData.rightEyeViewMat = view;
@@ -36,6 +36,7 @@
 namespace Falcor
 {
     struct BoundingBox;
+    struct BoundingBoxSoA;
     class ConstantBuffer;
 
     /** Camera class
@@ -158,6 +159,24 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Batched version of isObjectCulled(). Tests the boxes 8 at a time if AVX is enabled, 4 at a time (SSE) otherwise. See setAvxCullingEnabled().
+            \param[in] boxes The boxes to test
+            \param[out] pVisibleMask One entry per box. Set to 1 if the box is visible, 0 if it should be culled.
+        */
+        void cullBoxes(const BoundingBoxSoA& boxes, uint8_t* pVisibleMask) const;
+
+        /** Batched culling of the boxes in the range [first, first + count). pVisibleMask[i] holds the result of box first + i.
+        */
+        void cullBoxes(const BoundingBoxSoA& boxes, uint32_t first, uint32_t count, uint8_t* pVisibleMask) const;
+
+        /** Enable or disable the AVX path of cullBoxes(). It's enabled by default if the CPU supports it, and can't be enabled otherwise.
+        */
+        static void setAvxCullingEnabled(bool enable);
+
+        /** Check if cullBoxes() uses AVX
+        */
+        static bool isAvxCullingEnabled() { return sAvxCulling; }
+
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName) const;
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::size_t& offset) const;
 
@@ -180,6 +199,8 @@ namespace Falcor
     private:
         Camera();
 
+        static bool sAvxCulling;
+
         mutable bool mDirty = true;
         mutable bool mEnablePersistentProjMat = false;
         mutable bool mEnablePersistentViewMat = false;
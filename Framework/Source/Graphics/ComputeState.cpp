@@ -34,7 +34,7 @@ namespace Falcor
 {
     ComputeState::ComputeState()
     {
-        mpCsoGraph = StateGraph::create();
+        mpCsoCache = StateObjectCache<ComputeStateObject>::create();
     }
 
     ComputeState::~ComputeState() = default;
@@ -42,44 +42,25 @@ namespace Falcor
     ComputeStateObject::SharedPtr ComputeState::getCSO(const ComputeVars* pVars)
     {
         ProgramVersion::SharedConstPtr pProgVersion = mpProgram ? mpProgram->getActiveVersion() : nullptr;
-        bool newProgram = (pProgVersion.get() != mCachedData.pProgramVersion);
-        if (newProgram)
+        if (pProgVersion.get() != mCachedData.pProgramVersion)
         {
             mCachedData.pProgramVersion = pProgVersion.get();
-            mpCsoGraph->walk((void*)mCachedData.pProgramVersion);
+            mDesc.setProgramVersion(pProgVersion);
+            mpCso = nullptr;
         }
 
         RootSignature::SharedPtr pRoot = pVars ? pVars->getRootSignature() : RootSignature::getEmpty();
-
         if (mCachedData.pRootSig != pRoot.get())
         {
             mCachedData.pRootSig = pRoot.get();
-            mpCsoGraph->walk((void*)mCachedData.pRootSig);
+            mDesc.setRootSignature(pRoot);
+            mpCso = nullptr;
         }
 
-        ComputeStateObject::SharedPtr pCso = mpCsoGraph->getCurrentNode();
-
-        if(pCso == nullptr)
+        if (mpCso == nullptr)
         {
-            mDesc.setProgramVersion(pProgVersion);
-            mDesc.setRootSignature(pRoot);
-
-            StateGraph::CompareFunc cmpFunc = [&desc = mDesc](ComputeStateObject::SharedPtr pCso) -> bool
-            {
-                return pCso && (desc == pCso->getDesc());
-            };
-
-            if (mpCsoGraph->scanForMatchingNode(cmpFunc))
-            {
-                pCso = mpCsoGraph->getCurrentNode();
-            }
-            else
-            {
-                pCso = ComputeStateObject::create(mDesc);
-                mpCsoGraph->setCurrentNodeData(pCso);
-            }
+            mpCso = mpCsoCache->get(mDesc);
         }
-
-        return pCso;
+        return mpCso;
     }
 }
\ No newline at end of file
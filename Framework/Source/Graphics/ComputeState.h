@@ -29,7 +29,7 @@
 #include "API/ComputeStateObject.h"
 #include "Graphics/ComputeProgram.h"
 #include <stack>
-#include "Utils/Graph.h"
+#include "Graphics/StateObjectCache.h"
 
 namespace Falcor
 {
@@ -78,7 +78,7 @@ namespace Falcor
         };
         CachedData mCachedData;
 
-        using StateGraph = Graph<ComputeStateObject::SharedPtr, void*>;
-        StateGraph::SharedPtr mpCsoGraph;
+        StateObjectCache<ComputeStateObject>::SharedPtr mpCsoCache;
+        ComputeStateObject::SharedPtr mpCso;    // The state object matching mDesc. Reset when mDesc changes.
     };
 }
\ No newline at end of file
@@ -63,67 +63,101 @@ namespace Falcor
             setViewport(i, mViewports[i], true);
         }
 
-        mpGsoGraph = StateGraph::create();
+        mpGsoCache = StateObjectCache<GraphicsStateObject>::create();
     }
 
     GraphicsState::~GraphicsState() = default;
 
-    GraphicsStateObject::SharedPtr GraphicsState::getGSO(const GraphicsVars* pVars)
+    void GraphicsState::updateDesc(const GraphicsVars* pVars)
     {
         if (mpProgram && mpVao)
         {
             mpVao->getVertexLayout()->addVertexAttribDclToProg(mpProgram.get());
         }
         const ProgramVersion::SharedConstPtr pProgVersion = mpProgram ? mpProgram->getActiveVersion() : nullptr;
-        bool newProgVersion = pProgVersion.get() != mCachedData.pProgramVersion;
-        if (newProgVersion)
+        if (pProgVersion.get() != mCachedData.pProgramVersion)
         {
             mCachedData.pProgramVersion = pProgVersion.get();
-            mpGsoGraph->walk((void*)pProgVersion.get());
+            mDesc.setProgramVersion(pProgVersion);
+            mpGso = nullptr;
         }
-    
-        RootSignature::SharedPtr pRoot = pVars ? pVars->getRootSignature() : RootSignature::getEmpty();
 
+        RootSignature::SharedPtr pRoot = pVars ? pVars->getRootSignature() : RootSignature::getEmpty();
         if (mCachedData.pRootSig != pRoot.get())
         {
             mCachedData.pRootSig = pRoot.get();
-            mpGsoGraph->walk((void*)mCachedData.pRootSig);
+            mDesc.setRootSignature(pRoot);
+            mpGso = nullptr;
         }
 
+        // FBO descs are interned, so comparing the pointers is enough
         const Fbo::Desc* pFboDesc = mpFbo ? &mpFbo->getDesc() : nullptr;
-        if(mCachedData.pFboDesc != pFboDesc)
+        if (mCachedData.pFboDesc != pFboDesc)
         {
-            mpGsoGraph->walk((void*)pFboDesc);
             mCachedData.pFboDesc = pFboDesc;
+            mDesc.setFboFormats(pFboDesc ? *pFboDesc : Fbo::Desc());
+            mpGso = nullptr;
         }
+    }
 
-        GraphicsStateObject::SharedPtr pGso = mpGsoGraph->getCurrentNode();
-        if(pGso == nullptr)
+    GraphicsStateObject::SharedPtr GraphicsState::getGSO(const GraphicsVars* pVars)
+    {
+        updateDesc(pVars);
+        if (mpGso == nullptr)
         {
-            mDesc.setProgramVersion(pProgVersion);
-            mDesc.setFboFormats(mpFbo ? mpFbo->getDesc() : Fbo::Desc());
-            mDesc.setVertexLayout(mpVao->getVertexLayout());
-            mDesc.setPrimitiveType(topology2Type(mpVao->getPrimitiveTopology()));
-            mDesc.setRootSignature(pRoot);
+            mpGso = mpGsoCache->get(mDesc);
+        }
+        return mpGso;
+    }
 
-            mDesc.setSinglePassStereoEnable(mEnableSinglePassStereo);
-            
-            StateGraph::CompareFunc cmpFunc = [&desc = mDesc](GraphicsStateObject::SharedPtr pGso) -> bool
-            {
-                return pGso && (desc == pGso->getDesc());
-            };
+    uint32_t GraphicsState::prewarm(const GraphicsVars* pVars, const std::vector<Permutation>& permutations)
+    {
+        if (mpProgram == nullptr)
+        {
+            logError("GraphicsState::prewarm() - no program is bound.");
+            return (uint32_t)permutations.size();
+        }
+
+        // Don't use updateDesc(), getActiveVersion() would compile the current version synchronously or return a stale one
+        GraphicsStateObject::Desc baseDesc = mDesc;
+        baseDesc.setRootSignature(pVars ? pVars->getRootSignature() : RootSignature::getEmpty());
+        baseDesc.setFboFormats(mpFbo ? mpFbo->getDesc() : Fbo::Desc());
 
-            if (mpGsoGraph->scanForMatchingNode(cmpFunc))
+        uint32_t skipped = 0;
+        std::vector<GraphicsStateObject::Desc> descs;
+        descs.reserve(permutations.size());
+        for (const auto& permutation : permutations)
+        {
+            GraphicsStateObject::Desc desc = baseDesc;
+            if (permutation.pBlendState)        desc.setBlendState(permutation.pBlendState);
+            if (permutation.pRasterizerState)   desc.setRasterizerState(permutation.pRasterizerState);
+            if (permutation.pDepthStencilState) desc.setDepthStencilState(permutation.pDepthStencilState);
+
+            // The vertex layout selects the program version. Only the defines are changed here, nothing is compiled.
+            const Vao* pVao = permutation.pVao ? permutation.pVao.get() : mpVao.get();
+            if (pVao)
             {
-                pGso = mpGsoGraph->getCurrentNode();
+                desc.setVertexLayout(pVao->getVertexLayout());
+                desc.setPrimitiveType(topology2Type(pVao->getPrimitiveTopology()));
+                pVao->getVertexLayout()->addVertexAttribDclToProg(mpProgram.get());
             }
-            else
+
+            ProgramVersion::SharedConstPtr pVersion = mpProgram->tryGetVersion(mpProgram->getActiveDefinesList());
+            if (pVersion == nullptr)
             {
-                pGso = GraphicsStateObject::create(mDesc);
-                mpGsoGraph->setCurrentNodeData(pGso);
+                skipped++;
+                continue;
             }
+            desc.setProgramVersion(pVersion);
+            descs.push_back(desc);
         }
-        return pGso;
+
+        if (mpVao)
+        {
+            mpVao->getVertexLayout()->addVertexAttribDclToProg(mpProgram.get());
+        }
+        mpGsoCache->prewarm(descs);
+        return skipped;
     }
 
     GraphicsState& GraphicsState::setFbo(const Fbo::SharedPtr& pFbo, bool setVp0Sc0)
@@ -162,7 +196,14 @@ namespace Falcor
         if(mpVao != pVao)
         {
             mpVao = pVao;
-            mpGsoGraph->walk((void*)pVao->getVertexLayout().get());
+            VertexLayout::SharedConstPtr pLayout = pVao ? pVao->getVertexLayout() : nullptr;
+            GraphicsStateObject::PrimitiveType primType = pVao ? topology2Type(pVao->getPrimitiveTopology()) : GraphicsStateObject::PrimitiveType::Undefined;
+            if((pLayout != mDesc.getVertexLayout()) || (primType != mDesc.getPrimitiveType()))
+            {
+                mDesc.setVertexLayout(pLayout);
+                mDesc.setPrimitiveType(primType);
+                mpGso = nullptr;
+            }
         }
         return *this;
     }
@@ -172,7 +213,7 @@ namespace Falcor
         if(mDesc.getBlendState() != pBlendState)
         {
             mDesc.setBlendState(pBlendState);
-            mpGsoGraph->walk((void*)pBlendState.get());
+            mpGso = nullptr;
         }
         return *this;
     }
@@ -182,7 +223,7 @@ namespace Falcor
         if(mDesc.getRasterizerState() != pRasterizerState)
         {
             mDesc.setRasterizerState(pRasterizerState);
-            mpGsoGraph->walk((void*)pRasterizerState.get());
+            mpGso = nullptr;
         }
         return *this;
     }
@@ -192,7 +233,7 @@ namespace Falcor
         if(mDesc.getSampleMask() != sampleMask)
         {
             mDesc.setSampleMask(sampleMask);
-            mpGsoGraph->walk((void*)(uint64_t)sampleMask);
+            mpGso = nullptr;
         }
         return *this; 
     }
@@ -202,7 +243,7 @@ namespace Falcor
         if(mDesc.getDepthStencilState() != pDepthStencilState)
         {
             mDesc.setDepthStencilState(pDepthStencilState);
-            mpGsoGraph->walk((void*)pDepthStencilState.get());
+            mpGso = nullptr;
         }
         return *this;
     }
@@ -266,7 +307,8 @@ namespace Falcor
     {
 #if _ENABLE_NVAPI
         mEnableSinglePassStereo = enable;
-        mpGsoGraph->walk((void*)enable);
+        mDesc.setSinglePassStereoEnable(enable);
+        mpGso = nullptr;
 #else
         if (enable)
         {
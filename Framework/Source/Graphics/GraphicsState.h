@@ -34,7 +34,7 @@
 #include "API/DepthStencilState.h"
 #include "API/BlendState.h"
 #include <stack>
-#include "Utils/Graph.h"
+#include "Graphics/StateObjectCache.h"
 
 namespace Falcor
 {
@@ -206,6 +206,24 @@ namespace Falcor
         /** Get the active graphics state object
         */
         GraphicsStateObject::SharedPtr getGSO(const GraphicsVars* pVars);
+
+        /** A combination of the states which are switched between draws. Null members keep the current state.
+        */
+        struct Permutation
+        {
+            BlendState::SharedPtr pBlendState;
+            RasterizerState::SharedPtr pRasterizerState;
+            DepthStencilState::SharedPtr pDepthStencilState;
+            Vao::SharedConstPtr pVao;
+        };
+
+        /** Create the graphics state objects of permutations of the current state on the TaskQueue, so that the draws which use them later don't stall on state object creation.
+            Program versions are resolved with Program::tryGetVersion(), so this never compiles shaders on the calling thread. Permutations whose program version isn't built yet are skipped, and their version is compiled in the background.
+            \param[in] pVars The vars which will be used with the permutations
+            \param[in] permutations The states which differ from the current state
+            \return The number of skipped permutations. Call prewarm() again later to create their state objects.
+        */
+        uint32_t prewarm(const GraphicsVars* pVars, const std::vector<Permutation>& permutations);
         
         /** Enable/disable single-pass-stereo
         */
@@ -216,6 +234,8 @@ namespace Falcor
         bool isSinglePassStereoEnabled() const { return mEnableSinglePassStereo; }
     private:
         GraphicsState();
+        void updateDesc(const GraphicsVars* pVars);
+
         Vao::SharedConstPtr mpVao;
         Fbo::SharedPtr mpFbo;
         GraphicsProgram::SharedPtr mpProgram;
@@ -239,7 +259,7 @@ namespace Falcor
         };
         CachedData mCachedData;
 
-        using StateGraph = Graph<GraphicsStateObject::SharedPtr, void*>;
-        StateGraph::SharedPtr mpGsoGraph;
+        StateObjectCache<GraphicsStateObject>::SharedPtr mpGsoCache;
+        GraphicsStateObject::SharedPtr mpGso;   // The state object matching mDesc. Reset when mDesc changes.
     };
 }
\ No newline at end of file
@@ -98,6 +98,22 @@ namespace Falcor
         setIntoConstantBuffer(pBuffer, offset);
     }
 
+    void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer, const VariablesBufferLayout* pLayout)
+    {
+        pBuffer->setLayoutData(pLayout, &mData);
+    }
+
+    VariablesBufferLayout::SharedPtr Light::createBindingLayout(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& varName)
+    {
+        static_assert(kDataSize == offsetof(LightData, material), "'material' must be the last field in LightData");
+        auto pLayout = VariablesBufferLayout::create(pReflector, varName + ".worldPos", kDataSize);
+        if (pLayout == nullptr)
+        {
+            logWarning("Light::createBindingLayout() - variable \"" + varName + "\"not found in buffer\n");
+        }
+        return pLayout;
+    }
+
     void Light::resetGlobalIdCounter()
     {
         sCount = 0;
@@ -368,6 +384,12 @@ namespace Falcor
         Light::setIntoConstantBuffer(pBuffer, varName);
     }
 
+    void AreaLight::setIntoConstantBuffer(ConstantBuffer* pBuffer, const VariablesBufferLayout* pLayout)
+    {
+        prepareGPUData();
+        Light::setIntoConstantBuffer(pBuffer, pLayout);
+    }
+
     void AreaLight::prepareGPUData()
     {
         // DISABLED_FOR_D3D12
@@ -415,14 +437,26 @@ namespace Falcor
             const auto& pMesh = pMeshInstance->getObject();
             assert(pMesh != nullptr);
 
-            mpMeshInstance = pMeshInstance;
-
             const auto& vao = pMesh->getVao();
+            if (vao->getIndexBufferFormat() != ResourceFormat::R32Uint)
+            {
+                logError("AreaLight::setMeshData() - area lights require 32-bit indices. Don't load the model with Model::LoadFlags::OptimizeMeshes.");
+                return;
+            }
+
+            const Vao::ElementDesc posDesc = vao->getElementIndexByLocation(VERTEX_POSITION_LOC);
+            int32_t posIdx = posDesc.vbIndex;
+            assert(posIdx != Vao::ElementDesc::kInvalidIndex);
+            if (vao->getVertexLayout()->getBufferLayout(posIdx)->getElementFormat(posDesc.elementIndex) != ResourceFormat::RGB32Float)
+            {
+                logError("AreaLight::setMeshData() - area lights require RGB32Float positions. Don't load the model with Model::LoadFlags::QuantizePositions.");
+                return;
+            }
+
+            mpMeshInstance = pMeshInstance;
 
             setIndexBuffer(vao->getIndexBuffer());
 
-            int32_t posIdx = vao->getElementIndexByLocation(VERTEX_POSITION_LOC).vbIndex;
-            assert(posIdx != Vao::ElementDesc::kInvalidIndex);
             setPositionsBuffer(vao->getVertexBuffer(posIdx));
 
             const int32_t uvIdx = vao->getElementIndexByLocation(VERTEX_TEXCOORD_LOC).vbIndex;
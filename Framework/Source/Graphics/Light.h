@@ -32,6 +32,7 @@
 #include "API/Texture.h"
 #include "glm/mat4x4.hpp"
 #include "Data/HostDeviceData.h"
+#include "API/VariablesBufferLayout.h"
 #include "Utils/Gui.h"
 #include "Graphics/Model/Model.h"
 #include "Graphics/Paths/MovableObject.h"
@@ -59,6 +60,19 @@ namespace Falcor
         virtual void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName);
         virtual void setIntoConstantBuffer(ConstantBuffer* pBuffer, size_t offset);
 
+        /** Set the light parameters into a constant buffer using a layout created by createBindingLayout(). No variable lookups are performed.
+            \param[in] pBuffer The constant buffer to set the parameters into. Must be created from the same reflection object as the layout
+            \param[in] pLayout The light's binding layout
+        */
+        virtual void setIntoConstantBuffer(ConstantBuffer* pBuffer, const VariablesBufferLayout* pLayout);
+
+        /** Resolve the location of a light variable inside a buffer.
+            \param[in] pReflector The buffer reflection object
+            \param[in] varName The name of the light variable in the buffer
+            \return A new layout object, or nullptr if the variable wasn't found
+        */
+        static VariablesBufferLayout::SharedPtr createBindingLayout(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& varName);
+
         /** create UI elements for this light.
             \param[in] pGui The GUI to create the elements with
         */
@@ -310,6 +324,7 @@ namespace Falcor
             \param[in] varName The name of the light variable in the program.
         */
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName) override;
+        void setIntoConstantBuffer(ConstantBuffer* pBuffer, const VariablesBufferLayout* pLayout) override;
 
         /**
             Create UI elements for this light.
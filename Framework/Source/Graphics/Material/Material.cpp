@@ -297,49 +297,76 @@ namespace Falcor
     }
 
 #if _LOG_ENABLED
-#define check_offset(_a) assert(pCB->getVariableOffset(std::string(varName) + "." + #_a) == (offsetof(MaterialData, _a) + offset))
+#define check_offset(_a) assert(pCbReflector->getVariableData(std::string(varName) + "." + #_a, offset) && offset == (offsetof(MaterialData, _a) + baseOffset))
 #else
 #define check_offset(_a)
 #endif
 
-    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const
+    Material::BindingLayout Material::createBindingLayout(const ProgramReflection* pReflector, const ProgramReflection::BufferReflection::SharedConstPtr& pCbReflector, const char varName[])
     {
-        // OPTME:
-        // We can specialize this function based on the API we are using. This might be worth the extra maintenance cost:
-        // - DX12 - we could create a descriptor-table with all of the SRVs. This will reduce the API overhead to a single call. Pitfall - the textures might be dirty, so we will need to verify it
-        // - Bindless GL - just copy a blob with the GPU pointers. This is actually similar to DX12, but instead of SRVs we store uint64_t
-        // - DX11 - Single call at a time.
-        // Actually, looks like if we will be smart in the way we design ProgramVars::setTextureArray(), we could get away with a unified code
-
-        // First set the desc and the values
-        finalize();
         static const size_t dataSize = sizeof(MaterialDesc) + sizeof(MaterialValues);
         static_assert(dataSize % sizeof(glm::vec4) == 0, "Material::MaterialData size should be a multiple of 16");
 
-        size_t offset = pCB->getVariableOffset(std::string(varName) + ".desc.layers[0].type");
-
-        if(offset == ConstantBuffer::kInvalidOffset)
+        BindingLayout layout;
+        layout.pCbLayout = VariablesBufferLayout::create(pCbReflector, std::string(varName) + ".desc.layers[0].type", dataSize);
+        if(layout.pCbLayout == nullptr)
         {
-            logError(std::string("Material::setIntoConstantBuffer() - variable \"") + varName + "\"not found in constant buffer\n");
-            return;
+            logError(std::string("Material::createBindingLayout() - variable \"") + varName + "\"not found in constant buffer\n");
+            return layout;
         }
 
+#if _LOG_ENABLED
+        size_t baseOffset = layout.pCbLayout->getDstBegin();
+        size_t offset;
+#endif
         check_offset(values.layers[0].albedo);
         check_offset(values.id);
-        assert(offset + dataSize <= pCB->getSize());
-
-        pCB->setBlob(&mData, offset, dataSize);
 
 #ifdef FALCOR_GL
 #pragma error Fix material texture bindings for OpenGL
 #endif
 
-        // Now set the textures
-        std::string resourceName = std::string(varName) + ".textures.layers[0]";
-        const auto pResourceDesc = pVars->getReflection()->getResourceDesc(resourceName);
+        const auto pResourceDesc = pReflector->getResourceDesc(std::string(varName) + ".textures.layers[0]");
         if (pResourceDesc == nullptr)
         {
-            logWarning(std::string("Material::setIntoConstantBuffer() - can't find the first texture object"));
+            logWarning(std::string("Material::createBindingLayout() - can't find the first texture object"));
+            return layout;
+        }
+        layout.texRegIndex = pResourceDesc->regIndex;
+
+        const auto pSamplerDesc = pReflector->getResourceDesc(std::string(varName) + ".samplerState");
+        if (pSamplerDesc)
+        {
+            layout.samplerRegIndex = pSamplerDesc->regIndex;
+        }
+        return layout;
+    }
+
+    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const
+    {
+        setIntoProgramVars(pVars, pCB, createBindingLayout(pVars->getReflection().get(), pCB->getBufferReflector(), varName));
+    }
+
+    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const BindingLayout& layout) const
+    {
+        // OPTME:
+        // We can specialize this function based on the API we are using. This might be worth the extra maintenance cost:
+        // - DX12 - we could create a descriptor-table with all of the SRVs. This will reduce the API overhead to a single call. Pitfall - the textures might be dirty, so we will need to verify it
+        // - Bindless GL - just copy a blob with the GPU pointers. This is actually similar to DX12, but instead of SRVs we store uint64_t
+        // - DX11 - Single call at a time.
+        // Actually, looks like if we will be smart in the way we design ProgramVars::setTextureArray(), we could get away with a unified code
+        if(layout.pCbLayout == nullptr)
+        {
+            return;
+        }
+
+        // First set the desc and the values
+        finalize();
+        pCB->setLayoutData(layout.pCbLayout.get(), &mData);
+
+        // Now set the textures
+        if (layout.texRegIndex == ProgramReflection::kInvalidLocation)
+        {
             return;
         }
 
@@ -349,11 +376,14 @@ namespace Falcor
         {
             if (pTextures[i] != nullptr)
             {
-                pVars->setSrv(pResourceDesc->regIndex + i, pTextures[i]->getSRV());
+                pVars->setSrv(layout.texRegIndex + i, pTextures[i]->getSRV());
             }
         }
 
-        pVars->setSampler("gMaterial.samplerState", mData.samplerState);
+        if (layout.samplerRegIndex != ProgramReflection::kInvalidLocation)
+        {
+            pVars->setSampler(layout.samplerRegIndex, mData.samplerState);
+        }
     }
 
     bool Material::operator==(const Material& other) const
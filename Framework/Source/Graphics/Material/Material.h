@@ -34,6 +34,8 @@
 #include "API/Texture.h"
 #include "glm/mat4x4.hpp"
 #include "API/Sampler.h"
+#include "API/ProgramReflection.h"
+#include "API/VariablesBufferLayout.h"
 #include "Data/HostDeviceData.h"
 
 namespace Falcor
@@ -276,6 +278,30 @@ namespace Falcor
         */
         void setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const;
 
+        /** Binding locations of a material variable inside a program. Resolve it once per program using createBindingLayout(), and use it to set materials without any name lookups.
+        */
+        struct BindingLayout
+        {
+            VariablesBufferLayout::SharedPtr pCbLayout;                     ///< The material data inside the constant buffer
+            uint32_t texRegIndex = ProgramReflection::kInvalidLocation;     ///< Register index of the first material texture
+            uint32_t samplerRegIndex = ProgramReflection::kInvalidLocation; ///< Register index of the material sampler
+        };
+
+        /** Resolve the binding locations of a material variable.
+            \param[in] pReflector The program reflection object
+            \param[in] pCbReflector The reflection object of the constant buffer containing the material variable
+            \param[in] varName The name of the material variable in the buffer
+            \return The resolved locations. If the variable wasn't found, pCbLayout will be nullptr
+        */
+        static BindingLayout createBindingLayout(const ProgramReflection* pReflector, const ProgramReflection::BufferReflection::SharedConstPtr& pCbReflector, const char varName[]);
+
+        /** Set the material parameters into a constant buffer, using pre-resolved binding locations.
+            \param[in] pVars The graphics vars of the shader to set material into.
+            \param[in] pCB The constant buffer to set the parameters into. Must be created from the same reflection object as the layout
+            \param[in] layout The binding locations, created by createBindingLayout()
+        */
+        void setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const BindingLayout& layout) const;
+
         /** Override all sampling types of materials
         */
         void setSampler(const Sampler::SharedPtr& pSampler) { mData.samplerState = pSampler; }
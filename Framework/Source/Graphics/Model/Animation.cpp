@@ -27,104 +27,377 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "Animation.h"
-#include "AnimationController.h"
-#include "glm/gtc/matrix_transform.hpp"
-#include "glm/gtx/transform.hpp"
+#include <algorithm>
+#include <limits>
+#include "glm/gtc/quaternion.hpp"
 
 namespace Falcor
 {
+    static const float kQuantizedMax = 65535.0f;
+
     Animation::UniquePtr Animation::create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond)
     {
-        return UniquePtr(new Animation(name, animationSets, duration, ticksPerSecond));
+        return create(name, animationSets, duration, ticksPerSecond, CompressionDesc());
     }
 
-    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mAnimationSets(animationSets), mDuration(duration), mTicksPerSecond(ticksPerSecond)
+    Animation::UniquePtr Animation::create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond, const CompressionDesc& compression)
     {
+        return UniquePtr(new Animation(name, animationSets, duration, ticksPerSecond, compression));
+    }
+
+    // The number of quantized components per value
+    template<typename T>
+    static uint32_t getComponentCount() { return uint32_t(sizeof(T) / sizeof(float)); }
 
+    static glm::vec4 toVec4(const glm::vec3& v) { return glm::vec4(v, 0); }
+    static glm::vec4 toVec4(const glm::quat& q) { return glm::vec4(q.x, q.y, q.z, q.w); }
+
+    static void decodeValue(const uint16_t* pValue, const glm::vec4& offset, const glm::vec4& scale, glm::vec3& value)
+    {
+        value = glm::vec3(offset) + glm::vec3(pValue[0], pValue[1], pValue[2]) * glm::vec3(scale);
     }
 
-    Animation::~Animation() = default;
+    static void decodeValue(const uint16_t* pValue, const glm::vec4& offset, const glm::vec4& scale, glm::quat& value)
+    {
+        glm::vec4 c = offset + glm::vec4(pValue[0], pValue[1], pValue[2], pValue[3]) * scale;
+        value = glm::normalize(glm::quat(c.w, c.x, c.y, c.z));
+    }
+
+    // Tracks which can't be quantized within the tolerance keep their float values
+    static void decodeValue(const float* pValue, const glm::vec4& offset, const glm::vec4& scale, glm::vec3& value)
+    {
+        value = glm::vec3(pValue[0], pValue[1], pValue[2]);
+    }
+
+    static void decodeValue(const float* pValue, const glm::vec4& offset, const glm::vec4& scale, glm::quat& value)
+    {
+        value = glm::quat(pValue[3], pValue[0], pValue[1], pValue[2]);
+    }
 
     template<typename T>
-    uint32_t findCurrentFrame(T channel, float ticks)
+    static void encodeValue(const T& value, const glm::vec4& offset, const glm::vec4& scale, uint16_t* pValue)
     {
-        uint32_t curKeyID = channel.lastKeyUsed;
-        while(curKeyID < channel.keys.size() - 1)
+        glm::vec4 v = toVec4(value);
+        for(uint32_t c = 0; c < getComponentCount<T>(); c++)
         {
-            if(channel.keys[curKeyID + 1].time > ticks)
-            {
-                break;
-            }
-            curKeyID++;
+            float q = (scale[c] > 0) ? (v[c] - offset[c]) / scale[c] : 0;
+            pValue[c] = uint16_t(glm::clamp(q + 0.5f, 0.0f, kQuantizedMax));
         }
-        return curKeyID;
     }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
+    static glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
     {
         return start + ((end - start) * ratio);
     }
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
+    static glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
     {
         return glm::slerp(start, end, ratio);
     }
 
-    template<typename KeyType>
-    KeyType Animation::calcCurrentKey(AnimationChannel<KeyType>& channel, float ticks, float lastUpdateTime)
+    static float getError(const glm::vec3& a, const glm::vec3& b)
+    {
+        return glm::length(a - b);
+    }
+
+    // The angle of the rotation between the quaternions. atan2() keeps the precision for small angles, where acos() of the dot product doesn't.
+    static float getError(const glm::quat& a, const glm::quat& b)
     {
-        KeyType curValue;
-        if(channel.keys.size() > 0)
+        glm::quat r = glm::conjugate(a) * b;
+        return 2 * atan2(glm::length(glm::vec3(r.x, r.y, r.z)), glm::abs(r.w));
+    }
+
+    // q and -q are the same rotation. Flip the signs so that consecutive keys are in the same hemisphere, which keeps the quantization range tight.
+    static void makeContinuous(std::vector<glm::vec3>& values) {}
+    static void makeContinuous(std::vector<glm::quat>& values)
+    {
+        for(size_t i = 1; i < values.size(); i++)
         {
-            if(ticks < lastUpdateTime)
+            if(glm::dot(values[i - 1], values[i]) < 0)
             {
-                channel.lastKeyUsed = 0;
+                values[i] = -values[i];
             }
+        }
+    }
+
+    template<typename T>
+    Animation::Track Animation::compressTrack(const AnimationChannel<T>& channel, float tolerance)
+    {
+        Track track;
+        track.firstKey = uint32_t(mTimes.size());
 
-            // search for the next keyframe
-            uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
-            uint32_t nextKeyIndex = (curKeyIndex + 1) % channel.keys.size();
-            const AnimationKey<KeyType>& curKey = channel.keys[curKeyIndex];
-            const AnimationKey<KeyType>& nextKey = channel.keys[nextKeyIndex];
+        const auto& keys = channel.keys;
+        uint32_t count = uint32_t(keys.size());
+        mCompressionStats.rawKeyCount += count;
+        mCompressionStats.rawSize += count * sizeof(AnimationKey<T>);
+        if(count == 0)
+        {
+            return track;
+        }
 
-            assert(ticks >= curKey.time);
-            // Interpolate between them
-            float diff = nextKey.time - curKey.time;
-            if(diff < 0)
+        std::vector<T> values(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            values[i] = keys[i].value;
+        }
+        makeContinuous(values);
+
+        // A constant track is stored as a single key. Its value lives in the offset, so it's exact.
+        bool constant = true;
+        for(uint32_t i = 1; i < count && constant; i++)
+        {
+            constant = getError(values[0], values[i]) <= tolerance;
+        }
+
+        if(constant)
+        {
+            track.offset = toVec4(values[0]);
+            track.scale = glm::vec4(0);
+            track.keyCount = 1;
+            track.firstValue = uint32_t(mValues.size());
+            mTimes.push_back(keys[0].time);
+            mValues.insert(mValues.end(), getComponentCount<T>(), 0);
+            return track;
+        }
+
+        // Quantize relative to the track's range
+        glm::vec4 minValue(std::numeric_limits<float>::max());
+        glm::vec4 maxValue(-std::numeric_limits<float>::max());
+        for(const auto& v : values)
+        {
+            minValue = glm::min(minValue, toVec4(v));
+            maxValue = glm::max(maxValue, toVec4(v));
+        }
+        track.offset = minValue;
+        track.scale = (maxValue - minValue) / kQuantizedMax;
+
+        std::vector<uint16_t> quantized(count * getComponentCount<T>());
+        std::vector<T> decoded(count);
+        for(uint32_t i = 0; i < count && track.quantized; i++)
+        {
+            uint16_t* pValue = quantized.data() + i * getComponentCount<T>();
+            encodeValue(values[i], track.offset, track.scale, pValue);
+            decodeValue(pValue, track.offset, track.scale, decoded[i]);
+            track.quantized = getError(decoded[i], values[i]) <= tolerance;
+        }
+
+        // Large ranges, such as root motion, can't be quantized within the tolerance
+        if(track.quantized == false)
+        {
+            decoded = values;
+        }
+
+        // Remove the keys which can be reconstructed by interpolating the kept keys around them. The first and last keys are always kept, so the wrap-around segment is unchanged.
+        auto canRemoveKeys = [&](uint32_t start, uint32_t end)
+        {
+            float diff = keys[end].time - keys[start].time;
+            if(diff <= 0)
+            {
+                return false;
+            }
+            for(uint32_t k = start + 1; k < end; k++)
             {
-                diff += mDuration;
+                float ratio = (keys[k].time - keys[start].time) / diff;
+                if(getError(interpolate(decoded[start], decoded[end], ratio), values[k]) > tolerance)
+                {
+                    return false;
+                }
             }
-            else if(diff == 0)
+            return true;
+        };
+
+        std::vector<uint32_t> keptKeys(1, 0);
+        for(uint32_t end = 2; end < count; end++)
+        {
+            if(canRemoveKeys(keptKeys.back(), end) == false)
             {
-                curValue = curKey.value;
+                keptKeys.push_back(end - 1);
+            }
+        }
+        if(count > 1)
+        {
+            keptKeys.push_back(count - 1);
+        }
+
+        track.firstValue = uint32_t(track.quantized ? mValues.size() : mFloatValues.size());
+        for(uint32_t k : keptKeys)
+        {
+            mTimes.push_back(keys[k].time);
+            if(track.quantized)
+            {
+                const uint16_t* pValue = quantized.data() + k * getComponentCount<T>();
+                mValues.insert(mValues.end(), pValue, pValue + getComponentCount<T>());
             }
             else
             {
-                float ratio = (ticks - curKey.time) / diff;
-                curValue = interpolate(curKey.value, nextKey.value, ratio);
+                glm::vec4 v = toVec4(values[k]);
+                mFloatValues.insert(mFloatValues.end(), &v[0], &v[0] + getComponentCount<T>());
             }
-            channel.lastKeyUsed = curKeyIndex;
         }
-        return curValue;
+        track.keyCount = uint32_t(keptKeys.size());
+        return track;
     }
 
-    void Animation::animate(double totalTime, AnimationController* pAnimationController)
+    // Most exporters sample the clips at whole ticks. When every key is on a whole tick the times are stored as 16-bit integers, otherwise they are kept as floats.
+    void Animation::quantizeKeyTimes()
     {
-        // Calculate the relative time
-        float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+        std::vector<uint16_t> quantized(mTimes.size());
+        for(size_t i = 0; i < mTimes.size(); i++)
+        {
+            if(mTimes[i] < 0 || mTimes[i] > kQuantizedMax || mTimes[i] != floor(mTimes[i]))
+            {
+                return;
+            }
+            quantized[i] = uint16_t(mTimes[i]);
+        }
+
+        mQuantizedTimes = std::move(quantized);
+        mTimes.clear();
+        mTimes.shrink_to_fit();
+    }
+
+    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond, const CompressionDesc& compression) : mName(name), mDuration(duration), mTicksPerSecond(ticksPerSecond)
+    {
+        mBoneTracks.reserve(animationSets.size());
+        for(const auto& set : animationSets)
+        {
+            if(set.boneID == (uint32_t)-1)
+            {
+                continue;
+            }
+
+            BoneTracks tracks;
+            tracks.boneID = set.boneID;
+            tracks.translation = compressTrack(set.translation, compression.translationTolerance);
+            tracks.scaling = compressTrack(set.scaling, compression.scalingTolerance);
+            tracks.rotation = compressTrack(set.rotation, compression.rotationTolerance);
+            mBoneTracks.push_back(tracks);
+        }
+        mValues.shrink_to_fit();
+        mFloatValues.shrink_to_fit();
+        quantizeKeyTimes();
+
+        mCompressionStats.keyCount = uint32_t(mTimes.size() + mQuantizedTimes.size());
+        mCompressionStats.compressedSize = mTimes.size() * sizeof(float) + mQuantizedTimes.size() * sizeof(uint16_t) + mValues.size() * sizeof(uint16_t) + mFloatValues.size() * sizeof(float) + mBoneTracks.size() * sizeof(BoneTracks);
+
+        // Measure the error against the source keys
+        size_t trackIndex = 0;
+        for(const auto& set : animationSets)
+        {
+            if(set.boneID == (uint32_t)-1)
+            {
+                continue;
+            }
+            const BoneTracks& tracks = mBoneTracks[trackIndex++];
+            mCompressionStats.maxTranslationError = std::max(mCompressionStats.maxTranslationError, measureError(set.translation, tracks.translation));
+            mCompressionStats.maxScalingError = std::max(mCompressionStats.maxScalingError, measureError(set.scaling, tracks.scaling));
+            mCompressionStats.maxRotationError = std::max(mCompressionStats.maxRotationError, measureError(set.rotation, tracks.rotation));
+        }
+    }
+
+    Animation::~Animation() = default;
+
+    // Find the last key with time <= ticks
+    template<typename TimeType>
+    static uint32_t findKey(const TimeType* pTimes, uint32_t count, float ticks, uint32_t& cursor)
+    {
+        // When playing forward, the answer is usually the key we used last frame or the one after it
+        uint32_t key = cursor;
+        if(key < count && pTimes[key] <= ticks)
+        {
+            if(key + 1 == count || ticks < pTimes[key + 1])
+            {
+                return key;
+            }
+            if(key + 2 == count || ticks < pTimes[key + 2])
+            {
+                cursor = key + 1;
+                return cursor;
+            }
+        }
+
+        key = uint32_t(std::upper_bound(pTimes, pTimes + count, ticks) - pTimes);
+        cursor = key ? key - 1 : 0;
+        return cursor;
+    }
 
-        for(auto& Key : mAnimationSets)
+    // Decode the two keys around the time straight from the compressed arrays
+    template<typename T, typename TimeType, typename ValueType>
+    static T sampleKeys(const TimeType* pTimes, const ValueType* pValues, uint32_t keyCount, const glm::vec4& offset, const glm::vec4& scale, float ticks, float duration, uint32_t& cursor)
+    {
+        const uint32_t componentCount = getComponentCount<T>();
+        uint32_t curKey = findKey(pTimes, keyCount, ticks, cursor);
+        uint32_t nextKey = (curKey + 1 == keyCount) ? 0 : curKey + 1;
+
+        T curValue;
+        decodeValue(pValues + curKey * componentCount, offset, scale, curValue);
+
+        // The last key interpolates towards the first one, wrapping around the end of the animation
+        float curTime = float(pTimes[curKey]);
+        float diff = float(pTimes[nextKey]) - curTime;
+        if(diff < 0)
+        {
+            diff += duration;
+        }
+        if(diff <= 0 || ticks <= curTime)
         {
-            glm::mat4 translation;
-            translation[3] = glm::vec4(calcCurrentKey(Key.translation, ticks, Key.lastUpdateTime), 1);
-            glm::mat4 scaling = glm::scale(calcCurrentKey(Key.scaling, ticks, Key.lastUpdateTime));
-            glm::quat q = calcCurrentKey(Key.rotation, ticks, Key.lastUpdateTime);
-            glm::mat4 rotation = glm::mat4_cast(q);
+            return curValue;
+        }
+
+        T nextValue;
+        decodeValue(pValues + nextKey * componentCount, offset, scale, nextValue);
+        return interpolate(curValue, nextValue, (ticks - curTime) / diff);
+    }
 
-            Key.lastUpdateTime = ticks;
+    template<typename T, typename ValueType>
+    T Animation::sampleTrack(const Track& track, const ValueType* pValues, float ticks, uint32_t& cursor) const
+    {
+        if(mQuantizedTimes.empty())
+        {
+            return sampleKeys<T>(mTimes.data() + track.firstKey, pValues, track.keyCount, track.offset, track.scale, ticks, mDuration, cursor);
+        }
+        return sampleKeys<T>(mQuantizedTimes.data() + track.firstKey, pValues, track.keyCount, track.offset, track.scale, ticks, mDuration, cursor);
+    }
 
-            glm::mat4 T = translation * rotation * scaling;
-            pAnimationController->setBoneLocalTransform(Key.boneID, T);
+    template<typename T>
+    T Animation::sampleTrack(const Track& track, float ticks, uint32_t& cursor, const T& defaultValue) const
+    {
+        if(track.keyCount == 0)
+        {
+            return defaultValue;
+        }
+        if(track.quantized)
+        {
+            return sampleTrack<T>(track, mValues.data() + track.firstValue, ticks, cursor);
+        }
+        return sampleTrack<T>(track, mFloatValues.data() + track.firstValue, ticks, cursor);
+    }
+
+    template<typename T>
+    float Animation::measureError(const AnimationChannel<T>& channel, const Track& track) const
+    {
+        float maxError = 0;
+        uint32_t cursor = 0;
+        for(const auto& key : channel.keys)
+        {
+            T value = sampleTrack(track, glm::clamp(key.time, 0.0f, mDuration), cursor, key.value);
+            maxError = std::max(maxError, getError(value, key.value));
+        }
+        return maxError;
+    }
+
+    void Animation::animate(double totalTime, uint32_t* pKeyCursors, BonePose* pPoses) const
+    {
+        // Calculate the relative time
+        float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+
+        for(const auto& tracks : mBoneTracks)
+        {
+            BonePose& pose = pPoses[tracks.boneID];
+            pose.translation = sampleTrack(tracks.translation, ticks, pKeyCursors[0], glm::vec3(0));
+            pose.scaling = sampleTrack(tracks.scaling, ticks, pKeyCursors[1], glm::vec3(1));
+            pose.rotation = sampleTrack(tracks.rotation, ticks, pKeyCursors[2], glm::quat());
+            pKeyCursors += 3;
         }
     }
 }
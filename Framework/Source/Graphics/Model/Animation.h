@@ -28,12 +28,30 @@
 #pragma once
 #include <vector>
 #include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
 #include "glm/gtc/quaternion.hpp"
 
 namespace Falcor
 {
     class AnimationController;
 
+    /** A row-major 3x4 affine transform. The last row is implicitly (0, 0, 0, 1).
+        Used by the animation system to evaluate bone hierarchies with SSE.
+    */
+    struct alignas(16) AffineTransform
+    {
+        glm::vec4 rows[3] = { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) };
+    };
+
+    /** A bone's local transform, kept decomposed so that poses can be blended. The transform is translation * rotation * scaling.
+    */
+    struct BonePose
+    {
+        glm::vec3 translation = glm::vec3(0);
+        glm::quat rotation = glm::quat();
+        glm::vec3 scaling = glm::vec3(1);
+    };
+
     class Animation
     {
     public:
@@ -51,33 +69,105 @@ namespace Falcor
         struct AnimationChannel
         {
             std::vector<AnimationKey<T>> keys;
-            uint32_t lastKeyUsed = 0;
         };
 
         struct AnimationSet
         {
-            uint32_t boneID;
+            uint32_t boneID = (uint32_t)-1; // Sets with an invalid bone ID are ignored
             AnimationChannel<glm::vec3> translation;
             AnimationChannel<glm::vec3> scaling;
             AnimationChannel<glm::quat> rotation;
-            float lastUpdateTime = 0;
+        };
+
+        /** Controls the lossy compression applied when the animation is created. Keys which can be reconstructed by interpolating the keys around them are removed, and the remaining values are quantized to 16 bits per component when the track's range allows it.
+        */
+        struct CompressionDesc
+        {
+            float translationTolerance = 1e-3f; ///< Max translation error, in the units of the bone's parent space
+            float rotationTolerance = 1e-3f;    ///< Max rotation error, in radians
+            float scalingTolerance = 1e-3f;     ///< Max scaling error
+        };
+
+        /** Compression results, measured when the animation is created
+        */
+        struct CompressionStats
+        {
+            size_t rawSize = 0;             ///< Size of the source keys in bytes
+            size_t compressedSize = 0;      ///< Size of the compressed tracks in bytes
+            uint32_t rawKeyCount = 0;       ///< Number of source keys
+            uint32_t keyCount = 0;          ///< Number of keys left after key reduction
+            float maxTranslationError = 0;  ///< Max joint-space errors, measured at the source key times
+            float maxRotationError = 0;     ///< Radians
+            float maxScalingError = 0;
         };
 
         static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
+        static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond, const CompressionDesc& compression);
         ~Animation();
-        void animate(double totalTime, AnimationController* pAnimationController);
+
+        /** Evaluate the animation and write the poses of the animated bones. Only the keys around the current time are decoded from the compressed tracks. The animation itself is not modified, so it can be evaluated concurrently for different controllers and instances.
+            \param[in] totalTime The global time in seconds
+            \param[in,out] pKeyCursors Per-channel cache of the last key used, getKeyCursorCount() elements. Speeds up the key search when playing forward. Initialize to zero.
+            \param[in,out] pPoses The local bone poses, indexed by bone ID. Bones the animation doesn't affect are left untouched.
+        */
+        void animate(double totalTime, uint32_t* pKeyCursors, BonePose* pPoses) const;
+
+        /** Get the number of key cursors animate() expects
+        */
+        uint32_t getKeyCursorCount() const { return uint32_t(mBoneTracks.size() * 3); }
+
         const std::string& getName() const { return mName; }
 
+        /** Get the compression results
+        */
+        const CompressionStats& getCompressionStats() const { return mCompressionStats; }
+
     private:
-        Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
-        
+        Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond, const CompressionDesc& compression);
+
+        // A range of keys in the key arrays. Quantized values are relative to the track's range, value = offset + quantized * scale.
+        struct Track
+        {
+            uint32_t firstKey = 0;
+            uint32_t keyCount = 0;
+            uint32_t firstValue = 0;
+            bool quantized = true;
+            glm::vec4 offset;
+            glm::vec4 scale;
+        };
+
+        template<typename T>
+        Track compressTrack(const AnimationChannel<T>& channel, float tolerance);
+        void quantizeKeyTimes();
+
+        template<typename T>
+        T sampleTrack(const Track& track, float ticks, uint32_t& cursor, const T& defaultValue) const;
+        template<typename T, typename ValueType>
+        T sampleTrack(const Track& track, const ValueType* pValues, float ticks, uint32_t& cursor) const;
+
+        template<typename T>
+        float measureError(const AnimationChannel<T>& channel, const Track& track) const;
+
+        struct BoneTracks
+        {
+            uint32_t boneID;
+            Track translation;
+            Track scaling;
+            Track rotation;
+        };
+
         const std::string mName;
         float mDuration;
         float mTicksPerSecond;
 
-        std::vector<AnimationSet> mAnimationSets;
-
-        template<typename _KeyType>
-        _KeyType calcCurrentKey(AnimationChannel<_KeyType>& channel, float ticks, float lastUpdateTime);
+        // The keys of all the channels are stored back-to-back, with the times and values in separate arrays so the key search only touches the times.
+        // The times are stored as 16-bit integers when all the keys are on whole ticks, otherwise as floats. Values use 3 or 4 components per key, quantized
+        // to 16 bits unless the track's range is too large for the tolerance.
+        std::vector<BoneTracks> mBoneTracks;
+        std::vector<uint16_t> mQuantizedTimes;
+        std::vector<float> mTimes;
+        std::vector<uint16_t> mValues;
+        std::vector<float> mFloatValues;
+        CompressionStats mCompressionStats;
     };
 }
\ No newline at end of file
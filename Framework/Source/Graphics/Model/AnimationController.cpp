@@ -27,10 +27,12 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "AnimationController.h"
-#include "Model.h"
 #include <fstream>
 #include "Animation.h"
+#include "Utils/ThreadPool.h"
 #include <algorithm>
+#include <immintrin.h>
+#include "glm/gtx/matrix_decompose.hpp"
 
 namespace Falcor
 {
@@ -71,10 +73,123 @@ namespace Falcor
         return UniquePtr(new AnimationController(other.mBones));
     }
 
+    static AffineTransform toAffine(const glm::mat4& m)
+    {
+        AffineTransform a;
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            a.rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        }
+        return a;
+    }
+
+    static AffineTransform toAffine(const BonePose& pose)
+    {
+        glm::mat3 r = glm::mat3_cast(pose.rotation);
+        AffineTransform a;
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            a.rows[i] = glm::vec4(r[0][i] * pose.scaling.x, r[1][i] * pose.scaling.y, r[2][i] * pose.scaling.z, pose.translation[i]);
+        }
+        return a;
+    }
+
+    static BonePose toPose(const glm::mat4& m)
+    {
+        BonePose pose;
+        glm::vec3 skew;
+        glm::vec4 perspective;
+        if(glm::decompose(m, pose.scaling, pose.rotation, pose.translation, skew, perspective) == false)
+        {
+            logError("AnimationController: can't decompose a bone transform. Using identity instead.");
+            pose = BonePose();
+        }
+        return pose;
+    }
+
+    static BonePose blend(const BonePose& a, const BonePose& b, float weight)
+    {
+        BonePose pose;
+        pose.translation = glm::mix(a.translation, b.translation, weight);
+        pose.rotation = glm::slerp(a.rotation, b.rotation, weight);
+        pose.scaling = glm::mix(a.scaling, b.scaling, weight);
+        return pose;
+    }
+
+    // c = a * b. The rows of c are linear combinations of the rows of b
+    static void multiply(const AffineTransform& a, const AffineTransform& b, AffineTransform& c)
+    {
+        const __m128 b0 = _mm_load_ps(&b.rows[0].x);
+        const __m128 b1 = _mm_load_ps(&b.rows[1].x);
+        const __m128 b2 = _mm_load_ps(&b.rows[2].x);
+        const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            const __m128 r = _mm_load_ps(&a.rows[i].x);
+            __m128 res = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+            res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+            res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+            // The implicit last row of b is (0, 0, 0, 1), so a's translation only adds to w
+            res = _mm_add_ps(res, _mm_and_ps(r, wMask));
+            _mm_store_ps(&c.rows[i].x, res);
+        }
+    }
+
+    // Transpose the rows into the columns of a glm::mat4
+    static void storeMatrix(const AffineTransform& a, glm::mat4& m)
+    {
+        __m128 r0 = _mm_load_ps(&a.rows[0].x);
+        __m128 r1 = _mm_load_ps(&a.rows[1].x);
+        __m128 r2 = _mm_load_ps(&a.rows[2].x);
+        __m128 r3 = _mm_set_ps(1, 0, 0, 0);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&m[0][0], r0);
+        _mm_storeu_ps(&m[1][0], r1);
+        _mm_storeu_ps(&m[2][0], r2);
+        _mm_storeu_ps(&m[3][0], r3);
+    }
+
+    // Concatenate the poses down the hierarchy, then apply the offsets. Parents precede their children. store(boneID, transform) receives the bone matrices.
+    template<typename StoreFunc>
+    static void evaluateHierarchy(const std::vector<uint32_t>& parentIDs, const BonePose* pPoses, const AffineTransform* pOffsets, const AffineTransform* pRoot, AffineTransform* pGlobals, StoreFunc store)
+    {
+        for(uint32_t i = 0; i < parentIDs.size(); i++)
+        {
+            AffineTransform local = toAffine(pPoses[i]);
+            uint32_t parentID = parentIDs[i];
+            if(parentID != AnimationController::kInvalidBoneID)
+            {
+                multiply(pGlobals[parentID], local, pGlobals[i]);
+            }
+            else if(pRoot)
+            {
+                multiply(*pRoot, local, pGlobals[i]);
+            }
+            else
+            {
+                pGlobals[i] = local;
+            }
+
+            AffineTransform boneTransform;
+            multiply(pGlobals[i], pOffsets[i], boneTransform);
+            store(i, boneTransform);
+        }
+    }
+
     AnimationController::AnimationController(const std::vector<Bone>& Bones)
     {
         mBones = Bones;
         mBoneTransforms.resize(mBones.size());
+        mGlobalTransforms.resize(mBones.size());
+        for(const auto& bone : mBones)
+        {
+            assert(bone.parentID == kInvalidBoneID || bone.parentID < mParentIDs.size());
+            mParentIDs.push_back(bone.parentID);
+            mOffsets.push_back(toAffine(bone.offset));
+            mBindPoses.push_back(toPose(bone.originalLocalTransform));
+            mLocalPoses.push_back(toPose(bone.localTransform));
+        }
         setActiveAnimation(kBindPoseAnimationId);
     }
 
@@ -88,25 +203,96 @@ namespace Falcor
     void AnimationController::setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform)
     {
         assert(boneID < mBones.size());
-        mBones[boneID].localTransform = transform;
+        mLocalPoses[boneID] = toPose(transform);
+    }
+
+    void AnimationController::calculateBoneTransforms()
+    {
+        evaluateHierarchy(mParentIDs, mLocalPoses.data(), mOffsets.data(), nullptr, mGlobalTransforms.data(), [this](uint32_t boneID, const AffineTransform& transform)
+        {
+            storeMatrix(transform, mBoneTransforms[boneID]);
+        });
+        mVersion++;
     }
 
     void AnimationController::animate(double currentTime)
     {
         if(mActiveAnimation != kBindPoseAnimationId)
         {
-            mAnimations[mActiveAnimation]->animate(currentTime, this);
+            mAnimations[mActiveAnimation]->animate(currentTime, mKeyCursors.data(), mLocalPoses.data());
+        }
+        calculateBoneTransforms();
+    }
+
+    void AnimationController::animate(AnimationController* const* pControllers, uint32_t count, double currentTime, ThreadPool* pPool)
+    {
+        if(pPool == nullptr)
+        {
+            pPool = ThreadPool::getDefault();
+        }
+
+        // Controllers are independent, so a few of them per task keeps the scheduling overhead low without starving threads
+        pPool->parallelFor(count, 4, [pControllers, currentTime](uint32_t first, uint32_t last)
+        {
+            for(uint32_t i = first; i < last; i++)
+            {
+                pControllers[i]->animate(currentTime);
+            }
+        });
+    }
+
+    uint32_t AnimationController::getKeyCursorCount(const InstanceState& state) const
+    {
+        uint32_t count = 0;
+        if(state.animationID != kBindPoseAnimationId)
+        {
+            count += mAnimations[state.animationID]->getKeyCursorCount();
         }
+        if(state.blendWeight > 0 && state.blendAnimationID != kBindPoseAnimationId)
+        {
+            count += mAnimations[state.blendAnimationID]->getKeyCursorCount();
+        }
+        return count;
+    }
 
-        for(uint32_t i = 0; i < mBones.size(); i++)
+    void AnimationController::animateInstance(const InstanceState& state, double currentTime, const glm::mat4& instanceTransform, uint32_t* pKeyCursors, AffineTransform* pBoneTransforms) const
+    {
+        assert(state.animationID == kBindPoseAnimationId || state.animationID < mAnimations.size());
+        assert(state.blendAnimationID == kBindPoseAnimationId || state.blendAnimationID < mAnimations.size());
+
+        // Per-thread scratch, so evaluating many instances doesn't allocate
+        thread_local std::vector<BonePose> poses;
+        thread_local std::vector<BonePose> blendPoses;
+        thread_local std::vector<AffineTransform> globals;
+
+        // Bones an animation doesn't affect stay in the bind pose
+        const double time = currentTime + state.timeOffset;
+        poses.assign(mBindPoses.begin(), mBindPoses.end());
+        if(state.animationID != kBindPoseAnimationId)
         {
-            mBones[i].globalTransform = mBones[i].localTransform;
-            if(mBones[i].parentID != kInvalidBoneID)
+            mAnimations[state.animationID]->animate(time, pKeyCursors, poses.data());
+            pKeyCursors += mAnimations[state.animationID]->getKeyCursorCount();
+        }
+
+        if(state.blendWeight > 0)
+        {
+            blendPoses.assign(mBindPoses.begin(), mBindPoses.end());
+            if(state.blendAnimationID != kBindPoseAnimationId)
+            {
+                mAnimations[state.blendAnimationID]->animate(time, pKeyCursors, blendPoses.data());
+            }
+            for(uint32_t i = 0; i < poses.size(); i++)
             {
-                mBones[i].globalTransform = mBones[mBones[i].parentID].globalTransform * mBones[i].globalTransform;
+                poses[i] = blend(poses[i], blendPoses[i], state.blendWeight);
             }
-            mBoneTransforms[i] = mBones[i].globalTransform * mBones[i].offset;
         }
+
+        globals.resize(mParentIDs.size());
+        const AffineTransform root = toAffine(instanceTransform);
+        evaluateHierarchy(mParentIDs, poses.data(), mOffsets.data(), &root, globals.data(), [pBoneTransforms](uint32_t boneID, const AffineTransform& transform)
+        {
+            pBoneTransforms[boneID] = transform;
+        });
     }
 
     void AnimationController::setActiveAnimation(uint32_t id)
@@ -115,10 +301,12 @@ namespace Falcor
         mActiveAnimation = id;
         if(id == kBindPoseAnimationId)
         {
-            for(auto& bone : mBones)
-            {
-                bone.localTransform = bone.originalLocalTransform;
-            }
+            mLocalPoses = mBindPoses;
+            mKeyCursors.clear();
+        }
+        else
+        {
+            mKeyCursors.assign(mAnimations[id]->getKeyCursorCount(), 0);
         }
         animate(0);
     }
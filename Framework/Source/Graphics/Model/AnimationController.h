@@ -46,6 +46,7 @@ namespace Falcor
 
     class Model;
     class AssimpModelImporter;
+    class ThreadPool;
 
     class AnimationController
     {
@@ -55,6 +56,16 @@ namespace Falcor
         static const uint32_t kInvalidBoneID = -1;
         static const uint32_t kBindPoseAnimationId = -1;
 
+        /** The animation state of a single model instance. Instances with their own state animate independently of the controller's active animation, see animateInstance().
+        */
+        struct InstanceState
+        {
+            uint32_t animationID = kBindPoseAnimationId;        ///< The animation to play
+            double timeOffset = 0;                              ///< Added to the global time, so instances playing the same animation can be out of sync
+            uint32_t blendAnimationID = kBindPoseAnimationId;   ///< A second animation, blended with the first one
+            float blendWeight = 0;                              ///< The weight of blendAnimationID. 0 plays animationID only, 1 plays blendAnimationID only.
+        };
+
         static UniquePtr create(const std::vector<Bone>& bones);
         static UniquePtr create(const AnimationController& other);
         ~AnimationController();
@@ -62,8 +73,34 @@ namespace Falcor
         void addAnimation(Animation::UniquePtr pAnimation);
         void animate(double currentTime);
 
+        /** Animate a batch of controllers. The controllers are split across the threads of the pool.
+            \param[in] pControllers The controllers to animate. A controller must not appear more than once.
+            \param[in] count The number of controllers
+            \param[in] currentTime The current global time
+            \param[in] pPool The thread pool to use. If nullptr, the default pool is used.
+        */
+        static void animate(AnimationController* const* pControllers, uint32_t count, double currentTime, ThreadPool* pPool = nullptr);
+
+        /** Evaluate the bone matrices of a model instance. The controller isn't modified, so different instances can be evaluated concurrently.
+            \param[in] state The instance's animation state
+            \param[in] currentTime The current global time
+            \param[in] instanceTransform The instance's world transform. It is applied on top of the bone matrices.
+            \param[in,out] pKeyCursors The instance's key cursors, getKeyCursorCount(state) elements. Initialize to zero.
+            \param[out] pBoneTransforms getBoneCount() matrices
+        */
+        void animateInstance(const InstanceState& state, double currentTime, const glm::mat4& instanceTransform, uint32_t* pKeyCursors, AffineTransform* pBoneTransforms) const;
+
+        /** Get the number of key cursors animateInstance() expects for a state
+        */
+        uint32_t getKeyCursorCount(const InstanceState& state) const;
+
+        /** Get a counter which is incremented every time the bone matrices are recalculated
+        */
+        uint32_t getVersion() const { return mVersion; }
+
         uint32_t getAnimationCount() const { return uint32_t(mAnimations.size()); }
         const std::string& getAnimationName(uint32_t ID) const;
+        const Animation* getAnimation(uint32_t ID) const { return mAnimations[ID].get(); }
         void setActiveAnimation(uint32_t id);
         uint32_t getActiveAnimation() const {return mActiveAnimation;}
 
@@ -80,7 +117,16 @@ namespace Falcor
         std::vector<glm::mat4> mBoneTransforms;
         std::vector<Animation::UniquePtr> mAnimations;
 
+        // The hierarchy, stored as arrays so the per-frame pass only touches what it needs. Parents precede their children.
+        std::vector<uint32_t> mParentIDs;
+        std::vector<AffineTransform> mOffsets;
+        std::vector<BonePose> mBindPoses;
+        std::vector<BonePose> mLocalPoses;
+        std::vector<AffineTransform> mGlobalTransforms;
+        std::vector<uint32_t> mKeyCursors;
+
         uint32_t mActiveAnimation = kBindPoseAnimationId;
+        uint32_t mVersion = 0;
 
         void calculateBoneTransforms();
     };
@@ -34,13 +34,18 @@
 #include "../Animation.h"
 #include "../Mesh.h"
 #include "../AnimationController.h"
+#include "../TangentSpace.h"
+#include "../MeshOptimizer.h"
 #include "glm/common.hpp"
 #include "glm/geometric.hpp"
 #include "API/Texture.h"
 #include "API/Buffer.h"
 #include "glm/matrix.hpp"
 #include "Utils/OS.h"
+#include "Utils/CpuTimer.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
+#include "Graphics/TextureBaker.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
@@ -57,15 +62,7 @@ namespace Falcor
 
     using VertexIdsVec = std::vector<uvec8_4>;
 
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData);
-
+    std::vector<uint8_t> createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
 
     void loadBones(const aiMesh* pAiMesh, VertexWeightsVec& weights, VertexIdsVec& ids, uint32_t vertexCount, const std::map<std::string, uint32_t>& boneNameToIdMap)
     {
@@ -147,7 +144,7 @@ namespace Falcor
         return indices;
     }
 
-    void genTangentSpace(const aiMesh* pAiMesh)
+    void genTangentSpace(const aiMesh* pAiMesh, const std::vector<uint32_t>& indices, ThreadPool* pPool)
     {
         if (pAiMesh->mFaces[0].mNumIndices == 3)
         {
@@ -157,7 +154,6 @@ namespace Falcor
             const glm::vec3* pPos = (glm::vec3*)pMesh->mVertices;
             glm::vec3* pBi = (glm::vec3*)pMesh->mBitangents;
             glm::vec3* pNormals = (glm::vec3*)pMesh->mNormals;
-            std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
 
             uint32_t texCrdCount = 0;
             std::vector<glm::vec2> texCrd;
@@ -171,7 +167,15 @@ namespace Falcor
                 }
             }
 
-            generateSubmeshTangentData<glm::vec3>(indices, pPos, pNormals, (texCrdCount > 0 ? texCrd.data() : nullptr), texCrdCount, pBi);
+            TangentSpace::MeshData data;
+            data.pIndices = indices.data();
+            data.indexCount = (uint32_t)indices.size();
+            data.vertexCount = pMesh->mNumVertices;
+            data.pPositions = (const float*)pPos;
+            data.pNormals = pNormals;
+            data.pTexCrd = (texCrdCount > 0 ? texCrd.data() : nullptr);
+            data.texCrdStride = texCrdCount;
+            TangentSpace::generateBitangents(data, pBi, TangentSpace::Flags::None, pPool);
         }
     }
 
@@ -293,9 +297,24 @@ namespace Falcor
                 }
                 else
                 {
-                    // create a new texture
+                    // create a new texture. Image files were already decoded on the thread pool
                     std::string fullpath = folder + '\\' + s;
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
+                    const auto& decoded = mDecodedBitmaps.find(s);
+                    if (decoded != mDecodedBitmaps.end())
+                    {
+                        // Models loaded concurrently can decode the same image. Reuse the texture if another model created it first, so the cache keeps a single copy
+                        pTex = TextureCache::findFile(fullpath, true, isSrgbRequired(aiType, useSrgb), Texture::BindFlags::ShaderResource);
+                        if (pTex == nullptr)
+                        {
+                            pTex = createTextureFromBitmap(decoded->second.get(), fullpath, true, isSrgbRequired(aiType, useSrgb));
+                        }
+                        mDecodedBitmaps.erase(decoded);
+                    }
+                    else
+                    {
+                        pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
+                    }
+
                     if (pTex)
                     {
                         mTextureCache[s] = pTex;
@@ -457,7 +476,7 @@ namespace Falcor
                 if (aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
                 {
                     // Cache mesh
-                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
+                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId], mDecodedMeshes[aiId]);
                 }
 
                 mModel.addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
@@ -475,7 +494,6 @@ namespace Falcor
 
     bool AssimpModelImporter::createDrawList(const aiScene* pScene)
     {
-        createAnimationController(pScene);
         IdToMesh aiToFalcorMeshId;
         aiNode* pRoot = pScene->mRootNode;
         return parseAiSceneNode(pRoot, pScene, aiToFalcorMeshId);
@@ -511,6 +529,9 @@ namespace Falcor
         // Never use Assimp's tangent gen code
         AssimpFlags &= ~(aiProcess_CalcTangentSpace);
 
+        Stats stats;
+        CpuTimer::TimePoint stageStart = CpuTimer::getCurrentTimePoint();
+
         Assimp::Importer importer;
         const aiScene* pScene = importer.ReadFile(fullpath, AssimpFlags);
 
@@ -526,22 +547,45 @@ namespace Falcor
         auto last = fullpath.find_last_of("/\\");
         std::string modelFolder = fullpath.substr(0, last);
 
-        // Order of initialization matters, materials, bones and animations need to loaded before mesh initialization
-        bool isObjFile = hasSuffix(filename, ".obj", false);
+        // Order of initialization matters, bones need to be initialized before the meshes are decoded
+        createAnimationController(pScene);
+
+        CpuTimer::TimePoint stageEnd = CpuTimer::getCurrentTimePoint();
+        stats.parseTime = CpuTimer::calcDuration(stageStart, stageEnd);
+        stageStart = stageEnd;
+
         bool useSrgbTextures = !is_set(mFlags, Model::LoadFlags::AssumeLinearSpaceTextures);
-        if(createAllMaterials(pScene, modelFolder, isObjFile, useSrgbTextures) == false)
-        {
-            logError(std::string("Can't create materials for model ") + filename, true);
-            return false;
-        }
+        decodeTextures(pScene, modelFolder, useSrgbTextures);
+        decodeMeshes(pScene);
 
-        if (createDrawList(pScene) == false)
+        stats.decodeTime = CpuTimer::calcDuration(stageStart, CpuTimer::getCurrentTimePoint());
+
+        // When the import runs on a loading thread, this stage runs on the thread which owns the deferred create stage
+        bool success = false;
+        bool created = runCreateStage([&]()
         {
-            logError(std::string("Can't create draw lists for model ") + filename, true);
-            return false;
-        }
+            CpuTimer::TimePoint createStart = CpuTimer::getCurrentTimePoint();
 
-        return true;
+            // Materials need to be created before the meshes
+            bool isObjFile = hasSuffix(filename, ".obj", false);
+            if(createAllMaterials(pScene, modelFolder, isObjFile, useSrgbTextures) == false)
+            {
+                logError(std::string("Can't create materials for model ") + filename, true);
+                return;
+            }
+
+            if (createDrawList(pScene) == false)
+            {
+                logError(std::string("Can't create draw lists for model ") + filename, true);
+                return;
+            }
+
+            stats.createTime = CpuTimer::calcDuration(createStart, CpuTimer::getCurrentTimePoint());
+            success = true;
+        });
+
+        addStats(stats);
+        return created && success;
     }
 
     bool AssimpModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags)
@@ -720,40 +764,201 @@ namespace Falcor
         return BoundingBox::fromMinMax(boxMin, boxMax);
     }
 
-    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh)
+    void AssimpModelImporter::decodeTextures(const aiScene* pScene, const std::string& folder, bool useSrgb)
+    {
+        // Collect the image files referenced by the materials. DDS files are uploaded as-is and don't need decoding
+        std::vector<std::string> names;
+        for (uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[m];
+            for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
+            {
+                aiTextureType aiType = (aiTextureType)i;
+                if (pAiMaterial->GetTextureCount(aiType) != 1)
+                {
+                    continue;
+                }
+
+                aiString path;
+                pAiMaterial->GetTexture(aiType, 0, &path);
+                std::string s(path.data);
+                if (s.empty() || hasSuffix(s, ".dds", false) || mDecodedBitmaps.find(s) != mDecodedBitmaps.end() || mTextureCache.find(s) != mTextureCache.end())
+                {
+                    continue;
+                }
+
+                // Textures which were loaded by other models don't need to be decoded again
+                const std::string fullpath = folder + '\\' + s;
+                Texture::SharedPtr pCached = TextureCache::findFile(fullpath, true, isSrgbRequired(aiType, useSrgb), Texture::BindFlags::ShaderResource);
+                if (pCached)
+                {
+                    mTextureCache[s] = pCached;
+                    continue;
+                }
+
+                // Baked textures are loaded without decoding when the materials are created
+                if (TextureBaker::hasBakedFile(fullpath, isSrgbRequired(aiType, useSrgb)))
+                {
+                    continue;
+                }
+
+                mDecodedBitmaps[s] = nullptr;
+                names.push_back(s);
+            }
+        }
+
+        std::vector<Bitmap::UniqueConstPtr> bitmaps(names.size());
+        getThreadPool()->parallelFor((uint32_t)names.size(), 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                bitmaps[i] = loadBitmapForTexture(folder + '\\' + names[i]);
+            }
+        });
+
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            mDecodedBitmaps[names[i]] = std::move(bitmaps[i]);
+        }
+    }
+
+    void AssimpModelImporter::decodeMeshes(const aiScene* pScene)
+    {
+        mDecodedMeshes.resize(pScene->mNumMeshes);
+
+        // Large meshes generate their tangents up-front, when they can use the entire pool
+        if (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false)
+        {
+            for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
+            {
+                const aiMesh* pAiMesh = pScene->mMeshes[i];
+                if (pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices >= TangentSpace::kMinParallelIndexCount)
+                {
+                    mDecodedMeshes[i].indices = createIndexBufferData(pAiMesh);
+                    genTangentSpace(pAiMesh, mDecodedMeshes[i].indices, getThreadPool());
+                }
+            }
+        }
+
+        getThreadPool()->parallelFor(pScene->mNumMeshes, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                decodeMesh(pScene->mMeshes[i], mDecodedMeshes[i]);
+            }
+        });
+    }
+
+    bool AssimpModelImporter::decodeMesh(const aiMesh* pAiMesh, MeshData& data)
     {
         uint32_t vertexCount = pAiMesh->mNumVertices;
-        uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-        auto pIB = createIndexBuffer(pAiMesh);
-        BoundingBox boundingBox = createMeshBbox(pAiMesh);
+        data.boundingBox = createMeshBbox(pAiMesh);
 
-        if(is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false)
+        // The indices are already set if decodeMeshes() generated the tangents
+        bool genTangents = is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false;
+        if (data.indices.empty())
         {
-            genTangentSpace(pAiMesh);
+            data.indices = createIndexBufferData(pAiMesh);
+            if (genTangents)
+            {
+                genTangentSpace(pAiMesh, data.indices, getThreadPool());
+            }
         }
 
-        VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh);
-        if (pLayout == nullptr)
+        data.pLayout = createVertexLayout(pAiMesh);
+        if (data.pLayout)
         {
-            assert(0);
-            return nullptr;
+            // Initialize the bones data
+            VertexWeightsVec weights;
+            VertexIdsVec ids;
+            if (pAiMesh->HasBones())
+            {
+                loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+            }
+
+            // Fill the vertex buffers
+            data.vertexData.resize(data.pLayout->getBufferCount());
+            for (uint32_t i = 0; i < data.pLayout->getBufferCount(); i++)
+            {
+                const VertexBufferLayout* pVbLayout = data.pLayout->getBufferLayout(i).get();
+                data.vertexData[i] = createVertexBufferData(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            }
+
+            // The tangents are already generated, they depend on the triangle order
+            if (is_set(mFlags, Model::LoadFlags::OptimizeMeshes) && pAiMesh->mFaces[0].mNumIndices == 3)
+            {
+                optimizeMesh(pAiMesh, data);
+            }
+
+            if (is_set(mFlags, Model::LoadFlags::QuantizeVertexAttributes | Model::LoadFlags::QuantizePositions))
+            {
+                quantizeMesh(pAiMesh, data);
+            }
         }
 
-        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
+        if (genTangents)
+        {
+            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
+            safe_delete_array(pM->mBitangents);
+        }
 
-        // Initialize the bones data
-        VertexWeightsVec weights;
-        VertexIdsVec ids;
-        if (pAiMesh->HasBones())
+        return data.pLayout != nullptr;
+    }
+
+    void AssimpModelImporter::optimizeMesh(const aiMesh* pAiMesh, MeshData& data)
+    {
+        const uint32_t vertexCount = pAiMesh->mNumVertices;
+        const uint32_t indexCount = (uint32_t)data.indices.size();
+        MeshOptimizer::optimizeTriangleOrder(data.indices.data(), indexCount, vertexCount, &pAiMesh->mVertices[0].x, sizeof(aiVector3D));
+
+        std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexOrder(data.indices.data(), indexCount, vertexCount);
+        for (uint32_t i = 0; i < data.pLayout->getBufferCount(); i++)
+        {
+            MeshOptimizer::remapVertices(remap, data.pLayout->getBufferLayout(i)->getStride(), data.vertexData[i]);
+        }
+
+        if (MeshOptimizer::canUseShortIndices(vertexCount))
         {
-            loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+            data.shortIndices.assign(data.indices.begin(), data.indices.end());
         }
+    }
+
+    void AssimpModelImporter::quantizeMesh(const aiMesh* pAiMesh, MeshData& data)
+    {
+        // Each mesh creates its own layout, it can be replaced
+        VertexLayout::SharedPtr pLayout = VertexLayout::create();
+        if (is_set(mFlags, Model::LoadFlags::QuantizePositions))
+        {
+            data.positionTransform = VertexQuantization::calcPositionTransform(&pAiMesh->mVertices[0].x, sizeof(aiVector3D), pAiMesh->mNumVertices);
+        }
+
+        for (uint32_t i = 0; i < data.pLayout->getBufferCount(); i++)
+        {
+            pLayout->addBufferLayout(i, VertexQuantization::quantizeBuffer(data.pLayout->getBufferLayout(i), mFlags, data.positionTransform, data.vertexData[i]));
+        }
+        data.pLayout = pLayout;
+    }
+
+    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh, const MeshData& data)
+    {
+        uint32_t vertexCount = pAiMesh->mNumVertices;
+        uint32_t indexCount = (uint32_t)data.indices.size();
+
+        VertexLayout::SharedPtr pLayout = data.pLayout;
+        if (pLayout == nullptr)
+        {
+            assert(0);
+            return nullptr;
+        }
+
+        auto pIB = createIndexBuffer(data);
+        ResourceFormat ibFormat = data.shortIndices.empty() ? ResourceFormat::R32Uint : ResourceFormat::R16Uint;
 
         // Create corresponding vertex buffers
+        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
         for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
         {
-            const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            pVBs[i] = createVertexBuffer(data.vertexData[i]);
         }
 
         Vao::Topology topology;
@@ -776,27 +981,30 @@ namespace Falcor
         auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
         assert(pMaterial);
 
-        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
-
-        if (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false)
-        {
-            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
-            safe_delete_array(pM->mBitangents);
-        }
-
+        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, data.boundingBox, pAiMesh->HasBones(), ibFormat);
+        pMesh->mPositionScale = data.positionTransform.scale;
+        pMesh->mPositionOffset = data.positionTransform.offset;
         return pMesh;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
+    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const MeshData& data)
     {
-        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
-        const uint32_t size = (uint32_t)(sizeof(uint32_t) * indices.size());
         Buffer::BindFlags bindFlags = Buffer::BindFlags::Index;
         if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
-        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data());;
+
+        if (data.shortIndices.empty())
+        {
+            const uint32_t size = (uint32_t)(sizeof(uint32_t) * data.indices.size());
+            return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, data.indices.data());
+        }
+        else
+        {
+            const uint32_t size = (uint32_t)(sizeof(uint16_t) * data.shortIndices.size());
+            return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, data.shortIndices.data());
+        }
     }
 
 
@@ -866,7 +1074,7 @@ namespace Falcor
         return pLayout;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
+    std::vector<uint8_t> createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
     {
         const uint32_t vertexStride = pLayout->getStride();
         std::vector<uint8_t> initData(vertexStride * pAiMesh->mNumVertices, 0);
@@ -925,12 +1133,17 @@ namespace Falcor
                 memcpy(pDst, pSrc, size);
             }
         }
+        return initData;
+    }
+
+    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const std::vector<uint8_t>& vertexData)
+    {
         Buffer::BindFlags bindFlags = Buffer::BindFlags::Vertex;
         if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
 
-        return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data());;
+        return Buffer::create(vertexData.size(), bindFlags, Buffer::CpuAccess::None, vertexData.data());
     }
 }
\ No newline at end of file
@@ -32,6 +32,8 @@
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "../VertexQuantization.h"
+#include "Utils/Bitmap.h"
 
 struct aiScene;
 struct aiNode;
@@ -60,6 +62,18 @@ namespace Falcor
 
         using IdToMesh = std::unordered_map<uint32_t, Mesh::SharedPtr>;
 
+        /** CPU data of a mesh, prepared on the thread pool before the GPU resources are created
+        */
+        struct MeshData
+        {
+            std::vector<uint32_t> indices;
+            std::vector<uint16_t> shortIndices;             // Used instead of 'indices' when the mesh was optimized and has few enough vertices
+            BoundingBox boundingBox;
+            VertexLayout::SharedPtr pLayout;
+            std::vector<std::vector<uint8_t>> vertexData;   // One per buffer in pLayout
+            VertexQuantization::PositionTransform positionTransform;
+        };
+
         AssimpModelImporter(Model& model, Model::LoadFlags flags);
         AssimpModelImporter(const AssimpModelImporter&) = delete;
         void operator=(const AssimpModelImporter&) = delete;
@@ -76,10 +90,16 @@ namespace Falcor
 
         Animation::UniquePtr createAnimation(const aiAnimation* pAiAnim);
 
-        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh);
+        void decodeTextures(const aiScene* pScene, const std::string& folder, bool useSrgb);
+        void decodeMeshes(const aiScene* pScene);
+        bool decodeMesh(const aiMesh* pAiMesh, MeshData& data);
+        void optimizeMesh(const aiMesh* pAiMesh, MeshData& data);
+        void quantizeMesh(const aiMesh* pAiMesh, MeshData& data);
+
+        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh, const MeshData& data);
         VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
+        Buffer::SharedPtr createIndexBuffer(const MeshData& data);
+        Buffer::SharedPtr createVertexBuffer(const std::vector<uint8_t>& vertexData);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, BasicMaterial* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
 
@@ -91,5 +111,7 @@ namespace Falcor
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+        std::map<const std::string, Bitmap::UniqueConstPtr> mDecodedBitmaps;
+        std::vector<MeshData> mDecodedMeshes;
     };
 }
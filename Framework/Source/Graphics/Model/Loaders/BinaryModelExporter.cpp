@@ -276,7 +276,17 @@ namespace Falcor
             const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(i).get();
             assert(pLayout->getElementCount() == 1);
             AttribType type = getBinaryAttribType(pLayout->getElementName(0));
-            AttribFormat format = GetBinaryAttribFormat(pLayout->getElementFormat(0));
+            AttribFormat format = AttribFormat_Max;
+            switch(pLayout->getElementFormat(0))
+            {
+            case ResourceFormat::RGBA16Unorm:
+            case ResourceFormat::RGB10A2Unorm:
+            case ResourceFormat::RG16Float:
+                error("Binary format doesn't support quantized vertex attributes");
+                return false;
+            default:
+                format = GetBinaryAttribFormat(pLayout->getElementFormat(0));
+            }
             uint32_t channels = getFormatChannelCount(pLayout->getElementFormat(0));
 
             if(type == AttribType_Max)
@@ -353,8 +363,18 @@ namespace Falcor
         mStream << (int32_t)primCount;
 
         // Output the index buffer
+        // The file format always uses 32-bit indices
         const void* pIndices = pMesh->getVao()->getIndexBuffer()->map(Buffer::MapType::Read);
-        mStream.write(pIndices, indexCount * sizeof(uint32_t));
+        if(pMesh->getVao()->getIndexBufferFormat() == ResourceFormat::R16Uint)
+        {
+            const uint16_t* pShortIndices = (const uint16_t*)pIndices;
+            std::vector<uint32_t> indices(pShortIndices, pShortIndices + indexCount);
+            mStream.write(indices.data(), indexCount * sizeof(uint32_t));
+        }
+        else
+        {
+            mStream.write(pIndices, indexCount * sizeof(uint32_t));
+        }
         pMesh->getVao()->getIndexBuffer()->unmap();
 
         return true;
@@ -31,6 +31,7 @@
 #include "../Model.h"
 #include "../Mesh.h"
 #include "Utils/OS.h"
+#include "Utils/CpuTimer.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "API/Buffer.h"
@@ -39,7 +40,11 @@
 #include "API/Formats.h"
 #include "API/Texture.h"
 #include "Graphics/Material/Material.h"
+#include "Graphics/TextureCache.h"
 #include "glm/geometric.hpp"
+#include "../TangentSpace.h"
+#include "../MeshOptimizer.h"
+#include "../VertexQuantization.h"
 
 namespace Falcor
 {
@@ -48,122 +53,14 @@ namespace Falcor
         uint32_t width  = 0;
         uint32_t height = 0;
         ResourceFormat format = ResourceFormat::Unknown;
-        std::vector<uint8_t> data;
+        const uint8_t* pData = nullptr;     // Points either into the mapped file or into 'storage'
+        std::vector<uint8_t> storage;
+        size_t dataSize = 0;
+        bool expandRgb = false;             // 3-channel data which is padded to 4 channels in the decode stage
+        uint64_t hash = 0;                  // Content hash, used to share the texture with other models
         std::string name;
     };
 
-    bool isSpecialFloat(float f)
-    {
-        uint32_t d = *(uint32_t*)&f;
-        // Check the exponent
-        d = (d >> 23) & 0xff;
-        return d == 0xff;
-    }
-
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData)
-    {
-        // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
-        for(size_t primID = 0; primID < primCount; primID++)
-        {
-            struct Data
-            {
-                posType position;
-                glm::vec3 normal;
-                glm::vec2 uv;
-            };
-            Data V[3];
-
-            // Get the data
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                uint32_t index = indices[primID * 3 + i];
-                V[i].position = vertexPosData[index];
-                V[i].normal = vertexNormalData[index];
-
-                if(texCrdData)
-                {
-                    V[i].uv = texCrdData[index * texCrdCount];
-                }
-                else
-                {
-                    V[i].uv = glm::vec2(0.f, 0.f);
-                }
-            }
-
-            // Position delta
-            posType posDelta[2];
-            posDelta[0] = V[1].position - V[0].position;
-            posDelta[1] = V[2].position - V[0].position;
-
-            // Texture offset
-            glm::vec2 s = V[1].uv - V[0].uv;
-            glm::vec2 t = V[2].uv - V[0].uv;
-            s.y = -s.y;
-            t.y = -t.y;
-
-            glm::vec3 tangent;
-            glm::vec3 bitangent;
-
-            // when t1, t2, t3 in same position in UV space, just use default UV direction.
-            if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
-            {
-				const glm::vec3 &normal = V[0].normal;
-				if(abs(normal.x) > abs(normal.y))
-					bitangent = v3(normal.z, 0.f, -normal.x) / length(v2(normal.x, normal.z));
-				else
-					bitangent = v3(0.f, normal.z, -normal.y) / length(v2(normal.y, normal.z));
-				tangent = cross(bitangent, normal);
-            }
-			else
-			{
-				float dirCorrection = (t.x * s.y - t.y * s.x) < 0.0f ? -1.0f : 1.0f;
-
-				// tangent points in the direction where to positive X axis of the texture coord's would point in model space
-				// bitangent's points along the positive Y axis of the texture coord's, respectively
-				tangent.x = (posDelta[1].x * s.y - posDelta[0].x * t.y) * dirCorrection;
-				tangent.y = (posDelta[1].y * s.y - posDelta[0].y * t.y) * dirCorrection;
-				tangent.z = (posDelta[1].z * s.y - posDelta[0].z * t.y) * dirCorrection;
-
-				bitangent.x = (posDelta[1].x * s.x - posDelta[0].x * t.x) * dirCorrection;
-				bitangent.y = (posDelta[1].y * s.x - posDelta[0].y * t.x) * dirCorrection;
-				bitangent.z = (posDelta[1].z * s.x - posDelta[0].z * t.x) * dirCorrection;
-			}
-
-            // store for every vertex of that face
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                // project tangent and bitangent into the plane formed by the vertex' normal
-                glm::vec3 localTangent = tangent - V[i].normal * (glm::dot(tangent, V[i].normal));
-                localTangent = glm::normalize(localTangent);
-                glm::vec3 localBitangent = bitangent - V[i].normal * (glm::dot(bitangent, V[i].normal));
-                localBitangent = glm::normalize(localBitangent);
-                localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
-                localBitangent = glm::normalize(localBitangent);
-
-                // reconstruct tangent/bitangent according to normal and bitangent/tangent when it's infinite or NaN.
-                bool isInvalidBitangent = isSpecialFloat(localBitangent.x) || isSpecialFloat(localBitangent.y) || isSpecialFloat(localBitangent.z);
-
-                if (isInvalidBitangent)
-                {
-                    localBitangent = glm::cross(localTangent, V[i].normal);
-                    localBitangent = glm::normalize(localBitangent);
-                }
-
-                // and write it into the mesh
-                uint32_t index = indices[primID * 3 + i];
-                bitangentData[index] = localBitangent;
-            }
-        }
-    }
-
     static BasicMaterial::MapType getFalcorMapType(TextureType map)
     {
         switch(map)
@@ -341,17 +238,35 @@ namespace Falcor
         }
     }
 
-    std::string readString(BinaryFileStream& stream)
+    // Check that count records of at least recordSize bytes fit in the rest of the file. This is done before any count * size product is computed, so the products can't overflow.
+    static bool fitsInFile(const BinaryFileReader& stream, uint64_t count, uint64_t recordSize)
+    {
+        return (recordSize == 0) || (count <= stream.getRemainingSize() / recordSize);
+    }
+
+    // The smallest possible size of a few records, used to reject corrupted counts before allocating
+    static const uint64_t kMinTextureSize = sizeof(int32_t) + 8 + 5 * sizeof(int32_t);    // Name length, tag, version, width, height, bpp, channel count
+    static const uint64_t kMinMeshSize = 3 * sizeof(int32_t);                             // Attribute, vertex and submesh counts
+    static const uint64_t kMinAttribSize = 3 * sizeof(int32_t);                           // Type, format, length
+    static const uint64_t kMinSubmeshSize = 2 * sizeof(glm::vec3) + sizeof(glm::vec4) + sizeof(float) + sizeof(int32_t);  // Colors, glossiness, triangle count
+
+    std::string readString(BinaryFileReader& stream)
     {
         int32_t length;
         stream >> length;
+        if(length < 0 || (uint64_t)length > stream.getRemainingSize())
+        {
+            // Corrupted length. Skipping past the end of the file sets the fail flag, which the caller checks
+            stream.skip((size_t)-1);
+            return std::string();
+        }
         std::vector<char> charVec(length + 1);
         stream.read(&charVec[0], length);
         charVec[length] = 0;
         return std::string(charVec.data());
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    bool loadBinaryTextureData(BinaryFileReader& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
         char tag[9];
@@ -431,35 +346,74 @@ namespace Falcor
             formatId = format.getID();
         data.format = getTextureFormat(FW::ImageFormat::ID(formatId));
 
-        // Image data.
-        const int32_t texelCount = data.width * data.height;
+        // Image data. The texel count comes from the file, so the size math is done in 64 bits and checked against the file size
+        const uint64_t texelCount = (uint64_t)data.width * data.height;
+        if(fitsInFile(stream, texelCount, bpp) == false)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (image size is larger than the file).";
+            logError(msg);
+            return false;
+        }
+
+        // The texture is created from requiredSize bytes, so the data stored in the file can't be smaller than that
+        uint64_t requiredSize = bpp * texelCount;
+        if(isCompressedFormat(data.format))
+        {
+            const uint32_t widthRatio = getFormatWidthCompressionRatio(data.format);
+            const uint32_t heightRatio = getFormatHeightCompressionRatio(data.format);
+            requiredSize = (uint64_t)((data.width + widthRatio - 1) / widthRatio) * ((data.height + heightRatio - 1) / heightRatio) * getFormatBytesPerBlock(data.format);
+        }
         if(dataSize == -1)
         {
-            dataSize = bpp * texelCount;
+            dataSize = (int32_t)requiredSize;
+        }
+        if((uint64_t)dataSize > stream.getRemainingSize() || (uint64_t)dataSize < requiredSize)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (image size doesn't match the image dimensions).";
+            logError(msg);
+            return false;
+        }
+
+        // Use the data in-place if possible. RGB data is expanded to RGBX in place, so the storage must hold the larger of the two
+        data.expandRgb = (bpp == 3);
+        data.dataSize = dataSize;
+        data.pData = stream.readInPlace(dataSize);
+        if(data.pData == nullptr)
+        {
+            data.storage.resize(std::max((size_t)dataSize, data.expandRgb ? (size_t)(4 * texelCount) : 0));
+            stream.read(data.storage.data(), dataSize);
+            data.pData = data.storage.data();
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
-            storageSize = 4 * texelCount;
 
-        data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        return stream.isFail() == false;
+    }
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
-        if(bpp == 3)
+    void decodeTextureData(TextureData& data)
+    {
+        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding. Going backwards allows in-place conversion of streamed data
+        if(data.expandRgb)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            const uint8_t* pSrc = data.pData;
+            const size_t texelCount = (size_t)data.width * data.height;
+            data.storage.resize(4 * texelCount);
+            for(size_t i = texelCount; i-- > 0;)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
+                data.storage[i * 4 + 0] = pSrc[i * 3 + 0];
+                data.storage[i * 4 + 1] = pSrc[i * 3 + 1];
+                data.storage[i * 4 + 2] = pSrc[i * 3 + 2];
+                data.storage[i * 4 + 3] = 0xff;
             }
+            data.pData = data.storage.data();
+            data.dataSize = data.storage.size();
         }
 
-        return true;
+        if(TextureCache::isEnabled())
+        {
+            data.hash = TextureCache::hashImage(data.pData, data.dataSize);
+        }
     }
 
-    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
+    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileReader& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
 
@@ -475,7 +429,9 @@ namespace Falcor
         return true;
     }
 
-    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
+    uint64_t BinaryModelImporter::sMappingBudget = BinaryFileReader::kDefaultMappingBudget;
+
+    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath, sMappingBudget)
     {
     }
 
@@ -544,8 +500,238 @@ namespace Falcor
         }
     }
     
+    // The import runs in 3 stages. The parse stage walks the file and records where the data of every mesh and texture is. The decode stage processes
+    // the meshes and textures in parallel. The create stage creates the GPU resources and the model on the calling thread.
+    struct BinarySubmeshData
+    {
+        BasicMaterial material;
+        int32_t texIDs[TextureType_Max];
+        uint32_t numIndices = 0;
+        const uint32_t* pIndices = nullptr;     // Points either into the mapped file or into 'streamedIndices'
+        std::vector<uint32_t> streamedIndices;
+        std::vector<uint16_t> shortIndices;     // Replaces 'pIndices' when the mesh was optimized and has few enough vertices
+        BoundingBox box;
+    };
+
+    struct BinaryMeshData
+    {
+        struct BufferData
+        {
+            std::vector<uint8_t> vec;
+            bool shouldSkip = false;
+            uint32_t elementSize = 0;
+        };
+
+        int32_t numVertices = 0;
+        VertexLayout::SharedPtr pLayout;
+        std::vector<BufferData> buffers;
+        uint32_t numAttribs = 0;
+        uint32_t vertexStride = 0;
+        const uint8_t* pVertexData = nullptr;   // Interleaved. Points either into the mapped file or into 'streamedVertices'
+        std::vector<uint8_t> streamedVertices;
+
+        uint32_t positionBufferIndex = kInvalidBufferIndex;
+        uint32_t normalBufferIndex = kInvalidBufferIndex;
+        uint32_t bitangentBufferIndex = kInvalidBufferIndex;
+        uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+        bool genTangents = false;
+        VertexQuantization::PositionTransform positionTransform;
+
+        std::vector<BinarySubmeshData> submeshes;
+
+        static const uint32_t kInvalidBufferIndex = (uint32_t)-1;
+    };
+
+    uint32_t getMeshIndexCount(const BinaryMeshData& mesh)
+    {
+        uint32_t indexCount = 0;
+        for(const auto& submesh : mesh.submeshes)
+        {
+            indexCount += submesh.numIndices;
+        }
+        return indexCount;
+    }
+
+    void generateMeshTangents(BinaryMeshData& mesh, ThreadPool* pPool)
+    {
+        ResourceFormat posFormat = mesh.pLayout->getBufferLayout(mesh.positionBufferIndex)->getElementFormat(0);
+        if(posFormat != ResourceFormat::RGB32Float && posFormat != ResourceFormat::RGBA32Float)
+        {
+            return;
+        }
+
+        TangentSpace::MeshData data;
+        data.vertexCount = mesh.numVertices;
+        data.pPositions = (const float*)mesh.buffers[mesh.positionBufferIndex].vec.data();
+        data.positionStride = (posFormat == ResourceFormat::RGB32Float) ? sizeof(glm::vec3) : sizeof(glm::vec4);
+        data.pNormals = (const glm::vec3*)mesh.buffers[mesh.normalBufferIndex].vec.data();
+        if(mesh.texCoordBufferIndex != BinaryMeshData::kInvalidBufferIndex)
+        {
+            data.pTexCrd = (const glm::vec2*)mesh.buffers[mesh.texCoordBufferIndex].vec.data();
+            data.texCrdStride = mesh.pLayout->getBufferLayout(mesh.texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
+        }
+        glm::vec3* pBitangents = (glm::vec3*)mesh.buffers[mesh.bitangentBufferIndex].vec.data();
+
+        // Submeshes share the vertices, so they are processed in order
+        for(const auto& submesh : mesh.submeshes)
+        {
+            data.pIndices = submesh.pIndices;
+            data.indexCount = submesh.numIndices;
+            TangentSpace::generateBitangents(data, pBitangents, TangentSpace::Flags::None, pPool);
+        }
+    }
+
+    void optimizeMesh(BinaryMeshData& mesh)
+    {
+        // Submeshes share the vertices. The triangles are reordered per submesh, the vertices by their first use across all of them
+        std::vector<uint32_t> indices;
+        indices.reserve(getMeshIndexCount(mesh));
+        for(const auto& submesh : mesh.submeshes)
+        {
+            indices.insert(indices.end(), submesh.pIndices, submesh.pIndices + submesh.numIndices);
+        }
+
+        // The overdraw ordering needs float positions. Without them the triangles are only ordered for the vertex cache
+        const float* pPositions = nullptr;
+        uint32_t positionStride = 0;
+        if(mesh.positionBufferIndex != BinaryMeshData::kInvalidBufferIndex)
+        {
+            ResourceFormat posFormat = mesh.pLayout->getBufferLayout(mesh.positionBufferIndex)->getElementFormat(0);
+            if(posFormat == ResourceFormat::RGB32Float || posFormat == ResourceFormat::RGBA32Float)
+            {
+                pPositions = (const float*)mesh.buffers[mesh.positionBufferIndex].vec.data();
+                positionStride = mesh.buffers[mesh.positionBufferIndex].elementSize;
+            }
+        }
+
+        uint32_t offset = 0;
+        for(const auto& submesh : mesh.submeshes)
+        {
+            MeshOptimizer::optimizeTriangleOrder(indices.data() + offset, submesh.numIndices, (uint32_t)mesh.numVertices, pPositions, positionStride);
+            offset += submesh.numIndices;
+        }
+
+        std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexOrder(indices.data(), (uint32_t)indices.size(), (uint32_t)mesh.numVertices);
+        for(auto& buffer : mesh.buffers)
+        {
+            if(buffer.shouldSkip == false)
+            {
+                MeshOptimizer::remapVertices(remap, buffer.elementSize, buffer.vec);
+            }
+        }
+
+        offset = 0;
+        for(auto& submesh : mesh.submeshes)
+        {
+            const uint32_t* pOptimized = indices.data() + offset;
+            if(MeshOptimizer::canUseShortIndices((uint32_t)mesh.numVertices))
+            {
+                submesh.shortIndices.assign(pOptimized, pOptimized + submesh.numIndices);
+                submesh.streamedIndices = std::vector<uint32_t>();
+                submesh.pIndices = nullptr;
+            }
+            else
+            {
+                submesh.streamedIndices.assign(pOptimized, pOptimized + submesh.numIndices);
+                submesh.pIndices = submesh.streamedIndices.data();
+            }
+            offset += submesh.numIndices;
+        }
+    }
+
+    void quantizeMesh(BinaryMeshData& mesh, Model::LoadFlags flags)
+    {
+        if(is_set(flags, Model::LoadFlags::QuantizePositions))
+        {
+            ResourceFormat posFormat = mesh.pLayout->getBufferLayout(mesh.positionBufferIndex)->getElementFormat(0);
+            if(posFormat == ResourceFormat::RGB32Float || posFormat == ResourceFormat::RGBA32Float)
+            {
+                const auto& positions = mesh.buffers[mesh.positionBufferIndex];
+                mesh.positionTransform = VertexQuantization::calcPositionTransform((const float*)positions.vec.data(), positions.elementSize, mesh.numVertices);
+            }
+        }
+
+        // The submeshes share the layout, it's replaced before any of them is created
+        VertexLayout::SharedPtr pLayout = VertexLayout::create();
+        for(uint32_t i = 0; i < (uint32_t)mesh.buffers.size(); i++)
+        {
+            auto& buffer = mesh.buffers[i];
+            VertexBufferLayout::SharedConstPtr pBufferLayout = mesh.pLayout->getBufferLayout(i);
+            if(buffer.shouldSkip == false)
+            {
+                pBufferLayout = VertexQuantization::quantizeBuffer(pBufferLayout, flags, mesh.positionTransform, buffer.vec);
+                buffer.elementSize = pBufferLayout->getStride();
+            }
+            pLayout->addBufferLayout(i, pBufferLayout);
+        }
+        mesh.pLayout = pLayout;
+    }
+
+    bool decodeMeshData(BinaryMeshData& mesh, ThreadPool* pPool)
+    {
+        // De-interleave directly from the file data into the per-attribute buffers
+        uint32_t attribOffset = 0;
+        for(uint32_t attributes = 0; attributes < mesh.numAttribs; ++attributes)
+        {
+            const uint32_t elementSize = mesh.buffers[attributes].elementSize;
+            if(mesh.buffers[attributes].shouldSkip == false)
+            {
+                const uint8_t* pSrc = mesh.pVertexData + attribOffset;
+                mesh.buffers[attributes].vec.resize((size_t)elementSize * mesh.numVertices);
+                uint8_t* pDest = mesh.buffers[attributes].vec.data();
+                for(int32_t i = 0; i < mesh.numVertices; i++)
+                {
+                    std::memcpy(pDest, pSrc, elementSize);
+                    pDest += elementSize;
+                    pSrc += mesh.vertexStride;
+                }
+            }
+            attribOffset += elementSize;
+        }
+        mesh.streamedVertices = std::vector<uint8_t>();
+
+        const VertexBufferLayout* pPositionLayout = mesh.pLayout->getBufferLayout(mesh.positionBufferIndex).get();
+        const uint8_t* pPositions = mesh.buffers[mesh.positionBufferIndex].vec.data();
+
+        for(auto& submesh : mesh.submeshes)
+        {
+            // The indices come straight from the file and are used to address the vertices below
+            for(uint32_t i = 0; i < submesh.numIndices; i++)
+            {
+                if(submesh.pIndices[i] >= (uint32_t)mesh.numVertices)
+                {
+                    return false;
+                }
+            }
+
+            // Calculate the bounding-box
+            glm::vec3 max, min;
+            for(uint32_t i = 0; i < submesh.numIndices; i++)
+            {
+                uint32_t vertexID = submesh.pIndices[i];
+                const float* pPosition = (const float*)(pPositions + pPositionLayout->getStride() * vertexID);
+
+                glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
+                min = glm::min(min, xyz);
+                max = glm::max(max, xyz);
+            }
+
+            submesh.box = BoundingBox::fromMinMax(min, max);
+        }
+
+        // Large meshes generate their tangents after the decode loop, when they can use the entire pool
+        if(mesh.genTangents && getMeshIndexCount(mesh) < TangentSpace::kMinParallelIndexCount)
+        {
+            generateMeshTangents(mesh, pPool);
+        }
+        return true;
+    }
+
     bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags)
     {
+        Stats stats;
+        CpuTimer::TimePoint stageStart = CpuTimer::getCurrentTimePoint();
+
         // Format ID and version.
         char formatID[9];
         mStream.read(formatID, 8);
@@ -602,7 +788,7 @@ namespace Falcor
             }
         }
 
-        if(numTextures < 0 || numMeshes < 0 || numInstances < 0)
+        if(mStream.isFail() || numTextures < 0 || numMeshes < 0 || numInstances < 0 || fitsInFile(mStream, numTextures, kMinTextureSize) == false || fitsInFile(mStream, numMeshes, kMinMeshSize) == false)
         {
             std::string msg = "Error when loading model " + mModelName + ".\nFile is corrupted.";
             logError(msg);
@@ -616,34 +802,19 @@ namespace Falcor
 
         if(version >= 6)
         {
-            importTextures(texData, numTextures, mStream, mModelName);
-        }
-
-        // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
-        // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes Falcor IDs. This is what the next 2 variables are for.
-        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
-
-        // This importer loads mesh/submesh data before instance data, so the meshes are cached here.
-        std::vector<Mesh::SharedPtr> falcorMeshCache;
-        
-        struct TexSignature
-        {
-            const uint8_t* pData;
-            ResourceFormat format;
-            bool operator<(const TexSignature& other) const 
-            { 
-                if(pData < other.pData) return true;
-                if(pData == other.pData) return format < other.format;
+            if(importTextures(texData, numTextures, mStream, mModelName) == false)
+            {
                 return false;
             }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
-        };
-        std::map<TexSignature, Texture::SharedPtr> textures;
-        bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
+        }
 
-        // Load the meshes
+        std::vector<BinaryMeshData> meshes(numMeshes);
+
+        // Parse the meshes
         for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
         {
+            BinaryMeshData& mesh = meshes[meshIdx];
+
             // Mesh header
             int32_t numAttribs = 0;
             int32_t numVertices = 0;
@@ -660,37 +831,22 @@ namespace Falcor
                 numSubmeshes = numSubmeshes_v5;
             }
 
-            if(numAttribs < 0 || numVertices < 0 || numSubmeshes < 0)
+            if(mStream.isFail() || numAttribs < 0 || numVertices < 0 || numSubmeshes < 0 || fitsInFile(mStream, numAttribs, kMinAttribSize) == false)
             {
                 std::string Msg = "Error when loading model " + mModelName + ".\nCorrupted data.!";
                 logError(Msg);
                 return false;
             }
 
-            Vao::BufferVec pVBs;
-            VertexLayout::SharedPtr pLayout = VertexLayout::create();
-            
-            struct BufferData
-            {
-                std::vector<uint8_t> vec;
-                bool shouldSkip = false;
-                uint32_t elementSize = 0;
-            };
-
-            std::vector<BufferData> buffers;
-            pVBs.resize(numAttribs);
-            buffers.resize(numAttribs);
-
-            const uint32_t kInvalidBufferIndex = (uint32_t)-1;
-            uint32_t positionBufferIndex = kInvalidBufferIndex;
-            uint32_t normalBufferIndex = kInvalidBufferIndex;
-            uint32_t bitangentBufferIndex = kInvalidBufferIndex;
-            uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+            mesh.numVertices = numVertices;
+            mesh.numAttribs = numAttribs;
+            mesh.pLayout = VertexLayout::create();
+            mesh.buffers.resize(numAttribs);
 
             for(int i = 0; i < numAttribs; i++)
             {
                 VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
-                pLayout->addBufferLayout(i, pBufferLayout);
+                mesh.pLayout->addBufferLayout(i, pBufferLayout);
                 int32_t type, format, length;
                 mStream >> type >> format >> length;
 
@@ -709,99 +865,101 @@ namespace Falcor
                     switch (shaderLocation)
                     {
                     case VERTEX_POSITION_LOC:
-                        positionBufferIndex = i;
+                        mesh.positionBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float);
                         break;
                     case VERTEX_NORMAL_LOC:
-                        normalBufferIndex = i;
+                        mesh.normalBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_BITANGENT_LOC:
-                        bitangentBufferIndex = i;
+                        mesh.bitangentBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_TEXCOORD_LOC:
-                        texCoordBufferIndex = i;
+                        mesh.texCoordBufferIndex = i;
                         break;
                     }
 
-                    buffers[i].elementSize = getFormatBytesPerBlock(falcorFormat);
+                    mesh.buffers[i].elementSize = getFormatBytesPerBlock(falcorFormat);
+                    mesh.vertexStride += mesh.buffers[i].elementSize;
                     if(shaderLocation != kUnusedShaderElement)
                     {
                         pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
                     }
                     else
                     {
-                        buffers[i].shouldSkip = true;
+                        mesh.buffers[i].shouldSkip = true;
                     }
                 }
             }
 
-            
+            if(mesh.positionBufferIndex == BinaryMeshData::kInvalidBufferIndex)
+            {
+                std::string msg = "Error when loading model " + mModelName + ".\nMesh " + std::to_string(meshIdx) + " doesn't have positions.";
+                logError(msg);
+                return false;
+            }
+
+            // The vertices are interleaved in the file. Validate the size before touching the data
+            if(mStream.isFail() || fitsInFile(mStream, numVertices, mesh.vertexStride) == false)
+            {
+                std::string msg = "Error when loading model " + mModelName + ".\nVertex data is larger than the file.";
+                logError(msg);
+                return false;
+            }
+            const uint64_t vertexDataSize = (uint64_t)mesh.vertexStride * numVertices;
+
             // Check if we need to generate tangents  
-            bool genTangentForMesh = false;
-            if(shouldGenerateTangents && (bitangentBufferIndex == kInvalidBufferIndex))
+            if(shouldGenerateTangents && (mesh.bitangentBufferIndex == BinaryMeshData::kInvalidBufferIndex))
             {
-                if(normalBufferIndex == kInvalidBufferIndex)
+                if(mesh.normalBufferIndex == BinaryMeshData::kInvalidBufferIndex)
                 {
                     logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
-                    genTangentForMesh = false;
                 }
                 else
                 {
                     // Set the offsets
-                    genTangentForMesh = true;
-                    bitangentBufferIndex = (uint32_t)pVBs.size();
-                    pVBs.resize(bitangentBufferIndex + 1);
-                    buffers.resize(bitangentBufferIndex + 1);
-                   
+                    mesh.genTangents = true;
+                    mesh.bitangentBufferIndex = (uint32_t)mesh.buffers.size();
+                    mesh.buffers.resize(mesh.bitangentBufferIndex + 1);
+
                     auto pBitangentLayout = VertexBufferLayout::create();
-                    pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
+                    mesh.pLayout->addBufferLayout(mesh.bitangentBufferIndex, pBitangentLayout);
                     pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
-                    buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
+                    mesh.buffers[mesh.bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
                 }
             }
-            
 
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+            mesh.pVertexData = mStream.readInPlace((size_t)vertexDataSize);
+            if(mesh.pVertexData == nullptr)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
-                {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
-                    {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
-                    }
-                }
+                mesh.streamedVertices.resize((size_t)vertexDataSize);
+                mStream.read(mesh.streamedVertices.data(), mesh.streamedVertices.size());
+                mesh.pVertexData = mesh.streamedVertices.data();
             }
 
-            for (int32_t i = 0; i < numAttribs; ++i)
+            if(version <= 5)
             {
-                if(buffers[i].shouldSkip == false)
+                if(importTextures(texData, numTextures, mStream, mModelName) == false)
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    return false;
                 }
             }
 
-            if(version <= 5)
+            // Array of Submesh.
+            // Falcor doesn't have a concept of submeshes, a new mesh is created for each submesh
+            if(fitsInFile(mStream, numSubmeshes, kMinSubmeshSize) == false)
             {
-                importTextures(texData, numTextures, mStream, mModelName);
-                textures.clear();
+                std::string msg = "Error when loading model " + mModelName + ".\nCorrupt binary mesh data!";
+                logError(msg);
+                return false;
             }
-
-            // Array of Submesh.
-            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
-            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            mesh.submeshes.resize(numSubmeshes);
+            for(int submeshIdx = 0; submeshIdx < numSubmeshes; submeshIdx++)
             {
-                // create the material
-                BasicMaterial basicMaterial;
+                BinarySubmeshData& submesh = mesh.submeshes[submeshIdx];
+                BasicMaterial& basicMaterial = submesh.material;
 
                 glm::vec3 ambient;
                 glm::vec4 diffuse;
@@ -833,38 +991,9 @@ namespace Falcor
                         logError(msg);
                         return false;
                     }
-                    else if(texID != -1)
-                    {
-                        BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
-                        if(BasicMaterial::MapType::Count == falcorType)
-                        {
-                            logWarning("Texture of Type " + std::to_string(i) + " is not supported by the material system (model " + mModelName + ")");
-                            continue;
-                        }
-
-                        // Load the texture
-                        TexSignature texSig;
-                        texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
-                        texSig.pData = texData[texID].data.data();
-                        // Check if we already created a matching texture
-                        auto existingTex = textures.find(texSig);
-                        if(existingTex != textures.end())
-                        {
-                            basicMaterial.pTextures[falcorType] = existingTex->second;
-                        }
-                        else
-                        {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
-                            textures[texSig] = pTexture;
-                            basicMaterial.pTextures[falcorType] = pTexture;
-                        }
-                    }
+                    submesh.texIDs[i] = texID;
                 }
 
-                // Create material and check if it already exists
-                auto pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
-
                 int32_t numTriangles;
                 mStream >> numTriangles;
                 if(numTriangles < 0)
@@ -874,71 +1003,34 @@ namespace Falcor
                     return false;
                 }
 
-                // create the index buffer
-                uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
-                uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
-
-                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
-
-                // Generate tangent space data if needed
-                if(genTangentForMesh)
+                if(mStream.isFail() || fitsInFile(mStream, numTriangles, 3 * sizeof(uint32_t)) == false)
                 {
-                    uint32_t texCrdCount = 0;
-                    glm::vec2* texCrd = nullptr;
-                    if(texCoordBufferIndex != kInvalidBufferIndex)
-                    {
-                        texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                        texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
-                    }
-
-                    ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
-
-                    if (posFormat == ResourceFormat::RGB32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec3>(indices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
-                    else if (posFormat == ResourceFormat::RGBA32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec4>(indices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
-
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
+                    std::string Msg = "Error when loading model " + mModelName + ".\nCorrupt binary mesh data!";
+                    logError(Msg);
+                    return false;
                 }
-                
+                submesh.numIndices = numTriangles * 3;
+                const size_t ibSize = (size_t)submesh.numIndices * sizeof(uint32_t);
 
-                // Calculate the bounding-box
-                glm::vec3 max, min;
-                for(uint32_t i = 0; i < numIndices; i++)
+                submesh.pIndices = (const uint32_t*)mStream.readInPlace(ibSize);
+                if(submesh.pIndices == nullptr)
                 {
-                    uint32_t vertexID = indices[i];
-                    uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
-
-                    float* pPosition = (float*)pVertex;
-
-                    glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
-                    min = glm::min(min, xyz);
-                    max = glm::max(max, xyz);
+                    submesh.streamedIndices.resize(submesh.numIndices);
+                    mStream.read(submesh.streamedIndices.data(), ibSize);
+                    submesh.pIndices = submesh.streamedIndices.data();
                 }
 
-                BoundingBox box = BoundingBox::fromMinMax(min, max);
-
-                // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
-
-                if (version >= 6)
-                {
-                    falcorMeshCache.push_back(pMesh);
-                    meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
-                }
-                else
-                {
-                    model.addMeshInstance(pMesh, glm::mat4());
-                }
             }
         }
 
+        // Instances
+        struct InstanceData
+        {
+            int32_t meshIdx;
+            glm::mat4 transformation;
+        };
+        std::vector<InstanceData> instances;
+
         if(version >= 6)
         {
             for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
@@ -952,16 +1044,201 @@ namespace Falcor
                 readString(mStream);   // Name
                 readString(mStream);   // Meta-data
 
-                if(enabled)
+                if(mStream.isFail() || meshIdx < -1 || meshIdx >= numMeshes)
                 {
-                    for(uint32_t i : meshToSubmeshesID[meshIdx])
+                    std::string msg = "Error when loading model " + mModelName + ".\nCorrupt instance data!";
+                    logError(msg);
+                    return false;
+                }
+
+                if(enabled && meshIdx != -1)
+                {
+                    instances.push_back({ meshIdx, transformation });
+                }
+            }
+        }
+        else
+        {
+            instances.push_back({ 0, glm::mat4() });
+        }
+
+        CpuTimer::TimePoint stageEnd = CpuTimer::getCurrentTimePoint();
+        stats.parseTime = CpuTimer::calcDuration(stageStart, stageEnd);
+        stageStart = stageEnd;
+
+        // Decode the textures and meshes. Every item is independent
+        const uint32_t textureCount = (uint32_t)texData.size();
+        std::atomic<bool> meshDataValid(true);
+        getThreadPool()->parallelFor(textureCount + (uint32_t)meshes.size(), 1, [&](uint32_t first, uint32_t last)
+        {
+            for(uint32_t i = first; i < last; i++)
+            {
+                if(i < textureCount)
+                {
+                    decodeTextureData(texData[i]);
+                }
+                else if(decodeMeshData(meshes[i - textureCount], getThreadPool()) == false)
+                {
+                    meshDataValid = false;
+                }
+            }
+        });
+
+        if(meshDataValid == false)
+        {
+            std::string msg = "Error when loading model " + mModelName + ".\nIndex is out of range!";
+            logError(msg);
+            return false;
+        }
+
+        for(auto& mesh : meshes)
+        {
+            if(mesh.genTangents && getMeshIndexCount(mesh) >= TangentSpace::kMinParallelIndexCount)
+            {
+                generateMeshTangents(mesh, getThreadPool());
+            }
+        }
+
+        // The tangent generation depends on the triangle order and on float vertex data, so the meshes are optimized and quantized afterwards
+        const bool optimize = is_set(flags, Model::LoadFlags::OptimizeMeshes);
+        const bool quantize = is_set(flags, Model::LoadFlags::QuantizeVertexAttributes | Model::LoadFlags::QuantizePositions);
+        if(optimize || quantize)
+        {
+            getThreadPool()->parallelFor((uint32_t)meshes.size(), 1, [&](uint32_t first, uint32_t last)
+            {
+                for(uint32_t i = first; i < last; i++)
+                {
+                    if(optimize)
                     {
-                        model.addMeshInstance(falcorMeshCache[i], transformation);
+                        optimizeMesh(meshes[i]);
+                    }
+                    if(quantize)
+                    {
+                        quantizeMesh(meshes[i], flags);
                     }
                 }
-            }
+            });
         }
-        
-        return true;
+
+        stats.decodeTime = CpuTimer::calcDuration(stageStart, CpuTimer::getCurrentTimePoint());
+
+        // Create the resources. When the import runs on a loading thread, this stage runs on the thread which owns the deferred create stage
+        bool created = runCreateStage([&]()
+        {
+            CpuTimer::TimePoint createStart = CpuTimer::getCurrentTimePoint();
+
+            struct TexSignature
+            {
+                const uint8_t* pData;
+                ResourceFormat format;
+                bool operator<(const TexSignature& other) const 
+                { 
+                    if(pData < other.pData) return true;
+                    if(pData == other.pData) return format < other.format;
+                    return false;
+                }
+                bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+            };
+            std::map<TexSignature, Texture::SharedPtr> textures;
+            bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
+
+            // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
+            // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes
+            std::vector<std::vector<Mesh::SharedPtr>> meshToSubmeshes(numMeshes);
+
+            for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+            {
+                BinaryMeshData& mesh = meshes[meshIdx];
+
+                Vao::BufferVec pVBs(mesh.buffers.size());
+                for(size_t i = 0; i < mesh.buffers.size(); ++i)
+                {
+                    if(mesh.buffers[i].shouldSkip == false)
+                    {
+                        pVBs[i] = Buffer::create(mesh.buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, mesh.buffers[i].vec.data());
+                    }
+                    mesh.buffers[i].vec = std::vector<uint8_t>();
+                }
+
+                for(auto& submesh : mesh.submeshes)
+                {
+                    BasicMaterial& basicMaterial = submesh.material;
+                    for(int i = 0; i < numTextureSlots; i++)
+                    {
+                        int32_t texID = submesh.texIDs[i];
+                        if(texID != -1)
+                        {
+                            BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
+                            if(BasicMaterial::MapType::Count == falcorType)
+                            {
+                                logWarning("Texture of Type " + std::to_string(i) + " is not supported by the material system (model " + mModelName + ")");
+                                continue;
+                            }
+
+                            // Load the texture
+                            TexSignature texSig;
+                            texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
+                            texSig.pData = texData[texID].pData;
+                            // Check if we already created a matching texture
+                            auto existingTex = textures.find(texSig);
+                            if(existingTex != textures.end())
+                            {
+                                basicMaterial.pTextures[falcorType] = existingTex->second;
+                            }
+                            else
+                            {
+                                // Identical images embedded in other models are shared
+                                const TextureData& data = texData[texID];
+                                auto pTexture = TextureCache::findImage(data.hash, data.width, data.height, texSig.format, Texture::kMaxPossible);
+                                if(pTexture == nullptr)
+                                {
+                                    pTexture = Texture::create2D(data.width, data.height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
+                                    pTexture->setSourceFilename(data.name);
+                                    TextureCache::addImage(data.hash, data.width, data.height, texSig.format, Texture::kMaxPossible, pTexture);
+                                }
+                                textures[texSig] = pTexture;
+                                basicMaterial.pTextures[falcorType] = pTexture;
+                            }
+                        }
+                    }
+
+                    // Create material and check if it already exists
+                    auto pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
+
+                    // create the index buffer
+                    Buffer::SharedPtr pIB;
+                    ResourceFormat ibFormat;
+                    if(submesh.shortIndices.empty())
+                    {
+                        pIB = Buffer::create(submesh.numIndices * sizeof(uint32_t), Buffer::BindFlags::Index, Buffer::CpuAccess::None, submesh.pIndices);
+                        ibFormat = ResourceFormat::R32Uint;
+                    }
+                    else
+                    {
+                        pIB = Buffer::create(submesh.numIndices * sizeof(uint16_t), Buffer::BindFlags::Index, Buffer::CpuAccess::None, submesh.shortIndices.data());
+                        ibFormat = ResourceFormat::R16Uint;
+                    }
+
+                    // create the mesh
+                    auto pMesh = Mesh::create(pVBs, mesh.numVertices, pIB, submesh.numIndices, mesh.pLayout, Vao::Topology::TriangleList, pMaterial, submesh.box, false, ibFormat);
+                    pMesh->mPositionScale = mesh.positionTransform.scale;
+                    pMesh->mPositionOffset = mesh.positionTransform.offset;
+                    meshToSubmeshes[meshIdx].push_back(pMesh);
+                }
+            }
+
+            for(const auto& instance : instances)
+            {
+                for(const auto& pMesh : meshToSubmeshes[instance.meshIdx])
+                {
+                    model.addMeshInstance(pMesh, instance.transformation);
+                }
+            }
+
+            stats.createTime = CpuTimer::calcDuration(createStart, CpuTimer::getCurrentTimePoint());
+        });
+
+        addStats(stats);
+        return created;
     }
 }
@@ -27,7 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
-#include "Utils/BinaryFileStream.h"
+#include "Utils/BinaryFileReader.h"
 #include "glm/vec3.hpp"
 #include "../Model.h"
 #include "Graphics/Model/Loaders/ModelImporter.h"
@@ -46,12 +46,18 @@ namespace Falcor
         */
         static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
 
+        /** Set the largest file size which will be memory-mapped. Vertex, index and texture data of mapped files are passed to resource creation in-place. Larger files are streamed.
+            \param[in] budget The budget in bytes. Use 0 to always stream the files
+        */
+        static void setMappingBudget(uint64_t budget) { sMappingBudget = budget; }
+
     private:
         BinaryModelImporter(const std::string& fullpath);
         bool importModel(Model& model, Model::LoadFlags flags);
 
         std::string mModelName;
-        BinaryFileStream mStream;
+        BinaryFileReader mStream;
+        static uint64_t sMappingBudget;
 
         struct TangentSpace
         {
@@ -31,6 +31,93 @@
 
 namespace Falcor
 {
+    ThreadPool::SharedPtr ModelImporter::spThreadPool;
+    thread_local ModelImporter::DeferredCreateStage* ModelImporter::spDeferredCreateStage = nullptr;
+
+    static std::mutex sStatsMutex;
+    static ModelImporter::Stats sStats;
+
+    ModelImporter::Stats ModelImporter::getStats()
+    {
+        std::lock_guard<std::mutex> lock(sStatsMutex);
+        return sStats;
+    }
+
+    void ModelImporter::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(sStatsMutex);
+        sStats = Stats();
+    }
+
+    void ModelImporter::addStats(const Stats& stats)
+    {
+        std::lock_guard<std::mutex> lock(sStatsMutex);
+        sStats.parseTime += stats.parseTime;
+        sStats.decodeTime += stats.decodeTime;
+        sStats.createTime += stats.createTime;
+    }
+
+    bool ModelImporter::runCreateStage(const std::function<void()>& stage)
+    {
+        if(spDeferredCreateStage == nullptr)
+        {
+            stage();
+            return true;
+        }
+        return spDeferredCreateStage->execute(stage);
+    }
+
+    bool ModelImporter::DeferredCreateStage::execute(const std::function<void()>& stage)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(mState == State::Cancelled)
+        {
+            return false;
+        }
+
+        mpStage = &stage;
+        mState = State::Submitted;
+        mCondition.notify_all();
+        mCondition.wait(lock, [this] { return mState == State::Done || mState == State::Cancelled; });
+        mpStage = nullptr;
+        return mState == State::Done;
+    }
+
+    void ModelImporter::DeferredCreateStage::run()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mState != State::Pending; });
+        if(mState == State::Submitted)
+        {
+            // The importing thread is blocked until the state changes, so the stage can run without holding the lock
+            lock.unlock();
+            (*mpStage)();
+            lock.lock();
+            mState = State::Done;
+            mCondition.notify_all();
+        }
+    }
+
+    void ModelImporter::DeferredCreateStage::cancel()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mState == State::Pending || mState == State::Submitted)
+        {
+            mState = State::Cancelled;
+            mCondition.notify_all();
+        }
+    }
+
+    void ModelImporter::DeferredCreateStage::finish()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mState == State::Pending)
+        {
+            mState = State::Finished;
+            mCondition.notify_all();
+        }
+    }
+
     Material::SharedPtr ModelImporter::checkForExistingMaterial(const Material::SharedPtr& pMaterial)
     {
         // Check if the material already exists
@@ -29,13 +29,97 @@
 #pragma once
 
 #include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #include "Graphics/Material/Material.h"
+#include "Utils/ThreadPool.h"
 
 namespace Falcor
 {
     class ModelImporter
     {
+    public:
+        /** Timings of the import stages, in milliseconds
+        */
+        struct Stats
+        {
+            float parseTime = 0;    ///< Reading the file, runs on the calling thread
+            float decodeTime = 0;   ///< CPU processing of meshes and textures, runs on the thread pool
+            float createTime = 0;   ///< Creation of the GPU resources and the model, runs on the calling thread
+        };
+
+        /** Set the thread pool which decodes meshes and textures
+            \param[in] pPool The pool. nullptr selects ThreadPool::getDefault()
+        */
+        static void setThreadPool(const ThreadPool::SharedPtr& pPool) { spThreadPool = pPool; }
+
+        /** Get the thread pool which decodes meshes and textures
+        */
+        static ThreadPool* getThreadPool() { return spThreadPool ? spThreadPool.get() : ThreadPool::getDefault(); }
+
+        /** Get the timings accumulated by all imports since the last call to resetStats(). When models are imported concurrently, the times of the different imports are summed
+        */
+        static Stats getStats();
+
+        /** Reset the timings
+        */
+        static void resetStats();
+
+        /** The create stage of an import which runs on another thread. When the importing thread reaches the create stage, it blocks until the owner of this object runs the stage.
+            Allows importing models concurrently while creating the objects and resources in a deterministic order.
+        */
+        class DeferredCreateStage
+        {
+        public:
+            /** Wait until the import reaches its create stage and run it on the calling thread. Returns immediately if the import ended before reaching it.
+            */
+            void run();
+
+            /** Release the import without running its create stage. The import will fail.
+            */
+            void cancel();
+
+            /** Called by the importing thread once the import returned
+            */
+            void finish();
+
+        private:
+            friend class ModelImporter;
+            bool execute(const std::function<void()>& stage);
+
+            enum class State
+            {
+                Pending,
+                Submitted,
+                Done,
+                Cancelled,
+                Finished,
+            };
+
+            std::mutex mMutex;
+            std::condition_variable mCondition;
+            const std::function<void()>* mpStage = nullptr;
+            State mState = State::Pending;
+        };
+
+        /** Set the deferred create stage used by imports on the calling thread
+            \param[in] pStage The deferred stage. nullptr runs the create stage on the importing thread
+        */
+        static void setDeferredCreateStage(DeferredCreateStage* pStage) { spDeferredCreateStage = pStage; }
+
     protected:
+        static ThreadPool::SharedPtr spThreadPool;
+        static thread_local DeferredCreateStage* spDeferredCreateStage;
+
+        /** Accumulate the timings of an import
+        */
+        static void addStats(const Stats& stats);
+
+        /** Run the create stage of an import, either directly or on the thread which owns the deferred create stage of the calling thread
+            \return false if the import was cancelled, otherwise true
+        */
+        static bool runCreateStage(const std::function<void()>& stage);
 
         // If a similar material already exists, will return the existing one. Otherwise, will cache the material in pMaterial and return it
         Material::SharedPtr checkForExistingMaterial(const Material::SharedPtr& pMaterial);
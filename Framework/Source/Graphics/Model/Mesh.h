@@ -65,6 +65,7 @@ namespace Falcor
             \param[in] pMaterial The material of the mesh
             \param[in] BoundingBox The mesh's axis-aligned bounding-box
             \param[in] bHasBones Indicates the the mesh uses bones for animation
+            \param[in] indexFormat The format of the index buffer. Can be either R16Uint or R32Uint
         */
         static SharedPtr create(const Vao::BufferVec& vertexBuffers,
             uint32_t vertexCount,
@@ -74,7 +75,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat = ResourceFormat::R32Uint);
 
         /** Destructor
         */
@@ -96,6 +98,14 @@ namespace Falcor
         */
         uint32_t getIndexCount() const { return mIndexCount; }
 
+        /** Get the scale from the positions in the vertex buffer to object space. The positions are only scaled if the model was loaded with Model::LoadFlags::QuantizePositions
+        */
+        const glm::vec3& getPositionScale() const { return mPositionScale; }
+
+        /** Get the offset from the positions in the vertex buffer to object space, applied after getPositionScale()
+        */
+        const glm::vec3& getPositionOffset() const { return mPositionOffset; }
+
         /** Get a pointer to the mesh's material
         */
         const Material::SharedPtr& getMaterial() const { return mpMaterial; }
@@ -136,7 +146,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat);
 
         static uint32_t sMeshCounter;
 
@@ -148,5 +159,7 @@ namespace Falcor
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
+        glm::vec3 mPositionScale = glm::vec3(1);
+        glm::vec3 mPositionOffset = glm::vec3(0);
     };
 }
\ No newline at end of file
@@ -0,0 +1,402 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidIndex = (uint32_t)-1;
+
+        struct Cluster
+        {
+            uint32_t firstTriangle;
+            uint32_t triangleCount;
+            float sortKey;
+        };
+
+        // A FIFO cache of transformed vertices. A vertex is in the cache if less than 'cacheSize' vertices were transformed since it was
+        class FifoCache
+        {
+        public:
+            FifoCache(uint32_t vertexCount, uint32_t cacheSize) : mTimestamps(vertexCount, 0), mTime(cacheSize + 1), mCacheSize(cacheSize) {}
+
+            // Returns true on a miss
+            bool access(uint32_t vertex)
+            {
+                if(mTime - mTimestamps[vertex] > mCacheSize)
+                {
+                    mTimestamps[vertex] = mTime++;
+                    return true;
+                }
+                return false;
+            }
+
+            void flush() { mTime += mCacheSize + 1; }
+
+        private:
+            std::vector<uint32_t> mTimestamps;
+            uint32_t mTime;
+            uint32_t mCacheSize;
+        };
+
+        uint32_t countMisses(const uint32_t* pIndices, uint32_t firstTriangle, uint32_t triangleCount, FifoCache& cache)
+        {
+            uint32_t misses = 0;
+            for(uint32_t i = firstTriangle * 3; i < (firstTriangle + triangleCount) * 3; i++)
+            {
+                misses += cache.access(pIndices[i]) ? 1 : 0;
+            }
+            return misses;
+        }
+
+        // Tipsify. Returns the new triangle order and the clusters, which start where the algorithm had to jump to a vertex which isn't in the cache
+        void tipsify(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& output, std::vector<Cluster>& clusters)
+        {
+            const uint32_t triangleCount = indexCount / 3;
+
+            // Vertex-triangle adjacency
+            std::vector<uint32_t> liveCount(vertexCount, 0);
+            for(uint32_t i = 0; i < triangleCount * 3; i++)
+            {
+                liveCount[pIndices[i]]++;
+            }
+
+            std::vector<uint32_t> offsets(vertexCount + 1, 0);
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                offsets[v + 1] = offsets[v] + liveCount[v];
+            }
+
+            std::vector<uint32_t> adjacency(triangleCount * 3);
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for(uint32_t i = 0; i < triangleCount * 3; i++)
+            {
+                adjacency[fill[pIndices[i]]++] = i / 3;
+            }
+
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<uint32_t> deadEnds;
+            std::vector<uint32_t> candidates;
+            uint32_t time = cacheSize + 1;
+            uint32_t cursor = 0;
+
+            output.clear();
+            output.reserve(triangleCount * 3);
+            clusters.clear();
+
+            auto skipDeadEnd = [&]() -> uint32_t
+            {
+                while(deadEnds.empty() == false)
+                {
+                    uint32_t vertex = deadEnds.back();
+                    deadEnds.pop_back();
+                    if(liveCount[vertex] > 0)
+                    {
+                        return vertex;
+                    }
+                }
+
+                for(; cursor < vertexCount; cursor++)
+                {
+                    if(liveCount[cursor] > 0)
+                    {
+                        return cursor;
+                    }
+                }
+                return kInvalidIndex;
+            };
+
+            uint32_t fanningVertex = skipDeadEnd();
+            while(fanningVertex != kInvalidIndex)
+            {
+                if(clusters.empty())
+                {
+                    clusters.push_back({ 0, 0, 0 });
+                }
+
+                // Emit all the live triangles of the fanning vertex
+                candidates.clear();
+                for(uint32_t a = offsets[fanningVertex]; a < offsets[fanningVertex + 1]; a++)
+                {
+                    uint32_t triangle = adjacency[a];
+                    if(emitted[triangle])
+                    {
+                        continue;
+                    }
+
+                    for(uint32_t i = 0; i < 3; i++)
+                    {
+                        uint32_t vertex = pIndices[triangle * 3 + i];
+                        output.push_back(vertex);
+                        deadEnds.push_back(vertex);
+                        candidates.push_back(vertex);
+                        liveCount[vertex]--;
+                        if(time - timestamps[vertex] > cacheSize)
+                        {
+                            timestamps[vertex] = time++;
+                        }
+                    }
+                    emitted[triangle] = true;
+                }
+
+                // Continue with the candidate which stays in the cache the longest after fanning it, preferring vertices which are still in the cache
+                uint32_t next = kInvalidIndex;
+                int32_t bestPriority = -1;
+                for(uint32_t vertex : candidates)
+                {
+                    if(liveCount[vertex] > 0)
+                    {
+                        int32_t priority = 0;
+                        if(time - timestamps[vertex] + 2 * liveCount[vertex] <= cacheSize)
+                        {
+                            priority = (int32_t)(time - timestamps[vertex]);
+                        }
+
+                        if(priority > bestPriority)
+                        {
+                            bestPriority = priority;
+                            next = vertex;
+                        }
+                    }
+                }
+
+                if(next == kInvalidIndex)
+                {
+                    next = skipDeadEnd();
+                    clusters.push_back({ (uint32_t)output.size() / 3, 0, 0 });
+                }
+                fanningVertex = next;
+            }
+
+            // Fix the cluster sizes. The last one is empty
+            if(clusters.empty() == false)
+            {
+                clusters.pop_back();
+            }
+            for(size_t c = 0; c < clusters.size(); c++)
+            {
+                uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1].firstTriangle : triangleCount;
+                clusters[c].triangleCount = end - clusters[c].firstTriangle;
+            }
+        }
+
+        // Split the clusters wherever the part before the split has an ACMR within the threshold of the entire cluster. This keeps the clusters small enough for the overdraw sort to be useful, without losing too much cache efficiency
+        std::vector<Cluster> splitClusters(const uint32_t* pIndices, uint32_t vertexCount, const std::vector<Cluster>& clusters, uint32_t cacheSize, float threshold)
+        {
+            std::vector<Cluster> split;
+            FifoCache cache(vertexCount, cacheSize);
+            for(const auto& cluster : clusters)
+            {
+                cache.flush();
+                float clusterAcmr = (float)countMisses(pIndices, cluster.firstTriangle, cluster.triangleCount, cache) / (float)cluster.triangleCount;
+
+                cache.flush();
+                uint32_t start = cluster.firstTriangle;
+                uint32_t misses = 0;
+                for(uint32_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount; t++)
+                {
+                    misses += countMisses(pIndices, t, 1, cache);
+                    uint32_t count = t + 1 - start;
+                    if((float)misses / (float)count <= threshold * clusterAcmr)
+                    {
+                        split.push_back({ start, count, 0 });
+                        start = t + 1;
+                        misses = 0;
+                        cache.flush();
+                    }
+                }
+
+                if(start < cluster.firstTriangle + cluster.triangleCount)
+                {
+                    split.push_back({ start, cluster.firstTriangle + cluster.triangleCount - start, 0 });
+                }
+            }
+            return split;
+        }
+
+        // Clusters facing away from the center of the mesh are likely to occlude the others, so they are drawn first
+        void sortClusters(const uint32_t* pIndices, const float* pPositions, uint32_t positionStride, std::vector<Cluster>& clusters)
+        {
+            auto getPosition = [&](uint32_t vertex) { return *(const glm::vec3*)((const uint8_t*)pPositions + (size_t)vertex * positionStride); };
+
+            std::vector<glm::vec3> centroids(clusters.size());
+            std::vector<glm::vec3> normals(clusters.size());
+            glm::vec3 meshCentroid(0, 0, 0);
+            float meshArea = 0;
+            for(size_t c = 0; c < clusters.size(); c++)
+            {
+                glm::vec3 centroid(0, 0, 0);
+                glm::vec3 normal(0, 0, 0);
+                float area = 0;
+                for(uint32_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; t++)
+                {
+                    glm::vec3 p0 = getPosition(pIndices[t * 3 + 0]);
+                    glm::vec3 p1 = getPosition(pIndices[t * 3 + 1]);
+                    glm::vec3 p2 = getPosition(pIndices[t * 3 + 2]);
+                    glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                    float triangleArea = glm::length(n);
+                    centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                    normal += n;
+                    area += triangleArea;
+                }
+
+                meshCentroid += centroid;
+                meshArea += area;
+                centroids[c] = (area > 0) ? centroid / area : getPosition(pIndices[clusters[c].firstTriangle * 3]);
+                float normalLength = glm::length(normal);
+                normals[c] = (normalLength > 0) ? normal / normalLength : glm::vec3(0, 0, 0);
+            }
+
+            if(meshArea > 0)
+            {
+                meshCentroid /= meshArea;
+            }
+
+            for(size_t c = 0; c < clusters.size(); c++)
+            {
+                clusters[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+            }
+            std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+        }
+    }
+
+    void MeshOptimizer::optimizeTriangleOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, const float* pPositions, uint32_t positionStride, float overdrawThreshold, uint32_t cacheSize)
+    {
+        const uint32_t triangleCount = indexCount / 3;
+        if(triangleCount == 0)
+        {
+            return;
+        }
+
+        // Submeshes usually reference a small range of a shared vertex buffer. Work on that range, so the per-vertex arrays don't scale with the whole buffer
+        const auto range = std::minmax_element(pIndices, pIndices + indexCount);
+        const uint32_t baseVertex = *range.first;
+        vertexCount = *range.second - baseVertex + 1;
+        if(baseVertex > 0)
+        {
+            for(uint32_t i = 0; i < indexCount; i++)
+            {
+                pIndices[i] -= baseVertex;
+            }
+            if(pPositions)
+            {
+                pPositions = (const float*)((const uint8_t*)pPositions + (size_t)baseVertex * positionStride);
+            }
+        }
+
+        std::vector<uint32_t> cacheOrder;
+        std::vector<Cluster> clusters;
+        tipsify(pIndices, indexCount, vertexCount, cacheSize, cacheOrder, clusters);
+
+        if(pPositions && clusters.size() > 0)
+        {
+            clusters = splitClusters(cacheOrder.data(), vertexCount, clusters, cacheSize, overdrawThreshold);
+            sortClusters(cacheOrder.data(), pPositions, positionStride, clusters);
+
+            std::vector<uint32_t> overdrawOrder;
+            overdrawOrder.reserve(triangleCount * 3);
+            for(const auto& cluster : clusters)
+            {
+                overdrawOrder.insert(overdrawOrder.end(), cacheOrder.begin() + cluster.firstTriangle * 3, cacheOrder.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+            }
+
+            // The split bounds the ACMR of each cluster, but the clusters no longer share the vertices at their boundaries. Make sure the result is still within the threshold
+            float cacheAcmr = simulateVertexCache(cacheOrder.data(), triangleCount * 3, vertexCount, cacheSize).acmr;
+            float overdrawAcmr = simulateVertexCache(overdrawOrder.data(), triangleCount * 3, vertexCount, cacheSize).acmr;
+            if(overdrawAcmr <= cacheAcmr * overdrawThreshold)
+            {
+                cacheOrder.swap(overdrawOrder);
+            }
+        }
+
+        std::transform(cacheOrder.begin(), cacheOrder.end(), pIndices, [baseVertex](uint32_t index) { return index + baseVertex; });
+    }
+
+    std::vector<uint32_t> MeshOptimizer::optimizeVertexOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, kInvalidIndex);
+        uint32_t nextIndex = 0;
+        for(uint32_t i = 0; i < indexCount; i++)
+        {
+            uint32_t& newIndex = remap[pIndices[i]];
+            if(newIndex == kInvalidIndex)
+            {
+                newIndex = nextIndex++;
+            }
+            pIndices[i] = newIndex;
+        }
+
+        for(auto& newIndex : remap)
+        {
+            if(newIndex == kInvalidIndex)
+            {
+                newIndex = nextIndex++;
+            }
+        }
+        return remap;
+    }
+
+    void MeshOptimizer::remapVertices(const std::vector<uint32_t>& remap, uint32_t stride, std::vector<uint8_t>& data)
+    {
+        assert(data.size() >= remap.size() * stride);
+        std::vector<uint8_t> remapped(data.size());
+        for(size_t v = 0; v < remap.size(); v++)
+        {
+            memcpy(remapped.data() + (size_t)remap[v] * stride, data.data() + v * stride, stride);
+        }
+        data.swap(remapped);
+    }
+
+    MeshOptimizer::CacheStats MeshOptimizer::simulateVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        CacheStats stats;
+        stats.triangleCount = indexCount / 3;
+
+        std::vector<bool> referenced(vertexCount, false);
+        FifoCache cache(vertexCount, cacheSize);
+        for(uint32_t i = 0; i < stats.triangleCount * 3; i++)
+        {
+            uint32_t vertex = pIndices[i];
+            stats.missCount += cache.access(vertex) ? 1 : 0;
+            if(referenced[vertex] == false)
+            {
+                referenced[vertex] = true;
+                stats.vertexCount++;
+            }
+        }
+
+        stats.acmr = stats.triangleCount ? (float)stats.missCount / (float)stats.triangleCount : 0;
+        stats.atvr = stats.vertexCount ? (float)stats.missCount / (float)stats.vertexCount : 0;
+        return stats;
+    }
+}
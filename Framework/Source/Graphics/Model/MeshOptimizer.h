@@ -0,0 +1,95 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** Reorders the triangles and vertices of indexed triangle lists for faster rendering.\n
+        The triangles are reordered for the post-transform vertex cache using Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). The clusters it produces are then sorted front to back as seen from outside the mesh, which reduces overdraw, as long as the vertex cache efficiency doesn't drop by more than a threshold.
+        The vertices are then reordered by their first use, so that the vertex fetches walk the vertex buffers linearly.
+    */
+    class MeshOptimizer
+    {
+    public:
+        /** Post-transform vertex cache statistics
+        */
+        struct CacheStats
+        {
+            uint32_t triangleCount = 0;
+            uint32_t vertexCount = 0;   ///< The number of distinct vertices referenced by the triangles
+            uint32_t missCount = 0;     ///< The number of vertex shader invocations
+            float acmr = 0;             ///< Average cache miss ratio - misses per triangle. Lower is better, the best possible value is ~0.5
+            float atvr = 0;             ///< Average transform to vertex ratio - misses per referenced vertex. Lower is better, the best possible value is 1
+        };
+
+        /** The cache size the triangles are optimized for
+        */
+        static const uint32_t kDefaultCacheSize = 16;
+
+        /** Reorder the triangles of a mesh
+            \param[in, out] pIndices Triangle list
+            \param[in] indexCount The number of indices
+            \param[in] vertexCount The number of vertices. Only the range of vertices referenced by the indices is processed, so the cost doesn't depend on the size of a shared vertex buffer
+            \param[in] pPositions Optional. The vertex positions, used for overdraw ordering. Each element starts with the xyz position. Without positions, only the vertex cache order is used
+            \param[in] positionStride Position stride in bytes
+            \param[in] overdrawThreshold The overdraw ordering is only used if it keeps the ACMR within this factor of the vertex cache order
+            \param[in] cacheSize The vertex cache size to optimize for
+        */
+        static void optimizeTriangleOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, const float* pPositions = nullptr, uint32_t positionStride = 12, float overdrawThreshold = 1.05f, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder the vertices by their first use in the index buffer and remap the indices. Use remapVertices() to reorder the vertex data.\n
+            Vertices which aren't referenced are moved to the end, keeping their relative order.
+            \param[in, out] pIndices Triangle list. To reorder vertices shared by several meshes, pass the concatenation of their index buffers
+            \param[in] indexCount The number of indices
+            \param[in] vertexCount The number of vertices
+            \return For each vertex, its new index
+        */
+        static std::vector<uint32_t> optimizeVertexOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+        /** Reorder vertex data according to a remap table
+            \param[in] remap For each vertex, its new index
+            \param[in] stride The size of a vertex in bytes
+            \param[in, out] data The vertex data
+        */
+        static void remapVertices(const std::vector<uint32_t>& remap, uint32_t stride, std::vector<uint8_t>& data);
+
+        /** Check if a mesh can use 16-bit indices. The largest index must stay below 0xFFFF, since that value is reserved as the strip cut index
+            \param[in] vertexCount The number of vertices the indices can reference
+        */
+        static bool canUseShortIndices(uint32_t vertexCount) { return vertexCount < 0x10000; }
+
+        /** Simulate a FIFO post-transform vertex cache
+            \param[in] pIndices Triangle list
+            \param[in] indexCount The number of indices
+            \param[in] vertexCount The number of vertices
+            \param[in] cacheSize The simulated cache size
+        */
+        static CacheStats simulateVertexCache(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+    };
+}
@@ -89,32 +89,38 @@ namespace Falcor
     Model::SharedPtr Model::createFromFile(const char* filename, LoadFlags flags)
     {
         SharedPtr pModel = SharedPtr(new Model());
+        if(pModel->importFromFile(filename, flags) == false)
+        {
+            pModel = nullptr;
+        }
+
+        return pModel;
+    }
+
+    bool Model::importFromFile(const char* filename, LoadFlags flags)
+    {
         bool res;
         if(hasSuffix(filename, ".bin", false))
         {
-            res = BinaryModelImporter::import(*pModel, filename, flags);
+            res = BinaryModelImporter::import(*this, filename, flags);
         }
         else
         {
-            res = AssimpModelImporter::import(*pModel, filename, flags);
+            res = AssimpModelImporter::import(*this, filename, flags);
         }
 
         if(res)
         {
-            pModel->calculateModelProperties();
-            pModel->setFilename(filename);
+            calculateModelProperties();
+            setFilename(filename);
 
             std::string name = getFilenameFromPath(filename);
             size_t extPos = name.find_last_of('.');
             name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
-            pModel->setName(name);
-        }
-        else
-        {
-            pModel = nullptr;
+            setName(name);
         }
 
-        return pModel;
+        return res;
     }
 
     Model::SharedPtr Model::create()
@@ -229,6 +235,20 @@ namespace Falcor
         }
     }
 
+    void Model::animate(Model* const* pModels, uint32_t count, double currentTime, ThreadPool* pPool)
+    {
+        std::vector<AnimationController*> controllers;
+        controllers.reserve(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(pModels[i]->mpAnimationController)
+            {
+                controllers.push_back(pModels[i]->mpAnimationController.get());
+            }
+        }
+        AnimationController::animate(controllers.data(), uint32_t(controllers.size()), currentTime, pPool);
+    }
+
     bool Model::hasAnimations() const
     {
         return (getAnimationsCount() != 0);
@@ -317,6 +337,7 @@ namespace Falcor
         }
 
         mMeshes[meshID].push_back(MeshInstance::create(pMesh, baseTransform));
+        mMeshListVersion++;
     }
 
     void Model::sortMeshes()
@@ -328,6 +349,7 @@ namespace Falcor
         };
         
         std::sort(mMeshes.begin(), mMeshes.end(), matSortPred);
+        mMeshListVersion++;
     }
 
     template<typename T>
@@ -383,6 +405,7 @@ namespace Falcor
         auto pred = [](MeshInstanceList& meshInstances) { return meshInstances.size() == 0; };
         auto& meshesEnd = std::remove_if(mMeshes.begin(), mMeshes.end(), pred);
         mMeshes.erase(meshesEnd, mMeshes.end());
+        mMeshListVersion++;
 
         calculateModelProperties();
     }
@@ -44,6 +44,7 @@ namespace Falcor
     class BinaryModelExporter;
     class Buffer;
     class Camera;
+    class ThreadPool;
 
     /** Class representing a complete model object, including meshes, animations and materials
     */
@@ -65,6 +66,9 @@ namespace Falcor
             AssumeLinearSpaceTextures   = 0x4,    ///< By default, textures representing colors (diffuse/specular) are interpreted as sRGB data. Use this flag to force linear space for color textures.
             DontMergeMeshes             = 0x8,    ///< Preserve the original list of meshes in the scene, don't merge meshes with the same material
             BuffersAsShaderResource     = 0x10,   ///< Generate the VBs and IB with the shader-resource-view bind flag
+            OptimizeMeshes              = 0x20,   ///< Reorder the triangles for the post-transform vertex cache and overdraw, and the vertices for fetch locality. Meshes with up to 65536 vertices use 16-bit indices
+            QuantizeVertexAttributes    = 0x40,   ///< Store normals and bitangents as RGB10A2Unorm and texture coordinates as RG16Float. The default vertex shader decodes them
+            QuantizePositions           = 0x80,   ///< Store positions as RGBA16Unorm, relative to the bounding box of the mesh's vertices. The default vertex shader decodes them
         };
 
         /** create a new model from file
@@ -144,6 +148,10 @@ namespace Falcor
         */
         uint32_t getMeshInstanceCount(uint32_t meshID) const { return meshID >= mMeshes.size() ? 0 : (uint32_t)(mMeshes[meshID].size()); }
 
+        /** Get a counter which is incremented every time meshes or mesh instances are added, removed or reordered. Mesh and mesh instance IDs are only stable while it doesn't change.
+        */
+        uint32_t getMeshListVersion() const { return mMeshListVersion; }
+
         /** Adds a new mesh instance
             \param[in] pMesh Mesh geometry
             \param[in] baseTransform Base transform for the instance
@@ -163,6 +171,14 @@ namespace Falcor
         */
         void animate(double currentTime);
 
+        /** Animate a batch of models in parallel. Models without an animation controller are skipped.
+            \param[in] pModels The models to animate. A model must not appear more than once.
+            \param[in] count The number of models
+            \param[in] currentTime The current global time
+            \param[in] pPool The thread pool to use. If nullptr, the default pool is used.
+        */
+        static void animate(Model* const* pModels, uint32_t count, double currentTime, ThreadPool* pPool = nullptr);
+
         /** Get the animation name from animation ID
         */
         const std::string& getAnimationName(uint32_t animationID) const;
@@ -183,6 +199,10 @@ namespace Falcor
         */
         void setAnimationController(AnimationController::UniquePtr pAnimController);
 
+        /** Get the animation controller. Returns nullptr if the model isn't skinned.
+        */
+        const AnimationController* getAnimationController() const { return mpAnimationController.get(); }
+
         /** Check if the model has bones
         */
         bool hasBones() const;
@@ -231,9 +251,16 @@ namespace Falcor
 
     protected:
         friend class SimpleModelImporter;
+        friend class SceneImporter;
 
         Model();
         Model(const Model& other);
+
+        /** Import a file into an empty model. Allows creating the model object before the file is imported.
+            \return true if the import succeeded, otherwise false
+        */
+        bool importFromFile(const char* filename, LoadFlags flags);
+
         void sortMeshes();
         void deleteCulledMeshInstances(MeshInstanceList& meshInstances, const Camera *pCamera);
 
@@ -251,6 +278,7 @@ namespace Falcor
         uint32_t mId;
 
         std::vector<MeshInstanceList> mMeshes; // [Mesh][Instance]
+        uint32_t mMeshListVersion = 0;
 
         AnimationController::UniquePtr mpAnimationController;
 
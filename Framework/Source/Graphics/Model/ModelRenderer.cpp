@@ -28,16 +28,58 @@
 #include "Framework.h"
 #include "ModelRenderer.h"
 #include "Graphics/Scene/SceneRenderer.h"
+#include <unordered_map>
 
 namespace Falcor
 {
-    void ModelRenderer::render(RenderContext* pRenderContext, Model::SharedPtr pModel, Camera* pCamera, bool frustumCulling)
+    namespace
     {
-        Scene::SharedPtr pScene = Scene::create();
-        pScene->addModelInstance(pModel, "");
+        // The scene-wide data SceneRenderer uses (BVH, transform buffer, bone palette) is expensive to create, so each model keeps its scene between calls
+        struct CachedScene
+        {
+            std::weak_ptr<Model> pModel;
+            long sceneRefCount;     // The number of references the cached scene holds to the model
+            SceneRenderer::SharedPtr pRenderer;
+        };
+
+        std::unordered_map<const Model*, CachedScene> gSceneCache;
+
+        SceneRenderer* getSceneRenderer(const Model::SharedPtr& pModel)
+        {
+            auto& cache = gSceneCache;
+            auto it = cache.find(pModel.get());
+            if (it != cache.end())
+            {
+                return it->second.pRenderer.get();
+            }
+
+            // The cached scenes keep their models alive. Release the ones nobody else references anymore.
+            for (auto entry = cache.begin(); entry != cache.end();)
+            {
+                entry = (entry->second.pModel.use_count() <= entry->second.sceneRefCount) ? cache.erase(entry) : std::next(entry);
+            }
+
+            const long refCount = pModel.use_count();
+            Scene::SharedPtr pScene = Scene::create();
+            pScene->addModelInstance(pModel, "");
+
+            CachedScene& entry = cache[pModel.get()];
+            entry.pModel = pModel;
+            entry.sceneRefCount = pModel.use_count() - refCount;
+            entry.pRenderer = SceneRenderer::create(pScene);
+            return entry.pRenderer.get();
+        }
+    }
 
-        SceneRenderer::SharedPtr pSceneRenderer = SceneRenderer::create(pScene);
+    void ModelRenderer::render(RenderContext* pRenderContext, Model::SharedPtr pModel, Camera* pCamera, bool frustumCulling)
+    {
+        SceneRenderer* pSceneRenderer = getSceneRenderer(pModel);
         pSceneRenderer->setObjectCullState(frustumCulling);
         pSceneRenderer->renderScene(pRenderContext, pCamera);
     }
+
+    void ModelRenderer::cleanup()
+    {
+        gSceneCache.clear();
+    }
 }
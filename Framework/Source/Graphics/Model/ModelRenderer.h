@@ -47,6 +47,10 @@ namespace Falcor
         */
         static void render(RenderContext* pRenderContext, Model::SharedPtr pModel, Camera* pCamera, bool frustumCulling = true);
 
+        /** Release the scenes render() caches per model. The cached scenes keep their models alive, so this must be called before the device is destroyed
+        */
+        static void cleanup();
+
     private:
     };
 }
@@ -203,6 +203,15 @@ namespace Falcor
             return mBoundingBox;
         }
 
+        /** Gets a counter which is incremented every time the transform matrix is recalculated. Can be used to detect moved instances without comparing matrices.
+            \return Transform version
+        */
+        uint32_t getTransformVersion() const
+        {
+            updateInstanceProperties();
+            return mTransformVersion;
+        }
+
         /** IMovableObject interface
         */
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
@@ -243,6 +252,7 @@ namespace Falcor
 
                 mFinalTransformMatrix = mMovable.matrix * mBase.matrix;
                 mBoundingBox = mpObject->getBoundingBox().transform(mFinalTransformMatrix);
+                mTransformVersion++;
             }
         }
 
@@ -317,5 +327,6 @@ namespace Falcor
 
         mutable glm::mat4 mFinalTransformMatrix;
         mutable BoundingBox mBoundingBox;
+        mutable uint32_t mTransformVersion = 0;
     };
 }
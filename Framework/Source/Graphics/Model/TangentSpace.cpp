@@ -0,0 +1,460 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TangentSpace.h"
+#include "Utils/ThreadPool.h"
+#include "glm/geometric.hpp"
+#include <atomic>
+#include <algorithm>
+#include <immintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        bool isSpecialFloat(float f)
+        {
+            uint32_t d = *(uint32_t*)&f;
+            // Check the exponent
+            d = (d >> 23) & 0xff;
+            return d == 0xff;
+        }
+
+        const glm::vec3& getPosition(const TangentSpace::MeshData& mesh, uint32_t index)
+        {
+            return *(const glm::vec3*)((const uint8_t*)mesh.pPositions + (size_t)index * mesh.positionStride);
+        }
+
+        glm::vec2 getTexCrd(const TangentSpace::MeshData& mesh, uint32_t index)
+        {
+            return mesh.pTexCrd ? mesh.pTexCrd[(size_t)index * mesh.texCrdStride] : glm::vec2(0.f, 0.f);
+        }
+
+        // Four vectors, one per SSE lane. The operations follow the evaluation order of the glm functions used by the reference implementation, so both produce the same bits
+        struct Vec3x4
+        {
+            __m128 x, y, z;
+        };
+
+        Vec3x4 sub(const Vec3x4& a, const Vec3x4& b)
+        {
+            return{ _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+        }
+
+        Vec3x4 mul(const Vec3x4& a, __m128 s)
+        {
+            return{ _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+        }
+
+        __m128 dot(const Vec3x4& a, const Vec3x4& b)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+        }
+
+        Vec3x4 normalize(const Vec3x4& v)
+        {
+            return mul(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot(v, v))));
+        }
+
+        Vec3x4 cross(const Vec3x4& a, const Vec3x4& b)
+        {
+            return{
+                _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(b.y, a.z)),
+                _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(b.z, a.x)),
+                _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(b.x, a.y)) };
+        }
+
+        // Project a vector into the plane defined by a normal: v - n * dot(v, n)
+        Vec3x4 project(const Vec3x4& v, const Vec3x4& n)
+        {
+            return sub(v, mul(n, dot(v, n)));
+        }
+
+        __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        Vec3x4 select(__m128 mask, const Vec3x4& a, const Vec3x4& b)
+        {
+            return{ select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z) };
+        }
+
+        __m128 isSpecialFloat(__m128 f)
+        {
+            const __m128i exponent = _mm_set1_epi32(0x7f800000);
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_castps_si128(f), exponent), exponent));
+        }
+
+        __m128 absolute(__m128 f)
+        {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), f);
+        }
+
+        // Maps every vertex to the first vertex with identical attributes
+        std::vector<uint32_t> weldVertices(const TangentSpace::MeshData& mesh, ThreadPool* pPool)
+        {
+            struct Key
+            {
+                glm::vec3 position;
+                glm::vec3 normal;
+                glm::vec2 texCrd;
+            };
+
+            auto getKey = [&mesh](uint32_t index)
+            {
+                Key key;
+                key.position = getPosition(mesh, index);
+                key.normal = mesh.pNormals[index];
+                key.texCrd = getTexCrd(mesh, index);
+                return key;
+            };
+
+            // Hash the vertices, then sort them so that identical vertices are next to each other
+            std::vector<std::pair<uint32_t, uint32_t>> hashes(mesh.vertexCount);
+            pPool->parallelFor(mesh.vertexCount, 65536, [&](uint32_t first, uint32_t last)
+            {
+                for(uint32_t i = first; i < last; i++)
+                {
+                    Key key = getKey(i);
+                    const uint8_t* pBytes = (const uint8_t*)&key;
+                    uint32_t hash = 2166136261u;
+                    for(size_t b = 0; b < sizeof(Key); b++)
+                    {
+                        hash = (hash ^ pBytes[b]) * 16777619u;
+                    }
+                    hashes[i] = { hash, i };
+                }
+            });
+            std::sort(hashes.begin(), hashes.end());
+
+            std::vector<uint32_t> remap(mesh.vertexCount);
+            for(size_t runStart = 0; runStart < hashes.size();)
+            {
+                size_t runEnd = runStart + 1;
+                while(runEnd < hashes.size() && hashes[runEnd].first == hashes[runStart].first)
+                {
+                    runEnd++;
+                }
+
+                // The run is sorted by index, so the first match is the lowest index. Hash collisions are resolved by comparing the attributes
+                for(size_t i = runStart; i < runEnd; i++)
+                {
+                    uint32_t index = hashes[i].second;
+                    Key key = getKey(index);
+                    remap[index] = index;
+                    for(size_t j = runStart; j < i; j++)
+                    {
+                        Key other = getKey(hashes[j].second);
+                        if(memcmp(&key, &other, sizeof(Key)) == 0)
+                        {
+                            remap[index] = remap[hashes[j].second];
+                            break;
+                        }
+                    }
+                }
+                runStart = runEnd;
+            }
+            return remap;
+        }
+    }
+
+    void TangentSpace::generateBitangentsReference(const MeshData& mesh, glm::vec3* pBitangents)
+    {
+        // calculate the tangent and bitangent for every face
+        size_t primCount = mesh.indexCount / 3;
+        for(size_t primID = 0; primID < primCount; primID++)
+        {
+            struct Data
+            {
+                glm::vec3 position;
+                glm::vec3 normal;
+                glm::vec2 uv;
+            };
+            Data V[3];
+
+            // Get the data
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t index = mesh.pIndices[primID * 3 + i];
+                V[i].position = getPosition(mesh, index);
+                V[i].normal = mesh.pNormals[index];
+                V[i].uv = getTexCrd(mesh, index);
+            }
+
+            // Position delta
+            glm::vec3 posDelta[2];
+            posDelta[0] = V[1].position - V[0].position;
+            posDelta[1] = V[2].position - V[0].position;
+
+            // Texture offset
+            glm::vec2 s = V[1].uv - V[0].uv;
+            glm::vec2 t = V[2].uv - V[0].uv;
+            s.y = -s.y;
+            t.y = -t.y;
+
+            glm::vec3 tangent;
+            glm::vec3 bitangent;
+
+            // when t1, t2, t3 in same position in UV space, just use default UV direction.
+            if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
+            {
+                const glm::vec3 &normal = V[0].normal;
+                if(std::abs(normal.x) > std::abs(normal.y))
+                    bitangent = v3(normal.z, 0.f, -normal.x) / glm::length(v2(normal.x, normal.z));
+                else
+                    bitangent = v3(0.f, normal.z, -normal.y) / glm::length(v2(normal.y, normal.z));
+                tangent = glm::cross(bitangent, normal);
+            }
+            else
+            {
+                float dirCorrection = (t.x * s.y - t.y * s.x) < 0.0f ? -1.0f : 1.0f;
+
+                // tangent points in the direction where to positive X axis of the texture coord's would point in model space
+                // bitangent's points along the positive Y axis of the texture coord's, respectively
+                tangent.x = (posDelta[1].x * s.y - posDelta[0].x * t.y) * dirCorrection;
+                tangent.y = (posDelta[1].y * s.y - posDelta[0].y * t.y) * dirCorrection;
+                tangent.z = (posDelta[1].z * s.y - posDelta[0].z * t.y) * dirCorrection;
+
+                bitangent.x = (posDelta[1].x * s.x - posDelta[0].x * t.x) * dirCorrection;
+                bitangent.y = (posDelta[1].y * s.x - posDelta[0].y * t.x) * dirCorrection;
+                bitangent.z = (posDelta[1].z * s.x - posDelta[0].z * t.x) * dirCorrection;
+            }
+
+            // store for every vertex of that face
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                // project tangent and bitangent into the plane formed by the vertex' normal
+                glm::vec3 localTangent = tangent - V[i].normal * (glm::dot(tangent, V[i].normal));
+                localTangent = glm::normalize(localTangent);
+                glm::vec3 localBitangent = bitangent - V[i].normal * (glm::dot(bitangent, V[i].normal));
+                localBitangent = glm::normalize(localBitangent);
+                localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
+                localBitangent = glm::normalize(localBitangent);
+
+                // reconstruct tangent/bitangent according to normal and bitangent/tangent when it's infinite or NaN.
+                bool isInvalidBitangent = isSpecialFloat(localBitangent.x) || isSpecialFloat(localBitangent.y) || isSpecialFloat(localBitangent.z);
+
+                if (isInvalidBitangent)
+                {
+                    localBitangent = glm::cross(localTangent, V[i].normal);
+                    localBitangent = glm::normalize(localBitangent);
+                }
+
+                // and write it into the mesh
+                uint32_t index = mesh.pIndices[primID * 3 + i];
+                pBitangents[index] = localBitangent;
+            }
+        }
+    }
+
+    void TangentSpace::generateBitangents(const MeshData& mesh, glm::vec3* pBitangents, Flags flags, ThreadPool* pPool)
+    {
+        if(pPool == nullptr)
+        {
+            pPool = ThreadPool::getDefault();
+        }
+
+        const uint32_t primCount = mesh.indexCount / 3;
+        if(primCount == 0)
+        {
+            return;
+        }
+
+        // Welded vertices are processed as if the triangles referenced the first vertex of each group
+        std::vector<uint32_t> remap;
+        if(is_set(flags, Flags::WeldVertices))
+        {
+            remap = weldVertices(mesh, pPool);
+        }
+        const uint32_t* pRemap = remap.empty() ? nullptr : remap.data();
+
+        // The serial implementation lets the last triangle referencing a vertex determine its value. Find that triangle corner for every vertex, so that the triangles can be processed in any order.
+        // The owners are stored as corner+1, 0 means the vertex isn't referenced
+        std::unique_ptr<std::atomic<uint32_t>[]> owners(new std::atomic<uint32_t>[mesh.vertexCount]);
+        pPool->parallelFor(mesh.vertexCount, 65536, [&](uint32_t first, uint32_t last)
+        {
+            for(uint32_t i = first; i < last; i++)
+            {
+                owners[i].store(0, std::memory_order_relaxed);
+            }
+        });
+
+        // A locked compare-exchange for every corner is expensive. The first pass uses plain stores, which are correct unless two threads write the same vertex at the same time.
+        // The second pass fixes these vertices, and only needs to exchange when the first pass lost an update
+        const uint32_t cornerCount = primCount * 3;
+        const uint32_t chunkSize = kMinParallelIndexCount / 4;
+        for(bool exchange : { false, true })
+        {
+            pPool->parallelFor(cornerCount, chunkSize, [&](uint32_t first, uint32_t last)
+            {
+                for(uint32_t corner = first; corner < last; corner++)
+                {
+                    uint32_t index = mesh.pIndices[corner];
+                    index = pRemap ? pRemap[index] : index;
+                    uint32_t owner = owners[index].load(std::memory_order_relaxed);
+                    if(exchange == false)
+                    {
+                        if(owner < corner + 1)
+                        {
+                            owners[index].store(corner + 1, std::memory_order_relaxed);
+                        }
+                    }
+                    else
+                    {
+                        while(owner < corner + 1 && owners[index].compare_exchange_weak(owner, corner + 1, std::memory_order_relaxed) == false);
+                    }
+                }
+            });
+        }
+
+        // Process the triangles in groups of 4, one per lane. The last group repeats its last triangle in the unused lanes
+        const uint32_t groupCount = (primCount + 3) / 4;
+        pPool->parallelFor(groupCount, chunkSize / 12, [&](uint32_t first, uint32_t last)
+        {
+            for(uint32_t group = first; group < last; group++)
+            {
+                uint32_t primIDs[4];
+                for(uint32_t lane = 0; lane < 4; lane++)
+                {
+                    primIDs[lane] = std::min(group * 4 + lane, primCount - 1);
+                }
+
+                // Gather the data
+                Vec3x4 position[3];
+                Vec3x4 normal[3];
+                __m128 u[3];
+                __m128 v[3];
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t index[4];
+                    for(uint32_t lane = 0; lane < 4; lane++)
+                    {
+                        index[lane] = mesh.pIndices[primIDs[lane] * 3 + i];
+                    }
+
+                    const glm::vec3* p[4] = { &getPosition(mesh, index[0]), &getPosition(mesh, index[1]), &getPosition(mesh, index[2]), &getPosition(mesh, index[3]) };
+                    position[i] = { _mm_setr_ps(p[0]->x, p[1]->x, p[2]->x, p[3]->x), _mm_setr_ps(p[0]->y, p[1]->y, p[2]->y, p[3]->y), _mm_setr_ps(p[0]->z, p[1]->z, p[2]->z, p[3]->z) };
+
+                    const glm::vec3* n[4] = { &mesh.pNormals[index[0]], &mesh.pNormals[index[1]], &mesh.pNormals[index[2]], &mesh.pNormals[index[3]] };
+                    normal[i] = { _mm_setr_ps(n[0]->x, n[1]->x, n[2]->x, n[3]->x), _mm_setr_ps(n[0]->y, n[1]->y, n[2]->y, n[3]->y), _mm_setr_ps(n[0]->z, n[1]->z, n[2]->z, n[3]->z) };
+
+                    glm::vec2 uv[4] = { getTexCrd(mesh, index[0]), getTexCrd(mesh, index[1]), getTexCrd(mesh, index[2]), getTexCrd(mesh, index[3]) };
+                    u[i] = _mm_setr_ps(uv[0].x, uv[1].x, uv[2].x, uv[3].x);
+                    v[i] = _mm_setr_ps(uv[0].y, uv[1].y, uv[2].y, uv[3].y);
+                }
+
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 signBit = _mm_set1_ps(-0.0f);
+
+                // Position delta and texture offset
+                const Vec3x4 posDelta0 = sub(position[1], position[0]);
+                const Vec3x4 posDelta1 = sub(position[2], position[0]);
+                const __m128 sx = _mm_sub_ps(u[1], u[0]);
+                const __m128 sy = _mm_xor_ps(_mm_sub_ps(v[1], v[0]), signBit);
+                const __m128 tx = _mm_sub_ps(u[2], u[0]);
+                const __m128 ty = _mm_xor_ps(_mm_sub_ps(v[2], v[0]), signBit);
+
+                // Triangles whose texture coordinates are degenerate use the default UV direction
+                const Vec3x4& n0 = normal[0];
+                const __m128 useX = _mm_cmpgt_ps(absolute(n0.x), absolute(n0.y));
+                const __m128 lengthXZ = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(n0.x, n0.x), _mm_mul_ps(n0.z, n0.z)));
+                const __m128 lengthYZ = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(n0.y, n0.y), _mm_mul_ps(n0.z, n0.z)));
+                Vec3x4 defaultBitangent;
+                defaultBitangent.x = select(useX, _mm_div_ps(n0.z, lengthXZ), _mm_div_ps(zero, lengthYZ));
+                defaultBitangent.y = select(useX, _mm_div_ps(zero, lengthXZ), _mm_div_ps(n0.z, lengthYZ));
+                defaultBitangent.z = select(useX, _mm_div_ps(_mm_xor_ps(n0.x, signBit), lengthXZ), _mm_div_ps(_mm_xor_ps(n0.y, signBit), lengthYZ));
+                const Vec3x4 defaultTangent = cross(defaultBitangent, n0);
+
+                const __m128 dirCorrection = select(_mm_cmplt_ps(_mm_sub_ps(_mm_mul_ps(tx, sy), _mm_mul_ps(ty, sx)), zero), _mm_set1_ps(-1.0f), _mm_set1_ps(1.0f));
+                Vec3x4 uvTangent;
+                uvTangent.x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.x, sy), _mm_mul_ps(posDelta0.x, ty)), dirCorrection);
+                uvTangent.y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.y, sy), _mm_mul_ps(posDelta0.y, ty)), dirCorrection);
+                uvTangent.z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.z, sy), _mm_mul_ps(posDelta0.z, ty)), dirCorrection);
+                Vec3x4 uvBitangent;
+                uvBitangent.x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.x, sx), _mm_mul_ps(posDelta0.x, tx)), dirCorrection);
+                uvBitangent.y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.y, sx), _mm_mul_ps(posDelta0.y, tx)), dirCorrection);
+                uvBitangent.z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(posDelta1.z, sx), _mm_mul_ps(posDelta0.z, tx)), dirCorrection);
+
+                const __m128 sIsZero = _mm_and_ps(_mm_cmpeq_ps(sx, zero), _mm_cmpeq_ps(sy, zero));
+                const __m128 tIsZero = _mm_and_ps(_mm_cmpeq_ps(tx, zero), _mm_cmpeq_ps(ty, zero));
+                const __m128 isDegenerate = _mm_or_ps(sIsZero, tIsZero);
+                const Vec3x4 tangent = select(isDegenerate, defaultTangent, uvTangent);
+                const Vec3x4 bitangent = select(isDegenerate, defaultBitangent, uvBitangent);
+
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    // Project the tangent frame into the plane of the vertex' normal
+                    const Vec3x4 localTangent = normalize(project(tangent, normal[i]));
+                    Vec3x4 localBitangent = normalize(project(bitangent, normal[i]));
+                    localBitangent = normalize(sub(localBitangent, mul(localTangent, dot(localBitangent, localTangent))));
+
+                    // Reconstruct the bitangent from the normal and tangent when it's infinite or NaN
+                    const __m128 isInvalid = _mm_or_ps(_mm_or_ps(isSpecialFloat(localBitangent.x), isSpecialFloat(localBitangent.y)), isSpecialFloat(localBitangent.z));
+                    if(_mm_movemask_ps(isInvalid))
+                    {
+                        localBitangent = select(isInvalid, normalize(cross(localTangent, normal[i])), localBitangent);
+                    }
+
+                    alignas(16) float x[4], y[4], z[4];
+                    _mm_store_ps(x, localBitangent.x);
+                    _mm_store_ps(y, localBitangent.y);
+                    _mm_store_ps(z, localBitangent.z);
+
+                    // Only the owning corner writes the vertex
+                    const uint32_t laneCount = std::min(4U, primCount - group * 4);
+                    for(uint32_t lane = 0; lane < laneCount; lane++)
+                    {
+                        const uint32_t corner = primIDs[lane] * 3 + i;
+                        uint32_t index = mesh.pIndices[corner];
+                        index = pRemap ? pRemap[index] : index;
+                        if(owners[index].load(std::memory_order_relaxed) == corner + 1)
+                        {
+                            pBitangents[index] = glm::vec3(x[lane], y[lane], z[lane]);
+                        }
+                    }
+                }
+            }
+        });
+
+        // Copy the result to the welded vertices
+        if(pRemap)
+        {
+            pPool->parallelFor(mesh.vertexCount, 65536, [&](uint32_t first, uint32_t last)
+            {
+                for(uint32_t i = first; i < last; i++)
+                {
+                    if(pRemap[i] != i && owners[pRemap[i]].load(std::memory_order_relaxed) != 0)
+                    {
+                        pBitangents[i] = pBitangents[pRemap[i]];
+                    }
+                }
+            });
+        }
+    }
+}
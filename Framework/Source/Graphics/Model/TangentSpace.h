@@ -0,0 +1,81 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    class ThreadPool;
+
+    /** Generates the per-vertex bitangents used for normal mapping.\n
+        Each triangle computes its tangent frame from the positions and texture coordinates, projects it into the plane of each of its vertices' normals and writes the bitangent into the vertex. When several triangles share a vertex, the last triangle in index order determines the result.\n
+        The triangles are processed in parallel, four at a time using SSE. The result is bit-identical to the serial implementation, which is kept as a reference.
+    */
+    class TangentSpace
+    {
+    public:
+        enum class Flags : uint32_t
+        {
+            None            = 0x0,
+            WeldVertices    = 0x1,  ///< Vertices with identical position, normal and texture coordinate get the same bitangent, even if the triangles reference them using different indices. Removes seams between split vertices
+        };
+
+        /** The input mesh
+        */
+        struct MeshData
+        {
+            const uint32_t* pIndices = nullptr;             ///< Triangle list
+            uint32_t indexCount = 0;
+            uint32_t vertexCount = 0;                       ///< The number of elements in the vertex arrays
+            const float* pPositions = nullptr;              ///< Each element starts with the xyz position
+            uint32_t positionStride = sizeof(glm::vec3);    ///< Position stride in bytes
+            const glm::vec3* pNormals = nullptr;
+            const glm::vec2* pTexCrd = nullptr;             ///< Optional. Without texture coordinates the tangent frame is derived from the normal
+            uint32_t texCrdStride = 1;                      ///< Texture coordinate stride in glm::vec2 elements
+        };
+
+        /** Meshes with fewer indices are processed as a single task. Importers use it to decide whether a mesh is worth running on its own, outside of a per-mesh parallel loop
+        */
+        static const uint32_t kMinParallelIndexCount = 3 * 16384;
+
+        /** Generate the bitangents of a mesh
+            \param[in] mesh The mesh
+            \param[out] pBitangents Array with vertexCount elements. Vertices which are not referenced by any triangle are left untouched
+            \param[in] flags Generation flags
+            \param[in] pPool The thread pool to use. nullptr means the default pool. Calls made from inside a loop of the same pool run on the calling thread
+        */
+        static void generateBitangents(const MeshData& mesh, glm::vec3* pBitangents, Flags flags = Flags::None, ThreadPool* pPool = nullptr);
+
+        /** Generate the bitangents of a mesh using the serial scalar implementation. Doesn't support welding
+        */
+        static void generateBitangentsReference(const MeshData& mesh, glm::vec3* pBitangents);
+    };
+
+    enum_class_operators(TangentSpace::Flags);
+}
@@ -0,0 +1,213 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexQuantization.h"
+#include "glm/common.hpp"
+#include "glm/gtc/packing.hpp"
+#include <functional>
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t packUnitVector(const glm::vec3& v)
+        {
+            glm::vec3 unorm = glm::clamp(v * 0.5f + 0.5f, 0.0f, 1.0f);
+            uint32_t x = (uint32_t)glm::round(unorm.x * 1023.0f);
+            uint32_t y = (uint32_t)glm::round(unorm.y * 1023.0f);
+            uint32_t z = (uint32_t)glm::round(unorm.z * 1023.0f);
+            return x | (y << 10) | (z << 20);
+        }
+
+        glm::vec3 unpackUnitVector(uint32_t packed)
+        {
+            glm::vec3 unorm = glm::vec3((float)(packed & 0x3ff), (float)((packed >> 10) & 0x3ff), (float)((packed >> 20) & 0x3ff)) / 1023.0f;
+            return unorm * 2.0f - 1.0f;
+        }
+
+        uint16_t packPositionComponent(float p, float scale, float offset)
+        {
+            float unorm = (scale > 0) ? glm::clamp((p - offset) / scale, 0.0f, 1.0f) : 0;
+            return (uint16_t)glm::round(unorm * 65535.0f);
+        }
+
+        template<typename OutType>
+        void quantizeElements(const std::vector<uint8_t>& src, uint32_t srcStride, std::vector<uint8_t>& dst, uint32_t vertexCount, const std::function<OutType(const float*)>& quantize)
+        {
+            dst.resize(vertexCount * sizeof(OutType));
+            OutType* pDst = (OutType*)dst.data();
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                pDst[i] = quantize((const float*)(src.data() + (size_t)i * srcStride));
+            }
+        }
+
+        struct QuantizedPosition
+        {
+            uint16_t x, y, z, w;
+        };
+    }
+
+    VertexQuantization::PositionTransform VertexQuantization::calcPositionTransform(const float* pPositions, uint32_t positionStride, uint32_t vertexCount)
+    {
+        PositionTransform transform;
+        if(vertexCount == 0)
+        {
+            return transform;
+        }
+
+        glm::vec3 minPos(FLT_MAX);
+        glm::vec3 maxPos(-FLT_MAX);
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const float* pPos = (const float*)((const uint8_t*)pPositions + (size_t)i * positionStride);
+            glm::vec3 p(pPos[0], pPos[1], pPos[2]);
+            minPos = glm::min(minPos, p);
+            maxPos = glm::max(maxPos, p);
+        }
+
+        transform.scale = maxPos - minPos;
+        transform.offset = minPos;
+        return transform;
+    }
+
+    ResourceFormat VertexQuantization::getQuantizedFormat(uint32_t shaderLocation, ResourceFormat format, Model::LoadFlags flags)
+    {
+        const bool quantizeAttributes = is_set(flags, Model::LoadFlags::QuantizeVertexAttributes);
+        const bool quantizePositions = is_set(flags, Model::LoadFlags::QuantizePositions);
+
+        switch(shaderLocation)
+        {
+        case VERTEX_POSITION_LOC:
+            if(quantizePositions && (format == ResourceFormat::RGB32Float || format == ResourceFormat::RGBA32Float))
+            {
+                return ResourceFormat::RGBA16Unorm;
+            }
+            break;
+        case VERTEX_NORMAL_LOC:
+        case VERTEX_BITANGENT_LOC:
+            if(quantizeAttributes && format == ResourceFormat::RGB32Float)
+            {
+                return ResourceFormat::RGB10A2Unorm;
+            }
+            break;
+        case VERTEX_TEXCOORD_LOC:
+            if(quantizeAttributes && (format == ResourceFormat::RG32Float || format == ResourceFormat::RGB32Float))
+            {
+                return ResourceFormat::RG16Float;
+            }
+            break;
+        }
+        return format;
+    }
+
+    VertexBufferLayout::SharedConstPtr VertexQuantization::quantizeBuffer(const VertexBufferLayout::SharedConstPtr& pLayout, Model::LoadFlags flags, const PositionTransform& positionTransform, std::vector<uint8_t>& data)
+    {
+        if(pLayout->getElementCount() != 1)
+        {
+            return pLayout;
+        }
+
+        const uint32_t shaderLocation = pLayout->getElementShaderLocation(0);
+        const ResourceFormat format = pLayout->getElementFormat(0);
+        const ResourceFormat quantizedFormat = getQuantizedFormat(shaderLocation, format, flags);
+        if(quantizedFormat == format)
+        {
+            return pLayout;
+        }
+
+        const uint32_t stride = pLayout->getStride();
+        const uint32_t vertexCount = (uint32_t)(data.size() / stride);
+        std::vector<uint8_t> quantized;
+
+        switch(quantizedFormat)
+        {
+        case ResourceFormat::RGBA16Unorm:
+            quantizeElements<QuantizedPosition>(data, stride, quantized, vertexCount, [&positionTransform](const float* p)
+            {
+                QuantizedPosition q;
+                q.x = packPositionComponent(p[0], positionTransform.scale.x, positionTransform.offset.x);
+                q.y = packPositionComponent(p[1], positionTransform.scale.y, positionTransform.offset.y);
+                q.z = packPositionComponent(p[2], positionTransform.scale.z, positionTransform.offset.z);
+                q.w = 0xffff;
+                return q;
+            });
+            break;
+        case ResourceFormat::RGB10A2Unorm:
+            quantizeElements<uint32_t>(data, stride, quantized, vertexCount, [](const float* p)
+            {
+                return packUnitVector(glm::vec3(p[0], p[1], p[2]));
+            });
+            break;
+        case ResourceFormat::RG16Float:
+            quantizeElements<uint32_t>(data, stride, quantized, vertexCount, [](const float* p)
+            {
+                return glm::packHalf2x16(glm::vec2(p[0], p[1]));
+            });
+            break;
+        default:
+            should_not_get_here();
+            return pLayout;
+        }
+        data = std::move(quantized);
+
+        VertexBufferLayout::SharedPtr pQuantizedLayout = VertexBufferLayout::create();
+        pQuantizedLayout->addElement(pLayout->getElementName(0), 0, quantizedFormat, 1, shaderLocation);
+        pQuantizedLayout->setInputClass(pLayout->getInputClass(), pLayout->getInstanceStepRate());
+        return pQuantizedLayout;
+    }
+
+    glm::vec4 VertexQuantization::decodeElement(ResourceFormat format, const void* pData, const PositionTransform& positionTransform)
+    {
+        const float* pFloats = (const float*)pData;
+        switch(format)
+        {
+        case ResourceFormat::R32Float:
+            return glm::vec4(pFloats[0], 0, 0, 0);
+        case ResourceFormat::RG32Float:
+            return glm::vec4(pFloats[0], pFloats[1], 0, 0);
+        case ResourceFormat::RGB32Float:
+            return glm::vec4(pFloats[0], pFloats[1], pFloats[2], 0);
+        case ResourceFormat::RGBA32Float:
+            return glm::vec4(pFloats[0], pFloats[1], pFloats[2], pFloats[3]);
+        case ResourceFormat::RGBA16Unorm:
+        {
+            const QuantizedPosition& q = *(const QuantizedPosition*)pData;
+            glm::vec3 unorm = glm::vec3((float)q.x, (float)q.y, (float)q.z) / 65535.0f;
+            return glm::vec4(unorm * positionTransform.scale + positionTransform.offset, 1);
+        }
+        case ResourceFormat::RGB10A2Unorm:
+            return glm::vec4(unpackUnitVector(*(const uint32_t*)pData), 0);
+        case ResourceFormat::RG16Float:
+            return glm::vec4(glm::unpackHalf2x16(*(const uint32_t*)pData), 0, 0);
+        default:
+            should_not_get_here();
+            return glm::vec4(0);
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "API/VertexLayout.h"
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    /** Packs vertex attributes into compact formats.\n
+        Normals and bitangents are stored as RGB10A2Unorm, mapping [-1, 1] to [0, 1]. Texture coordinates are stored as RG16Float.
+        Positions are stored as RGBA16Unorm, mapping the bounding box of the vertices to [0, 1]. The mesh holds the transform back to object space, see Mesh::getPositionScale().
+        The default vertex shader decodes the attributes, see getVertexPosition() and friends in VertexAttrib.h.
+    */
+    class VertexQuantization
+    {
+    public:
+        /** Transform from the quantized positions to object space
+        */
+        struct PositionTransform
+        {
+            glm::vec3 scale = glm::vec3(1);
+            glm::vec3 offset = glm::vec3(0);
+        };
+
+        /** Calculate the transform that maps [0, 1] to the bounding box of the positions
+            \param[in] pPositions The positions. Each element starts with the xyz position
+            \param[in] positionStride Position stride in bytes
+            \param[in] vertexCount The number of vertices
+        */
+        static PositionTransform calcPositionTransform(const float* pPositions, uint32_t positionStride, uint32_t vertexCount);
+
+        /** Get the format a vertex element is quantized to. Returns the original format if the element isn't quantized
+            \param[in] shaderLocation The element's shader location
+            \param[in] format The element's format
+            \param[in] flags Model::LoadFlags::QuantizeVertexAttributes and Model::LoadFlags::QuantizePositions select the elements to quantize
+        */
+        static ResourceFormat getQuantizedFormat(uint32_t shaderLocation, ResourceFormat format, Model::LoadFlags flags);
+
+        /** Quantize a vertex buffer which holds a single element, like the ones the model importers create
+            \param[in] pLayout The buffer's layout
+            \param[in] flags Model::LoadFlags::QuantizeVertexAttributes and Model::LoadFlags::QuantizePositions select the elements to quantize
+            \param[in] positionTransform The transform returned by calcPositionTransform(). Only used for positions
+            \param[in, out] data The vertex data
+            \return The layout of the quantized buffer. If the element isn't quantized, that's pLayout
+        */
+        static VertexBufferLayout::SharedConstPtr quantizeBuffer(const VertexBufferLayout::SharedConstPtr& pLayout, Model::LoadFlags flags, const PositionTransform& positionTransform, std::vector<uint8_t>& data);
+
+        /** Decode a single vertex element, the same way the vertex shader does. Used to measure the quantization error
+            \param[in] format The element's format. Either a 32-bit float format or one of the quantized formats
+            \param[in] pData The element's data
+            \param[in] positionTransform Applied to RGBA16Unorm elements, which are quantized positions
+        */
+        static glm::vec4 decodeElement(ResourceFormat format, const void* pData, const PositionTransform& positionTransform);
+    };
+}
@@ -28,6 +28,8 @@
 #include "Framework.h"
 #include "Program.h"
 #include <vector>
+#include <mutex>
+#include <algorithm>
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "Graphics/TextureHelper.h"
@@ -39,11 +41,91 @@
 #include "Utils/ShaderUtils.h"
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
+#include "Utils/TaskQueue.h"
 
 namespace Falcor
 {
     std::vector<Program*> Program::sPrograms;
 
+    namespace
+    {
+        uint32_t internString(const std::string& str)
+        {
+            static std::mutex sMutex;
+            static std::unordered_map<std::string, uint32_t> sIDs;
+
+            std::lock_guard<std::mutex> lock(sMutex);
+            return sIDs.emplace(str, (uint32_t)sIDs.size()).first->second;
+        }
+
+        // 64-bit finalizer of MurmurHash3. The key hash is the XOR of the hashed defines, so it doesn't depend on their order and can be updated incrementally
+        uint64_t hashDefine(uint64_t define)
+        {
+            define ^= define >> 33;
+            define *= 0xff51afd7ed558ccdull;
+            define ^= define >> 33;
+            define *= 0xc4ceb9fe1a85ec53ull;
+            define ^= define >> 33;
+            return define;
+        }
+
+        uint64_t packDefine(uint32_t nameID, uint32_t valueID)
+        {
+            return ((uint64_t)nameID << 32) | valueID;
+        }
+    }
+
+    Program::Define Program::createDefine(const std::string& name, const std::string& value)
+    {
+        Define define;
+        define.name = name;
+        define.value = value;
+        define.nameID = internString(name);
+        define.valueID = internString(value);
+        return define;
+    }
+
+    Program::PermutationKey::PermutationKey(const DefineList& defines)
+    {
+        for(const auto& define : defines)
+        {
+            set(internString(define.first), internString(define.second));
+        }
+    }
+
+    bool Program::PermutationKey::set(uint32_t nameID, uint32_t valueID)
+    {
+        const uint64_t packed = packDefine(nameID, valueID);
+        auto it = std::lower_bound(mDefines.begin(), mDefines.end(), packDefine(nameID, 0));
+        if(it != mDefines.end() && (*it >> 32) == nameID)
+        {
+            if(*it == packed)
+            {
+                return false;
+            }
+            mHash ^= hashDefine(*it);
+            *it = packed;
+        }
+        else
+        {
+            mDefines.insert(it, packed);
+        }
+        mHash ^= hashDefine(packed);
+        return true;
+    }
+
+    bool Program::PermutationKey::remove(uint32_t nameID)
+    {
+        auto it = std::lower_bound(mDefines.begin(), mDefines.end(), packDefine(nameID, 0));
+        if(it == mDefines.end() || (*it >> 32) != nameID)
+        {
+            return false;
+        }
+        mHash ^= hashDefine(*it);
+        mDefines.erase(it);
+        return true;
+    }
+
     Program::Program()
     {
         sPrograms.push_back(this);
@@ -51,6 +133,9 @@ namespace Falcor
 
     Program::~Program()
     {
+        // Background compilations reference this object
+        waitForPendingVersions();
+
         // Remove the current program from the program vector
         for(auto it = sPrograms.begin() ; it != sPrograms.end() ; it++)
         {
@@ -84,40 +169,67 @@ namespace Falcor
         mShaderStrings[(uint32_t)ShaderType::Hull] = HS;
         mShaderStrings[(uint32_t)ShaderType::Domain] = DS;
         mCreatedFromFile = createdFromFile;
-        mDefineList = programDefines;
+        replaceAllDefines(programDefines);
     }
 
     void Program::init(const std::string& cs, const DefineList& programDefines, bool createdFromFile)
     {
         mShaderStrings[(uint32_t)ShaderType::Compute] = cs;
         mCreatedFromFile = createdFromFile;
-        mDefineList = programDefines;
+        replaceAllDefines(programDefines);
     }
 
     void Program::addDefine(const std::string& name, const std::string& value)
     {
-        // Make sure that it doesn't exist already
-        if(mDefineList.find(name) != mDefineList.end())
+        // Nothing to do if the define already exists with the same value
+        if(mDefineKey.set(internString(name), internString(value)))
         {
-            if(mDefineList[name] == value)
-            {
-                // Same define
-                return;
-            }
+            mLinkRequired = true;
+            mDefineList[name] = value;
+        }
+    }
+
+    void Program::addDefine(const Define& define)
+    {
+        if(mDefineKey.set(define.nameID, define.valueID))
+        {
+            mLinkRequired = true;
+            mDefineList[define.name] = define.value;
         }
-        mLinkRequired = true;
-        mDefineList[name] = value;
     }
 
     void Program::removeDefine(const std::string& name)
     {
-        if(mDefineList.find(name) != mDefineList.end())
+        if(mDefineKey.remove(internString(name)))
         {
             mLinkRequired = true;
             mDefineList.erase(name);
         }
     }
 
+    void Program::removeDefine(const Define& define)
+    {
+        if(mDefineKey.remove(define.nameID))
+        {
+            mLinkRequired = true;
+            mDefineList.erase(define.name);
+        }
+    }
+
+    void Program::clearDefines()
+    {
+        mLinkRequired = true;
+        mDefineList.clear();
+        mDefineKey = PermutationKey();
+    }
+
+    void Program::replaceAllDefines(const DefineList& dl)
+    {
+        mLinkRequired = true;
+        mDefineList = dl;
+        mDefineKey = PermutationKey(dl);
+    }
+
     bool Program::checkIfFilesChanged()
     {
         if(mpActiveProgram == nullptr)
@@ -156,10 +268,38 @@ namespace Falcor
 
     ProgramVersion::SharedConstPtr Program::getActiveVersion() const
     {
+        if(mPendingVersions.size())
+        {
+            collectPendingVersions(false);
+        }
+
         if(mLinkRequired)
         {
-            const auto& it = mProgramVersions.find(mDefineList);
-            ProgramVersion::SharedConstPtr pVersion = nullptr;
+            auto it = mProgramVersions.find(mDefineKey);
+            if(it == mProgramVersions.end())
+            {
+                // Versions which failed in the background are linked synchronously, which reports the error
+                bool failedBefore = mFailedVersions.erase(mDefineKey) != 0;
+                if(failedBefore == false)
+                {
+                    auto pendingIt = mPendingVersions.find(mDefineKey);
+                    if(mAsyncCompilation && mpActiveProgram)
+                    {
+                        // Keep using the current version until the new one is ready
+                        queueVersion(mDefineKey, mDefineList);
+                        return mpActiveProgram;
+                    }
+                    else if(pendingIt != mPendingVersions.end())
+                    {
+                        // The version is already being compiled, wait for it instead of compiling it again
+                        pendingIt->second->done.wait();
+                        collectPendingVersions(false);
+                        mFailedVersions.erase(mDefineKey);
+                        it = mProgramVersions.find(mDefineKey);
+                    }
+                }
+            }
+
             if(it == mProgramVersions.end())
             {
                 if(link() == false)
@@ -168,23 +308,112 @@ namespace Falcor
                 }
                 else
                 {
-                    mProgramVersions[mDefineList] = mpActiveProgram;
+                    mProgramVersions[mDefineKey] = mpActiveProgram;
                 }
             }
             else
             {
-                mpActiveProgram = mProgramVersions[mDefineList];
+                mpActiveProgram = it->second;
             }
+            mLinkRequired = false;
         }
 
         return mpActiveProgram;
     }
 
-    void Program::updateFileTimestamps() const
+    void Program::prewarm(const std::vector<DefineList>& defineLists) const
+    {
+        for(const auto& defines : defineLists)
+        {
+            PermutationKey key(defines);
+            if(mProgramVersions.find(key) == mProgramVersions.end())
+            {
+                queueVersion(key, defines);
+            }
+        }
+    }
+
+    ProgramVersion::SharedConstPtr Program::tryGetVersion(const DefineList& defines) const
+    {
+        if(mPendingVersions.size())
+        {
+            collectPendingVersions(false);
+        }
+
+        PermutationKey key(defines);
+        auto it = mProgramVersions.find(key);
+        if(it != mProgramVersions.end())
+        {
+            return it->second;
+        }
+
+        // Failed versions are reported when they are linked by getActiveVersion(), don't compile them again
+        if(mFailedVersions.find(key) == mFailedVersions.end())
+        {
+            queueVersion(key, defines);
+        }
+        return nullptr;
+    }
+
+    void Program::queueVersion(const PermutationKey& key, const DefineList& defines) const
+    {
+        if(mPendingVersions.find(key) != mPendingVersions.end())
+        {
+            return;
+        }
+
+        auto pPending = std::make_shared<PendingVersion>();
+        PendingVersion* pData = pPending.get();
+        pPending->done = TaskQueue::getDefault()->enqueue([this, pData, defines]()
+        {
+            pData->pVersion = createProgramVersion(defines, pData->log, false);
+        });
+        mPendingVersions[key] = pPending;
+    }
+
+    void Program::collectPendingVersions(bool wait) const
+    {
+        for(auto it = mPendingVersions.begin(); it != mPendingVersions.end();)
+        {
+            const PendingVersion& pending = *it->second;
+            if(wait)
+            {
+                pending.done.wait();
+            }
+            else if(pending.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                it++;
+                continue;
+            }
+
+            if(pending.pVersion)
+            {
+                mProgramVersions[it->first] = pending.pVersion;
+                if(it->first == mDefineKey)
+                {
+                    mpActiveProgram = pending.pVersion;
+                }
+                updateFileTimestamps(pending.pVersion.get());
+            }
+            else
+            {
+                logWarning("Background compilation failed.\n" + getProgramDescString() + "\n" + pending.log);
+                mFailedVersions.insert(it->first);
+            }
+            it = mPendingVersions.erase(it);
+        }
+    }
+
+    void Program::waitForPendingVersions() const
+    {
+        collectPendingVersions(true);
+    }
+
+    void Program::updateFileTimestamps(const ProgramVersion* pVersion) const
     {
         for (uint32_t i = 0; i < kShaderCount; i++)
         {
-            const auto pShader = mpActiveProgram->getShader((ShaderType)i);
+            const auto pShader = pVersion->getShader((ShaderType)i);
             if (pShader)
             {
                 if (mCreatedFromFile)
@@ -202,10 +431,8 @@ namespace Falcor
         }
     }
 
-    ProgramVersion::SharedPtr Program::createProgramVersion(std::string& log) const
+    ProgramVersion::SharedPtr Program::createProgramVersion(const DefineList& defines, std::string& log, bool interactive) const
     {
-        mFileTimeMap.clear();
-
         Shader::SharedPtr shaders[kShaderCount] = {};
 
         // create the shaders
@@ -213,13 +440,22 @@ namespace Falcor
         {
             if (mShaderStrings[i].size())
             {
-                if (mCreatedFromFile)
+                if (interactive == false)
+                {
+                    // A missing shader would silently create a version without that stage, so fail the entire version
+                    shaders[i] = mCreatedFromFile ? createShaderFromFile(mShaderStrings[i], ShaderType(i), defines, log) : createShaderFromString(mShaderStrings[i], ShaderType(i), defines, log);
+                    if (shaders[i] == nullptr)
+                    {
+                        return nullptr;
+                    }
+                }
+                else if (mCreatedFromFile)
                 {
-                    shaders[i] = createShaderFromFile(mShaderStrings[i], ShaderType(i), mDefineList);
+                    shaders[i] = createShaderFromFile(mShaderStrings[i], ShaderType(i), defines);
                 }
                 else
                 {
-                    shaders[i] = createShaderFromString(mShaderStrings[i], ShaderType(i), mDefineList);
+                    shaders[i] = createShaderFromString(mShaderStrings[i], ShaderType(i), defines);
                 }
             }           
         }
@@ -246,7 +482,7 @@ namespace Falcor
         {
             // create the program
             std::string log;
-            ProgramVersion::SharedConstPtr pProgram = createProgramVersion(log);
+            ProgramVersion::SharedConstPtr pProgram = createProgramVersion(mDefineList, log, true);
 
             if(pProgram == nullptr)
             {
@@ -263,7 +499,7 @@ namespace Falcor
             else
             {
                 mpActiveProgram = pProgram;
-                updateFileTimestamps();
+                updateFileTimestamps(pProgram.get());
                 return true;
             }
         }
@@ -271,6 +507,9 @@ namespace Falcor
 
     void Program::reset()
     {
+        // Results of background compilations which were started before the reset are outdated
+        waitForPendingVersions();
+        mFailedVersions.clear();
         mpActiveProgram = nullptr;
         mProgramVersions.clear();
         mFileTimeMap.clear();
@@ -29,6 +29,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
 #include "API/ProgramVersion.h"
 
 namespace Falcor
@@ -52,6 +55,52 @@ namespace Falcor
             void remove(const std::string& name) {(*this).erase(name); }
         };
 
+        /** A define whose name and value were interned.\n
+            Adding or removing an interned define doesn't hash or compare strings unless the define list actually changes. Use it for defines which are toggled every frame.
+        */
+        struct Define
+        {
+            std::string name;
+            std::string value;
+            uint32_t nameID = 0;
+            uint32_t valueID = 0;
+        };
+
+        /** Create an interned define. The IDs are global and valid for the lifetime of the application.
+            \param[in] name The name of the define
+            \param[in] value Optional. The value of the define string
+        */
+        static Define createDefine(const std::string& name, const std::string& value = "");
+
+        /** Identifies a program version by the interned IDs of its defines.\n
+            The 64-bit hash is updated incrementally when a define changes. Equal hashes are confirmed by comparing the IDs, so hash collisions can't return the wrong version.
+        */
+        class PermutationKey
+        {
+        public:
+            PermutationKey() = default;
+            PermutationKey(const DefineList& defines);
+
+            /** Add a define or change its value. Returns true if the key changed.
+            */
+            bool set(uint32_t nameID, uint32_t valueID);
+
+            /** Remove a define. Returns true if the key changed.
+            */
+            bool remove(uint32_t nameID);
+
+            uint64_t getHash() const { return mHash; }
+            bool operator==(const PermutationKey& other) const { return (mHash == other.mHash) && (mDefines == other.mDefines); }
+
+            struct Hasher
+            {
+                size_t operator()(const PermutationKey& key) const { return (size_t)key.getHash(); }
+            };
+        private:
+            std::vector<uint64_t> mDefines;     // (nameID << 32) | valueID, sorted by name ID
+            uint64_t mHash = 0;
+        };
+
         virtual ~Program() = 0;
 
         /** Get the API handle of the active program
@@ -65,14 +114,22 @@ namespace Falcor
         */
         void addDefine(const std::string& name, const std::string& value = "");
 
+        /** Adds an interned macro definition to the program. If the macro already exists, its will be replaced.
+        */
+        void addDefine(const Define& define);
+
         /** Remove a macro definition from the program. If the definition doesn't exist, the function call will be silently ignored.
             \param[in] name The name of define. Must be valid
         */
         void removeDefine(const std::string& name);
 
+        /** Remove an interned macro definition from the program. If the definition doesn't exist, the function call will be silently ignored.
+        */
+        void removeDefine(const Define& define);
+
         /** Clear the macro definition list
         */
-        void clearDefines() { mDefineList.clear(); }
+        void clearDefines();
     
         /** Get the macro definition string of the active program version
         */
@@ -84,7 +141,36 @@ namespace Falcor
 
         /** update define list
         */
-        void replaceAllDefines(const DefineList& dl) { mDefineList = dl; }
+        void replaceAllDefines(const DefineList& dl);
+
+        /** Enable or disable asynchronous compilation.\n
+            When enabled, getActiveVersion() doesn't block when the active define list requires a version which wasn't built yet. The version is compiled on the TaskQueue, and the previously active version is returned until it's ready.
+            The first version of a program is always compiled synchronously, since there's nothing to fall back to.
+        */
+        void setAsyncCompilation(bool enable) { mAsyncCompilation = enable; }
+
+        /** Check if asynchronous compilation is enabled
+        */
+        bool isAsyncCompilationEnabled() const { return mAsyncCompilation; }
+
+        /** Compile a list of program versions in the background, regardless of the asynchronous compilation mode. Use it at load time for define lists which are known to be used later.
+            \param[in] defineLists The define lists to compile. Versions which were already built or queued are skipped.
+        */
+        void prewarm(const std::vector<DefineList>& defineLists) const;
+
+        /** Get a program version without blocking, regardless of the asynchronous compilation mode. Doesn't change the active version.
+            \param[in] defines The define list of the version
+            \return The version if it was already built. Otherwise nullptr, and the version is compiled in the background unless it already failed.
+        */
+        ProgramVersion::SharedConstPtr tryGetVersion(const DefineList& defines) const;
+
+        /** Get the number of versions which are being compiled in the background
+        */
+        uint32_t getPendingVersionCount() const { return (uint32_t)mPendingVersions.size(); }
+
+        /** Wait for all the background compilations to finish and make the results available
+        */
+        void waitForPendingVersions() const;
     protected:
         static const uint32_t kShaderCount = (uint32_t)ShaderType::Count;
 
@@ -93,17 +179,32 @@ namespace Falcor
         void init(const std::string& cs, const DefineList& programDefines, bool createdFromFile);
 
         bool link() const;
-        virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log) const;
-        void updateFileTimestamps() const;
+        // Background versions are created with interactive set to false. They don't show any UI, errors are returned in the log and reported when the version is linked on the render thread.
+        virtual ProgramVersion::SharedPtr createProgramVersion(const DefineList& defines, std::string& log, bool interactive) const;
+        void updateFileTimestamps(const ProgramVersion* pVersion) const;
+
+        // Background compilation
+        struct PendingVersion
+        {
+            std::shared_future<void> done;
+            ProgramVersion::SharedPtr pVersion;     // Written by the worker, only read after 'done' is ready
+            std::string log;
+        };
+        void queueVersion(const PermutationKey& key, const DefineList& defines) const;
+        void collectPendingVersions(bool wait) const;
 
         std::string mShaderStrings[kShaderCount]; // Either a filename or a string, depending on the value of mCreatedFromFile
 
         DefineList mDefineList;
+        PermutationKey mDefineKey;      // Kept in sync with mDefineList
 
         // We are doing lazy compilation, so these are mutable
         mutable bool mLinkRequired = true;
-        mutable std::map<const DefineList, ProgramVersion::SharedConstPtr> mProgramVersions;
+        mutable std::unordered_map<PermutationKey, ProgramVersion::SharedConstPtr, PermutationKey::Hasher> mProgramVersions;
         mutable ProgramVersion::SharedConstPtr mpActiveProgram = nullptr;
+        mutable std::unordered_map<PermutationKey, std::shared_ptr<PendingVersion>, PermutationKey::Hasher> mPendingVersions;
+        mutable std::unordered_set<PermutationKey, PermutationKey::Hasher> mFailedVersions;  // Failed background compilations. These are linked synchronously, which reports the error
+        bool mAsyncCompilation = false;
 
         std::string getProgramDescString() const;
         static std::vector<Program*> sPrograms;
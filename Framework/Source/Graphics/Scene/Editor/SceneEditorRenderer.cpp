@@ -53,6 +53,9 @@ namespace Falcor
     {
         mpGraphicsState = GraphicsState::create();
 
+        // Gizmo state is set per model instance, so instances must not be merged across model instances
+        toggleSortedDrawList(false);
+
         // Solid Rasterizer state
         RasterizerState::Desc rsDesc;
         rsDesc.setFillMode(RasterizerState::FillMode::Solid).setCullMode(RasterizerState::CullMode::Back);
@@ -0,0 +1,347 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightClusters.h"
+#include "Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    static_assert(offsetof(LightData, material) == 176, "LIGHT_DATA_SIZE in ShaderCommon.h must match the size of LightData without the material");
+
+    namespace
+    {
+        glm::vec3 unproject(const glm::mat4& invProj, float x, float y, float z)
+        {
+            glm::vec4 p = invProj * glm::vec4(x, y, z, 1);
+            return glm::vec3(p) / p.w;
+        }
+
+        // The point at view depth 'depth' along the view ray through an NDC position. Works for both perspective and orthographic projections
+        glm::vec3 pointAtDepth(const glm::mat4& invProj, float x, float y, float depth)
+        {
+            glm::vec3 p0 = unproject(invProj, x, y, 0);
+            glm::vec3 p1 = unproject(invProj, x, y, 1);
+            float t = (-depth - p0.z) / (p1.z - p0.z);
+            return p0 + t * (p1 - p0);
+        }
+
+        float maxComponent(const glm::vec3& v)
+        {
+            return glm::max(v.x, glm::max(v.y, v.z));
+        }
+
+        bool sphereIntersectsBox(const glm::vec4& sphere, const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            glm::vec3 d = glm::max(boxMin - glm::vec3(sphere), glm::vec3(0)) + glm::max(glm::vec3(sphere) - boxMax, glm::vec3(0));
+            return glm::dot(d, d) <= sphere.w * sphere.w;
+        }
+    }
+
+    LightClusters::SharedPtr LightClusters::create(uint32_t tilesX, uint32_t tilesY, uint32_t slices)
+    {
+        if (tilesX == 0 || tilesY == 0 || slices == 0)
+        {
+            logError("LightClusters::create() - the grid dimensions must be larger than zero");
+            return nullptr;
+        }
+        return SharedPtr(new LightClusters(tilesX, tilesY, slices));
+    }
+
+    LightClusters::LightClusters(uint32_t tilesX, uint32_t tilesY, uint32_t slices)
+    {
+        mData.tilesX = tilesX;
+        mData.tilesY = tilesY;
+        mData.slices = slices;
+
+        const uint32_t clusterCount = getClusterCount();
+        mClusterMin.resize(clusterCount);
+        mClusterMax.resize(clusterCount);
+        mClusterLights.resize(clusterCount);
+        mRanges.resize(clusterCount);
+        mSliceLights.resize(slices);
+    }
+
+    void LightClusters::updateClusterBounds(const glm::mat4& projMat, float nearZ, float farZ)
+    {
+        if (projMat == mProjMat && nearZ == mData.nearZ && farZ == mFarZ)
+        {
+            return;
+        }
+        mProjMat = projMat;
+        mData.nearZ = nearZ;
+        mFarZ = farZ;
+        mData.sliceScale = mData.slices / log(farZ / nearZ);
+
+        const glm::mat4 invProj = glm::inverse(projMat);
+        for (uint32_t z = 0; z < mData.slices; z++)
+        {
+            const float depth[2] = { nearZ * pow(farZ / nearZ, (float)z / mData.slices), nearZ * pow(farZ / nearZ, (float)(z + 1) / mData.slices) };
+            for (uint32_t y = 0; y < mData.tilesY; y++)
+            {
+                const float ndcY[2] = { -1 + 2.0f * y / mData.tilesY, -1 + 2.0f * (y + 1) / mData.tilesY };
+                for (uint32_t x = 0; x < mData.tilesX; x++)
+                {
+                    const float ndcX[2] = { -1 + 2.0f * x / mData.tilesX, -1 + 2.0f * (x + 1) / mData.tilesX };
+                    glm::vec3 boxMin(FLT_MAX);
+                    glm::vec3 boxMax(-FLT_MAX);
+                    for (uint32_t i = 0; i < 8; i++)
+                    {
+                        glm::vec3 p = pointAtDepth(invProj, ndcX[i & 1], ndcY[(i >> 1) & 1], depth[i >> 2]);
+                        boxMin = glm::min(boxMin, p);
+                        boxMax = glm::max(boxMax, p);
+                    }
+                    const uint32_t cluster = getClusterIndex(x, y, z);
+                    mClusterMin[cluster] = boxMin;
+                    mClusterMax[cluster] = boxMax;
+                }
+            }
+        }
+    }
+
+    void LightClusters::getClusterBounds(uint32_t cluster, glm::vec3& boxMin, glm::vec3& boxMax) const
+    {
+        boxMin = mClusterMin[cluster];
+        boxMax = mClusterMax[cluster];
+    }
+
+    void LightClusters::boundLight(uint32_t i, const glm::mat4& viewMat, const glm::mat4& projMat, float nearZ, float farZ)
+    {
+        const LightData& data = mLights[i]->getData();
+        glm::vec3 center = data.worldPos;
+        float radius = 0;
+        if (data.type == LightArea)
+        {
+            // The radiance is scaled by the surface area, and the light is offset by the size of its geometry
+            center = glm::vec3(data.transMat * glm::vec4(data.worldPos, 1));
+            const float scale = glm::max(glm::length(glm::vec3(data.transMat[0])), glm::max(glm::length(glm::vec3(data.transMat[1])), glm::length(glm::vec3(data.transMat[2]))));
+            const float extent = (data.aabbMax.x >= data.aabbMin.x) ? 0.5f * glm::length(data.aabbMax - data.aabbMin) * scale : 0;
+            radius = sqrt(maxComponent(data.intensity) * data.surfaceArea / mIntensityCutoff) + extent;
+        }
+        else
+        {
+            radius = sqrt(maxComponent(data.intensity) / mIntensityCutoff);
+        }
+
+        center = glm::vec3(viewMat * glm::vec4(center, 1));
+        const float depth = -center.z;
+        if (radius <= 0 || depth + radius < nearZ || depth - radius > farZ)
+        {
+            return;
+        }
+        mLightBounds[i] = glm::vec4(center, radius);
+
+        // Project the part of the sphere's bounding box which is in front of the near plane. The box is convex, so the projected corners bound it
+        const float boxFarZ = center.z - radius;
+        const float boxNearZ = glm::min(center.z + radius, -nearZ);
+        glm::vec2 ndcMin(FLT_MAX);
+        glm::vec2 ndcMax(-FLT_MAX);
+        for (uint32_t c = 0; c < 8; c++)
+        {
+            glm::vec4 corner((c & 1) ? center.x + radius : center.x - radius, (c & 2) ? center.y + radius : center.y - radius, (c & 4) ? boxNearZ : boxFarZ, 1);
+            glm::vec4 clip = projMat * corner;
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+        if (ndcMin.x > 1 || ndcMin.y > 1 || ndcMax.x < -1 || ndcMax.y < -1)
+        {
+            return;
+        }
+
+        auto toTile = [](float ndc, uint32_t tileCount) { return (uint32_t)glm::clamp((int32_t)floor((ndc * 0.5f + 0.5f) * tileCount), 0, (int32_t)tileCount - 1); };
+        mLightTiles[i] = glm::uvec4(toTile(ndcMin.x, mData.tilesX), toTile(ndcMin.y, mData.tilesY), toTile(ndcMax.x, mData.tilesX), toTile(ndcMax.y, mData.tilesY));
+
+        auto toSlice = [this](float d) { return (uint32_t)glm::clamp((int32_t)floor(log(d / mData.nearZ) * mData.sliceScale), 0, (int32_t)mData.slices - 1); };
+        mLightSlices[i] = glm::uvec2(toSlice(glm::max(depth - radius, nearZ)), toSlice(glm::min(depth + radius, farZ)));
+    }
+
+    void LightClusters::build(const std::vector<Light::SharedPtr>& lights, const Camera* pCamera, ThreadPool* pPool)
+    {
+        const glm::mat4& viewMat = pCamera->getViewMatrix();
+        const glm::mat4& projMat = pCamera->getProjMatrix();
+        const float nearZ = pCamera->getNearPlane();
+        const float farZ = pCamera->getFarPlane();
+        updateClusterBounds(projMat, nearZ, farZ);
+
+        // Directional lights go first, they are not binned
+        mLights.clear();
+        for (const auto& pLight : lights)
+        {
+            if (pLight->getType() == LightDirectional)
+            {
+                mLights.push_back(pLight.get());
+            }
+        }
+        mData.globalLightCount = (uint32_t)mLights.size();
+        for (const auto& pLight : lights)
+        {
+            if (pLight->getType() != LightDirectional)
+            {
+                mLights.push_back(pLight.get());
+            }
+        }
+        mData.lightCount = (uint32_t)mLights.size();
+
+        // Find the view-space bounding sphere of each light, and the tiles and slices it covers
+        mLightBounds.assign(mLights.size(), glm::vec4(0));
+        mLightTiles.resize(mLights.size());
+        mLightSlices.assign(mLights.size(), glm::uvec2(1, 0));
+        auto boundLights = [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                boundLight(mData.globalLightCount + i, viewMat, projMat, nearZ, farZ);
+            }
+        };
+
+        const uint32_t binnedCount = mData.lightCount - mData.globalLightCount;
+        if (pPool)
+        {
+            pPool->parallelFor(binnedCount, 256, boundLights);
+        }
+        else
+        {
+            boundLights(0, binnedCount);
+        }
+
+        for (auto& sliceLights : mSliceLights)
+        {
+            sliceLights.clear();
+        }
+        for (uint32_t i = mData.globalLightCount; i < (uint32_t)mLights.size(); i++)
+        {
+            for (uint32_t s = mLightSlices[i].x; s <= mLightSlices[i].y; s++)
+            {
+                mSliceLights[s].push_back(i);
+            }
+        }
+
+        // Bin the lights. Each slice owns its clusters, so slices can be processed in parallel
+        if (pPool)
+        {
+            pPool->parallelFor(mData.slices, 1, [this](uint32_t first, uint32_t last) { binSlices(first, last); });
+        }
+        else
+        {
+            binSlices(0, mData.slices);
+        }
+
+        // Flatten the lists
+        uint32_t indexCount = 0;
+        for (uint32_t c = 0; c < getClusterCount(); c++)
+        {
+            mRanges[c].first = indexCount;
+            mRanges[c].count = (uint32_t)mClusterLights[c].size();
+            indexCount += mRanges[c].count;
+        }
+
+        mLightIndices.resize(indexCount);
+        for (uint32_t c = 0; c < getClusterCount(); c++)
+        {
+            if (mRanges[c].count)
+            {
+                memcpy(&mLightIndices[mRanges[c].first], mClusterLights[c].data(), mRanges[c].count * sizeof(uint32_t));
+            }
+        }
+    }
+
+    void LightClusters::binSlices(uint32_t firstSlice, uint32_t lastSlice)
+    {
+        for (uint32_t z = firstSlice; z < lastSlice; z++)
+        {
+            for (uint32_t cluster = getClusterIndex(0, 0, z); cluster < getClusterIndex(0, 0, z + 1); cluster++)
+            {
+                mClusterLights[cluster].clear();
+            }
+
+            for (uint32_t lightIndex : mSliceLights[z])
+            {
+                const glm::vec4& sphere = mLightBounds[lightIndex];
+                const glm::uvec4& tiles = mLightTiles[lightIndex];
+                for (uint32_t y = tiles.y; y <= tiles.w; y++)
+                {
+                    for (uint32_t x = tiles.x; x <= tiles.z; x++)
+                    {
+                        const uint32_t cluster = getClusterIndex(x, y, z);
+                        if (sphereIntersectsBox(sphere, mClusterMin[cluster], mClusterMax[cluster]))
+                        {
+                            mClusterLights[cluster].push_back(lightIndex);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusters::update(const Scene* pScene, const Camera* pCamera, ThreadPool* pPool)
+    {
+        // Area lights fetch their mesh instance's transform when preparing the GPU data
+        for (const auto& pLight : pScene->getLights())
+        {
+            AreaLight* pAreaLight = dynamic_cast<AreaLight*>(pLight.get());
+            if (pAreaLight && pAreaLight->getMeshData())
+            {
+                pAreaLight->prepareGPUData();
+            }
+        }
+
+        build(pScene->getLights(), pCamera, pPool);
+
+        // Upload the lights
+        const size_t lightDataSize = Light::getShaderStructSize();
+        mLightData.resize(glm::max<size_t>(mLights.size(), 1) * lightDataSize);
+        for (size_t i = 0; i < mLights.size(); i++)
+        {
+            memcpy(&mLightData[i * lightDataSize], &mLights[i]->getData(), lightDataSize);
+        }
+        if (mpLightBuffer == nullptr || mpLightBuffer->getSize() < mLightData.size())
+        {
+            mpLightBuffer = Buffer::create(mLightData.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mLightData.data());
+        }
+        else
+        {
+            mpLightBuffer->updateData(mLightData.data(), 0, mLightData.size());
+        }
+
+        // Upload the ranges followed by the indices
+        const size_t rangesSize = mRanges.size() * sizeof(Range);
+        const size_t indicesSize = mLightIndices.size() * sizeof(uint32_t);
+        if (mpClusterBuffer == nullptr || mpClusterBuffer->getSize() < rangesSize + indicesSize)
+        {
+            // Leave room for the lists to grow, so the buffer isn't recreated every time a light moves
+            mpClusterBuffer = Buffer::create(rangesSize + indicesSize * 2 + sizeof(uint32_t), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr);
+        }
+        mpClusterBuffer->updateData(mRanges.data(), 0, rangesSize);
+        if (indicesSize)
+        {
+            mpClusterBuffer->updateData(mLightIndices.data(), rangesSize, indicesSize);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "API/Buffer.h"
+#include "Graphics/Light.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+    class ThreadPool;
+
+    /** Clustered light assignment.
+        The camera frustum is split into a grid of clusters - screen-space tiles along x and y, and exponentially distributed slices along the view depth. Each point and area light is bound by the sphere outside of which its radiance drops below the intensity cutoff, and is added to the light list of every cluster the sphere touches.
+        Directional lights affect every cluster, so they are not binned. They are stored first in the light buffer and shaders evaluate them unconditionally.
+        The binning runs on the CPU and doesn't need a device, build() can be used headlessly. update() builds the lists and uploads them. See getLightClusterIndex() in ShaderCommon.h for the shader side.
+    */
+    class LightClusters
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightClusters>;
+        using SharedConstPtr = std::shared_ptr<const LightClusters>;
+
+        /** A cluster's range in getLightIndices()
+        */
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        /** Create a new object
+            \param[in] tilesX Number of clusters along the screen's x axis
+            \param[in] tilesY Number of clusters along the screen's y axis
+            \param[in] slices Number of clusters along the view depth
+        */
+        static SharedPtr create(uint32_t tilesX = 16, uint32_t tilesY = 8, uint32_t slices = 24);
+
+        /** Set the radiance below which a light is considered to have no effect. Smaller values make the lights' bounding spheres larger
+        */
+        void setIntensityCutoff(float cutoff) { mIntensityCutoff = cutoff; }
+        float getIntensityCutoff() const { return mIntensityCutoff; }
+
+        /** Build the cluster light lists. CPU only
+            \param[in] lights The lights to bin
+            \param[in] pCamera The camera whose frustum the clusters are built against
+            \param[in] pPool Optional thread pool to bin the slices with
+        */
+        void build(const std::vector<Light::SharedPtr>& lights, const Camera* pCamera, ThreadPool* pPool = nullptr);
+
+        /** Build the cluster light lists for the scene's lights and upload the light and cluster buffers
+        */
+        void update(const Scene* pScene, const Camera* pCamera, ThreadPool* pPool = nullptr);
+
+        /** Get the grid description, which is set into the per-frame constant buffer
+        */
+        const LightClusterData& getData() const { return mData; }
+
+        uint32_t getClusterCount() const { return mData.tilesX * mData.tilesY * mData.slices; }
+        uint32_t getClusterIndex(uint32_t x, uint32_t y, uint32_t slice) const { return x + mData.tilesX * (y + mData.tilesY * slice); }
+
+        /** Get the range of a cluster's lights in getLightIndices()
+        */
+        const Range& getClusterRange(uint32_t cluster) const { return mRanges[cluster]; }
+
+        /** Get the light indices of all the clusters. The indices refer to getLights()
+        */
+        const std::vector<uint32_t>& getLightIndices() const { return mLightIndices; }
+
+        /** Get the lights in the order they are stored in the light buffer. The first getData().globalLightCount lights affect all the clusters
+        */
+        const std::vector<const Light*>& getLights() const { return mLights; }
+
+        /** Get the view-space bounding sphere of a light, xyz is the center and w the radius. Only valid for binned lights
+        */
+        const glm::vec4& getLightBounds(uint32_t lightIndex) const { return mLightBounds[lightIndex]; }
+
+        /** Get the view-space bounds of a cluster
+        */
+        void getClusterBounds(uint32_t cluster, glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+        /** Get the GPU buffer holding the lights' LightData, without the material. Indexed the same as getLights()
+        */
+        const Buffer::SharedPtr& getLightBuffer() const { return mpLightBuffer; }
+
+        /** Get the GPU buffer holding a Range per cluster, followed by the light indices
+        */
+        const Buffer::SharedPtr& getClusterBuffer() const { return mpClusterBuffer; }
+
+    private:
+        LightClusters(uint32_t tilesX, uint32_t tilesY, uint32_t slices);
+
+        void updateClusterBounds(const glm::mat4& projMat, float nearZ, float farZ);
+        void boundLight(uint32_t lightIndex, const glm::mat4& viewMat, const glm::mat4& projMat, float nearZ, float farZ);
+        void binSlices(uint32_t firstSlice, uint32_t lastSlice);
+
+        LightClusterData mData;
+        float mIntensityCutoff = 0.01f;
+
+        // Cached per projection matrix
+        glm::mat4 mProjMat = glm::mat4(0);
+        float mFarZ = 0;
+        std::vector<glm::vec3> mClusterMin;
+        std::vector<glm::vec3> mClusterMax;
+
+        std::vector<const Light*> mLights;
+        std::vector<glm::vec4> mLightBounds;
+        std::vector<glm::uvec4> mLightTiles;    // Tile range of each binned light, min x, min y, max x, max y
+        std::vector<glm::uvec2> mLightSlices;   // Slice range of each binned light. Empty if the light isn't visible
+        std::vector<std::vector<uint32_t>> mSliceLights;
+        std::vector<std::vector<uint32_t>> mClusterLights;
+        std::vector<Range> mRanges;
+        std::vector<uint32_t> mLightIndices;
+
+        std::vector<uint8_t> mLightData;
+        Buffer::SharedPtr mpLightBuffer;
+        Buffer::SharedPtr mpClusterBuffer;
+    };
+}
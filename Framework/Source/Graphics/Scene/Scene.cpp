@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "Utils/ThreadPool.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -121,6 +122,7 @@ namespace Falcor
 
     bool Scene::update(double currentTime, CameraController* cameraController)
     {
+        mAnimationTime = currentTime;
         bool changed = false;
         for (auto& path : mpPaths)
         {
@@ -131,6 +133,7 @@ namespace Falcor
         }
 
         mExtentsDirty = mExtentsDirty || changed;
+        updateTransforms();
 
         // Ignore the elapsed time we got from the user. This will allow camera movement in cases where the time is frozen
         if(cameraController)
@@ -145,6 +148,11 @@ namespace Falcor
 
     void Scene::deleteModel(uint32_t modelID)
     {
+        for (const auto& pInstance : mModels[modelID])
+        {
+            mInstanceAnimations.erase(pInstance.get());
+        }
+
         if (mpMaterialHistory != nullptr)
         {
             mpMaterialHistory->onModelRemoved(getModel(modelID).get());
@@ -154,12 +162,15 @@ namespace Falcor
         mModels.erase(mModels.begin() + modelID);
 
         mExtentsDirty = true;
+        mBvhDirty = true;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
+        mInstanceAnimations.clear();
         mExtentsDirty = true;
+        mBvhDirty = true;
     }
 
     uint32_t Scene::getModelInstanceCount(uint32_t modelID) const
@@ -176,6 +187,8 @@ namespace Falcor
 
     void Scene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
+        mBvhDirty = true;
+
         // Checking for existing instance list for model
         for (uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
         {
@@ -198,8 +211,10 @@ namespace Falcor
         // Delete instance
         auto& instances = mModels[modelID];
 
+        mInstanceAnimations.erase(instances[instanceID].get());
         instances.erase(instances.begin() + instanceID);
         mExtentsDirty = true;
+        mBvhDirty = true;
 
         // If no instances are left, delete the vector
         if (instances.empty())
@@ -208,6 +223,40 @@ namespace Falcor
         }
     }
 
+    void Scene::setModelInstanceAnimation(uint32_t modelID, uint32_t instanceID, const AnimationController::InstanceState& state)
+    {
+        const ModelInstance* pInstance = getModelInstance(modelID, instanceID).get();
+        const AnimationController* pController = pInstance->getObject()->getAnimationController();
+        if (pController == nullptr)
+        {
+            logError("Scene::setModelInstanceAnimation() - the model doesn't have an animation controller");
+            return;
+        }
+        if ((state.animationID != AnimationController::kBindPoseAnimationId && state.animationID >= pController->getAnimationCount()) ||
+            (state.blendAnimationID != AnimationController::kBindPoseAnimationId && state.blendAnimationID >= pController->getAnimationCount()))
+        {
+            logError("Scene::setModelInstanceAnimation() - invalid animation ID");
+            return;
+        }
+
+        mInstanceAnimations[pInstance] = state;
+        mAnimationStateVersion++;
+    }
+
+    void Scene::clearModelInstanceAnimation(uint32_t modelID, uint32_t instanceID)
+    {
+        if (mInstanceAnimations.erase(getModelInstance(modelID, instanceID).get()))
+        {
+            mAnimationStateVersion++;
+        }
+    }
+
+    const AnimationController::InstanceState* Scene::getModelInstanceAnimation(const ModelInstance* pInstance) const
+    {
+        const auto& it = mInstanceAnimations.find(pInstance);
+        return (it == mInstanceAnimations.end()) ? nullptr : &it->second;
+    }
+
     const Scene::UserVariable& Scene::getUserVariable(const std::string& name)
     {
         const auto& a = mUserVars.find(name);
@@ -310,7 +359,10 @@ namespace Falcor
         merge(mCameras);
 #undef merge
         mUserVars.insert(pFrom->mUserVars.begin(), pFrom->mUserVars.end());
+        mInstanceAnimations.insert(pFrom->mInstanceAnimations.begin(), pFrom->mInstanceAnimations.end());
+        mAnimationStateVersion++;
         mExtentsDirty = true;
+        mBvhDirty = true;
     }
 
     void Scene::createAreaLights()
@@ -352,6 +404,124 @@ namespace Falcor
         }
     }
 
+    void Scene::updateBVH(ThreadPool* pPool)
+    {
+        if (mpBVH == nullptr)
+        {
+            mpBVH = SceneBVH::create();
+        }
+
+        // Mesh and mesh instance IDs are baked into the leaves, so changing a model's mesh list requires a rebuild
+        if (mBvhDirty || mpBVH->isStructureValid() == false)
+        {
+            mpBVH->build(this);
+            mBvhDirty = false;
+        }
+        else
+        {
+            mpBVH->refit(pPool);
+        }
+    }
+
+    const SceneBVH* Scene::getBVH()
+    {
+        updateBVH(nullptr);
+        return mpBVH.get();
+    }
+
+    const SceneTransformBuffer* Scene::getTransformBuffer()
+    {
+        if (mpTransformBuffer == nullptr)
+        {
+            mpTransformBuffer = SceneTransformBuffer::create();
+        }
+
+        mpTransformBuffer->update(this, getBVH());
+        return mpTransformBuffer.get();
+    }
+
+    void Scene::animateModels(double currentTime, ThreadPool* pPool)
+    {
+        std::vector<Model*> models;
+        models.reserve(getModelCount());
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            if (getModel(modelID)->hasBones())
+            {
+                models.push_back(getModel(modelID).get());
+            }
+        }
+        Model::animate(models.data(), (uint32_t)models.size(), currentTime, pPool);
+
+        mAnimationTime = currentTime;
+        if (mpBonePalette == nullptr)
+        {
+            mpBonePalette = SceneBonePalette::create();
+        }
+        mpBonePalette->update(this, mAnimationTime, pPool);
+    }
+
+    const SceneBonePalette* Scene::getBonePalette()
+    {
+        if (mpBonePalette == nullptr)
+        {
+            mpBonePalette = SceneBonePalette::create();
+        }
+
+        mpBonePalette->update(this, mAnimationTime);
+        return mpBonePalette.get();
+    }
+
+    void Scene::updateTransforms(ThreadPool* pPool)
+    {
+        if (pPool == nullptr)
+        {
+            pPool = ThreadPool::getDefault();
+        }
+
+        // Mesh instances are shared by all the instances of a model, so update them first, one model per task
+        pPool->parallelFor(getModelCount(), 1, [this](uint32_t first, uint32_t last)
+        {
+            for (uint32_t modelID = first; modelID < last; modelID++)
+            {
+                const Model* pModel = getModel(modelID).get();
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        // Querying the version triggers the lazy transform update
+                        pModel->getMeshInstance(meshID, meshInstanceID)->getTransformVersion();
+                    }
+                }
+            }
+        });
+
+        mInstanceList.clear();
+        for (const auto& instances : mModels)
+        {
+            for (const auto& pInstance : instances)
+            {
+                mInstanceList.push_back(pInstance.get());
+            }
+        }
+
+        pPool->parallelFor((uint32_t)mInstanceList.size(), 1024, [this](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                mInstanceList[i]->getTransformVersion();
+            }
+        });
+
+        // Propagate the new transforms. The instances are up to date, so the leaves and matrices can be computed in parallel.
+        updateBVH(pPool);
+        if (mpTransformBuffer == nullptr)
+        {
+            mpTransformBuffer = SceneTransformBuffer::create();
+        }
+        mpTransformBuffer->update(this, mpBVH.get(), pPool);
+    }
+
     void Scene::bindSamplerToMaterials(Sampler::SharedPtr pSampler)
     {
         for (auto& pMat : mpMaterials)
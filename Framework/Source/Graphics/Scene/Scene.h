@@ -37,9 +37,15 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Material/MaterialHistory.h"
+#include "Graphics/Scene/SceneBVH.h"
+#include "Graphics/Scene/SceneTransformBuffer.h"
+#include "Graphics/Scene/SceneBonePalette.h"
+#include <unordered_map>
 
 namespace Falcor
 {
+    class ThreadPool;
+
     class Scene : public std::enable_shared_from_this<Scene>
     {
     public:
@@ -99,7 +105,8 @@ namespace Falcor
         {
 			None                =   0x0,
 			GenerateAreaLights  =   0x1,    ///< Create area light(s) for meshes that have emissive material
-            StoreMaterialHistory =  0x2     ///< Store history of overridden mesh materials
+            StoreMaterialHistory =  0x2,    ///< Store history of overridden mesh materials
+            SerialModelLoading  =   0x4     ///< Load the models one after the other on the calling thread, instead of concurrently
         };
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags = Model::LoadFlags::None, Scene::LoadFlags sceneLoadFlags = LoadFlags::None);
@@ -121,6 +128,22 @@ namespace Falcor
         const ModelInstance::SharedPtr& getModelInstance(uint32_t modelID, uint32_t instanceID) const { return mModels[modelID][instanceID]; };
         void deleteModelInstance(uint32_t modelID, uint32_t instanceID);
 
+        /** Give a skinned model instance its own animation state, so it animates independently of the other instances. Instances without a state follow their model's animation controller.
+        */
+        void setModelInstanceAnimation(uint32_t modelID, uint32_t instanceID, const AnimationController::InstanceState& state);
+
+        /** Make a model instance follow its model's animation controller again
+        */
+        void clearModelInstanceAnimation(uint32_t modelID, uint32_t instanceID);
+
+        /** Get the animation state of a model instance. Returns nullptr if the instance follows its model's animation controller.
+        */
+        const AnimationController::InstanceState* getModelInstanceAnimation(const ModelInstance* pInstance) const;
+
+        /** Get a counter which is incremented every time an instance's animation state changes
+        */
+        uint32_t getAnimationStateVersion() const { return mAnimationStateVersion; }
+
         // Light sources
         uint32_t addLight(const Light::SharedPtr& pLight);
         void deleteLight(uint32_t lightID);
@@ -199,6 +222,30 @@ namespace Falcor
         */
         void deleteAreaLights();
 
+        /** Get the bounding volume hierarchy of the scene's mesh instances. The hierarchy is rebuilt if models or instances were added/removed since the last call, and refitted if instances moved.
+        */
+        const SceneBVH* getBVH();
+
+        /** Get the buffer of mesh instance matrices, indexed by BVH leaf ID. Updates the BVH and uploads the matrices of instances which moved since the last call.
+        */
+        const SceneTransformBuffer* getTransformBuffer();
+
+        /** Recalculate the transforms of all the model and mesh instances which moved, then update the BVH and the transform buffer.
+            The work is split across the threads of the pool. Called by update(), after animating the paths. Once it returns, rendering only reads the instances' transforms.
+            \param[in] pPool The thread pool to use. If nullptr, the default pool is used.
+        */
+        void updateTransforms(ThreadPool* pPool = nullptr);
+
+        /** Play the active animation of all the skinned models in the scene. The models are animated in parallel.
+            \param[in] currentTime The current global time
+            \param[in] pPool The thread pool to use. If nullptr, the default pool is used.
+        */
+        void animateModels(double currentTime, ThreadPool* pPool = nullptr);
+
+        /** Get the bone matrices of all the skinned model instances. The instances which changed since the last call are re-evaluated at the time last passed to update() or animateModels().
+        */
+        const SceneBonePalette* getBonePalette();
+
         /** Bind a sampler to all the scene's global materials
         */
         void bindSamplerToMaterials(Sampler::SharedPtr pSampler);
@@ -213,6 +260,7 @@ namespace Falcor
             Update changed scene extents (radius and center).
         */
         void updateExtents();
+        void updateBVH(ThreadPool* pPool);
         
         static uint32_t sSceneCounter;
 
@@ -237,6 +285,16 @@ namespace Falcor
 
         bool mExtentsDirty = true;
 
+        SceneBVH::SharedPtr mpBVH;
+        bool mBvhDirty = true;
+        SceneTransformBuffer::SharedPtr mpTransformBuffer;
+        std::vector<const ModelInstance*> mInstanceList; // Scratch list for updateTransforms()
+
+        std::unordered_map<const ModelInstance*, AnimationController::InstanceState> mInstanceAnimations;
+        uint32_t mAnimationStateVersion = 0;
+        double mAnimationTime = 0;
+        SceneBonePalette::SharedPtr mpBonePalette;
+
         using string_uservar_map = std::map<const std::string, UserVariable>;
         string_uservar_map mUserVars;
         static const UserVariable kInvalidVar;
@@ -0,0 +1,325 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBVH.h"
+#include "Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    SceneBVH::SharedPtr SceneBVH::create()
+    {
+        return SharedPtr(new SceneBVH());
+    }
+
+    void SceneBVH::build(const Scene* pScene)
+    {
+        mNodes.clear();
+        mLeaves.clear();
+        mLeafMeshVersions.clear();
+        mLeafOrder.clear();
+        mOrderedLeafBoxes.clear();
+        mInstances.clear();
+        mBuildCount++;
+
+        // Collect the leaves in scene order
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                InstanceRecord record;
+                record.pInstance = pScene->getModelInstance(modelID, instanceID).get();
+                record.transformVersion = record.pInstance->getTransformVersion();
+                record.meshListVersion = pModel->getMeshListVersion();
+                record.firstLeaf = (uint32_t)mLeaves.size();
+
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        Leaf leaf;
+                        leaf.modelID = modelID;
+                        leaf.modelInstanceID = instanceID;
+                        leaf.meshID = meshID;
+                        leaf.meshInstanceID = meshInstanceID;
+                        mLeaves.push_back(leaf);
+                    }
+                }
+
+                record.leafCount = (uint32_t)mLeaves.size() - record.firstLeaf;
+                mLeafMeshVersions.resize(mLeaves.size());
+                updateMeshVersions(record);
+                updateInstanceLeaves(record);
+                mInstances.push_back(record);
+            }
+        }
+
+        mLeafOrder.resize(mLeaves.size());
+        for (uint32_t i = 0; i < (uint32_t)mLeafOrder.size(); i++)
+        {
+            mLeafOrder[i] = i;
+        }
+
+        if (mLeaves.empty() == false)
+        {
+            mNodes.reserve(2 * (mLeaves.size() / kMaxLeavesPerNode + 1));
+            buildRecursive(0, (uint32_t)mLeaves.size());
+            mBounds = mNodes[0].box;
+            updateOrderedLeafBoxes();
+        }
+        else
+        {
+            mBounds = BoundingBox();
+        }
+    }
+
+    uint32_t SceneBVH::buildRecursive(uint32_t first, uint32_t count)
+    {
+        const uint32_t nodeID = (uint32_t)mNodes.size();
+        mNodes.emplace_back();
+
+        glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+        glm::vec3 centerMin(FLT_MAX), centerMax(-FLT_MAX);
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            const BoundingBox& box = mLeaves[mLeafOrder[i]].box;
+            boxMin = glm::min(boxMin, box.getMinPos());
+            boxMax = glm::max(boxMax, box.getMaxPos());
+            centerMin = glm::min(centerMin, box.center);
+            centerMax = glm::max(centerMax, box.center);
+        }
+        mNodes[nodeID].box = BoundingBox::fromMinMax(boxMin, boxMax);
+
+        if (count <= kMaxLeavesPerNode)
+        {
+            mNodes[nodeID].first = first;
+            mNodes[nodeID].count = count;
+            return nodeID;
+        }
+
+        // Median split along the axis with the largest spread of leaf centers
+        const glm::vec3 spread = centerMax - centerMin;
+        const uint32_t axis = (spread.x > spread.y) ? ((spread.x > spread.z) ? 0 : 2) : ((spread.y > spread.z) ? 1 : 2);
+        const uint32_t mid = first + count / 2;
+        std::nth_element(mLeafOrder.begin() + first, mLeafOrder.begin() + mid, mLeafOrder.begin() + first + count,
+            [this, axis](uint32_t a, uint32_t b) { return mLeaves[a].box.center[axis] < mLeaves[b].box.center[axis]; });
+
+        buildRecursive(first, mid - first);
+        const uint32_t rightChild = buildRecursive(mid, first + count - mid);
+
+        mNodes[nodeID].first = rightChild;
+        mNodes[nodeID].count = 0;
+        return nodeID;
+    }
+
+    void SceneBVH::updateInstanceLeaves(const InstanceRecord& record)
+    {
+        const glm::mat4& instanceMat = record.pInstance->getTransformMatrix();
+        const Model* pModel = record.pInstance->getObject().get();
+
+        for (uint32_t leafID = record.firstLeaf; leafID < record.firstLeaf + record.leafCount; leafID++)
+        {
+            Leaf& leaf = mLeaves[leafID];
+            const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(leaf.meshID, leaf.meshInstanceID).get();
+            leaf.box = pMeshInstance->getBoundingBox().transform(instanceMat);
+        }
+    }
+
+    bool SceneBVH::updateMeshVersions(const InstanceRecord& record)
+    {
+        // Mesh instances can be moved on their own (area lights, the scene editor), independently of the model instance
+        const Model* pModel = record.pInstance->getObject().get();
+        bool changed = false;
+        for (uint32_t leafID = record.firstLeaf; leafID < record.firstLeaf + record.leafCount; leafID++)
+        {
+            const Leaf& leaf = mLeaves[leafID];
+            const uint32_t version = pModel->getMeshInstance(leaf.meshID, leaf.meshInstanceID)->getTransformVersion();
+            if (version != mLeafMeshVersions[leafID])
+            {
+                mLeafMeshVersions[leafID] = version;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    bool SceneBVH::isStructureValid() const
+    {
+        for (const auto& record : mInstances)
+        {
+            if (record.pInstance->getObject()->getMeshListVersion() != record.meshListVersion)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SceneBVH::updateOrderedLeafBoxes()
+    {
+        mOrderedLeafBoxes.resize((uint32_t)mLeafOrder.size());
+        for (uint32_t i = 0; i < (uint32_t)mLeafOrder.size(); i++)
+        {
+            mOrderedLeafBoxes.set(i, mLeaves[mLeafOrder[i]].box);
+        }
+    }
+
+    void SceneBVH::refitNode(uint32_t nodeID)
+    {
+        Node& node = mNodes[nodeID];
+        if (node.count == 0)
+        {
+            node.box = BoundingBox::fromUnion(mNodes[nodeID + 1].box, mNodes[node.first].box);
+        }
+        else
+        {
+            glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                const BoundingBox& box = mLeaves[mLeafOrder[i]].box;
+                boxMin = glm::min(boxMin, box.getMinPos());
+                boxMax = glm::max(boxMax, box.getMaxPos());
+            }
+            node.box = BoundingBox::fromMinMax(boxMin, boxMax);
+        }
+    }
+
+    bool SceneBVH::refit(ThreadPool* pPool)
+    {
+        // Instances own disjoint leaf ranges, so they can be updated in parallel
+        std::atomic<bool> dirty(false);
+        auto refitInstances = [this, &dirty](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                // Querying the version also triggers the lazy transform update of the instance
+                InstanceRecord& record = mInstances[i];
+                const uint32_t version = record.pInstance->getTransformVersion();
+                const bool meshesMoved = updateMeshVersions(record);
+                if (version != record.transformVersion || meshesMoved)
+                {
+                    record.transformVersion = version;
+                    updateInstanceLeaves(record);
+                    dirty = true;
+                }
+            }
+        };
+
+        if (pPool)
+        {
+            pPool->parallelFor((uint32_t)mInstances.size(), 256, refitInstances);
+        }
+        else
+        {
+            refitInstances(0, (uint32_t)mInstances.size());
+        }
+
+        if (dirty)
+        {
+            // Children always come after their parent, so walking backwards refits bottom-up
+            for (size_t nodeID = mNodes.size(); nodeID-- > 0;)
+            {
+                refitNode((uint32_t)nodeID);
+            }
+            mBounds = mNodes[0].box;
+            updateOrderedLeafBoxes();
+        }
+        return dirty;
+    }
+
+    void SceneBVH::cull(const Camera* pCamera, std::vector<uint32_t>& visibleLeaves) const
+    {
+        visibleLeaves.clear();
+        if (mNodes.empty())
+        {
+            return;
+        }
+
+        // Leaf nodes are reached in increasing mLeafOrder order, so the leaves of consecutive visible nodes form contiguous runs in mOrderedLeafBoxes.
+        // Each run is tested with a single cullBoxes() call, which keeps its 8-wide path busy instead of testing at most kMaxLeavesPerNode boxes at a time.
+        std::vector<uint8_t> visible;
+        uint32_t runFirst = 0;
+        uint32_t runCount = 0;
+        auto cullRun = [&]()
+        {
+            visible.resize(runCount);
+            pCamera->cullBoxes(mOrderedLeafBoxes, runFirst, runCount, visible.data());
+            for (uint32_t i = 0; i < runCount; i++)
+            {
+                if (visible[i])
+                {
+                    visibleLeaves.push_back(mLeafOrder[runFirst + i]);
+                }
+            }
+        };
+
+        // Median splits keep the tree balanced, so the depth is bounded by log2 of the leaf count
+        uint32_t stack[64];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const uint32_t nodeID = stack[--stackSize];
+            const Node& node = mNodes[nodeID];
+
+            if (pCamera->isObjectCulled(node.box))
+            {
+                continue;
+            }
+
+            if (node.count == 0)
+            {
+                stack[stackSize++] = node.first;
+                stack[stackSize++] = nodeID + 1;
+            }
+            else if (runCount > 0 && runFirst + runCount == node.first)
+            {
+                runCount += node.count;
+            }
+            else
+            {
+                if (runCount > 0)
+                {
+                    cullRun();
+                }
+                runFirst = node.first;
+                runCount = node.count;
+            }
+        }
+
+        if (runCount > 0)
+        {
+            cullRun();
+        }
+
+        std::sort(visibleLeaves.begin(), visibleLeaves.end());
+    }
+}
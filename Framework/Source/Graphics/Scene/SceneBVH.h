@@ -0,0 +1,137 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "Utils/AABB.h"
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+    class ThreadPool;
+
+    /** Bounding volume hierarchy over the world-space boxes of all the mesh instances in a scene.
+        The hierarchy is built once when the scene's structure changes, and refitted when model instances are moved.
+        Mesh instance transforms are considered static relative to their model.
+    */
+    class SceneBVH
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBVH>;
+        using SharedConstPtr = std::shared_ptr<const SceneBVH>;
+
+        /** A single mesh instance in the hierarchy. Leaves are stored in scene order (model, model instance, mesh, mesh instance), so sorting leaf IDs groups them the way SceneRenderer draws them.
+        */
+        struct Leaf
+        {
+            BoundingBox box;            ///< World-space bounding box
+            uint32_t modelID;
+            uint32_t modelInstanceID;
+            uint32_t meshID;
+            uint32_t meshInstanceID;
+        };
+
+        static SharedPtr create();
+
+        /** Rebuild the hierarchy from scratch
+        */
+        void build(const Scene* pScene);
+
+        /** Check if the hierarchy still matches the scene's meshes. Returns false if the mesh list of any of the models changed since the last build, in which case the hierarchy must be rebuilt before it's refitted.
+        */
+        bool isStructureValid() const;
+
+        /** Update the boxes of model and mesh instances whose transform changed since the last build/refit. The tree topology is preserved.
+            \param[in] pPool Optional thread pool to update the leaves with. The model and mesh instance transforms must already be up to date when using a pool, see Scene::updateTransforms().
+            \return true if any of the boxes changed
+        */
+        bool refit(ThreadPool* pPool = nullptr);
+
+        /** Get the IDs of the leaves which are not culled by the camera's frustum. The result is sorted by leaf ID.
+        */
+        void cull(const Camera* pCamera, std::vector<uint32_t>& visibleLeaves) const;
+
+        /** Get the number of leaves (mesh instances) in the hierarchy
+        */
+        uint32_t getLeafCount() const { return (uint32_t)mLeaves.size(); }
+
+        /** Get a leaf
+        */
+        const Leaf& getLeaf(uint32_t leafID) const { return mLeaves[leafID]; }
+
+        /** Get the world-space bounds of the entire scene
+        */
+        const BoundingBox& getBounds() const { return mBounds; }
+
+        /** Get the number of nodes in the hierarchy
+        */
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+
+        /** Get the number of times the hierarchy was rebuilt. Leaf IDs are only stable between builds.
+        */
+        uint32_t getBuildCount() const { return mBuildCount; }
+
+    private:
+        SceneBVH() = default;
+
+        static const uint32_t kMaxLeavesPerNode = 4;
+
+        // Nodes are stored in depth-first order. The left child of an internal node immediately follows it, so children always have a larger index than their parent.
+        struct Node
+        {
+            BoundingBox box;
+            uint32_t first;     ///< Internal node: index of the right child. Leaf node: offset into mLeafOrder.
+            uint32_t count;     ///< Number of leaves. 0 for internal nodes.
+        };
+
+        struct InstanceRecord
+        {
+            const ObjectInstance<Model>* pInstance;
+            uint32_t transformVersion;
+            uint32_t meshListVersion;
+            uint32_t firstLeaf;
+            uint32_t leafCount;
+        };
+
+        uint32_t buildRecursive(uint32_t first, uint32_t count);
+        void updateInstanceLeaves(const InstanceRecord& record);
+        bool updateMeshVersions(const InstanceRecord& record);
+        void refitNode(uint32_t nodeID);
+        void updateOrderedLeafBoxes();
+
+        std::vector<Node> mNodes;
+        std::vector<Leaf> mLeaves;
+        std::vector<uint32_t> mLeafMeshVersions;    ///< The transform version of each leaf's mesh instance when its box was last computed
+        std::vector<uint32_t> mLeafOrder;
+        BoundingBoxSoA mOrderedLeafBoxes;   ///< Leaf boxes in mLeafOrder order, for batched culling of leaf nodes
+        std::vector<InstanceRecord> mInstances;
+        BoundingBox mBounds = {};
+        uint32_t mBuildCount = 0;
+    };
+}
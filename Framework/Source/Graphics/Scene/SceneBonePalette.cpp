@@ -0,0 +1,199 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBonePalette.h"
+#include "Scene.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    // The inverse transpose of the upper 3x3 part, in the same row layout
+    static AffineTransform calcNormalTransform(const AffineTransform& transform)
+    {
+        const glm::mat3 m = glm::transpose(glm::mat3(glm::vec3(transform.rows[0]), glm::vec3(transform.rows[1]), glm::vec3(transform.rows[2])));
+        const glm::mat3 n = transpose(inverse(m));
+        AffineTransform normalTransform;
+        for (uint32_t r = 0; r < 3; r++)
+        {
+            normalTransform.rows[r] = glm::vec4(n[0][r], n[1][r], n[2][r], 0);
+        }
+        return normalTransform;
+    }
+
+    SceneBonePalette::SharedPtr SceneBonePalette::create()
+    {
+        return SharedPtr(new SceneBonePalette());
+    }
+
+    uint32_t SceneBonePalette::getPaletteOffset(const ObjectInstance<Model>* pInstance) const
+    {
+        const auto& it = mPaletteOffsets.find(pInstance);
+        return (it == mPaletteOffsets.end()) ? kInvalidOffset : it->second;
+    }
+
+    bool SceneBonePalette::rebuild(const Scene* pScene)
+    {
+        // Walk the skinned instances in scene order. If they didn't change, keep the records and their key cursors
+        uint32_t index = 0;
+        uint32_t boneCount = 0;
+        bool changed = false;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            if (pModel->hasBones() == false)
+            {
+                continue;
+            }
+
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const ObjectInstance<Model>* pInstance = pScene->getModelInstance(modelID, instanceID).get();
+                if (index < mInstances.size() && mInstances[index].pInstance == pInstance && mInstances[index].pController == pModel->getAnimationController())
+                {
+                    index++;
+                    boneCount += pModel->getBonesCount();
+                    continue;
+                }
+
+                changed = true;
+                mInstances.resize(index);
+                InstanceRecord record;
+                record.pInstance = pInstance;
+                record.pController = pModel->getAnimationController();
+                record.firstBone = boneCount;
+                mInstances.push_back(record);
+                index++;
+                boneCount += pModel->getBonesCount();
+            }
+        }
+
+        if (changed == false && index == mInstances.size())
+        {
+            return false;
+        }
+
+        mInstances.resize(index);
+        mPaletteOffsets.clear();
+        for (const auto& record : mInstances)
+        {
+            mPaletteOffsets[record.pInstance] = record.firstBone;
+        }
+        mTransforms.resize(boneCount);
+        mNormalTransforms.resize(boneCount);
+        mDirtyInstances.assign(mInstances.size(), 1);
+        mpBuffer = nullptr;
+        mpNormalBuffer = nullptr;
+        return true;
+    }
+
+    void SceneBonePalette::update(const Scene* pScene, double currentTime, ThreadPool* pPool)
+    {
+        if (pPool == nullptr)
+        {
+            pPool = ThreadPool::getDefault();
+        }
+
+        const bool rebuilt = rebuild(pScene);
+        const uint32_t stateVersion = pScene->getAnimationStateVersion();
+
+        // Instances own disjoint bone ranges, so they can be evaluated in parallel
+        pPool->parallelFor((uint32_t)mInstances.size(), 4, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                InstanceRecord& record = mInstances[i];
+                const AnimationController::InstanceState* pState = pScene->getModelInstanceAnimation(record.pInstance);
+                const uint32_t transformVersion = record.pInstance->getTransformVersion();
+
+                // Instances with their own state depend on the time, the others on the controller's pose
+                bool dirty = rebuilt || transformVersion != record.transformVersion || stateVersion != record.stateVersion;
+                dirty = dirty || (pState ? (currentTime != record.time) : (record.pController->getVersion() != record.controllerVersion));
+                mDirtyInstances[i] = dirty ? 1 : 0;
+                if (dirty == false)
+                {
+                    continue;
+                }
+
+                record.transformVersion = transformVersion;
+                record.stateVersion = stateVersion;
+                record.controllerVersion = record.pController->getVersion();
+                record.time = currentTime;
+
+                const glm::mat4& instanceMat = record.pInstance->getTransformMatrix();
+                AffineTransform* pTransforms = mTransforms.data() + record.firstBone;
+                if (pState)
+                {
+                    record.keyCursors.resize(record.pController->getKeyCursorCount(*pState), 0);
+                    record.pController->animateInstance(*pState, currentTime, instanceMat, record.keyCursors.data(), pTransforms);
+                }
+                else
+                {
+                    const glm::mat4* pBones = record.pController->getBoneMatrices();
+                    for (uint32_t b = 0; b < record.pController->getBoneCount(); b++)
+                    {
+                        const glm::mat4 m = instanceMat * pBones[b];
+                        for (uint32_t r = 0; r < 3; r++)
+                        {
+                            pTransforms[b].rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+                        }
+                    }
+                }
+
+                AffineTransform* pNormalTransforms = mNormalTransforms.data() + record.firstBone;
+                for (uint32_t b = 0; b < record.pController->getBoneCount(); b++)
+                {
+                    pNormalTransforms[b] = calcNormalTransform(pTransforms[b]);
+                }
+            }
+        });
+
+        mLastUpdateCount = 0;
+        for (uint8_t dirty : mDirtyInstances)
+        {
+            mLastUpdateCount += dirty;
+        }
+
+        if (mTransforms.empty() || mLastUpdateCount == 0)
+        {
+            return;
+        }
+
+        // Animated instances usually change every frame, so upload everything instead of tracking ranges
+        const size_t size = mTransforms.size() * sizeof(AffineTransform);
+        if (mpBuffer == nullptr)
+        {
+            mpBuffer = Buffer::create(size, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mTransforms.data());
+            mpNormalBuffer = Buffer::create(size, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mNormalTransforms.data());
+        }
+        else
+        {
+            mpBuffer->updateData(mTransforms.data(), 0, size);
+            mpNormalBuffer->updateData(mNormalTransforms.data(), 0, size);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "API/Buffer.h"
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    class Scene;
+    class ThreadPool;
+
+    /** GPU buffer holding the bone matrices of all the skinned model instances in a scene.
+        Each skinned model instance owns a contiguous range of getBoneCount() matrices, starting at its palette offset. The instance's world transform is baked into its matrices, so instances of the same model can be drawn with a single instanced draw.
+        Instances with an animation state (see Scene::setModelInstanceAnimation()) are evaluated independently. The others use the current pose of their model's animation controller.
+        Each bone also has a normal matrix, the inverse transpose of its matrix, so skinned instances and their bones can use any affine transform. See getBlendedInvTransposeWorldMat() in ShaderCommon.h.
+    */
+    class SceneBonePalette
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBonePalette>;
+        using SharedConstPtr = std::shared_ptr<const SceneBonePalette>;
+
+        static const uint32_t kInvalidOffset = -1;
+
+        static SharedPtr create();
+
+        /** Evaluate the matrices of the instances which changed since the last call and upload them
+            \param[in] pScene The scene
+            \param[in] currentTime The global time to evaluate instances with an animation state at
+            \param[in] pPool The thread pool to use. If nullptr, the default pool is used.
+        */
+        void update(const Scene* pScene, double currentTime, ThreadPool* pPool = nullptr);
+
+        /** Get the GPU buffer. Each bone is stored as 3 float4 rows, see AffineTransform.
+        */
+        const Buffer::SharedPtr& getBuffer() const { return mpBuffer; }
+
+        /** Get the GPU buffer of the normal matrices. Uses the same layout as getBuffer(), the translation is zero.
+        */
+        const Buffer::SharedPtr& getNormalBuffer() const { return mpNormalBuffer; }
+
+        /** Get the index of a model instance's first bone, or kInvalidOffset if the instance isn't skinned
+        */
+        uint32_t getPaletteOffset(const ObjectInstance<Model>* pInstance) const;
+
+        /** Get the total number of bones
+        */
+        uint32_t getBoneCount() const { return (uint32_t)mTransforms.size(); }
+
+        /** Get the CPU copy of a bone matrix
+        */
+        const AffineTransform& getTransform(uint32_t index) const { return mTransforms[index]; }
+
+        /** Get the CPU copy of a bone's normal matrix
+        */
+        const AffineTransform& getNormalTransform(uint32_t index) const { return mNormalTransforms[index]; }
+
+        /** Get the number of instances evaluated by the last update() call
+        */
+        uint32_t getLastUpdateCount() const { return mLastUpdateCount; }
+
+    private:
+        SceneBonePalette() = default;
+
+        struct InstanceRecord
+        {
+            const ObjectInstance<Model>* pInstance = nullptr;
+            const AnimationController* pController = nullptr;
+            uint32_t firstBone = 0;
+            uint32_t transformVersion = 0;
+            uint32_t controllerVersion = 0;
+            uint32_t stateVersion = 0;
+            double time = 0;
+            std::vector<uint32_t> keyCursors;   // See AnimationController::animateInstance()
+        };
+
+        bool rebuild(const Scene* pScene);
+
+        std::vector<InstanceRecord> mInstances;
+        std::unordered_map<const ObjectInstance<Model>*, uint32_t> mPaletteOffsets;
+        std::vector<AffineTransform> mTransforms;
+        std::vector<AffineTransform> mNormalTransforms;
+        std::vector<uint8_t> mDirtyInstances;
+        Buffer::SharedPtr mpBuffer;
+        Buffer::SharedPtr mpNormalBuffer;
+        uint32_t mLastUpdateCount = 0;
+    };
+}
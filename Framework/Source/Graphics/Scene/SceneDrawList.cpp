@@ -0,0 +1,136 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneDrawList.h"
+#include "Graphics/Camera/Camera.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    SceneDrawList::SharedPtr SceneDrawList::create()
+    {
+        return SharedPtr(new SceneDrawList());
+    }
+
+    uint64_t SceneDrawList::calculateSortKey(const Model* pModel, const Mesh* pMesh, float depth)
+    {
+        // [63]     Skinned models use the _VERTEX_BLENDING program version
+        // [62:40]  Material ID
+        // [39:16]  Mesh ID, selects the VAO
+        // [15:0]   View depth, front to back
+        const uint64_t skinned = pModel->hasBones() ? 1 : 0;
+        const uint64_t materialID = (uint64_t)(uint32_t)pMesh->getMaterial()->getId() & 0x7FFFFF;
+        const uint64_t meshID = (uint64_t)pMesh->getId() & 0xFFFFFF;
+        const uint64_t depthBits = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * 65535.0f);
+
+        return (skinned << 63) | (materialID << 40) | (meshID << 16) | depthBits;
+    }
+
+    void SceneDrawList::build(Scene* pScene, const Camera* pCamera, bool cull, uint32_t maxInstanceCount)
+    {
+        mItems.clear();
+        mDraws.clear();
+        mMaterialChangeCount = 0;
+
+        const SceneBVH* pBVH = pScene->getBVH();
+        if (cull)
+        {
+            pBVH->cull(pCamera, mLeaves);
+        }
+        else
+        {
+            mLeaves.resize(pBVH->getLeafCount());
+            for (uint32_t i = 0; i < (uint32_t)mLeaves.size(); i++)
+            {
+                mLeaves[i] = i;
+            }
+        }
+
+        glm::vec4 depthPlane(0.0f);
+        if (pCamera)
+        {
+            // Normalized view depth: -z / farZ
+            const glm::mat4& view = pCamera->getViewMatrix();
+            depthPlane = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]) / pCamera->getFarPlane();
+        }
+
+        // Collect the items
+        mItems.reserve(mLeaves.size());
+        for (uint32_t leafID : mLeaves)
+        {
+            const SceneBVH::Leaf& leaf = pBVH->getLeaf(leafID);
+            const Scene::ModelInstance* pModelInstance = pScene->getModelInstance(leaf.modelID, leaf.modelInstanceID).get();
+            const Model* pModel = pModelInstance->getObject().get();
+            const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(leaf.meshID, leaf.meshInstanceID).get();
+            if (pModelInstance->isVisible() == false || pMeshInstance->isVisible() == false)
+            {
+                continue;
+            }
+
+            Item item;
+            item.pModelInstance = pModelInstance;
+            item.pMeshInstance = pMeshInstance;
+            item.pMesh = pMeshInstance->getObject().get();
+            item.modelInstanceID = leaf.modelInstanceID;
+            item.transformID = leafID;
+            item.sortKey = calculateSortKey(pModel, item.pMesh, glm::dot(depthPlane, glm::vec4(leaf.box.center, 1.0f)));
+            mItems.push_back(item);
+        }
+
+        std::sort(mItems.begin(), mItems.end(), [](const Item& a, const Item& b) { return a.sortKey < b.sortKey; });
+
+        // Merge consecutive instances of the same mesh into draws. Skinned instances read their bones from the scene's bone palette, so they are merged too.
+        const Material* pLastMaterial = nullptr;
+        for (uint32_t i = 0; i < (uint32_t)mItems.size(); i++)
+        {
+            const Item& item = mItems[i];
+            const Material* pMaterial = item.pMesh->getMaterial().get();
+            if (pMaterial != pLastMaterial)
+            {
+                mMaterialChangeCount++;
+                pLastMaterial = pMaterial;
+            }
+
+            if (mDraws.empty() == false)
+            {
+                Draw& draw = mDraws.back();
+                const Item& first = mItems[draw.firstItem];
+                if (first.pMesh == item.pMesh && draw.itemCount < maxInstanceCount)
+                {
+                    draw.itemCount++;
+                    continue;
+                }
+            }
+
+            Draw draw;
+            draw.firstItem = i;
+            draw.itemCount = 1;
+            mDraws.push_back(draw);
+        }
+    }
+}
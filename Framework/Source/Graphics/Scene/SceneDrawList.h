@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "Graphics/Scene/Scene.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** A sorted list of the mesh instances to render, grouped into instanced draws.
+        The list spans the entire scene, so instances of the same mesh coming from different model instances are merged into a single draw.
+        Items are sorted by a 64-bit key built from the program permutation (skinned/static), material, mesh (VAO) and view depth.
+    */
+    class SceneDrawList
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneDrawList>;
+        using SharedConstPtr = std::shared_ptr<const SceneDrawList>;
+
+        /** A single mesh instance
+        */
+        struct Item
+        {
+            uint64_t sortKey;
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            const Mesh* pMesh;
+            uint32_t modelInstanceID;
+            uint32_t transformID;   ///< The BVH leaf ID, which is also the slot in the scene's transform buffer
+        };
+
+        /** A range of items sharing the same mesh and material, drawn with a single instanced draw call
+        */
+        struct Draw
+        {
+            uint32_t firstItem;
+            uint32_t itemCount;
+        };
+
+        static SharedPtr create();
+
+        /** Build the list
+            \param[in] pScene The scene to collect the instances from
+            \param[in] pCamera The camera used for culling and depth sorting. Can be nullptr if cull is false.
+            \param[in] cull Whether to cull the instances against the camera frustum
+            \param[in] maxInstanceCount The maximal number of instances in a single draw
+        */
+        void build(Scene* pScene, const Camera* pCamera, bool cull, uint32_t maxInstanceCount);
+
+        uint32_t getItemCount() const { return (uint32_t)mItems.size(); }
+        const Item& getItem(uint32_t index) const { return mItems[index]; }
+
+        uint32_t getDrawCount() const { return (uint32_t)mDraws.size(); }
+        const Draw& getDraw(uint32_t index) const { return mDraws[index]; }
+        const std::vector<Draw>& getDraws() const { return mDraws; }
+
+        /** Get the number of times the material changes when walking the list
+        */
+        uint32_t getMaterialChangeCount() const { return mMaterialChangeCount; }
+
+    private:
+        SceneDrawList() = default;
+
+        static uint64_t calculateSortKey(const Model* pModel, const Mesh* pMesh, float depth);
+
+        std::vector<Item> mItems;
+        std::vector<Draw> mDraws;
+        std::vector<uint32_t> mLeaves;
+        uint32_t mMaterialChangeCount = 0;
+    };
+}
@@ -174,6 +174,9 @@ namespace Falcor
 
     bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
     {
+        assert(mModelEntryCount < mpFileLoads->models.size());
+        ModelLoad* pLoad = mpFileLoads->models[mModelEntryCount++];
+
         // Model must have at least a filename
         if(jsonModel.HasMember(SceneKeys::kFilename) == false)
         {
@@ -185,13 +188,8 @@ namespace Falcor
             return error("Model filename must be a string");
         }
 
-        // Load the model
-        std::string file =  mDirectory + '\\' + modelFile.GetString();
-        if (doesFileExist(file) == false)
-        {
-            file = modelFile.GetString();
-        }
-        auto pModel = Model::createFromFile(file.c_str(), mModelLoadFlags);
+        // Load the model. The file was resolved by collectModelLoads()
+        auto pModel = completeModelLoad(pLoad);
         if(pModel == nullptr)
         {
             return false;
@@ -313,6 +311,179 @@ namespace Falcor
         return true;
     }
 
+    void SceneImporter::collectModelLoads(const rapidjson::Value& jsonDoc, const std::string& directory, FileModelLoads& fileLoads, std::map<std::string, ModelLoad*>& sharedLoads)
+    {
+        if(jsonDoc.IsObject() == false)
+        {
+            return;
+        }
+
+        // The loads are collected in the order createModel() and loadIncludeFile() will be called when parsing
+        const auto& jsonModels = jsonDoc.FindMember(SceneKeys::kModels);
+        if(jsonModels != jsonDoc.MemberEnd() && jsonModels->value.IsArray())
+        {
+            for(uint32_t i = 0; i < jsonModels->value.Size(); i++)
+            {
+                const auto& jsonModel = jsonModels->value[i];
+                ModelLoad* pLoad = nullptr;
+
+                if(jsonModel.IsObject() && jsonModel.HasMember(SceneKeys::kFilename) && jsonModel[SceneKeys::kFilename].IsString())
+                {
+                    const std::string modelFile = jsonModel[SceneKeys::kFilename].GetString();
+                    std::string file = directory + '\\' + modelFile;
+                    if(doesFileExist(file) == false)
+                    {
+                        file = modelFile;
+                    }
+
+                    // Entries which only add instances can share a model. Other entries modify the model, so they get their own
+                    bool canShare = true;
+                    for(auto& m = jsonModel.MemberBegin(); m != jsonModel.MemberEnd(); m++)
+                    {
+                        std::string key(m->name.GetString());
+                        canShare = canShare && (key == SceneKeys::kFilename || key == SceneKeys::kModelInstances);
+                    }
+
+                    auto sharedLoad = canShare ? sharedLoads.find(file) : sharedLoads.end();
+                    if(sharedLoad != sharedLoads.end())
+                    {
+                        pLoad = sharedLoad->second;
+                    }
+                    else
+                    {
+                        mpModelLoads->loads.push_back(std::make_unique<ModelLoad>());
+                        pLoad = mpModelLoads->loads.back().get();
+                        pLoad->file = file;
+                        if(canShare)
+                        {
+                            sharedLoads[file] = pLoad;
+                        }
+                    }
+                }
+
+                fileLoads.models.push_back(pLoad);
+            }
+        }
+
+        const auto& jsonIncludes = jsonDoc.FindMember(SceneKeys::kInclude);
+        if(jsonIncludes != jsonDoc.MemberEnd() && jsonIncludes->value.IsArray())
+        {
+            fileLoads.includes.resize(jsonIncludes->value.Size());
+            for(uint32_t i = 0; i < jsonIncludes->value.Size(); i++)
+            {
+                if(jsonIncludes->value[i].IsString() == false)
+                {
+                    continue;
+                }
+
+                const std::string include = jsonIncludes->value[i].GetString();
+                std::string fullpath = directory + '\\' + include;
+                if(doesFileExist(fullpath) == false && findFileInDataDirectories(include, fullpath) == false)
+                {
+                    continue;
+                }
+
+                // Errors are reported when the include is loaded
+                std::ifstream fileStream(fullpath);
+                std::stringstream strStream;
+                strStream << fileStream.rdbuf();
+                std::string jsonData = strStream.str();
+                rapidjson::StringStream JStream(jsonData.c_str());
+
+                rapidjson::Document jsonInclude;
+                jsonInclude.ParseStream(JStream);
+                if(jsonInclude.HasParseError() == false)
+                {
+                    auto last = fullpath.find_last_of("/\\");
+                    collectModelLoads(jsonInclude, fullpath.substr(0, last), fileLoads.includes[i], sharedLoads);
+                }
+            }
+        }
+    }
+
+    void SceneImporter::startModelLoads()
+    {
+        const auto& loads = mpModelLoads->loads;
+        if(loads.size() < 2)
+        {
+            return;
+        }
+
+        mpModelLoads->pQueue = TaskQueue::create((uint32_t)std::min<size_t>(loads.size(), std::thread::hardware_concurrency()));
+        Model::LoadFlags flags = mModelLoadFlags;
+
+        for(const auto& pLoad : loads)
+        {
+            // The models are created in the order a serial load creates them, so they get the same IDs.
+            // The create stage of each import is deferred to this thread, and runs when parsing reaches the model, see completeModelLoad()
+            ModelLoad* pModelLoad = pLoad.get();
+            pModelLoad->pModel = Model::SharedPtr(new Model());
+            pModelLoad->importTask = mpModelLoads->pQueue->enqueue([pModelLoad, flags]()
+            {
+                ModelImporter::setDeferredCreateStage(&pModelLoad->createStage);
+                pModelLoad->imported = pModelLoad->pModel->importFromFile(pModelLoad->file.c_str(), flags);
+                ModelImporter::setDeferredCreateStage(nullptr);
+                pModelLoad->createStage.finish();
+            });
+        }
+    }
+
+    Model::SharedPtr SceneImporter::completeModelLoad(ModelLoad* pLoad)
+    {
+        if(pLoad->completed == false)
+        {
+            if(pLoad->importTask.valid())
+            {
+                pLoad->createStage.run();
+                pLoad->importTask.wait();
+            }
+            else
+            {
+                pLoad->pModel = Model::SharedPtr(new Model());
+                pLoad->imported = pLoad->pModel->importFromFile(pLoad->file.c_str(), mModelLoadFlags);
+            }
+            pLoad->completed = true;
+        }
+
+        return pLoad->imported ? pLoad->pModel : nullptr;
+    }
+
+    void SceneImporter::completeModelLoads(FileModelLoads& fileLoads)
+    {
+        for(ModelLoad* pLoad : fileLoads.models)
+        {
+            if(pLoad && pLoad->importTask.valid())
+            {
+                completeModelLoad(pLoad);
+            }
+        }
+
+        for(auto& include : fileLoads.includes)
+        {
+            completeModelLoads(include);
+        }
+    }
+
+    SceneImporter::ModelLoadList::~ModelLoadList()
+    {
+        // Release the imports which are waiting for their create stage, in case parsing failed
+        for(const auto& pLoad : loads)
+        {
+            if(pLoad->importTask.valid())
+            {
+                pLoad->createStage.cancel();
+            }
+        }
+
+        for(const auto& pLoad : loads)
+        {
+            if(pLoad->importTask.valid())
+            {
+                pLoad->importTask.wait();
+            }
+        }
+    }
+
     bool SceneImporter::parseModels(const rapidjson::Value& jsonVal)
     {
         if(jsonVal.IsArray() == false)
@@ -1186,6 +1357,20 @@ namespace Falcor
                 return error(std::string("JSON Parse error in line ") + std::to_string(line) + ". " + rapidjson::GetParseError_En(mJDoc.GetParseError()));
             }
 
+            // Resolve the models of the scene and its includes before parsing, so that they can be loaded concurrently
+            if(mpFileLoads == nullptr)
+            {
+                mpModelLoads = std::make_unique<ModelLoadList>();
+                mpFileLoads = &mpModelLoads->root;
+                std::map<std::string, ModelLoad*> sharedLoads;
+                collectModelLoads(mJDoc, mDirectory, *mpFileLoads, sharedLoads);
+
+                if(is_set(mSceneLoadFlags, Scene::LoadFlags::SerialModelLoading) == false)
+                {
+                    startModelLoads();
+                }
+            }
+
             if(topLevelLoop() == false)
             {
                 return false;
@@ -1376,6 +1561,9 @@ namespace Falcor
 
     bool SceneImporter::loadIncludeFile(const std::string& include)
     {
+        assert(mIncludeEntryCount < mpFileLoads->includes.size());
+        FileModelLoads& includeLoads = mpFileLoads->includes[mIncludeEntryCount++];
+
         // Find the file
         std::string fullpath = mDirectory + '\\' + include;
         if(doesFileExist(fullpath) == false)
@@ -1388,7 +1576,12 @@ namespace Falcor
         }
 
         Scene::SharedPtr pScene = Scene::create();
-        SceneImporter::loadScene(*pScene, fullpath, mModelLoadFlags, mSceneLoadFlags);
+        SceneImporter importer(*pScene, &includeLoads);
+        importer.load(fullpath, mModelLoadFlags, mSceneLoadFlags);
+
+        // If the include failed, some of its imports might still be waiting for their create stage
+        completeModelLoads(includeLoads);
+
         if(pScene == nullptr)
         {
             return false;
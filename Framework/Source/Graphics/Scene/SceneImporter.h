@@ -27,8 +27,11 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <future>
 #include "Externals/RapidJson/include/rapidjson/document.h"
 #include "Graphics/Material/Material.h"
+#include "Graphics/Model/Loaders/ModelImporter.h"
+#include "Utils/TaskQueue.h"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
@@ -42,10 +45,42 @@ namespace Falcor
         static bool loadScene(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
 
     private:
+        /** A model file which is loaded for one or more model entries
+        */
+        struct ModelLoad
+        {
+            std::string file;
+            Model::SharedPtr pModel;
+            bool imported = false;
+            bool completed = false;
+            ModelImporter::DeferredCreateStage createStage;
+            std::shared_future<void> importTask;
+        };
+
+        /** The models of a scene file and its includes, collected before the file is parsed so the models can be loaded concurrently
+        */
+        struct FileModelLoads
+        {
+            std::vector<ModelLoad*> models;         // One per entry in the models array. Entries which share a model point to the same load
+            std::vector<FileModelLoads> includes;   // One per entry in the include array
+        };
 
-        SceneImporter(Scene& scene) : mScene(scene) {}
+        struct ModelLoadList
+        {
+            ~ModelLoadList();
+            std::vector<std::unique_ptr<ModelLoad>> loads;
+            FileModelLoads root;
+            TaskQueue::SharedPtr pQueue;
+        };
+
+        SceneImporter(Scene& scene, FileModelLoads* pFileLoads = nullptr) : mScene(scene), mpFileLoads(pFileLoads) {}
         bool load(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
 
+        void collectModelLoads(const rapidjson::Value& jsonDoc, const std::string& directory, FileModelLoads& fileLoads, std::map<std::string, ModelLoad*>& sharedLoads);
+        void startModelLoads();
+        Model::SharedPtr completeModelLoad(ModelLoad* pLoad);
+        void completeModelLoads(FileModelLoads& fileLoads);
+
         bool parseVersion(const rapidjson::Value& jsonVal);
         bool parseModels(const rapidjson::Value& jsonVal);
         bool parseLights(const rapidjson::Value& jsonVal);
@@ -103,6 +138,11 @@ namespace Falcor
         ObjectMap mCameraMap;
         ObjectMap mLightMap;
 
+        std::unique_ptr<ModelLoadList> mpModelLoads;    // Only set for the top-level file
+        FileModelLoads* mpFileLoads = nullptr;
+        uint32_t mModelEntryCount = 0;
+        uint32_t mIncludeEntryCount = 0;
+
         struct FuncValue
         {
             const std::string token;
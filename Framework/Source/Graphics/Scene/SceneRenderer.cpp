@@ -37,22 +37,36 @@
 #include "API/Device.h"
 #include "glm/matrix.hpp"
 #include "Graphics/Material/MaterialSystem.h"
+#include "Utils/ThreadPool.h"
 
 namespace Falcor
 {
-    size_t SceneRenderer::sBonesOffset = ConstantBuffer::kInvalidOffset;
+    namespace
+    {
+        // Toggled for every skinned model, so it's interned once
+        const Program::Define kVertexBlendingDefine = Program::createDefine("_VERTEX_BLENDING");
+    }
+
     size_t SceneRenderer::sCameraDataOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sWorldMatArraySize = 0;
-    size_t SceneRenderer::sWorldMatOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sWorldInvTransposeMatOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sInstanceTransformIdOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sInstanceTransformIdCount = 0;
+    size_t SceneRenderer::sPositionScaleOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPositionOffsetOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightCountOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightArrayOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sLightArraySize = 0;
+    size_t SceneRenderer::sLightClusterGridOffset = ConstantBuffer::kInvalidOffset;
 
     const char* SceneRenderer::kPerMaterialCbName = "InternalPerMaterialCB";
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
     const char* SceneRenderer::kPerMeshCbName = "InternalPerMeshCB";
+    const char* SceneRenderer::kInstanceTransformsName = "gInstanceTransforms";
+    const char* SceneRenderer::kBonePaletteName = "gBonePalette";
+    const char* SceneRenderer::kBoneNormalPaletteName = "gBoneNormalPalette";
+    const char* SceneRenderer::kClusterLightsName = "gClusterLights";
+    const char* SceneRenderer::kLightClustersName = "gLightClusters";
 
     SceneRenderer::SharedPtr SceneRenderer::create(const Scene::SharedPtr& pScene)
     {
@@ -66,21 +80,19 @@ namespace Falcor
 
     void SceneRenderer::updateVariableOffsets(const ProgramReflection* pReflector)
     {
-        if (sWorldMatOffset == ConstantBuffer::kInvalidOffset)
+        if (sMeshIdOffset == ConstantBuffer::kInvalidOffset)
         {
             const auto pPerMeshCbData = pReflector->getBufferDesc(kPerMeshCbName, ProgramReflection::BufferReflection::Type::Constant);
 
             if (pPerMeshCbData != nullptr)
             {
-                assert(pPerMeshCbData->getVariableData("gWorldMat[0]")->isRowMajor == false); // We copy into CBs as column-major
-                assert(pPerMeshCbData->getVariableData("gWorldInvTransposeMat[0]")->isRowMajor == false);
-                assert(pPerMeshCbData->getVariableData("gWorldMat[0]")->arraySize == pPerMeshCbData->getVariableData("gWorldInvTransposeMat[0]")->arraySize);
-
-                sWorldMatArraySize = pPerMeshCbData->getVariableData("gWorldMat[0]")->arraySize;
-                sWorldMatOffset = pPerMeshCbData->getVariableData("gWorldMat[0]")->location;
-                sWorldInvTransposeMatOffset = pPerMeshCbData->getVariableData("gWorldInvTransposeMat[0]")->location;
                 sMeshIdOffset = pPerMeshCbData->getVariableData("gMeshId")->location;
                 sDrawIDOffset = pPerMeshCbData->getVariableData("gDrawId[0]")->location;
+                const auto& pTransformIdData = pPerMeshCbData->getVariableData("gInstanceTransformId[0]");
+                sInstanceTransformIdOffset = pTransformIdData->location;
+                sInstanceTransformIdCount = pTransformIdData->arraySize * 4; // uint4 elements
+                sPositionScaleOffset = pPerMeshCbData->getVariableData("gPositionScale")->location;
+                sPositionOffsetOffset = pPerMeshCbData->getVariableData("gPositionOffset")->location;
             }
         }
 
@@ -95,6 +107,14 @@ namespace Falcor
                 sLightCountOffset = pCountOffset ? pCountOffset->location : ConstantBuffer::kInvalidOffset;
                 const auto& pLightOffset = pPerFrameCbData->getVariableData("gLights[0].worldPos");
                 sLightArrayOffset = pLightOffset ? pLightOffset->location : ConstantBuffer::kInvalidOffset;
+                // Arrays of structs are reflected per element
+                sLightArraySize = 0;
+                while (pPerFrameCbData->getVariableData("gLights[" + std::to_string(sLightArraySize) + "].worldPos"))
+                {
+                    sLightArraySize++;
+                }
+                const auto& pGridOffset = pPerFrameCbData->getVariableData("gLightClusterGrid.tilesX");
+                sLightClusterGridOffset = pGridOffset ? pGridOffset->location : ConstantBuffer::kInvalidOffset;
             }
         }
     }
@@ -110,38 +130,31 @@ namespace Falcor
                 currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
             }
 
-            // Set lights
+            // Set lights. The array only holds the first MAX_LIGHT_SOURCES lights, shaders which need more should use the light clusters
+            const uint32_t lightCount = glm::min(mpScene->getLightCount(), (uint32_t)sLightArraySize);
             if (sLightArrayOffset != ConstantBuffer::kInvalidOffset)
             {
-                assert(mpScene->getLightCount() < 16);  // Max array size in the shader
-                for (uint_t i = 0; i < mpScene->getLightCount(); i++)
+                if (lightCount < mpScene->getLightCount() && mLightOverflowReported == false && currentData.pVars->getReflection()->getResourceDesc(kLightClustersName) == nullptr)
+                {
+                    logWarning("SceneRenderer: the scene has " + std::to_string(mpScene->getLightCount()) + " lights but gLights only holds " + std::to_string(lightCount) + ". The remaining lights are ignored. Use the light clusters (see evalSceneLights() in Shading.h) or increase MAX_LIGHT_SOURCES.");
+                    mLightOverflowReported = true;
+                }
+
+                for (uint_t i = 0; i < lightCount; i++)
                 {
                     mpScene->getLight(i)->setIntoConstantBuffer(pCB, i * Light::getShaderStructSize() + sLightArrayOffset);
                 }
             }
             if (sLightCountOffset != ConstantBuffer::kInvalidOffset)
             {
-                pCB->setVariable(sLightCountOffset, mpScene->getLightCount());
+                pCB->setVariable(sLightCountOffset, lightCount);
             }
         }
     }
 
     bool SceneRenderer::setPerModelData(const CurrentWorkingData& currentData)
     {
-        // Set bones
-        if (currentData.pModel->hasBones())
-        {
-            ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerMeshCbName).get();
-            if (pCB)
-            {
-                if (sBonesOffset == ConstantBuffer::kInvalidOffset)
-                {
-                    sBonesOffset = pCB->getVariableOffset("gWorldMat[0]");
-                }
-
-                pCB->setVariableArray(sBonesOffset, currentData.pModel->getBonesMatrices(), currentData.pModel->getBonesCount());
-            }
-        }
+        // The bones of skinned models live in the scene's bone palette, see setBonePalette()
         return true;
     }
 
@@ -152,6 +165,13 @@ namespace Falcor
 
     bool SceneRenderer::setPerMeshData(const CurrentWorkingData& currentData, const Mesh* pMesh)
     {
+        ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerMeshCbName).get();
+        if (pCB)
+        {
+            // Dequantization of the positions. Identity unless the model was loaded with Model::LoadFlags::QuantizePositions
+            pCB->setVariable(sPositionScaleOffset, pMesh->getPositionScale());
+            pCB->setVariable(sPositionOffsetOffset, pMesh->getPositionOffset());
+        }
         return true;
     }
 
@@ -162,16 +182,11 @@ namespace Falcor
         {
             const Mesh* pMesh = pMeshInstance->getObject().get();
 
-            assert(drawInstanceID == 0 || !pMesh->hasBones()); // The same array is reused for bone and instance matrices, both cannot be active
-            if (pMesh->hasBones() == false)
-            {
-                glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
-                glm::mat3x4 worldInvTransposeMat = transpose(inverse(glm::mat3(worldMat)));
-
-                assert(drawInstanceID < sWorldMatArraySize);
-                pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
-                pCB->setBlob(&worldInvTransposeMat, sWorldInvTransposeMatOffset + drawInstanceID * sizeof(glm::mat3x4), sizeof(glm::mat3x4)); // HLSL uses column-major and packing rules require 16B alignment, hence use glm:mat3x4
-            }
+            // The matrices live in the scene's transform buffer or, for skinned models, in the bone palette. Only the slot is set per instance.
+            const uint32_t slot = currentData.pModel->hasBones() ? currentData.bonePaletteOffset : currentData.transformID;
+            assert(drawInstanceID < sInstanceTransformIdCount);
+            assert(slot != SceneBonePalette::kInvalidOffset);
+            pCB->setBlob(&slot, sInstanceTransformIdOffset + drawInstanceID * sizeof(uint32_t), sizeof(uint32_t));
 
             // Set mesh id
             pCB->setVariable(sMeshIdOffset, pMesh->getId());
@@ -185,7 +200,14 @@ namespace Falcor
         ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerMaterialCbName).get();
         if (pCB)
         {
-            pMaterial->setIntoProgramVars(currentData.pVars, pCB, "gMaterial");
+            // Resolve the material variable once per program instead of on every material change
+            const ProgramReflection::SharedConstPtr& pReflector = currentData.pVars->getReflection();
+            if (pReflector != mpMaterialBindingReflector)
+            {
+                mMaterialBinding = Material::createBindingLayout(pReflector.get(), pCB->getBufferReflector(), "gMaterial");
+                mpMaterialBindingReflector = pReflector;
+            }
+            pMaterial->setIntoProgramVars(currentData.pVars, pCB, mMaterialBinding);
         }
 
         return true;
@@ -227,7 +249,7 @@ namespace Falcor
 
     }
 
-    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
+    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID, const uint32_t* pVisibleLeaves, uint32_t leafCount)
     {
         const Model* pModel = currentData.pModel;
         const Mesh* pMesh = pModel->getMesh(meshID).get();
@@ -239,28 +261,25 @@ namespace Falcor
 
             uint32_t activeInstances = 0;
 
-            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
-            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            for (uint32_t i = 0; i < leafCount; i++)
             {
+                const uint32_t instanceID = currentData.pBVH->getLeaf(pVisibleLeaves[i]).meshInstanceID;
                 const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, instanceID).get();
-                BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
 
-                if ((mCullEnabled == false) || (currentData.pCamera->isObjectCulled(box) == false))
+                if (pMeshInstance->isVisible())
                 {
-                    if (pMeshInstance->isVisible())
+                    currentData.transformID = pVisibleLeaves[i];
+                    if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
                     {
-                        if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
+                        currentData.drawID++;
+                        activeInstances++;
+
+                        if (activeInstances == mMaxInstanceCount)
                         {
-                            currentData.drawID++;
-                            activeInstances++;
-
-                            if (activeInstances == mMaxInstanceCount)
-                            {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                draw(currentData, pMesh, activeInstances);
-                                activeInstances = 0;
-                            }
+                            // DISABLED_FOR_D3D12
+                            //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
+                            draw(currentData, pMesh, activeInstances);
+                            activeInstances = 0;
                         }
                     }
                 }
@@ -272,7 +291,7 @@ namespace Falcor
         }
     }
 
-    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance)
+    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const uint32_t* pVisibleLeaves, uint32_t leafCount)
     {
         const Model* pModel = pModelInstance->getObject().get();
 
@@ -282,24 +301,159 @@ namespace Falcor
             // Bind the program
             if(pModel->hasBones())
             {
-                pProgram->addDefine("_VERTEX_BLENDING");
+                pProgram->addDefine(kVertexBlendingDefine);
             }
 
             mpLastMaterial = nullptr;
 
-            // Loop over the meshes
-            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            // The leaves are sorted, so the visible instances of each mesh are contiguous
+            uint32_t first = 0;
+            while (first < leafCount)
             {
-                renderMeshInstances(currentData, pModelInstance, meshID);
+                const uint32_t meshID = currentData.pBVH->getLeaf(pVisibleLeaves[first]).meshID;
+                uint32_t last = first + 1;
+                while (last < leafCount && currentData.pBVH->getLeaf(pVisibleLeaves[last]).meshID == meshID)
+                {
+                    last++;
+                }
+
+                renderMeshInstances(currentData, pModelInstance, meshID, pVisibleLeaves + first, last - first);
+                first = last;
             }
 
             // Restore the program state
             if(pModel->hasBones())
             {
-                pProgram->removeDefine("_VERTEX_BLENDING");
+                pProgram->removeDefine(kVertexBlendingDefine);
+            }
+        }
+
+    }
+
+    void SceneRenderer::renderVisibleInstances(CurrentWorkingData& currentData, bool cull)
+    {
+        currentData.pBVH = mpScene->getBVH();
+        if (cull)
+        {
+            currentData.pBVH->cull(currentData.pCamera, mVisibleLeaves);
+        }
+        else
+        {
+            mVisibleLeaves.resize(currentData.pBVH->getLeafCount());
+            for (uint32_t i = 0; i < (uint32_t)mVisibleLeaves.size(); i++)
+            {
+                mVisibleLeaves[i] = i;
+            }
+        }
+
+        // Walk the sorted list one model instance at a time
+        const uint32_t leafCount = (uint32_t)mVisibleLeaves.size();
+        uint32_t first = 0;
+        while (first < leafCount)
+        {
+            const SceneBVH::Leaf& leaf = currentData.pBVH->getLeaf(mVisibleLeaves[first]);
+            uint32_t last = first + 1;
+            while (last < leafCount)
+            {
+                const SceneBVH::Leaf& next = currentData.pBVH->getLeaf(mVisibleLeaves[last]);
+                if (next.modelID != leaf.modelID || next.modelInstanceID != leaf.modelInstanceID)
+                {
+                    break;
+                }
+                last++;
+            }
+
+            currentData.pModel = mpScene->getModel(leaf.modelID).get();
+            const auto pInstance = mpScene->getModelInstance(leaf.modelID, leaf.modelInstanceID).get();
+            if (pInstance->isVisible())
+            {
+                currentData.bonePaletteOffset = currentData.pModel->hasBones() ? currentData.pBonePalette->getPaletteOffset(pInstance) : SceneBonePalette::kInvalidOffset;
+                if (setPerModelInstanceData(currentData, pInstance, leaf.modelInstanceID))
+                {
+                    renderModelInstance(currentData, pInstance, mVisibleLeaves.data() + first, last - first);
+                }
+            }
+            first = last;
+        }
+        currentData.pBVH = nullptr;
+    }
+
+    void SceneRenderer::renderDrawList(CurrentWorkingData& currentData, const SceneDrawList* pDrawList)
+    {
+        const Scene::ModelInstance* pLastInstance = nullptr;
+        bool instanceActive = false;
+        bool modelActive = false;
+        bool vertexBlending = false;
+        currentData.pModel = nullptr;
+        mpLastMaterial = nullptr;
+
+        for (const auto& d : pDrawList->getDraws())
+        {
+            const SceneDrawList::Item& first = pDrawList->getItem(d.firstItem);
+            const Model* pModel = first.pModelInstance->getObject().get();
+
+            if (pModel != currentData.pModel)
+            {
+                currentData.pModel = pModel;
+                modelActive = setPerModelData(currentData);
+            }
+
+            if (modelActive == false)
+            {
+                continue;
+            }
+
+            // Skinned items are sorted last, so the define changes at most once per list
+            if (pModel->hasBones() != vertexBlending)
+            {
+                vertexBlending = pModel->hasBones();
+                Program* pProgram = currentData.pState->getProgram().get();
+                if (vertexBlending)
+                {
+                    pProgram->addDefine(kVertexBlendingDefine);
+                }
+                else
+                {
+                    pProgram->removeDefine(kVertexBlendingDefine);
+                }
+            }
+
+            if (setPerMeshData(currentData, first.pMesh))
+            {
+                // Bind VAO and set topology
+                currentData.pState->setVao(first.pMesh->getVao());
+
+                uint32_t activeInstances = 0;
+                for (uint32_t i = d.firstItem; i < d.firstItem + d.itemCount; i++)
+                {
+                    const SceneDrawList::Item& item = pDrawList->getItem(i);
+                    if (item.pModelInstance != pLastInstance)
+                    {
+                        pLastInstance = item.pModelInstance;
+                        currentData.bonePaletteOffset = pModel->hasBones() ? currentData.pBonePalette->getPaletteOffset(item.pModelInstance) : SceneBonePalette::kInvalidOffset;
+                        instanceActive = setPerModelInstanceData(currentData, item.pModelInstance, item.modelInstanceID);
+                    }
+
+                    currentData.transformID = item.transformID;
+                    if (instanceActive && setPerMeshInstanceData(currentData, item.pModelInstance, item.pMeshInstance, activeInstances))
+                    {
+                        currentData.drawID++;
+                        activeInstances++;
+                    }
+                }
+
+                if (activeInstances != 0)
+                {
+                    draw(currentData, first.pMesh, activeInstances);
+                }
             }
         }
 
+        // Restore the program state
+        if (vertexBlending)
+        {
+            currentData.pState->getProgram()->removeDefine(kVertexBlendingDefine);
+        }
     }
 
     bool SceneRenderer::update(double currentTime)
@@ -327,27 +481,71 @@ namespace Falcor
         }
     }
 
+    void SceneRenderer::setInstanceTransforms(const CurrentWorkingData& currentData)
+    {
+        const SceneTransformBuffer* pTransforms = mpScene->getTransformBuffer();
+        if (pTransforms->getBuffer() && currentData.pVars->getReflection()->getResourceDesc(kInstanceTransformsName))
+        {
+            currentData.pVars->setRawBuffer(kInstanceTransformsName, pTransforms->getBuffer());
+        }
+    }
+
+    void SceneRenderer::setBonePalette(CurrentWorkingData& currentData)
+    {
+        currentData.pBonePalette = mpScene->getBonePalette();
+        if (currentData.pBonePalette->getBuffer() && currentData.pVars->getReflection()->getResourceDesc(kBonePaletteName))
+        {
+            currentData.pVars->setRawBuffer(kBonePaletteName, currentData.pBonePalette->getBuffer());
+        }
+        if (currentData.pBonePalette->getNormalBuffer() && currentData.pVars->getReflection()->getResourceDesc(kBoneNormalPaletteName))
+        {
+            currentData.pVars->setRawBuffer(kBoneNormalPaletteName, currentData.pBonePalette->getNormalBuffer());
+        }
+    }
+
+    void SceneRenderer::setLightClusters(const CurrentWorkingData& currentData)
+    {
+        const ProgramReflection* pReflector = currentData.pVars->getReflection().get();
+        if (currentData.pCamera == nullptr || pReflector->getResourceDesc(kLightClustersName) == nullptr)
+        {
+            return;
+        }
+
+        if (mpLightClusters == nullptr)
+        {
+            mpLightClusters = LightClusters::create();
+        }
+        mpLightClusters->update(mpScene.get(), currentData.pCamera, ThreadPool::getDefault());
+
+        currentData.pVars->setRawBuffer(kClusterLightsName, mpLightClusters->getLightBuffer());
+        currentData.pVars->setRawBuffer(kLightClustersName, mpLightClusters->getClusterBuffer());
+        ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerFrameCbName).get();
+        if (pCB && sLightClusterGridOffset != ConstantBuffer::kInvalidOffset)
+        {
+            pCB->setBlob(&mpLightClusters->getData(), sLightClusterGridOffset, sizeof(LightClusterData));
+        }
+    }
+
     void SceneRenderer::renderScene(CurrentWorkingData& currentData)
     {
         setupVR();
         setPerFrameData(currentData);
+        setInstanceTransforms(currentData);
+        setBonePalette(currentData);
+        setLightClusters(currentData);
 
-        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        if (mSortedDrawListEnabled)
         {
-            currentData.pModel = mpScene->getModel(modelID).get();
-
-            for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+            if (mpDrawList == nullptr)
             {
-                const auto pInstance = mpScene->getModelInstance(modelID, instanceID).get();
-                if (pInstance->isVisible())
-                {
-                    if (setPerModelInstanceData(currentData, pInstance, instanceID))
-                    {
-                        renderModelInstance(currentData, pInstance);
-                    }
-                }
+                mpDrawList = SceneDrawList::create();
             }
+            mpDrawList->build(mpScene.get(), currentData.pCamera, mCullEnabled && currentData.pCamera, mMaxInstanceCount);
+            renderDrawList(currentData, mpDrawList.get());
+            return;
         }
+
+        renderVisibleInstances(currentData, mCullEnabled && currentData.pCamera);
     }
 
     void SceneRenderer::renderScene(RenderContext* pContext, Camera* pCamera)
@@ -365,6 +563,27 @@ namespace Falcor
         renderScene(currentData);
     }
 
+    void SceneRenderer::renderScene(RenderContext* pContext, Camera* pCamera, const SceneDrawList* pDrawList)
+    {
+        updateVariableOffsets(pContext->getGraphicsVars()->getReflection().get());
+
+        CurrentWorkingData currentData;
+        currentData.pContext = pContext;
+        currentData.pState = pContext->getGraphicsState().get();
+        currentData.pVars = pContext->getGraphicsVars().get();
+        currentData.pCamera = pCamera;
+        currentData.pMaterial = nullptr;
+        currentData.pModel = nullptr;
+        currentData.drawID = 0;
+
+        setupVR();
+        setPerFrameData(currentData);
+        setInstanceTransforms(currentData);
+        setBonePalette(currentData);
+        setLightClusters(currentData);
+        renderDrawList(currentData, pDrawList);
+    }
+
     void SceneRenderer::setCameraControllerType(CameraControllerType type)
     {
         switch(type)
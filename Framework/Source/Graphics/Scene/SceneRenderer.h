@@ -30,6 +30,8 @@
 #include "Utils/Gui.h"
 #include "Graphics/Camera/CameraController.h"
 #include "Graphics/Scene/Scene.h"
+#include "Graphics/Scene/SceneDrawList.h"
+#include "Graphics/Scene/LightClusters.h"
 #include "utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
@@ -68,6 +70,10 @@ namespace Falcor
         */
         void renderScene(RenderContext* pContext, Camera* pCamera);
 
+        /** Renders a draw list built by a previous renderScene() call, possibly by another renderer of the same scene
+        */
+        void renderScene(RenderContext* pContext, Camera* pCamera, const SceneDrawList* pDrawList);
+
         /** Update the camera and model animation.
             Should be called before renderScene(), unless not animations are used and you update the camera manualy
         */
@@ -104,6 +110,19 @@ namespace Falcor
         void setRenderMode(RenderMode mode);
         void toggleStaticMaterialCompilation(bool on) { mCompileMaterialWithProgram = on; }
 
+        /** Enable/disable the sorted draw list. When enabled, the visible mesh instances of the entire scene are sorted by state and instances of the same mesh are merged into instanced draws, even across model instances.
+            Disable it when the renderer sets state per model instance which must not be shared by a single draw.
+        */
+        void toggleSortedDrawList(bool on) { mSortedDrawListEnabled = on; }
+
+        /** Get the draw list built by the last renderScene() call. Returns nullptr if the sorted draw list is disabled.
+        */
+        SceneDrawList::SharedConstPtr getDrawList() const { return mpDrawList; }
+
+        /** Get the light clusters built by the last renderScene() call. The clusters are only built for programs which declare gLightClusters (see ShaderCommon.h), returns nullptr otherwise.
+        */
+        LightClusters::SharedConstPtr getLightClusters() const { return mpLightClusters; }
+
     protected:
 
         struct CurrentWorkingData
@@ -114,6 +133,10 @@ namespace Falcor
             const Camera* pCamera = nullptr;
             const Model* pModel = nullptr;
             const Material* pMaterial = nullptr;
+            const SceneBVH* pBVH = nullptr; // Set when rendering the list of BVH leaves
+            uint32_t transformID = 0; // Slot of the current mesh instance in the scene's transform buffer
+            const SceneBonePalette* pBonePalette = nullptr;
+            uint32_t bonePaletteOffset = SceneBonePalette::kInvalidOffset; // First bone of the current model instance in the bone palette, if it's skinned
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
         };
@@ -125,15 +148,22 @@ namespace Falcor
         static const char* kPerFrameCbName;
         static const char* kPerMeshCbName;
 
-        static size_t sBonesOffset;
         static size_t sCameraDataOffset;
         static size_t sLightCountOffset;
         static size_t sLightArrayOffset;
-        static size_t sWorldMatArraySize;
-        static size_t sWorldMatOffset;
-        static size_t sWorldInvTransposeMatOffset;
+        static size_t sLightArraySize;
+        static size_t sLightClusterGridOffset;
         static size_t sMeshIdOffset;
         static size_t sDrawIDOffset;
+        static size_t sInstanceTransformIdOffset;
+        static size_t sInstanceTransformIdCount;
+        static size_t sPositionScaleOffset;
+        static size_t sPositionOffsetOffset;
+        static const char* kInstanceTransformsName;
+        static const char* kBonePaletteName;
+        static const char* kBoneNormalPaletteName;
+        static const char* kClusterLightsName;
+        static const char* kLightClustersName;
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
@@ -146,8 +176,15 @@ namespace Falcor
         virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
 
-        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
-        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
+        /** Render the mesh instances of a model instance referenced by the BVH leaves in the list. The list must be sorted.
+        */
+        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const uint32_t* pVisibleLeaves, uint32_t leafCount);
+        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID, const uint32_t* pVisibleLeaves, uint32_t leafCount);
+        void renderVisibleInstances(CurrentWorkingData& currentData, bool cull);
+        void setInstanceTransforms(const CurrentWorkingData& currentData);
+        void setBonePalette(CurrentWorkingData& currentData);
+        void setLightClusters(const CurrentWorkingData& currentData);
+        void renderDrawList(CurrentWorkingData& currentData, const SceneDrawList* pDrawList);
         void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
 
         void setupVR();
@@ -158,7 +195,14 @@ namespace Falcor
 
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
+        ProgramReflection::SharedConstPtr mpMaterialBindingReflector;   // The program mMaterialBinding was resolved for
+        Material::BindingLayout mMaterialBinding;
         bool mCullEnabled = true;
+        std::vector<uint32_t> mVisibleLeaves;
+        bool mSortedDrawListEnabled = true;
+        SceneDrawList::SharedPtr mpDrawList;
+        LightClusters::SharedPtr mpLightClusters;
+        bool mLightOverflowReported = false;
         bool mUnloadTexturesOnMaterialChange = false;
         RenderMode mRenderMode = RenderMode::Mono;
         bool mCompileMaterialWithProgram = true;
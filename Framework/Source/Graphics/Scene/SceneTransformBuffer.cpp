@@ -0,0 +1,186 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneTransformBuffer.h"
+#include "Scene.h"
+#include "SceneBVH.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    SceneTransformBuffer::SharedPtr SceneTransformBuffer::create()
+    {
+        return SharedPtr(new SceneTransformBuffer());
+    }
+
+    void SceneTransformBuffer::rebuild(const Scene* pScene, const SceneBVH* pBVH)
+    {
+        const uint32_t slotCount = pBVH->getLeafCount();
+        mTransforms.resize(slotCount);
+        mMeshInstances.resize(slotCount);
+        mMeshVersions.resize(slotCount);
+        mInstances.clear();
+
+        // Leaves are stored in scene order, so the slots of a model instance are contiguous
+        uint32_t slot = 0;
+        while (slot < slotCount)
+        {
+            const SceneBVH::Leaf& leaf = pBVH->getLeaf(slot);
+            InstanceRecord record;
+            record.pInstance = pScene->getModelInstance(leaf.modelID, leaf.modelInstanceID).get();
+            record.transformVersion = record.pInstance->getTransformVersion();
+            record.firstSlot = slot;
+
+            const Model* pModel = record.pInstance->getObject().get();
+            for (; slot < slotCount; slot++)
+            {
+                const SceneBVH::Leaf& next = pBVH->getLeaf(slot);
+                if (next.modelID != leaf.modelID || next.modelInstanceID != leaf.modelInstanceID)
+                {
+                    break;
+                }
+                mMeshInstances[slot] = pModel->getMeshInstance(next.meshID, next.meshInstanceID).get();
+            }
+
+            record.slotCount = slot - record.firstSlot;
+            updateMeshVersions(record);
+            updateInstanceSlots(record);
+            mInstances.push_back(record);
+        }
+
+        mDirtyInstances.assign(mInstances.size(), 0);
+        mpBuffer = nullptr;
+        if (slotCount > 0)
+        {
+            mpBuffer = Buffer::create(slotCount * sizeof(InstanceTransform), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mTransforms.data());
+        }
+        mLastUploadSize = slotCount * sizeof(InstanceTransform);
+        mBvhBuildCount = pBVH->getBuildCount();
+    }
+
+    void SceneTransformBuffer::updateInstanceSlots(const InstanceRecord& record)
+    {
+        const glm::mat4& instanceMat = record.pInstance->getTransformMatrix();
+        for (uint32_t slot = record.firstSlot; slot < record.firstSlot + record.slotCount; slot++)
+        {
+            InstanceTransform& transform = mTransforms[slot];
+            transform.worldMat = instanceMat * mMeshInstances[slot]->getTransformMatrix();
+            transform.worldInvTransposeMat = transpose(inverse(glm::mat3(transform.worldMat)));
+        }
+    }
+
+    bool SceneTransformBuffer::updateMeshVersions(const InstanceRecord& record)
+    {
+        bool changed = false;
+        for (uint32_t slot = record.firstSlot; slot < record.firstSlot + record.slotCount; slot++)
+        {
+            const uint32_t version = mMeshInstances[slot]->getTransformVersion();
+            if (version != mMeshVersions[slot])
+            {
+                mMeshVersions[slot] = version;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void SceneTransformBuffer::uploadRange(uint32_t firstSlot, uint32_t slotCount)
+    {
+        const size_t size = slotCount * sizeof(InstanceTransform);
+        mpBuffer->updateData(&mTransforms[firstSlot], firstSlot * sizeof(InstanceTransform), size);
+        mLastUploadSize += size;
+    }
+
+    void SceneTransformBuffer::update(const Scene* pScene, const SceneBVH* pBVH, ThreadPool* pPool)
+    {
+        if (mBvhBuildCount != pBVH->getBuildCount())
+        {
+            rebuild(pScene, pBVH);
+            return;
+        }
+
+        mLastUploadSize = 0;
+
+        // Compute the matrices. Instances own disjoint slot ranges, so they can be updated in parallel.
+        auto updateInstances = [this](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                InstanceRecord& record = mInstances[i];
+                const uint32_t version = record.pInstance->getTransformVersion();
+                const bool meshesMoved = updateMeshVersions(record);
+                mDirtyInstances[i] = (version != record.transformVersion || meshesMoved) ? 1 : 0;
+                if (mDirtyInstances[i])
+                {
+                    record.transformVersion = version;
+                    updateInstanceSlots(record);
+                }
+            }
+        };
+
+        if (pPool)
+        {
+            pPool->parallelFor((uint32_t)mInstances.size(), 256, updateInstances);
+        }
+        else
+        {
+            updateInstances(0, (uint32_t)mInstances.size());
+        }
+
+        // Coalesce the slots of adjacent dirty instances into a single upload
+        uint32_t rangeFirst = 0;
+        uint32_t rangeCount = 0;
+        for (uint32_t i = 0; i < (uint32_t)mInstances.size(); i++)
+        {
+            if (mDirtyInstances[i] == 0)
+            {
+                continue;
+            }
+
+            const InstanceRecord& record = mInstances[i];
+            if (rangeCount > 0 && rangeFirst + rangeCount == record.firstSlot)
+            {
+                rangeCount += record.slotCount;
+            }
+            else
+            {
+                if (rangeCount > 0)
+                {
+                    uploadRange(rangeFirst, rangeCount);
+                }
+                rangeFirst = record.firstSlot;
+                rangeCount = record.slotCount;
+            }
+        }
+
+        if (rangeCount > 0)
+        {
+            uploadRange(rangeFirst, rangeCount);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "API/Buffer.h"
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    class Scene;
+    class SceneBVH;
+    class ThreadPool;
+
+    /** GPU buffer holding the world and normal matrices of all the mesh instances in a scene.
+        Each mesh instance owns a slot, indexed by its SceneBVH leaf ID. Shaders fetch the matrices by slot, so drawing only requires writing the slot index per instance.
+        The buffer is rewritten when the BVH is rebuilt. Otherwise, only the slots of model instances whose transform or mesh instance transforms changed are uploaded.
+    */
+    class SceneTransformBuffer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneTransformBuffer>;
+        using SharedConstPtr = std::shared_ptr<const SceneTransformBuffer>;
+
+        /** The matrices of a single mesh instance. Matches the layout gInstanceTransforms is read with in ShaderCommon.h
+        */
+        struct InstanceTransform
+        {
+            glm::mat4 worldMat;
+            glm::mat3x4 worldInvTransposeMat;   // HLSL packing rules require 16B alignment, hence use glm:mat3x4
+        };
+
+        static SharedPtr create();
+
+        /** Update the CPU copy of the matrices and upload the changed ranges
+            \param[in] pScene The scene
+            \param[in] pBVH The scene's BVH, which defines the slot of each mesh instance
+            \param[in] pPool Optional thread pool to compute the matrices with. The model and mesh instance transforms must already be up to date when using a pool, see Scene::updateTransforms().
+        */
+        void update(const Scene* pScene, const SceneBVH* pBVH, ThreadPool* pPool = nullptr);
+
+        /** Get the GPU buffer
+        */
+        const Buffer::SharedPtr& getBuffer() const { return mpBuffer; }
+
+        /** Get the number of slots
+        */
+        uint32_t getInstanceCount() const { return (uint32_t)mTransforms.size(); }
+
+        /** Get the CPU copy of a slot's matrices
+        */
+        const InstanceTransform& getTransform(uint32_t slot) const { return mTransforms[slot]; }
+
+        /** Get the number of bytes uploaded by the last update() call
+        */
+        size_t getLastUploadSize() const { return mLastUploadSize; }
+
+    private:
+        SceneTransformBuffer() = default;
+
+        struct InstanceRecord
+        {
+            const ObjectInstance<Model>* pInstance;
+            uint32_t transformVersion;
+            uint32_t firstSlot;
+            uint32_t slotCount;
+        };
+
+        void rebuild(const Scene* pScene, const SceneBVH* pBVH);
+        void updateInstanceSlots(const InstanceRecord& record);
+        bool updateMeshVersions(const InstanceRecord& record);
+        void uploadRange(uint32_t firstSlot, uint32_t slotCount);
+
+        std::vector<InstanceTransform> mTransforms;
+        std::vector<const Model::MeshInstance*> mMeshInstances;
+        std::vector<uint32_t> mMeshVersions;
+        std::vector<InstanceRecord> mInstances;
+        std::vector<uint8_t> mDirtyInstances;
+        Buffer::SharedPtr mpBuffer;
+        uint32_t mBvhBuildCount = 0;
+        size_t mLastUploadSize = 0;
+    };
+}
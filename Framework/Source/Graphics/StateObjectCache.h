@@ -0,0 +1,125 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <unordered_map>
+#include <future>
+#include <vector>
+#include "Utils/TaskQueue.h"
+
+namespace Falcor
+{
+    /** A cache of pipeline state objects, keyed by their descriptor.
+        Lookups hash the descriptor, so finding a state object costs the same regardless of how many combinations were created.
+        StateObjectType must provide SharedPtr, Desc and create(const Desc&). The Desc must provide getHash() and operator==.
+    */
+    template<typename StateObjectType>
+    class StateObjectCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<StateObjectCache>;
+        using SharedConstPtr = std::shared_ptr<const StateObjectCache>;
+        using Desc = typename StateObjectType::Desc;
+        using StateObjectPtr = typename StateObjectType::SharedPtr;
+
+        /** Create a new object
+        */
+        static SharedPtr create() { return SharedPtr(new StateObjectCache()); }
+
+        ~StateObjectCache()
+        {
+            // The background tasks write into the entries
+            for(auto& entry : mStateObjects)
+            {
+                if(entry.second.pending.valid())
+                {
+                    entry.second.pending.wait();
+                }
+            }
+        }
+
+        /** Get the state object matching a descriptor. It is created if it wasn't created or prewarmed before. If it is still being prewarmed, the call waits for it.
+        */
+        StateObjectPtr get(const Desc& desc)
+        {
+            Entry& entry = mStateObjects[desc];
+            if(entry.pending.valid())
+            {
+                entry.pending.wait();
+                entry.pending = std::shared_future<void>();
+            }
+
+            // Creation errors are reported synchronously
+            if(entry.pObject == nullptr)
+            {
+                entry.pObject = StateObjectType::create(desc);
+            }
+            return entry.pObject;
+        }
+
+        /** Create state objects on the TaskQueue ahead of time, so that the first get() which needs them doesn't stall on the driver.
+            \param[in] descs The descriptors of the state objects. Descriptors which are already in the cache are skipped.
+        */
+        void prewarm(const std::vector<Desc>& descs)
+        {
+            for(const auto& desc : descs)
+            {
+                if(mStateObjects.find(desc) != mStateObjects.end())
+                {
+                    continue;
+                }
+
+                // Elements of an unordered_map don't move when it rehashes, so the task can keep a pointer to the entry
+                Entry* pEntry = &mStateObjects[desc];
+                pEntry->pending = TaskQueue::getDefault()->enqueue([pEntry, desc]()
+                {
+                    pEntry->pObject = StateObjectType::create(desc);
+                });
+            }
+        }
+
+        /** Get the number of descriptors in the cache, including the ones which are still being prewarmed
+        */
+        uint32_t getSize() const { return (uint32_t)mStateObjects.size(); }
+
+    private:
+        StateObjectCache() = default;
+
+        struct Entry
+        {
+            StateObjectPtr pObject;
+            std::shared_future<void> pending;   // Valid while a prewarm task may still write pObject
+        };
+
+        struct DescHasher
+        {
+            size_t operator()(const Desc& desc) const { return desc.getHash(); }
+        };
+
+        std::unordered_map<Desc, Entry, DescHasher> mStateObjects;
+    };
+}
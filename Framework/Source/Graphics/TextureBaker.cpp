@@ -0,0 +1,732 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureBaker.h"
+#include "TextureHelper.h"
+#include "Graphics/Model/Model.h"
+#include "Graphics/Scene/Scene.h"
+#include "Data/HostDeviceData.h"
+#include "Utils/DDSHeader.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/StringUtils.h"
+#include "glm/common.hpp"
+#include "glm/gtc/packing.hpp"
+#include <atomic>
+#include <climits>
+#include <set>
+
+#ifdef FALCOR_GL
+static const bool kTopDown = false;
+#elif defined FALCOR_D3D
+static const bool kTopDown = true;
+#endif
+
+namespace Falcor
+{
+    using namespace DdsHelper;
+
+    namespace
+    {
+        const uint32_t kDdsMagicNumber = 0x20534444;
+        const uint32_t kDx10FourCC = 0x30315844;    // 'DX10'
+        const uint32_t kBakedTag = 0x4b414246;      // 'FBAK'
+        const uint32_t kBakedVersion = 2;
+        const uint32_t kTopDownFlag = 0x1;
+        const uint32_t kCompressFlag = 0x2;     // Set if the file was baked with Flags::Compress, even if the format couldn't be compressed
+
+        // Baked files are identified using the reserved words of the DDS header
+        enum ReservedWord
+        {
+            kTagWord,
+            kVersionWord,
+            kFlagsWord,
+            kTimeLowWord,
+            kTimeHighWord,
+            kSizeLowWord,
+            kSizeHighWord,
+        };
+
+        struct BakedHeader
+        {
+            uint32_t magic;
+            DdsHeader header;
+            DdsHeaderDX10 dx10Header;
+        };
+        static_assert(sizeof(BakedHeader) == 148, "Unexpected DDS header size");
+
+        struct BakedFormat
+        {
+            ResourceFormat format;
+            DXGI_FORMAT dxgiFormat;
+        };
+
+        // The formats which can be stored in baked files
+        const BakedFormat kBakedFormats[] =
+        {
+            {ResourceFormat::BGRA8Unorm,        DXGI_FORMAT_B8G8R8A8_UNORM},
+            {ResourceFormat::BGRA8UnormSrgb,    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB},
+            {ResourceFormat::BGRX8Unorm,        DXGI_FORMAT_B8G8R8X8_UNORM},
+            {ResourceFormat::BGRX8UnormSrgb,    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB},
+            {ResourceFormat::RG8Unorm,          DXGI_FORMAT_R8G8_UNORM},
+            {ResourceFormat::R8Unorm,           DXGI_FORMAT_R8_UNORM},
+            {ResourceFormat::RGBA16Float,       DXGI_FORMAT_R16G16B16A16_FLOAT},
+            {ResourceFormat::RGBA32Float,       DXGI_FORMAT_R32G32B32A32_FLOAT},
+            {ResourceFormat::RGB32Float,        DXGI_FORMAT_R32G32B32_FLOAT},
+            {ResourceFormat::BC1Unorm,          DXGI_FORMAT_BC1_UNORM},
+            {ResourceFormat::BC1UnormSrgb,      DXGI_FORMAT_BC1_UNORM_SRGB},
+            {ResourceFormat::BC3Unorm,          DXGI_FORMAT_BC3_UNORM},
+            {ResourceFormat::BC3UnormSrgb,      DXGI_FORMAT_BC3_UNORM_SRGB},
+        };
+
+        std::atomic<bool> sLoadingEnabled(true);
+
+        DXGI_FORMAT getBakedDxgiFormat(ResourceFormat format)
+        {
+            for(const auto& f : kBakedFormats)
+            {
+                if(f.format == format) return f.dxgiFormat;
+            }
+            return DXGI_FORMAT_UNKNOWN;
+        }
+
+        ResourceFormat getBakedResourceFormat(DXGI_FORMAT dxgiFormat)
+        {
+            for(const auto& f : kBakedFormats)
+            {
+                if(f.dxgiFormat == dxgiFormat) return f.format;
+            }
+            return ResourceFormat::Unknown;
+        }
+
+        uint32_t getMipCount(uint32_t width, uint32_t height)
+        {
+            uint32_t count = 1;
+            while((width | height) >> count)
+            {
+                count++;
+            }
+            return count;
+        }
+
+        size_t getMipSize(ResourceFormat format, uint32_t width, uint32_t height, uint32_t mip)
+        {
+            uint32_t mipWidth = std::max(1u, width >> mip);
+            uint32_t mipHeight = std::max(1u, height >> mip);
+            uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+            uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+            return (size_t)((mipWidth + blockWidth - 1) / blockWidth) * ((mipHeight + blockHeight - 1) / blockHeight) * getFormatBytesPerBlock(format);
+        }
+
+        uint32_t getBakedFlags(TextureBaker::Flags flags)
+        {
+            return (kTopDown ? kTopDownFlag : 0) | (is_set(flags, TextureBaker::Flags::Compress) ? kCompressFlag : 0);
+        }
+
+        // Only the bits in flagsMask have to match the baked flags
+        bool isHeaderValid(const BakedHeader& header, const std::string& sourcePath, uint64_t fileSize, uint32_t flags, uint32_t flagsMask)
+        {
+            const DdsHeader& dds = header.header;
+            if(fileSize < sizeof(BakedHeader) || header.magic != kDdsMagicNumber || dds.pixelFormat.fourCC != kDx10FourCC)
+            {
+                return false;
+            }
+            if(dds.reserved[kTagWord] != kBakedTag || dds.reserved[kVersionWord] != kBakedVersion || (dds.reserved[kFlagsWord] & flagsMask) != (flags & flagsMask))
+            {
+                return false;
+            }
+
+            // The source must not have changed since it was baked
+            uint64_t sourceTime = (uint64_t)getFileModifiedTime(sourcePath);
+            uint64_t sourceSize = getFileSize(sourcePath);
+            if(dds.reserved[kTimeLowWord] != (uint32_t)sourceTime || dds.reserved[kTimeHighWord] != (uint32_t)(sourceTime >> 32) ||
+                dds.reserved[kSizeLowWord] != (uint32_t)sourceSize || dds.reserved[kSizeHighWord] != (uint32_t)(sourceSize >> 32))
+            {
+                return false;
+            }
+
+            ResourceFormat format = getBakedResourceFormat(header.dx10Header.dxgiFormat);
+            if(format == ResourceFormat::Unknown || header.dx10Header.resourceDimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D || header.dx10Header.arraySize != 1 ||
+                dds.width == 0 || dds.height == 0 || dds.mipCount != getMipCount(dds.width, dds.height))
+            {
+                return false;
+            }
+
+            // Protect against truncated files
+            uint64_t dataSize = 0;
+            for(uint32_t mip = 0; mip < dds.mipCount; mip++)
+            {
+                dataSize += getMipSize(format, dds.width, dds.height, mip);
+            }
+            return fileSize >= sizeof(BakedHeader) + dataSize;
+        }
+
+        bool isBakedFileValid(const std::string& bakedFile, const std::string& sourcePath, uint32_t flags, uint32_t flagsMask)
+        {
+            if(doesFileExist(bakedFile) == false)
+            {
+                return false;
+            }
+
+            BakedHeader header;
+            BinaryFileStream stream(bakedFile, BinaryFileStream::Mode::Read);
+            stream >> header;
+            return stream.isFail() == false && isHeaderValid(header, sourcePath, getFileSize(bakedFile), flags, flagsMask);
+        }
+
+        // Image data in linear space, used to generate the mip-chain
+        struct FloatImage
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t channels = 0;
+            std::vector<float> texels;
+        };
+
+        FloatImage decodeImage(const Bitmap* pBitmap, bool isSrgb)
+        {
+            FloatImage image;
+            image.width = pBitmap->getWidth();
+            image.height = pBitmap->getHeight();
+            const size_t texelCount = (size_t)image.width * image.height;
+            const uint8_t* pData = pBitmap->getData();
+
+            switch(pBitmap->getFormat())
+            {
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+            case ResourceFormat::RG8Unorm:
+            case ResourceFormat::R8Unorm:
+                image.channels = getFormatBytesPerBlock(pBitmap->getFormat());
+                image.texels.resize(texelCount * image.channels);
+                for(size_t i = 0; i < image.texels.size(); i++)
+                {
+                    // Alpha is always linear
+                    float value = pData[i] / 255.0f;
+                    image.texels[i] = (isSrgb && (i % image.channels) < 3) ? SRGBToLinear(value) : value;
+                }
+                break;
+            case ResourceFormat::RGBA16Float:
+                image.channels = 4;
+                image.texels.resize(texelCount * image.channels);
+                for(size_t i = 0; i < image.texels.size(); i++)
+                {
+                    image.texels[i] = glm::unpackHalf1x16(((const uint16_t*)pData)[i]);
+                }
+                break;
+            case ResourceFormat::RGBA32Float:
+            case ResourceFormat::RGB32Float:
+                image.channels = getFormatBytesPerBlock(pBitmap->getFormat()) / sizeof(float);
+                image.texels.assign((const float*)pData, (const float*)pData + texelCount * image.channels);
+                break;
+            default:
+                should_not_get_here();
+            }
+            return image;
+        }
+
+        void encodeImage(const FloatImage& image, ResourceFormat format, std::vector<uint8_t>& data)
+        {
+            const bool isSrgb = isSrgbFormat(format);
+            const size_t offset = data.size();
+            const size_t count = image.texels.size();
+
+            switch(srgbToLinearFormat(format))
+            {
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+            case ResourceFormat::RG8Unorm:
+            case ResourceFormat::R8Unorm:
+                data.resize(offset + count);
+                for(size_t i = 0; i < count; i++)
+                {
+                    float value = image.texels[i];
+                    value = (isSrgb && (i % image.channels) < 3) ? LinearToSRGB(value) : value;
+                    data[offset + i] = (uint8_t)(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+                break;
+            case ResourceFormat::RGBA16Float:
+                data.resize(offset + count * sizeof(uint16_t));
+                for(size_t i = 0; i < count; i++)
+                {
+                    ((uint16_t*)(data.data() + offset))[i] = glm::packHalf1x16(image.texels[i]);
+                }
+                break;
+            case ResourceFormat::RGBA32Float:
+            case ResourceFormat::RGB32Float:
+                data.resize(offset + count * sizeof(float));
+                memcpy(data.data() + offset, image.texels.data(), count * sizeof(float));
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+
+        // 2x2 box filter. The last row/column of odd-sized images is clamped
+        FloatImage downsample(const FloatImage& src)
+        {
+            FloatImage dst;
+            dst.width = std::max(1u, src.width / 2);
+            dst.height = std::max(1u, src.height / 2);
+            dst.channels = src.channels;
+            dst.texels.resize((size_t)dst.width * dst.height * dst.channels);
+
+            for(uint32_t y = 0; y < dst.height; y++)
+            {
+                const uint32_t y0 = std::min(2 * y, src.height - 1);
+                const uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+                for(uint32_t x = 0; x < dst.width; x++)
+                {
+                    const uint32_t x0 = std::min(2 * x, src.width - 1);
+                    const uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+                    for(uint32_t c = 0; c < dst.channels; c++)
+                    {
+                        auto texel = [&](uint32_t tx, uint32_t ty) { return src.texels[((size_t)ty * src.width + tx) * src.channels + c]; };
+                        dst.texels[((size_t)y * dst.width + x) * dst.channels + c] = 0.25f * (texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1));
+                    }
+                }
+            }
+            return dst;
+        }
+
+        uint16_t packRgb565(const int bgr[3])
+        {
+            return (uint16_t)(((bgr[2] >> 3) << 11) | ((bgr[1] >> 2) << 5) | (bgr[0] >> 3));
+        }
+
+        void unpackRgb565(uint16_t color, int bgr[3])
+        {
+            int r = (color >> 11) & 0x1f;
+            int g = (color >> 5) & 0x3f;
+            int b = color & 0x1f;
+            bgr[0] = (b << 3) | (b >> 2);
+            bgr[1] = (g << 2) | (g >> 4);
+            bgr[2] = (r << 3) | (r >> 2);
+        }
+
+        // BC1 color block using a range fit - the endpoints are the corners of the block's bounding box, inset to reduce the error at the ends of the range
+        void compressColorBlock(const uint8_t texels[16][4], uint8_t* pBlock)
+        {
+            int minColor[3] = { 255, 255, 255 };
+            int maxColor[3] = { 0, 0, 0 };
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    minColor[c] = std::min(minColor[c], (int)texels[i][c]);
+                    maxColor[c] = std::max(maxColor[c], (int)texels[i][c]);
+                }
+            }
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                int inset = (maxColor[c] - minColor[c]) >> 4;
+                minColor[c] += inset;
+                maxColor[c] -= inset;
+            }
+
+            // The first endpoint must be larger, otherwise the block is decoded using the 3-color mode
+            uint16_t endpoints[2] = { packRgb565(maxColor), packRgb565(minColor) };
+            if(endpoints[0] < endpoints[1])
+            {
+                std::swap(endpoints[0], endpoints[1]);
+            }
+
+            uint32_t indices = 0;
+            if(endpoints[0] != endpoints[1])
+            {
+                int palette[4][3];
+                unpackRgb565(endpoints[0], palette[0]);
+                unpackRgb565(endpoints[1], palette[1]);
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t bestIndex = 0;
+                    int bestDistance = INT_MAX;
+                    for(uint32_t p = 0; p < 4; p++)
+                    {
+                        int distance = 0;
+                        for(uint32_t c = 0; c < 3; c++)
+                        {
+                            int d = (int)texels[i][c] - palette[p][c];
+                            distance += d * d;
+                        }
+                        if(distance < bestDistance)
+                        {
+                            bestDistance = distance;
+                            bestIndex = p;
+                        }
+                    }
+                    indices |= bestIndex << (2 * i);
+                }
+            }
+
+            memcpy(pBlock, endpoints, sizeof(endpoints));
+            memcpy(pBlock + sizeof(endpoints), &indices, sizeof(indices));
+        }
+
+        // BC3 alpha block, using the 8-alpha mode
+        void compressAlphaBlock(const uint8_t texels[16][4], uint8_t* pBlock)
+        {
+            int maxAlpha = 0;
+            int minAlpha = 255;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                maxAlpha = std::max(maxAlpha, (int)texels[i][3]);
+                minAlpha = std::min(minAlpha, (int)texels[i][3]);
+            }
+
+            uint64_t indices = 0;
+            if(maxAlpha > minAlpha)
+            {
+                int palette[8] = { maxAlpha, minAlpha };
+                for(int p = 1; p < 7; p++)
+                {
+                    palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+                }
+
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    uint64_t bestIndex = 0;
+                    int bestDistance = INT_MAX;
+                    for(uint32_t p = 0; p < 8; p++)
+                    {
+                        int distance = abs((int)texels[i][3] - palette[p]);
+                        if(distance < bestDistance)
+                        {
+                            bestDistance = distance;
+                            bestIndex = p;
+                        }
+                    }
+                    indices |= bestIndex << (3 * i);
+                }
+            }
+
+            pBlock[0] = (uint8_t)maxAlpha;
+            pBlock[1] = (uint8_t)minAlpha;
+            memcpy(pBlock + 2, &indices, 6);
+        }
+
+        void compressImage(const uint8_t* pBgra, uint32_t width, uint32_t height, bool hasAlpha, std::vector<uint8_t>& data)
+        {
+            const uint32_t blockSize = hasAlpha ? 16 : 8;
+            const uint32_t widthInBlocks = (width + 3) / 4;
+            const uint32_t heightInBlocks = (height + 3) / 4;
+            size_t offset = data.size();
+            data.resize(offset + (size_t)widthInBlocks * heightInBlocks * blockSize);
+
+            for(uint32_t by = 0; by < heightInBlocks; by++)
+            {
+                for(uint32_t bx = 0; bx < widthInBlocks; bx++)
+                {
+                    // Mip-levels which are smaller than a block are padded by clamping
+                    uint8_t texels[16][4];
+                    for(uint32_t i = 0; i < 16; i++)
+                    {
+                        uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+                        uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+                        memcpy(texels[i], pBgra + ((size_t)y * width + x) * 4, 4);
+                    }
+
+                    uint8_t* pBlock = data.data() + offset;
+                    if(hasAlpha)
+                    {
+                        compressAlphaBlock(texels, pBlock);
+                        pBlock += 8;
+                    }
+                    compressColorBlock(texels, pBlock);
+                    offset += blockSize;
+                }
+            }
+        }
+
+        void collectMaterialTextures(const Material* pMaterial, std::set<const Texture*>& textures)
+        {
+            for(uint32_t i = 0; i < pMaterial->getNumLayers(); i++)
+            {
+                textures.insert(pMaterial->getLayer(i).pTexture.get());
+            }
+            textures.insert(pMaterial->getNormalMap().get());
+            textures.insert(pMaterial->getAlphaMap().get());
+            textures.insert(pMaterial->getAmbientOcclusionMap().get());
+            textures.insert(pMaterial->getHeightMap().get());
+        }
+    }
+
+    void TextureBaker::setEnabled(bool enabled)
+    {
+        sLoadingEnabled = enabled;
+    }
+
+    bool TextureBaker::isEnabled()
+    {
+        return sLoadingEnabled;
+    }
+
+    std::string TextureBaker::getBakedFilename(const std::string& fullpath, bool loadAsSrgb)
+    {
+        return fullpath + (loadAsSrgb ? ".baked_srgb.dds" : ".baked.dds");
+    }
+
+    bool TextureBaker::hasBakedFile(const std::string& filename, bool loadAsSrgb)
+    {
+        std::string fullpath;
+        if(isEnabled() == false || findFileInDataDirectories(filename, fullpath) == false)
+        {
+            return false;
+        }
+        // Any compression mode can be loaded
+        return isBakedFileValid(getBakedFilename(fullpath, loadAsSrgb), fullpath, getBakedFlags(Flags::None), kTopDownFlag);
+    }
+
+    bool TextureBaker::hasBakedFile(const std::string& filename, bool loadAsSrgb, Flags flags)
+    {
+        std::string fullpath;
+        if(isEnabled() == false || findFileInDataDirectories(filename, fullpath) == false)
+        {
+            return false;
+        }
+        return isBakedFileValid(getBakedFilename(fullpath, loadAsSrgb), fullpath, getBakedFlags(flags), kTopDownFlag | kCompressFlag);
+    }
+
+    bool TextureBaker::bakeTexture(const std::string& filename, bool loadAsSrgb, Flags flags, bool* pWritten)
+    {
+        if(pWritten)
+        {
+            *pWritten = false;
+        }
+
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError("Can't find texture file " + filename);
+            return false;
+        }
+
+        const std::string bakedFile = getBakedFilename(fullpath, loadAsSrgb);
+        // A file which was baked with a different compression mode is rebaked
+        if(isBakedFileValid(bakedFile, fullpath, getBakedFlags(flags), kTopDownFlag | kCompressFlag))
+        {
+            return true;
+        }
+
+        Bitmap::UniqueConstPtr pBitmap = loadBitmapForTexture(fullpath);
+        if(pBitmap == nullptr)
+        {
+            return false;
+        }
+
+        const uint32_t width = pBitmap->getWidth();
+        const uint32_t height = pBitmap->getHeight();
+        const ResourceFormat format = loadAsSrgb ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat();
+        if(getBakedDxgiFormat(format) == DXGI_FORMAT_UNKNOWN)
+        {
+            logWarning("Can't bake " + filename + ". The image format is not supported.");
+            return false;
+        }
+
+        // Block-compress 8-bit color images. D3D requires the dimensions of the top level to be a multiple of the block size
+        ResourceFormat bakedFormat = format;
+        const ResourceFormat linearFormat = srgbToLinearFormat(format);
+        const bool compress = is_set(flags, Flags::Compress) && (linearFormat == ResourceFormat::BGRA8Unorm || linearFormat == ResourceFormat::BGRX8Unorm) && (width % 4 == 0) && (height % 4 == 0);
+        bool hasAlpha = false;
+        if(compress)
+        {
+            if(linearFormat == ResourceFormat::BGRA8Unorm)
+            {
+                const uint8_t* pData = pBitmap->getData();
+                for(size_t i = 3; i < (size_t)width * height * 4 && hasAlpha == false; i += 4)
+                {
+                    hasAlpha = (pData[i] != 0xff);
+                }
+            }
+            bakedFormat = hasAlpha ? ResourceFormat::BC3Unorm : ResourceFormat::BC1Unorm;
+            bakedFormat = isSrgbFormat(format) ? linearToSrgbFormat(bakedFormat) : bakedFormat;
+        }
+
+        const uint32_t mipCount = getMipCount(width, height);
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> mipData;
+        FloatImage image;
+        for(uint32_t mip = 0; mip < mipCount; mip++)
+        {
+            // The top level is stored as-is, the rest of the chain is filtered in linear space
+            mipData.clear();
+            if(mip == 0)
+            {
+                mipData.assign(pBitmap->getData(), pBitmap->getData() + getMipSize(format, width, height, 0));
+            }
+            else
+            {
+                image = (mip == 1) ? downsample(decodeImage(pBitmap.get(), isSrgbFormat(format))) : downsample(image);
+                encodeImage(image, format, mipData);
+            }
+
+            if(compress)
+            {
+                compressImage(mipData.data(), std::max(1u, width >> mip), std::max(1u, height >> mip), hasAlpha, data);
+            }
+            else
+            {
+                data.insert(data.end(), mipData.begin(), mipData.end());
+            }
+        }
+
+        BakedHeader header = {};
+        header.magic = kDdsMagicNumber;
+
+        DdsHeader& dds = header.header;
+        dds.headerSize = sizeof(DdsHeader);
+        dds.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask;
+        dds.flags |= isCompressedFormat(bakedFormat) ? DdsHeader::kLinearSizeMask : DdsHeader::kPitchMask;
+        dds.width = width;
+        dds.height = height;
+        dds.pitch = isCompressedFormat(bakedFormat) ? (uint32_t)getMipSize(bakedFormat, width, height, 0) : width * getFormatBytesPerBlock(bakedFormat);
+        dds.mipCount = mipCount;
+        dds.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+        dds.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+        dds.pixelFormat.fourCC = kDx10FourCC;
+        dds.caps[0] = DdsHeader::kCapsTextureMask | ((mipCount > 1) ? (DdsHeader::kCapsComplexMask | DdsHeader::kCapsMipMapMask) : 0);
+
+        const uint64_t sourceTime = (uint64_t)getFileModifiedTime(fullpath);
+        const uint64_t sourceSize = getFileSize(fullpath);
+        dds.reserved[kTagWord] = kBakedTag;
+        dds.reserved[kVersionWord] = kBakedVersion;
+        dds.reserved[kFlagsWord] = getBakedFlags(flags);
+        dds.reserved[kTimeLowWord] = (uint32_t)sourceTime;
+        dds.reserved[kTimeHighWord] = (uint32_t)(sourceTime >> 32);
+        dds.reserved[kSizeLowWord] = (uint32_t)sourceSize;
+        dds.reserved[kSizeHighWord] = (uint32_t)(sourceSize >> 32);
+
+        header.dx10Header.dxgiFormat = getBakedDxgiFormat(bakedFormat);
+        header.dx10Header.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        header.dx10Header.arraySize = 1;
+
+        BinaryFileStream stream(bakedFile, BinaryFileStream::Mode::Write);
+        stream << header;
+        stream.write(data.data(), data.size());
+        if(stream.isFail())
+        {
+            stream.remove();
+            logError("Can't write the baked texture file " + bakedFile);
+            return false;
+        }
+
+        if(pWritten)
+        {
+            *pWritten = true;
+        }
+        return true;
+    }
+
+    std::vector<std::string> TextureBaker::bakeModel(const Model* pModel, Flags flags)
+    {
+        // Many meshes share the same materials and textures
+        std::set<const Texture*> textures;
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            const Material* pMaterial = pModel->getMesh(i)->getMaterial().get();
+            if(pMaterial)
+            {
+                collectMaterialTextures(pMaterial, textures);
+            }
+        }
+
+        std::vector<std::string> bakedFiles;
+        for(const Texture* pTexture : textures)
+        {
+            // Textures without a source file were embedded in the model file
+            std::string fullpath;
+            if(pTexture == nullptr || hasSuffix(pTexture->getSourceFilename(), ".dds", false) || findFileInDataDirectories(pTexture->getSourceFilename(), fullpath) == false)
+            {
+                continue;
+            }
+
+            bool loadAsSrgb = isSrgbFormat(pTexture->getFormat());
+            bool written = false;
+            if(bakeTexture(fullpath, loadAsSrgb, flags, &written) && written)
+            {
+                bakedFiles.push_back(getBakedFilename(fullpath, loadAsSrgb));
+            }
+        }
+        return bakedFiles;
+    }
+
+    std::vector<std::string> TextureBaker::bakeScene(const Scene* pScene, Flags flags)
+    {
+        std::vector<std::string> bakedFiles;
+        for(uint32_t i = 0; i < pScene->getModelCount(); i++)
+        {
+            std::vector<std::string> modelFiles = bakeModel(pScene->getModel(i).get(), flags);
+            bakedFiles.insert(bakedFiles.end(), modelFiles.begin(), modelFiles.end());
+        }
+        return bakedFiles;
+    }
+
+    Texture::SharedPtr TextureBaker::loadBakedTexture(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        std::string fullpath;
+        if(isEnabled() == false || findFileInDataDirectories(filename, fullpath) == false)
+        {
+            return nullptr;
+        }
+
+        const std::string bakedFile = getBakedFilename(fullpath, loadAsSrgb);
+        if(doesFileExist(bakedFile) == false)
+        {
+            return nullptr;
+        }
+
+        // The texture is uploaded directly from the mapped file
+        size_t size = 0;
+        const uint8_t* pFile = (const uint8_t*)mapFileToMemory(bakedFile, size);
+        if(pFile == nullptr)
+        {
+            return nullptr;
+        }
+
+        Texture::SharedPtr pTexture;
+        const BakedHeader* pHeader = (const BakedHeader*)pFile;
+        if(size >= sizeof(BakedHeader) && isHeaderValid(*pHeader, fullpath, size, getBakedFlags(Flags::None), kTopDownFlag))
+        {
+            const DdsHeader& dds = pHeader->header;
+            ResourceFormat format = getBakedResourceFormat(pHeader->dx10Header.dxgiFormat);
+            pTexture = Texture::create2D(dds.width, dds.height, format, 1, generateMipLevels ? dds.mipCount : 1, pFile + sizeof(BakedHeader), bindFlags);
+            if(pTexture)
+            {
+                pTexture->setSourceFilename(stripDataDirectories(filename));
+            }
+        }
+
+        unmapFileFromMemory(pFile);
+        return pTexture;
+    }
+}
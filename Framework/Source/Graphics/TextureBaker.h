@@ -0,0 +1,109 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "API/Texture.h"
+
+namespace Falcor
+{
+    class Model;
+    class Scene;
+
+    /** Offline texture preprocessing.\n
+        Baking converts an image file into a GPU-ready file which is stored next to the source. The baked file contains the data in the layout the API expects, including the full mip-chain, and can optionally be block-compressed.
+        Loading a baked file is a single read straight into the texture upload - no image decoding, no flipping and no mip generation.\n
+        Baked files are DDS files with a DX10 header, so they can be inspected using standard tools. Each file records the timestamp and size of its source, and is ignored once the source changes. It also records whether it was baked with Flags::Compress, so switching the mode rebakes it.
+    */
+    class TextureBaker
+    {
+    public:
+        enum class Flags : uint32_t
+        {
+            None        = 0x0,
+            Compress    = 0x1,      ///< Block-compress 8-bit color textures. Opaque textures use BC1, textures with alpha use BC3. Textures whose dimensions aren't a multiple of 4 are stored uncompressed
+        };
+
+        /** Enable or disable loading baked files. Enabled by default
+        */
+        static void setEnabled(bool enabled);
+
+        /** Check if loading baked files is enabled
+        */
+        static bool isEnabled();
+
+        /** Get the name of the baked file of a texture
+            \param[in] fullpath The full path of the source image
+            \param[in] loadAsSrgb Whether the texture is loaded using an sRGB format. Each color space has its own baked file
+        */
+        static std::string getBakedFilename(const std::string& fullpath, bool loadAsSrgb);
+
+        /** Check if a texture has a baked file which is up-to-date with its source
+            \param[in] filename The source image. Relative paths are resolved using the data directories
+            \param[in] loadAsSrgb Whether the texture is loaded using an sRGB format
+        */
+        static bool hasBakedFile(const std::string& filename, bool loadAsSrgb);
+
+        /** Check if a texture has a baked file which is up-to-date with its source and was baked using the same compression mode
+            \param[in] filename The source image. Relative paths are resolved using the data directories
+            \param[in] loadAsSrgb Whether the texture is loaded using an sRGB format
+            \param[in] flags The baking flags the file is expected to use
+        */
+        static bool hasBakedFile(const std::string& filename, bool loadAsSrgb, Flags flags);
+
+        /** Bake an image file. Does nothing if the baked file is already up-to-date and was baked using the same compression mode
+            \param[in] filename The source image. Relative paths are resolved using the data directories
+            \param[in] loadAsSrgb Whether the texture is loaded using an sRGB format
+            \param[in] flags Baking flags
+            \param[out] pWritten Optional. Set to true if a new baked file was written
+            \return true if the texture has an up-to-date baked file, otherwise false
+        */
+        static bool bakeTexture(const std::string& filename, bool loadAsSrgb, Flags flags = Flags::None, bool* pWritten = nullptr);
+
+        /** Bake the textures which are used by the materials of a model. Embedded textures and DDS files are skipped
+            \return The baked files which were written
+        */
+        static std::vector<std::string> bakeModel(const Model* pModel, Flags flags = Flags::None);
+
+        /** Bake the textures which are used by the models of a scene. Embedded textures and DDS files are skipped
+            \return The baked files which were written
+        */
+        static std::vector<std::string> bakeScene(const Scene* pScene, Flags flags = Flags::None);
+
+        /** Create a texture from the baked file of an image
+            \param[in] filename The source image. Relative paths are resolved using the data directories
+            \param[in] generateMipLevels Whether to create the full mip-chain. The mip-levels are read from the baked file
+            \param[in] loadAsSrgb Whether to load the texture using an sRGB format
+            \param[in] bindFlags The bind flags for the texture
+            \return A new texture, or nullptr if loading is disabled or the image doesn't have an up-to-date baked file
+        */
+        static Texture::SharedPtr loadBakedTexture(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+    };
+
+    enum_class_operators(TextureBaker::Flags);
+}
@@ -0,0 +1,200 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCache.h"
+#include "Utils/OS.h"
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct CacheData
+        {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+            TextureCache::Stats stats;
+            bool enabled = true;
+        };
+
+        CacheData& getCacheData()
+        {
+            static CacheData data;
+            return data;
+        }
+
+        std::string getFileKey(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+        {
+            std::string fullpath;
+            if(findFileInDataDirectories(filename, fullpath) == false)
+            {
+                fullpath = canonicalizeFilename(filename);
+            }
+
+            // Windows paths are case-insensitive
+            std::transform(fullpath.begin(), fullpath.end(), fullpath.begin(), ::tolower);
+            return "file:" + fullpath + '|' + (generateMipLevels ? '1' : '0') + (loadAsSrgb ? '1' : '0') + std::to_string((uint32_t)bindFlags);
+        }
+
+        std::string getImageKey(uint64_t hash, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels)
+        {
+            return "image:" + std::to_string(hash) + '|' + std::to_string(width) + 'x' + std::to_string(height) + '|' + std::to_string((uint32_t)format) + '|' + std::to_string(mipLevels);
+        }
+
+        Texture::SharedPtr find(const std::string& key)
+        {
+            CacheData& data = getCacheData();
+            std::lock_guard<std::mutex> lock(data.mutex);
+            Texture::SharedPtr pTexture;
+            auto it = data.textures.find(key);
+            if(it != data.textures.end())
+            {
+                pTexture = it->second.lock();
+                if(pTexture == nullptr)
+                {
+                    data.textures.erase(it);
+                }
+            }
+
+            if(pTexture)
+            {
+                data.stats.hitCount++;
+                data.stats.savedBytes += pTexture->getDataSize();
+            }
+            else
+            {
+                data.stats.missCount++;
+            }
+            return pTexture;
+        }
+
+        void add(const std::string& key, const Texture::SharedPtr& pTexture)
+        {
+            CacheData& data = getCacheData();
+            std::lock_guard<std::mutex> lock(data.mutex);
+            data.textures[key] = pTexture;
+
+            // Drop the entries of released textures once in a while, so the map doesn't grow forever
+            if((data.textures.size() & 0xff) == 0)
+            {
+                for(auto it = data.textures.begin(); it != data.textures.end();)
+                {
+                    it = it->second.expired() ? data.textures.erase(it) : std::next(it);
+                }
+            }
+        }
+    }
+
+    void TextureCache::setEnabled(bool enabled)
+    {
+        CacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.enabled = enabled;
+        if(enabled == false)
+        {
+            data.textures.clear();
+        }
+    }
+
+    bool TextureCache::isEnabled()
+    {
+        CacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        return data.enabled;
+    }
+
+    Texture::SharedPtr TextureCache::findFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        return isEnabled() ? find(getFileKey(filename, generateMipLevels, loadAsSrgb, bindFlags)) : nullptr;
+    }
+
+    void TextureCache::addFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const Texture::SharedPtr& pTexture)
+    {
+        if(pTexture && isEnabled())
+        {
+            add(getFileKey(filename, generateMipLevels, loadAsSrgb, bindFlags), pTexture);
+        }
+    }
+
+    uint64_t TextureCache::hashImage(const void* pData, size_t size)
+    {
+        // Images are large, so the data is hashed 8 bytes at a time
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t hash = 0xcbf29ce484222325ull ^ size;
+        size_t i = 0;
+        for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, pBytes + i, sizeof(word));
+            hash = (hash ^ word) * 0x100000001b3ull;
+            hash ^= hash >> 29;
+        }
+        for(; i < size; i++)
+        {
+            hash = (hash ^ pBytes[i]) * 0x100000001b3ull;
+        }
+
+        // Final mix, so that every input bit affects every output bit
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    Texture::SharedPtr TextureCache::findImage(uint64_t hash, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels)
+    {
+        return isEnabled() ? find(getImageKey(hash, width, height, format, mipLevels)) : nullptr;
+    }
+
+    void TextureCache::addImage(uint64_t hash, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels, const Texture::SharedPtr& pTexture)
+    {
+        if(pTexture && isEnabled())
+        {
+            add(getImageKey(hash, width, height, format, mipLevels), pTexture);
+        }
+    }
+
+    TextureCache::Stats TextureCache::getStats()
+    {
+        CacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        return data.stats;
+    }
+
+    void TextureCache::resetStats()
+    {
+        CacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.stats = TextureCache::Stats();
+    }
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "API/Texture.h"
+
+namespace Falcor
+{
+    /** Process-wide registry of the textures created from files and from image data embedded in model files.\n
+        Textures are registered using weak references. A texture is shared as long as someone holds it, and released as usual once the last user releases it.
+        File textures are keyed by their canonical path and creation flags. Embedded images are keyed by a hash of their content, so identical images in different models share a texture.\n
+        All functions are thread-safe.
+    */
+    class TextureCache
+    {
+    public:
+        /** Cache statistics
+        */
+        struct Stats
+        {
+            uint32_t hitCount = 0;      ///< Number of lookups which returned an existing texture
+            uint32_t missCount = 0;     ///< Number of lookups which didn't find a texture
+            uint64_t savedBytes = 0;    ///< Texture memory which wasn't allocated thanks to cache hits
+        };
+
+        /** Enable or disable the cache. When disabled, lookups always fail and nothing is registered. The cache is enabled by default
+        */
+        static void setEnabled(bool enabled);
+
+        /** Check if the cache is enabled
+        */
+        static bool isEnabled();
+
+        /** Find a texture which was created from a file
+            \param[in] filename The file. Relative paths are resolved using the data directories
+            \param[in] generateMipLevels Whether the texture has a full mip-chain
+            \param[in] loadAsSrgb Whether the texture was created using an sRGB format
+            \param[in] bindFlags The bind flags of the texture
+            \return The texture, or nullptr if it isn't in the cache
+        */
+        static Texture::SharedPtr findFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags);
+
+        /** Register a texture which was created from a file. The parameters are the same as findFile()
+        */
+        static void addFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const Texture::SharedPtr& pTexture);
+
+        /** Hash image data. The result is used as the key of textures which are created from memory
+        */
+        static uint64_t hashImage(const void* pData, size_t size);
+
+        /** Find a texture which was created from image data
+            \param[in] hash The hash of the image data, created by hashImage()
+            \param[in] width The width of the image
+            \param[in] height The height of the image
+            \param[in] format The format of the texture
+            \param[in] mipLevels The requested number of mip-levels
+            \return The texture, or nullptr if it isn't in the cache
+        */
+        static Texture::SharedPtr findImage(uint64_t hash, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels);
+
+        /** Register a texture which was created from image data. The parameters are the same as findImage()
+        */
+        static void addImage(uint64_t hash, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels, const Texture::SharedPtr& pTexture);
+
+        /** Get the statistics since the application started or the last call to resetStats()
+        */
+        static Stats getStats();
+
+        /** Reset the statistics
+        */
+        static void resetStats();
+    };
+}
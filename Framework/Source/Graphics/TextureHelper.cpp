@@ -27,6 +27,8 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "TextureHelper.h"
+#include "TextureCache.h"
+#include "TextureBaker.h"
 #include "API/Texture.h"
 #include "Utils/Bitmap.h"
 #include "Utils/DDSHeader.h"
@@ -639,8 +641,207 @@ namespace Falcor
         return nullptr;
     }
 
-	Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, Texture::BindFlags bindFlags)
+#ifdef FALCOR_LOW_LEVEL_API
+    // Size of a single subresource inside a DDS file
+    struct DdsSubresourceLayout
+    {
+        size_t rowPitch;
+        uint32_t rowCount;
+        size_t slicePitch;
+        size_t size;
+    };
+
+    DdsSubresourceLayout getDdsSubresourceLayout(ResourceFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevel)
+    {
+        uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+        uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+
+        DdsSubresourceLayout layout;
+        layout.rowPitch = (size_t)((max(width >> mipLevel, 1U) + blockWidth - 1) / blockWidth) * getFormatBytesPerBlock(format);
+        layout.rowCount = (max(height >> mipLevel, 1U) + blockHeight - 1) / blockHeight;
+        layout.slicePitch = layout.rowPitch * layout.rowCount;
+        layout.size = layout.slicePitch * max(depth >> mipLevel, 1U);
+        return layout;
+    }
+
+    /** Stream a DDS file into a texture. The file is mapped and the subresources are copied one at a time straight into the upload buffer, in the destination row order.
+        Creates the same texture as the in-memory loader, without holding a copy of the file's data.
+    */
+    Texture::SharedPtr streamTextureFromDDSFile(const std::string& filename, bool generateMips, Texture::BindFlags bindFlags)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError(std::string("Can't find texture file ") + filename);
+            return nullptr;
+        }
+
+        size_t fileSize = 0;
+        const uint8_t* pFile = (const uint8_t*)mapFileToMemory(fullpath, fileSize);
+        if(pFile == nullptr)
+        {
+            logError(std::string("Can't open texture file ") + filename);
+            return nullptr;
+        }
+
+        // Read the headers
+        DdsData ddsData;
+        size_t dataOffset = sizeof(uint32_t) + sizeof(DdsHeader);
+        bool isValid = (fileSize >= dataOffset) && (*(const uint32_t*)pFile == kDdsMagicNumber);
+        if(isValid)
+        {
+            memcpy(&ddsData.header, pFile + sizeof(uint32_t), sizeof(DdsHeader));
+            ddsData.hasDX10Header = (ddsData.header.pixelFormat.flags & DdsHeader::PixelFormat::kFourCCFlag) && (makeFourCC("DX10") == ddsData.header.pixelFormat.fourCC);
+            if(ddsData.hasDX10Header)
+            {
+                isValid = fileSize >= dataOffset + sizeof(DdsHeaderDX10);
+                if(isValid)
+                {
+                    memcpy(&ddsData.dx10Header, pFile + dataOffset, sizeof(DdsHeaderDX10));
+                    dataOffset += sizeof(DdsHeaderDX10);
+                }
+            }
+        }
+
+        if(isValid == false)
+        {
+            unmapFileFromMemory(pFile);
+            logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
+            return nullptr;
+        }
+
+        ResourceFormat format = getDdsResourceFormat(ddsData);
+        assert(format != ResourceFormat::Unknown);
+
+        const DdsHeader& header = ddsData.header;
+        uint32_t fileMipCount = (header.flags & DdsHeader::kMipCountMask) ? max(header.mipCount, 1U) : 1;
+        uint32_t mipLevels = generateMips ? Texture::kMaxPossible : fileMipCount;
+
+        // Mip generation renders into the texture. The in-memory loader gets the flag from Texture::create*()
+        Texture::BindFlags createFlags = generateMips ? (bindFlags | Texture::BindFlags::RenderTarget) : bindFlags;
+
+        // Create the texture without data. The rows are flipped wherever the in-memory loader calls flipData()
+        Texture::SharedPtr pTexture;
+        uint32_t depth = 1;
+        uint32_t sliceCount = 1;
+        bool isCubemap = false;
+        bool flip = true;
+        if(ddsData.hasDX10Header)
+        {
+            sliceCount = ddsData.dx10Header.arraySize;
+            assert(sliceCount > 0);
+            switch(ddsData.dx10Header.resourceDimension)
+            {
+            case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE1D:
+                flip = false;
+                pTexture = Texture::create1D(header.width, format, sliceCount, mipLevels, nullptr, createFlags);
+                break;
+            case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE2D:
+                if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
+                {
+                    isCubemap = true;
+                    pTexture = Texture::createCube(header.width, header.height, format, sliceCount, mipLevels, nullptr, createFlags);
+                    sliceCount *= 6;
+                }
+                else
+                {
+                    pTexture = Texture::create2D(header.width, header.height, format, sliceCount, mipLevels, nullptr, createFlags);
+                }
+                break;
+            case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE3D:
+                depth = header.depth;
+                pTexture = Texture::create3D(header.width, header.height, header.depth, format, mipLevels, nullptr, createFlags);
+                break;
+            default:
+                logError(std::string("the resource dimension specified in ") + filename + std::string(" is not supported by Falcor"));
+                break;
+            }
+        }
+        else if(header.flags & DdsHeader::kDepthMask)
+        {
+            depth = header.depth;
+            pTexture = Texture::create3D(header.width, header.height, header.depth, format, mipLevels, nullptr, createFlags);
+        }
+        else if(header.caps[1] & DdsHeader::kCaps2CubeMapMask)
+        {
+            flip = false;
+            sliceCount = 6;
+            pTexture = Texture::createCube(header.width, header.height, format, 1, mipLevels, nullptr, createFlags);
+        }
+        else
+        {
+            pTexture = Texture::create2D(header.width, header.height, format, 1, mipLevels, nullptr, createFlags);
+        }
+
+        if(pTexture)
+        {
+            const uint32_t height = (pTexture->getType() == Texture::Type::Texture1D) ? 1 : header.height;
+            const bool flipRows = flip && !kTopDown && !isCompressedFormat(format);
+            const uint8_t* pData = pFile + dataOffset;
+            const size_t dataSize = fileSize - dataOffset;
+
+            // Every slice stores its full mip-chain, followed by the next slice
+            size_t sliceSize = 0;
+            for(uint32_t mip = 0; mip < fileMipCount; mip++)
+            {
+                sliceSize += getDdsSubresourceLayout(format, header.width, height, depth, mip).size;
+            }
+
+            // When generating mips, only the top level is uploaded
+            const uint32_t uploadMipCount = generateMips ? 1 : fileMipCount;
+            auto& pRenderContext = gpDevice->getRenderContext();
+            for(uint32_t slice = 0; slice < sliceCount && pTexture; slice++)
+            {
+                // flipData() also swaps the +Y and -Y faces of cube-maps
+                uint32_t srcSlice = slice;
+                if(flipRows && isCubemap)
+                {
+                    srcSlice += (slice % 6 == 2) ? 1 : 0;
+                    srcSlice -= (slice % 6 == 3) ? 1 : 0;
+                }
+
+                size_t offset = srcSlice * sliceSize;
+                for(uint32_t mip = 0; mip < uploadMipCount; mip++)
+                {
+                    DdsSubresourceLayout layout = getDdsSubresourceLayout(format, header.width, height, depth, mip);
+                    if(offset + layout.size > dataSize)
+                    {
+                        logError(std::string("The dds file ") + filename + std::string(" is truncated"));
+                        pTexture = nullptr;
+                        break;
+                    }
+
+                    const uint8_t* pSrc = pData + offset;
+                    pRenderContext->updateTextureSubresource(pTexture.get(), pTexture->getSubresourceIndex(slice, mip), [&](uint32_t depthSlice, uint32_t row, uint8_t* pDst, size_t rowSize)
+                    {
+                        uint32_t srcRow = flipRows ? (layout.rowCount - 1 - row) : row;
+                        memcpy(pDst, pSrc + depthSlice * layout.slicePitch + srcRow * layout.rowPitch, min(rowSize, layout.rowPitch));
+                    });
+                    offset += layout.size;
+                }
+            }
+
+            if(pTexture && generateMips)
+            {
+                pTexture->generateMips();
+                pTexture->invalidateViews();
+            }
+        }
+
+        unmapFileFromMemory(pFile);
+        return pTexture;
+    }
+#endif
+
+	Texture::SharedPtr createTextureFromDDSFile(const std::string& filename, bool generateMips, Texture::BindFlags bindFlags, bool streamed)
 	{
+#ifdef FALCOR_LOW_LEVEL_API
+        if(streamed)
+        {
+            return streamTextureFromDDSFile(filename, generateMips, bindFlags);
+        }
+#endif
+
 		DdsData ddsData;
 		loadDDSDataFromFile(filename, ddsData);
 		
@@ -677,12 +878,40 @@ namespace Falcor
         logWarning("createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
     }
 			
+        // The same file is usually referenced by many models and scenes
+        Texture::SharedPtr pCached = TextureCache::findFile(filename, generateMipLevels, loadAsSrgb, bindFlags);
+        if(pCached)
+        {
+            return pCached;
+        }
+
 		if (hasSuffix(filename, ".dds"))
 		{
-			return createTextureFromDDSFile(filename, generateMipLevels, bindFlags);
+			Texture::SharedPtr pTex = createTextureFromDDSFile(filename, generateMipLevels, bindFlags);
+            TextureCache::addFile(filename, generateMipLevels, loadAsSrgb, bindFlags, pTex);
+            return pTex;
 		}
 
-        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        // An up-to-date baked file is uploaded as-is, without decoding the image or generating mips
+        Texture::SharedPtr pBaked = TextureBaker::loadBakedTexture(filename, generateMipLevels, loadAsSrgb, bindFlags);
+        if(pBaked)
+        {
+            TextureCache::addFile(filename, generateMipLevels, loadAsSrgb, bindFlags, pBaked);
+            return pBaked;
+        }
+
+        Bitmap::UniqueConstPtr pBitmap = loadBitmapForTexture(filename);
+        return createTextureFromBitmap(pBitmap.get(), filename, generateMipLevels, loadAsSrgb, bindFlags);
+    }
+#undef no_srgb
+
+    Bitmap::UniqueConstPtr loadBitmapForTexture(const std::string& filename)
+    {
+        return Bitmap::createFromFile(filename, kTopDown);
+    }
+
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
         Texture::SharedPtr pTex;
 
         if(pBitmap)
@@ -695,8 +924,8 @@ namespace Falcor
 
             pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
             pTex->setSourceFilename(stripDataDirectories(filename));
+            TextureCache::addFile(filename, generateMipLevels, loadAsSrgb, bindFlags, pTex);
         }
         return pTex;
     }
-#undef no_srgb
 }
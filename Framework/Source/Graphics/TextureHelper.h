@@ -28,6 +28,7 @@
 #pragma once
 #include <string>
 #include "API/Texture.h"
+#include "Utils/Bitmap.h"
 namespace Falcor
 {
     /*!
@@ -35,13 +36,37 @@ namespace Falcor
     *  @{
     */
 
-    /** create a new texture from an a file
+    /** create a new texture from an a file. If the file was already loaded with the same parameters and the texture is still alive, the existing texture is returned, see TextureCache.
+        If the image has an up-to-date baked file, the texture is created from it, see TextureBaker
         \param[in] Filename Filename
         \param[in] generateMipLevels true is mip-chain should be generated, otherwise false
         \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3/4 component textures.
         \param[in] bindFlags The bind flags to create the texture with
     */
 	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+    /** create a new texture from a DDS file. Unlike createTextureFromFile(), the texture is not looked up in the TextureCache
+        \param[in] filename Filename
+        \param[in] generateMipLevels true if the mip-chain should be generated, otherwise the mip-levels are loaded from the file
+        \param[in] bindFlags The bind flags to create the texture with
+        \param[in] streamed If true, the file is mapped and each subresource is copied straight into the upload buffer, so peak memory is bounded by the largest subresource. Otherwise, the whole file is read into memory first. Streaming requires a low-level API and is ignored otherwise
+    */
+    Texture::SharedPtr createTextureFromDDSFile(const std::string& filename, bool generateMipLevels, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource, bool streamed = true);
+
+    /** Load an image file with the memory layout createTextureFromBitmap() expects. Doesn't create any API objects, so it can run on any thread.
+        \param[in] filename Filename
+        \return If loading was successful, a new bitmap. Otherwise, nullptr.
+    */
+    Bitmap::UniqueConstPtr loadBitmapForTexture(const std::string& filename);
+
+    /** create a new texture from a bitmap which was loaded using loadBitmapForTexture(). The texture is registered in the TextureCache under the filename
+        \param[in] pBitmap The bitmap. If it's nullptr, the function returns nullptr
+        \param[in] filename The file the bitmap was loaded from. Used as the texture's source filename
+        \param[in] generateMipLevels true is mip-chain should be generated, otherwise false
+        \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3/4 component textures.
+        \param[in] bindFlags The bind flags to create the texture with
+    */
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
     
     /*! @} */
 }
\ No newline at end of file
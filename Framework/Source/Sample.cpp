@@ -35,6 +35,7 @@
 #include "API/FBO.h"
 #include "VR\OpenVR\VRSystem.h"
 #include "Utils\ProgressBar.h"
+#include "Graphics/Model/ModelRenderer.h"
 #include <sstream>
 #include <iomanip>
 
@@ -155,6 +156,7 @@ namespace Falcor
         }
 
         VRSystem::cleanup();
+        ModelRenderer::cleanup();
 
         mpGui.reset();
         mpDefaultPipelineState.reset();
@@ -746,4 +746,28 @@ void _fn sampleMaterial(
 	}
 }
 
+/*******************************************************************
+Scene lights
+*******************************************************************/
+
+#if defined(HLSL_CODE) && defined(_FALCOR_SHADER_COMMON_H_)
+/**
+Evaluate the material with all the scene lights which affect the shading point, using the light clusters set by SceneRenderer.
+Directional lights are evaluated everywhere, point and area lights only in the clusters their range overlaps. The results are accumulated into result, which must be initialized by the caller.
+*/
+void evalSceneLights(in const ShadingAttribs shAttr, inout ShadingOutput result)
+{
+    for(uint i = 0; i < gLightClusterGrid.globalLightCount; i++)
+    {
+        evalMaterial(shAttr, loadClusterLight(i), result);
+    }
+
+    uint2 range = getLightClusterRange(getLightClusterIndex(shAttr.P));
+    for(uint i = 0; i < range.y; i++)
+    {
+        evalMaterial(shAttr, loadClusterLight(getLightClusterLightIndex(range.x + i)), result);
+    }
+}
+#endif
+
 #endif	// _FALCOR_SHADING_H_
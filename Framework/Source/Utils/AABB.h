@@ -29,6 +29,7 @@
 #include "glm/vec3.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/common.hpp"
+#include <vector>
 
 namespace Falcor
 {
@@ -99,4 +100,54 @@ namespace Falcor
             return BoundingBox::fromMinMax( min(bb0.getMinPos(), bb1.getMinPos()), max(bb0.getMaxPos(), bb1.getMaxPos()) );
         }
     };
-}
\ No newline at end of file
+
+    /** Structure-of-arrays storage for a list of bounding boxes. Used for batched culling.
+    */
+    struct BoundingBoxSoA
+    {
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+
+        uint32_t size() const { return (uint32_t)centerX.size(); }
+
+        void resize(uint32_t count)
+        {
+            centerX.resize(count);
+            centerY.resize(count);
+            centerZ.resize(count);
+            extentX.resize(count);
+            extentY.resize(count);
+            extentZ.resize(count);
+        }
+
+        void clear() { resize(0); }
+
+        void set(uint32_t index, const BoundingBox& box)
+        {
+            centerX[index] = box.center.x;
+            centerY[index] = box.center.y;
+            centerZ[index] = box.center.z;
+            extentX[index] = box.extent.x;
+            extentY[index] = box.extent.y;
+            extentZ[index] = box.extent.z;
+        }
+
+        void push_back(const BoundingBox& box)
+        {
+            resize(size() + 1);
+            set(size() - 1, box);
+        }
+
+        BoundingBox get(uint32_t index) const
+        {
+            BoundingBox box;
+            box.center = glm::vec3(centerX[index], centerY[index], centerZ[index]);
+            box.extent = glm::vec3(extentX[index], extentY[index], extentZ[index]);
+            return box;
+        }
+    };
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BinaryFileReader.h"
+#include "Utils/OS.h"
+
+namespace Falcor
+{
+    BinaryFileReader::BinaryFileReader(const std::string& filename, uint64_t mappingBudget)
+    {
+        mSize = getFileSize(filename);
+        if(mSize != 0 && mSize <= mappingBudget)
+        {
+            size_t mappedSize;
+            mpData = (const uint8_t*)mapFileToMemory(filename, mappedSize);
+        }
+
+        if(mpData == nullptr)
+        {
+            mStream.open(filename, BinaryFileStream::Mode::Read);
+            mFail = mStream.isFail();
+        }
+    }
+
+    BinaryFileReader::~BinaryFileReader()
+    {
+        unmapFileFromMemory(mpData);
+    }
+
+    bool BinaryFileReader::reserve(size_t size)
+    {
+        if(mFail || size > getRemainingSize())
+        {
+            mFail = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* BinaryFileReader::readInPlace(size_t size)
+    {
+        if(mpData == nullptr || reserve(size) == false)
+        {
+            return nullptr;
+        }
+        const uint8_t* pData = mpData + mOffset;
+        mOffset += size;
+        return pData;
+    }
+
+    BinaryFileReader& BinaryFileReader::read(void* pData, size_t size)
+    {
+        if(reserve(size) == false)
+        {
+            std::memset(pData, 0, size);
+            return *this;
+        }
+
+        if(mpData)
+        {
+            std::memcpy(pData, mpData + mOffset, size);
+        }
+        else
+        {
+            mStream.read(pData, size);
+            mFail = mStream.isFail();
+        }
+        mOffset += size;
+        return *this;
+    }
+
+    void BinaryFileReader::skip(size_t size)
+    {
+        if(reserve(size))
+        {
+            if(mpData == nullptr)
+            {
+                mStream.skip((uint32_t)size);
+            }
+            mOffset += size;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <cstring>
+#include "Utils/BinaryFileStream.h"
+
+namespace Falcor
+{
+    /** Read-only access to a binary file.\n
+        Files which fit in the mapping budget are memory-mapped, and their content can be accessed in-place with readInPlace() without copying it. Larger files are streamed using BinaryFileStream.\n
+        Reads are bounds-checked. Reading past the end of the file sets the fail flag and zero-fills the destination.
+    */
+    class BinaryFileReader
+    {
+    public:
+        static const uint64_t kDefaultMappingBudget = (sizeof(void*) == 8) ? (16ull << 30) : (512ull << 20);
+
+        /** Open a file
+            \param[in] filename The full path of the file
+            \param[in] mappingBudget The largest file size which will be memory-mapped. Use 0 to always stream the file
+        */
+        BinaryFileReader(const std::string& filename, uint64_t mappingBudget = kDefaultMappingBudget);
+        ~BinaryFileReader();
+
+        /** Check if the file is memory-mapped
+        */
+        bool isMapped() const { return mpData != nullptr; }
+
+        /** Get the size of the file in bytes
+        */
+        uint64_t getSize() const { return mSize; }
+
+        /** Get the number of bytes between the current position and the end of the file
+        */
+        uint64_t getRemainingSize() const { return mSize - mOffset; }
+
+        /** Check if a read failed
+        */
+        bool isFail() const { return mFail; }
+
+        /** Get a pointer to the next bytes in the file and advance the position.
+            \return A pointer to the mapped data, or nullptr if the file is not mapped or there's not enough data left. In the first case the position doesn't change, use read() instead
+        */
+        const uint8_t* readInPlace(size_t size);
+
+        /** Copy the next bytes in the file and advance the position
+        */
+        BinaryFileReader& read(void* pData, size_t size);
+
+        /** Advance the position
+        */
+        void skip(size_t size);
+
+        template<typename T>
+        BinaryFileReader& operator>>(T& val) { return read(&val, sizeof(T)); }
+
+    private:
+        BinaryFileReader(const BinaryFileReader&) = delete;
+        BinaryFileReader& operator=(const BinaryFileReader&) = delete;
+        bool reserve(size_t size);
+
+        const uint8_t* mpData = nullptr;
+        uint64_t mSize = 0;
+        uint64_t mOffset = 0;
+        bool mFail = false;
+        BinaryFileStream mStream;
+    };
+}
@@ -206,6 +206,25 @@ namespace Falcor
     */
     time_t getFileModifiedTime(const std::string& filename);
 
+    /** Get the size of a file in bytes. If the file is not found will return 0
+    */
+    uint64_t getFileSize(const std::string& filename);
+
+    /** Check if the CPU and the OS support AVX instructions
+    */
+    bool isAvxSupported();
+
+    /** Map a file into the address space of the process for reading.
+        \param[in] filename The file to map
+        \param[out] size On successful return, the size of the mapped file in bytes
+        \return A pointer to the file's content, or nullptr if the file can't be mapped. Release it with unmapFileFromMemory()
+    */
+    const void* mapFileToMemory(const std::string& filename, size_t& size);
+
+    /** Release a file mapping created by mapFileToMemory()
+    */
+    void unmapFileFromMemory(const void* pData);
+
     enum class ThreadPriorityType : int32_t
     {
         BackgroundBegin     = -2,   //< Indicates I/O-intense thread
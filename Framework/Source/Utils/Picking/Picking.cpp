@@ -73,6 +73,9 @@ namespace Falcor
     {
         mpGraphicsState = GraphicsState::create();
 
+        // Gizmo state is set per model instance, so instances must not be merged across model instances
+        toggleSortedDrawList(false);
+
         // Create FBO
         resizeFBO(fboWidth, fboHeight);
         mpGraphicsState->setFbo(mpFBO);
@@ -32,7 +32,7 @@
 
 namespace Falcor
 {
-    Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType shaderType, const Program::DefineList& shaderDefines)
+    Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType shaderType, const Program::DefineList& shaderDefines, std::string& log)
     {
         std::string shader = shaderString;
         std::string errorMsg;
@@ -41,20 +41,29 @@ namespace Falcor
 
         if(ShaderPreprocessor::parseShader("", shader, errorMsg, includeList, shaderDefines) == false)
         {
-            std::string msg = std::string("Error when parsing shader from string. Code:\n") + shaderString + "\nError:\n" + errorMsg;
-            logError(msg);
+            log = std::string("Error when parsing shader from string. Code:\n") + shaderString + "\nError:\n" + errorMsg;
             return nullptr;
         }
 
-        std::string log;
-        auto pShader = Shader::create(shader, shaderType, log);
+        std::string compilerLog;
+        auto pShader = Shader::create(shader, shaderType, compilerLog, includeList);
+
+        if(pShader == nullptr)
+        {
+            log = "Error when creating " + to_string(shaderType) + " shader from string\nError log:\n";
+            log += compilerLog;
+            log += "\nShader string:\n" + shaderString + "\n";
+        }
+        return pShader;
+    }
 
+    Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType shaderType, const Program::DefineList& shaderDefines)
+    {
+        std::string log;
+        auto pShader = createShaderFromString(shaderString, shaderType, shaderDefines, log);
         if(pShader == nullptr)
         {
-            std::string msg = "Error when creating " + to_string(shaderType) + " shader from string\nError log:\n";
-            msg += log;
-            msg += "\nShader string:\n" + shaderString + "\n";
-            logError(msg);
+            logError(log);
         }
         return pShader;
     }
@@ -63,4 +72,9 @@ namespace Falcor
     {
         return createShaderFromFile<Shader>(filename, shaderType, shaderDefines);
     }
+
+    Shader::SharedPtr createShaderFromFile(const std::string& filename, ShaderType shaderType, const Program::DefineList& shaderDefines, std::string& log)
+    {
+        return createShaderFromFile<Shader>(filename, shaderType, shaderDefines, log);
+    }
 }
@@ -54,6 +54,56 @@ namespace Falcor
     \return A pointer to a new object if compilation was successful, otherwise nullptr.
     */
     Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType type, const Program::DefineList& shaderDefines = Program::DefineList());
+
+    /** create a new shader from file without any user interaction. Used for background compilation, where errors are reported later by the caller.
+    \param[in] filename Shader filename. It will search for the shader in the common directory structure.
+    \param[in] type Shader Type
+    \param[in] shaderDefines A string containing macro definitions to be patched into the shaders.
+    \param[out] log In case of an error, receives the pre-processor or compiler log.
+    \return A pointer to a new object if compilation was successful, otherwise nullptr.
+    */
+    Shader::SharedPtr createShaderFromFile(const std::string& filename, ShaderType type, const Program::DefineList& shaderDefines, std::string& log);
+
+    /** create a new shader from a string without any user interaction. Used for background compilation, where errors are reported later by the caller.
+    \param[in] shaderString The shader.
+    \param[in] type Shader Type
+    \param[in] shaderDefines A string containing macro definitions to be patched into the shaders.
+    \param[out] log In case of an error, receives the pre-processor or compiler log.
+    \return A pointer to a new object if compilation was successful, otherwise nullptr.
+    */
+    Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType type, const Program::DefineList& shaderDefines, std::string& log);
+
+    template<typename ObjectType, typename EnumType>
+    typename ObjectType::SharedPtr createShaderFromFile(const std::string& filename, EnumType shaderType, const Program::DefineList& shaderDefines, std::string& log)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            log = std::string("Can't find shader file ") + filename;
+            return nullptr;
+        }
+
+        std::string shader;
+        readFileToString(fullpath, shader);
+
+        std::string errorMsg;
+        Shader::unordered_string_set includeList;
+        if (ShaderPreprocessor::parseShader(fullpath, shader, errorMsg, includeList, shaderDefines) == false)
+        {
+            log = std::string("Error when pre-processing shader ") + filename + "\n" + errorMsg;
+            return nullptr;
+        }
+
+        std::string errorLog;
+        auto pShader = ObjectType::create(shader, shaderType, errorLog, includeList);
+        if (pShader == nullptr)
+        {
+            log = std::string("Compilation of shader ") + filename + "\n\n" + errorLog;
+            return nullptr;
+        }
+        pShader->setIncludeList(includeList);
+        return pShader;
+    }
        
     template<typename ObjectType, typename EnumType>
     typename ObjectType::SharedPtr createShaderFromFile(const std::string& filename, EnumType shaderType, const Program::DefineList& shaderDefines)
@@ -89,7 +139,7 @@ namespace Falcor
             {
                 // Preprocessing is good
                 std::string errorLog;
-                auto pShader = ObjectType::create(shader, shaderType, errorLog);
+                auto pShader = ObjectType::create(shader, shaderType, errorLog, includeList);
 
                 if (pShader == nullptr)
                 {
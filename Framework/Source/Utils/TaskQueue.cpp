@@ -0,0 +1,113 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TaskQueue.h"
+
+namespace Falcor
+{
+    TaskQueue::SharedPtr TaskQueue::create(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+        return SharedPtr(new TaskQueue(threadCount));
+    }
+
+    TaskQueue* TaskQueue::getDefault()
+    {
+        static SharedPtr spDefault = create();
+        return spDefault.get();
+    }
+
+    TaskQueue::TaskQueue(uint32_t threadCount)
+    {
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mWorkers.emplace_back(&TaskQueue::workerLoop, this);
+        }
+    }
+
+    TaskQueue::~TaskQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+    }
+
+    void TaskQueue::workerLoop()
+    {
+        while (true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mTerminate || mTasks.empty() == false; });
+
+                // Drain the queue before terminating, someone might be waiting on these tasks
+                if (mTasks.empty())
+                {
+                    return;
+                }
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+                mRunningCount++;
+            }
+
+            task();
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunningCount--;
+        }
+    }
+
+    std::shared_future<void> TaskQueue::enqueue(const Task& task)
+    {
+        std::packaged_task<void()> packagedTask(task);
+        std::shared_future<void> future = packagedTask.get_future().share();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back(std::move(packagedTask));
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    uint32_t TaskQueue::getPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return (uint32_t)mTasks.size() + mRunningCount;
+    }
+}
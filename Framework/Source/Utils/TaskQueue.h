@@ -0,0 +1,86 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <vector>
+
+namespace Falcor
+{
+    /** A pool of worker threads executing independent background tasks, such as shader compilation or asset loading.\n
+        Tasks are executed in submission order. Unlike ThreadPool, the caller doesn't participate and doesn't wait - completion is reported through the returned future.
+        Destroying the queue finishes all the tasks which were already submitted.
+    */
+    class TaskQueue
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TaskQueue>;
+        using SharedConstPtr = std::shared_ptr<const TaskQueue>;
+        using Task = std::function<void()>;
+
+        /** Create a new queue
+            \param[in] threadCount The number of worker threads. 0 means one thread less than the number of hardware threads (at least 1), leaving a core for the render thread.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Get the queue shared by the framework
+        */
+        static TaskQueue* getDefault();
+
+        ~TaskQueue();
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mWorkers.size(); }
+
+        /** Submit a task
+            \param[in] task The task to execute
+            \return A future which becomes ready once the task was executed
+        */
+        std::shared_future<void> enqueue(const Task& task);
+
+        /** Get the number of tasks which were submitted and haven't finished yet
+        */
+        uint32_t getPendingCount() const;
+
+    private:
+        TaskQueue(uint32_t threadCount);
+        void workerLoop();
+
+        std::vector<std::thread> mWorkers;
+        mutable std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque<std::packaged_task<void()>> mTasks;
+        uint32_t mRunningCount = 0;
+        bool mTerminate = false;
+    };
+}
@@ -0,0 +1,138 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ThreadPool.h"
+
+namespace Falcor
+{
+    ThreadPool::SharedPtr ThreadPool::create(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return SharedPtr(new ThreadPool(threadCount));
+    }
+
+    ThreadPool* ThreadPool::getDefault()
+    {
+        static SharedPtr spDefault = create();
+        return spDefault.get();
+    }
+
+    ThreadPool::ThreadPool(uint32_t threadCount) : mNextChunk(0)
+    {
+        for (uint32_t i = 1; i < threadCount; i++)
+        {
+            mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mWorkCondition.notify_all();
+
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::processChunks()
+    {
+        const uint32_t chunkCount = (mCount + mChunkSize - 1) / mChunkSize;
+        for (uint32_t chunk = mNextChunk++; chunk < chunkCount; chunk = mNextChunk++)
+        {
+            const uint32_t first = chunk * mChunkSize;
+            (*mpFunc)(first, std::min(first + mChunkSize, mCount));
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        uint32_t generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkCondition.wait(lock, [&] { return mTerminate || mGeneration != generation; });
+                if (mTerminate)
+                {
+                    return;
+                }
+                generation = mGeneration;
+            }
+
+            processChunks();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mActiveWorkers--;
+            }
+            mDoneCondition.notify_one();
+        }
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, uint32_t chunkSize, const RangeFunc& func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        chunkSize = std::max(1u, chunkSize);
+
+        // Run serially when there's nothing to split, or when a loop is already running
+        std::unique_lock<std::mutex> loopLock(mLoopMutex, std::try_to_lock);
+        if (mWorkers.empty() || count <= chunkSize || loopLock.owns_lock() == false)
+        {
+            func(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mpFunc = &func;
+            mCount = count;
+            mChunkSize = chunkSize;
+            mNextChunk = 0;
+            mActiveWorkers = (uint32_t)mWorkers.size();
+            mGeneration++;
+        }
+        mWorkCondition.notify_all();
+
+        processChunks();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [this] { return mActiveWorkers == 0; });
+        mpFunc = nullptr;
+    }
+}
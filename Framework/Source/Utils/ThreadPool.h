@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace Falcor
+{
+    /** A pool of persistent worker threads for data-parallel loops.
+        A loop is split into fixed-size chunks. Every thread, including the calling one, keeps grabbing the next unprocessed chunk until none are left, so threads which finish early pick up the remaining work.
+        Only one loop runs at a time. A parallelFor() called while another one is running (for example, from inside a loop body) is executed serially on the calling thread.
+    */
+    class ThreadPool
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ThreadPool>;
+        using SharedConstPtr = std::shared_ptr<const ThreadPool>;
+
+        /** The loop body. Processes the elements in the range [first, last)
+        */
+        using RangeFunc = std::function<void(uint32_t first, uint32_t last)>;
+
+        /** Create a new pool
+            \param[in] threadCount The total number of threads executing a loop, including the calling thread. 0 means one thread per hardware thread.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Get the pool shared by the framework. It uses one thread per hardware thread.
+        */
+        static ThreadPool* getDefault();
+
+        ~ThreadPool();
+
+        /** Get the total number of threads executing a loop, including the calling thread
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mWorkers.size() + 1; }
+
+        /** Run a loop over [0, count) and wait for it to finish
+            \param[in] count The number of elements
+            \param[in] chunkSize The number of elements a thread processes at once
+            \param[in] func The loop body
+        */
+        void parallelFor(uint32_t count, uint32_t chunkSize, const RangeFunc& func);
+
+    private:
+        ThreadPool(uint32_t threadCount);
+        void workerLoop();
+        void processChunks();
+
+        std::vector<std::thread> mWorkers;
+        std::mutex mLoopMutex;          // Held by the thread running a loop
+
+        std::mutex mMutex;
+        std::condition_variable mWorkCondition;
+        std::condition_variable mDoneCondition;
+        uint32_t mGeneration = 0;       // Incremented when a loop is published
+        uint32_t mActiveWorkers = 0;
+        bool mTerminate = false;
+
+        const RangeFunc* mpFunc = nullptr;
+        uint32_t mCount = 0;
+        uint32_t mChunkSize = 1;
+        std::atomic<uint32_t> mNextChunk;
+    };
+}
@@ -35,6 +35,7 @@
 #include <shlobj.h>
 #include <sys/types.h>
 #include "API/Window.h"
+#include <intrin.h>
 
 // Always run in Optimus mode on laptops
 extern "C"
@@ -461,4 +462,59 @@ namespace Falcor
 
         return s.st_mtime;
     }
+
+    uint64_t getFileSize(const std::string& filename)
+    {
+        struct _stat64 s;
+        if(_stat64(filename.c_str(), &s) != 0)
+        {
+            return 0;
+        }
+
+        return (uint64_t)s.st_size;
+    }
+
+    bool isAvxSupported()
+    {
+        // The CPU must support AVX, and the OS must save the YMM registers on context switches
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        return osxsave && avx && ((_xgetbv(0) & 0x6) == 0x6);
+    }
+
+    const void* mapFileToMemory(const std::string& filename, size_t& size)
+    {
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(hFile == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        const void* pData = nullptr;
+        LARGE_INTEGER fileSize;
+        if(GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+        {
+            // The view keeps the mapping object alive, so the handles can be closed right away
+            HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(hMapping)
+            {
+                pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(hMapping);
+            }
+        }
+        CloseHandle(hFile);
+
+        size = pData ? (size_t)fileSize.QuadPart : 0;
+        return pData;
+    }
+
+    void unmapFileFromMemory(const void* pData)
+    {
+        if(pData)
+        {
+            UnmapViewOfFile(pData);
+        }
+    }
 }
\ No newline at end of file
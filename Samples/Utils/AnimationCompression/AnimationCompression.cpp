@@ -0,0 +1,106 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AnimationCompression.h"
+
+// Number of evaluations used to measure the playback throughput of each clip
+static const uint32_t kEvaluationCount = 1000;
+
+AnimationCompression::AnimationCompression(std::vector<std::string> files)
+{
+    mFiles = files;
+}
+
+void AnimationCompression::reportFile(const std::string& file)
+{
+    printf("%s\n", file.c_str());
+    auto pModel = Model::createFromFile(file.c_str());
+    const AnimationController* pController = pModel ? pModel->getAnimationController() : nullptr;
+    if (pController == nullptr)
+    {
+        printf("    No animations.\n");
+        return;
+    }
+
+    std::vector<BonePose> poses(pController->getBoneCount());
+    for (uint32_t i = 0; i < pController->getAnimationCount(); i++)
+    {
+        const Animation* pAnimation = pController->getAnimation(i);
+        const Animation::CompressionStats& stats = pAnimation->getCompressionStats();
+        printf("    %s\n", pAnimation->getName().c_str());
+        printf("        Keys: %u -> %u\n", stats.rawKeyCount, stats.keyCount);
+        printf("        Size: %.1fKB -> %.1fKB, ratio %.2f\n", stats.rawSize / 1024.0, stats.compressedSize / 1024.0, stats.compressedSize ? double(stats.rawSize) / stats.compressedSize : 0.0);
+        printf("        Max error: translation %g, rotation %g rad, scaling %g\n", stats.maxTranslationError, stats.maxRotationError, stats.maxScalingError);
+
+        // Play the clip forward at 60 frames per second
+        std::vector<uint32_t> keyCursors(pAnimation->getKeyCursorCount(), 0);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t frame = 0; frame < kEvaluationCount; frame++)
+        {
+            pAnimation->animate(frame / 60.0, keyCursors.data(), poses.data());
+        }
+        double duration = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        printf("        Evaluation: %.2fus per frame\n", duration * 1000 / kEvaluationCount);
+    }
+}
+
+void AnimationCompression::onLoad()
+{
+    for (const auto& file : mFiles)
+    {
+        reportFile(file);
+    }
+    shutdownApp();
+}
+
+void AnimationCompression::onShutdown()
+{
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> files;
+    for (int argi = 1; argi < argc; ++argi)
+    {
+        files.push_back(argv[argi]);
+    }
+
+    if (files.size())
+    {
+        AnimationCompression animationCompression(files);
+        SampleConfig config;
+        config.windowDesc.width = 256;
+        config.windowDesc.height = 256;
+        config.windowDesc.title = "AnimationCompression";
+        animationCompression.run(config);
+    }
+    else
+    {
+        printf("Syntax: AnimationCompression <list of model files>\n");
+    }
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BakeTextures.h"
+
+BakeTextures::BakeTextures(std::vector<std::string> files, TextureBaker::Flags flags)
+{
+    mFiles = files;
+    mFlags = flags;
+}
+
+void BakeTextures::bakeFile(const std::string& file)
+{
+    printf("Baking the textures of %s ...\n", file.c_str());
+
+    // Textures which already have an up-to-date baked file are skipped
+    std::vector<std::string> bakedFiles;
+    if (hasSuffix(file, ".fscene", false))
+    {
+        auto pScene = Scene::loadFromFile(file);
+        if (pScene)
+        {
+            bakedFiles = TextureBaker::bakeScene(pScene.get(), mFlags);
+        }
+    }
+    else
+    {
+        auto pModel = Model::createFromFile(file.c_str());
+        if (pModel)
+        {
+            bakedFiles = TextureBaker::bakeModel(pModel.get(), mFlags);
+        }
+    }
+
+    for (const auto& bakedFile : bakedFiles)
+    {
+        printf("    Wrote %s\n", bakedFile.c_str());
+    }
+    printf("    %d textures baked.\n", (int)bakedFiles.size());
+}
+
+void BakeTextures::onLoad()
+{
+    for (const auto& file : mFiles)
+    {
+        bakeFile(file);
+    }
+    shutdownApp();
+}
+
+void BakeTextures::onShutdown()
+{
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> files;
+    TextureBaker::Flags flags = TextureBaker::Flags::None;
+    for (int argi = 1; argi < argc; ++argi)
+    {
+        std::string arg(argv[argi]);
+        if (arg == "-compress")
+        {
+            flags |= TextureBaker::Flags::Compress;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size())
+    {
+        BakeTextures bakeTextures(files, flags);
+        SampleConfig config;
+        config.windowDesc.width = 256;
+        config.windowDesc.height = 256;
+        config.windowDesc.title = "BakeTextures";
+        bakeTextures.run(config);
+    }
+    else
+    {
+        printf("Syntax: BakeTextures [-compress] <list of scene or model files>\n");
+    }
+}
@@ -32,10 +32,6 @@
 
 cbuffer PerFrameCB
 {
-#foreach p in _LIGHT_SOURCES
-    LightData $(p);
-#endforeach
-
     float3 gAmbient;
 };
 
@@ -44,13 +40,11 @@ vec4 main(VS_OUT vOut) : SV_TARGET
     ShadingAttribs shAttr;
     prepareShadingAttribs(gMaterial, vOut.posW, gCam.position, vOut.normalW, vOut.bitangentW, vOut.texC, shAttr);
 
-    ShadingOutput result;
-    result.finalValue = 0;
+    ShadingOutput result = (ShadingOutput)0;
     float4 finalColor = 0;
 
-#foreach p in _LIGHT_SOURCES
-    evalMaterial(shAttr, $(p), result, $(_valIndex) == 0);
-#endforeach
+    // The scene's lights are bound by SceneRenderer, only the lights affecting the pixel's cluster are evaluated
+    evalSceneLights(shAttr, result);
 
     finalColor = vec4(result.finalValue, 1.f);
 
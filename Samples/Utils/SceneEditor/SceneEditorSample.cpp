@@ -83,9 +83,6 @@ void SceneEditorSample::initNewScene()
 void SceneEditorSample::initShader()
 {
     mpProgram = GraphicsProgram::createFromFile("", "SceneEditorSample.fs");
-    std::string lights;
-    getSceneLightString(mpScene.get(), lights);
-    mpProgram->addDefine("_LIGHT_SOURCES", lights);
     mpVars = GraphicsVars::create(mpProgram->getActiveVersion()->getReflector());
 }
 
@@ -123,16 +120,9 @@ void SceneEditorSample::onFrameRender()
 
     if(mpScene)
     {
-        // If lights changed, recompile shader
-        if (mScenePrevLightCount != mpScene->getLightCount())
-        {
-            initShader();
-            mScenePrevLightCount = mpScene->getLightCount();
-        }
-
         mpDefaultPipelineState->setBlendState(nullptr);
         mpDefaultPipelineState->setDepthStencilState(nullptr);
-        setSceneLightsIntoConstantBuffer(mpScene.get(), mpVars["PerFrameCB"].get());
+        mpVars["PerFrameCB"]->setVariable("gAmbient", mpScene->getAmbientIntensity());
         mpRenderContext->setGraphicsVars(mpVars);
         mpDefaultPipelineState->setProgram(mpProgram);
 
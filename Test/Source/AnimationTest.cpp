@@ -0,0 +1,558 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AnimationTest.h"
+#include "Graphics/Model/AnimationController.h"
+#include "glm/gtx/transform.hpp"
+#include <random>
+
+namespace
+{
+    const uint32_t kKeyCount = 30;
+    const float kDuration = 100;
+
+    std::vector<Bone> createSkeleton(uint32_t boneCount, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> dist(-1, 1);
+        std::vector<Bone> bones(boneCount);
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            Bone& bone = bones[i];
+            bone.boneID = i;
+            bone.parentID = i ? std::uniform_int_distribution<uint32_t>(0, i - 1)(rng) : AnimationController::kInvalidBoneID;
+            bone.name = "Bone" + std::to_string(i);
+            bone.offset = glm::translate(vec3(dist(rng), dist(rng), dist(rng))) * glm::mat4_cast(normalize(quat(dist(rng), dist(rng), dist(rng), dist(rng))));
+            bone.localTransform = glm::translate(vec3(dist(rng), dist(rng), dist(rng)));
+            bone.originalLocalTransform = bone.localTransform;
+        }
+        return bones;
+    }
+
+    std::vector<Animation::AnimationSet> createAnimationSets(uint32_t boneCount, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> dist(-1, 1);
+        std::uniform_real_distribution<float> scale(0.5f, 2);
+        std::vector<Animation::AnimationSet> sets(boneCount);
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            sets[i].boneID = i;
+            for (uint32_t k = 0; k < kKeyCount; k++)
+            {
+                // Start after 0 so the first frames wrap around from the last key
+                float time = kDuration * (k + 0.5f) / kKeyCount;
+                sets[i].translation.keys.push_back({ vec3(dist(rng), dist(rng), dist(rng)), time });
+                sets[i].scaling.keys.push_back({ vec3(scale(rng), scale(rng), scale(rng)), time });
+                sets[i].rotation.keys.push_back({ normalize(quat(dist(rng), dist(rng), dist(rng), dist(rng))), time });
+            }
+        }
+        return sets;
+    }
+
+    // Smooth curves sampled at every tick, like motion capture. Scaling is constant.
+    std::vector<Animation::AnimationSet> createMocapSets(uint32_t boneCount, uint32_t frameCount, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> dist(-1, 1);
+        std::uniform_real_distribution<float> frequency(0.5f, 4);
+        std::vector<Animation::AnimationSet> sets(boneCount);
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            sets[i].boneID = i;
+            vec3 base(dist(rng), dist(rng), dist(rng));
+            vec3 amplitude(dist(rng), dist(rng), dist(rng));
+            vec3 axis = normalize(vec3(dist(rng), dist(rng), dist(rng)));
+            float f = frequency(rng) * 2 * glm::pi<float>() / frameCount;
+            for (uint32_t k = 0; k < frameCount; k++)
+            {
+                float time = float(k);
+                sets[i].translation.keys.push_back({ base + amplitude * sin(f * time), time });
+                sets[i].scaling.keys.push_back({ vec3(1), time });
+                sets[i].rotation.keys.push_back({ glm::angleAxis(sin(f * time), axis), time });
+            }
+        }
+        return sets;
+    }
+
+    AnimationController::UniquePtr createController(const std::vector<Bone>& bones, const std::vector<Animation::AnimationSet>& sets, float ticksPerSecond)
+    {
+        AnimationController::UniquePtr pController = AnimationController::create(bones);
+        pController->addAnimation(Animation::create("Test", sets, kDuration, ticksPerSecond));
+        pController->setActiveAnimation(0);
+        return pController;
+    }
+
+    // A straightforward implementation with a linear key search and full matrix products
+    template<typename T>
+    T sampleChannel(const Animation::AnimationChannel<T>& channel, float ticks, T (*interpolate)(const T&, const T&, float), float duration = kDuration)
+    {
+        uint32_t cur = 0;
+        while (cur + 1 < channel.keys.size() && channel.keys[cur + 1].time <= ticks)
+        {
+            cur++;
+        }
+        uint32_t next = (cur + 1) % (uint32_t)channel.keys.size();
+        float diff = channel.keys[next].time - channel.keys[cur].time;
+        if (diff < 0)
+        {
+            diff += duration;
+        }
+        if (diff == 0 || ticks <= channel.keys[cur].time)
+        {
+            return channel.keys[cur].value;
+        }
+        return interpolate(channel.keys[cur].value, channel.keys[next].value, (ticks - channel.keys[cur].time) / diff);
+    }
+
+    vec3 lerpVec3(const vec3& a, const vec3& b, float t) { return a + (b - a) * t; }
+    quat slerpQuat(const quat& a, const quat& b, float t) { return glm::slerp(a, b, t); }
+
+    void animateReference(const std::vector<Bone>& bones, const std::vector<Animation::AnimationSet>& sets, float ticksPerSecond, double time, std::vector<glm::mat4>& result)
+    {
+        float ticks = (float)fmod(time * ticksPerSecond, kDuration);
+        std::vector<glm::mat4> global(bones.size());
+        result.resize(bones.size());
+        for (uint32_t i = 0; i < bones.size(); i++)
+        {
+            const Animation::AnimationSet& set = sets[i];
+            glm::mat4 local = glm::translate(sampleChannel(set.translation, ticks, lerpVec3)) * glm::mat4_cast(sampleChannel(set.rotation, ticks, slerpQuat)) * glm::scale(sampleChannel(set.scaling, ticks, lerpVec3));
+            global[i] = (bones[i].parentID == AnimationController::kInvalidBoneID) ? local : global[bones[i].parentID] * local;
+            result[i] = global[i] * bones[i].offset;
+        }
+    }
+
+    glm::mat4 toMatrix(const AffineTransform& a)
+    {
+        return transpose(glm::mat4(a.rows[0], a.rows[1], a.rows[2], vec4(0, 0, 0, 1)));
+    }
+
+    // The keys are quantized, so the tolerance is relative to the magnitude of the whole matrix rather than of each element
+    bool compareMatrices(const glm::mat4* pA, const glm::mat4* pB, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float magnitude = 1;
+            float error = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    magnitude = glm::max(magnitude, abs(pB[i][c][r]));
+                    error = glm::max(error, abs(pA[i][c][r] - pB[i][c][r]));
+                }
+            }
+            if (error > 1e-3f * magnitude)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void AnimationTest::addTests()
+{
+    addTestToList<TestAgainstReference>();
+    addTestToList<TestBatchedAnimation>();
+    addTestToList<TestInstanceAnimation>();
+    addTestToList<TestAnimationBlending>();
+    addTestToList<TestPerformance>();
+    addTestToList<TestCompression>();
+    addTestToList<TestKeyReduction>();
+    addTestToList<TestCompressionPerformance>();
+}
+
+testing_func(AnimationTest, TestAgainstReference)
+{
+    std::mt19937 rng(0);
+    const uint32_t kBoneCount = 40;
+    const float kTicksPerSecond = 25;
+    std::vector<Bone> bones = createSkeleton(kBoneCount, rng);
+    std::vector<Animation::AnimationSet> sets = createAnimationSets(kBoneCount, rng);
+    AnimationController::UniquePtr pController = createController(bones, sets, kTicksPerSecond);
+
+    // Play forward in small and large steps, then jump around to defeat the cached key cursors
+    std::vector<double> times;
+    for (double t = 0; t < 10; t += 1.0 / 60)
+    {
+        times.push_back(t);
+    }
+    for (double t = 0; t < 10; t += 0.37)
+    {
+        times.push_back(t);
+    }
+    std::uniform_real_distribution<double> randomTime(0, 10);
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        times.push_back(randomTime(rng));
+    }
+
+    std::vector<glm::mat4> expected;
+    for (double t : times)
+    {
+        pController->animate(t);
+        animateReference(bones, sets, kTicksPerSecond, t, expected);
+        if (compareMatrices(pController->getBoneMatrices(), expected.data(), kBoneCount) == false)
+        {
+            return test_fail("Bone matrices don't match the reference at time " + std::to_string(t));
+        }
+    }
+
+    // The bind pose ignores the animation
+    pController->setActiveAnimation(AnimationController::kBindPoseAnimationId);
+    std::vector<Animation::AnimationSet> bindPose(kBoneCount);
+    for (uint32_t i = 0; i < kBoneCount; i++)
+    {
+        bindPose[i].translation.keys.push_back({ vec3(bones[i].localTransform[3]), 0 });
+        bindPose[i].scaling.keys.push_back({ vec3(1), 0 });
+        bindPose[i].rotation.keys.push_back({ quat(), 0 });
+    }
+    animateReference(bones, bindPose, kTicksPerSecond, 0, expected);
+    if (compareMatrices(pController->getBoneMatrices(), expected.data(), kBoneCount) == false)
+    {
+        return test_fail("Bind pose doesn't match the reference");
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestBatchedAnimation)
+{
+    std::mt19937 rng(1);
+    const uint32_t kModelCount = 64;
+    const uint32_t kBoneCount = 20;
+    std::vector<Bone> bones = createSkeleton(kBoneCount, rng);
+    std::vector<Animation::AnimationSet> sets = createAnimationSets(kBoneCount, rng);
+
+    // Each controller plays at its own speed, the batch must give the same results as animating them one by one
+    std::vector<AnimationController::UniquePtr> batched;
+    std::vector<AnimationController::UniquePtr> single;
+    std::vector<AnimationController*> controllers;
+    for (uint32_t i = 0; i < kModelCount; i++)
+    {
+        batched.push_back(createController(bones, sets, 10.0f + i));
+        single.push_back(createController(bones, sets, 10.0f + i));
+        controllers.push_back(batched.back().get());
+    }
+
+    ThreadPool::SharedPtr pPool = ThreadPool::create(4);
+    for (double t = 0; t < 5; t += 0.1)
+    {
+        AnimationController::animate(controllers.data(), kModelCount, t, pPool.get());
+        for (uint32_t i = 0; i < kModelCount; i++)
+        {
+            single[i]->animate(t);
+            if (memcmp(batched[i]->getBoneMatrices(), single[i]->getBoneMatrices(), sizeof(glm::mat4) * kBoneCount) != 0)
+            {
+                return test_fail("Batched animation doesn't match");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestInstanceAnimation)
+{
+    std::mt19937 rng(3);
+    const uint32_t kBoneCount = 30;
+    std::vector<Bone> bones = createSkeleton(kBoneCount, rng);
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+    pController->addAnimation(Animation::create("A", createAnimationSets(kBoneCount, rng), kDuration, 25));
+    pController->addAnimation(Animation::create("B", createAnimationSets(kBoneCount, rng), kDuration, 30));
+
+    // Instances with different animations, time offsets and transforms. Each must match the controller playing the same animation, with the instance transform applied.
+    struct Instance
+    {
+        AnimationController::InstanceState state;
+        glm::mat4 transform;
+        std::vector<uint32_t> keyCursors;
+        std::vector<AffineTransform> palette;
+    };
+    std::vector<Instance> instances(8);
+    for (uint32_t i = 0; i < (uint32_t)instances.size(); i++)
+    {
+        Instance& instance = instances[i];
+        instance.state.animationID = (i == 7) ? AnimationController::kBindPoseAnimationId : i % 2;
+        instance.state.timeOffset = i * 0.73;
+        instance.transform = glm::translate(vec3(i * 2.0f, 0, -1.0f)) * glm::rotate(i * 0.4f, vec3(0, 1, 0));
+        instance.keyCursors.resize(pController->getKeyCursorCount(instance.state), 0);
+        instance.palette.resize(kBoneCount);
+    }
+
+    std::vector<glm::mat4> expected(kBoneCount);
+    std::vector<glm::mat4> actual(kBoneCount);
+    for (double t = 0; t < 4; t += 0.05)
+    {
+        for (Instance& instance : instances)
+        {
+            pController->animateInstance(instance.state, t, instance.transform, instance.keyCursors.data(), instance.palette.data());
+        }
+
+        for (Instance& instance : instances)
+        {
+            pController->setActiveAnimation(instance.state.animationID);
+            pController->animate(t + instance.state.timeOffset);
+            for (uint32_t b = 0; b < kBoneCount; b++)
+            {
+                expected[b] = instance.transform * pController->getBoneMatrices()[b];
+                actual[b] = toMatrix(instance.palette[b]);
+            }
+            if (compareMatrices(actual.data(), expected.data(), kBoneCount) == false)
+            {
+                return test_fail("Instance palette doesn't match the single-instance path at time " + std::to_string(t));
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestAnimationBlending)
+{
+    std::mt19937 rng(4);
+    const uint32_t kBoneCount = 20;
+    std::vector<Bone> bones = createSkeleton(kBoneCount, rng);
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+    pController->addAnimation(Animation::create("A", createAnimationSets(kBoneCount, rng), kDuration, 25));
+    pController->addAnimation(Animation::create("B", createAnimationSets(kBoneCount, rng), kDuration, 25));
+
+    const glm::mat4 identity;
+    std::vector<AffineTransform> a(kBoneCount), b(kBoneCount), blended(kBoneCount);
+    for (double t = 0; t < 2; t += 0.1)
+    {
+        AnimationController::InstanceState state;
+        state.animationID = 0;
+        std::vector<uint32_t> cursors(pController->getKeyCursorCount(state), 0);
+        pController->animateInstance(state, t, identity, cursors.data(), a.data());
+        state.animationID = 1;
+        pController->animateInstance(state, t, identity, cursors.data(), b.data());
+
+        // The blend weight selects between the two animations at its ends
+        state.animationID = 0;
+        state.blendAnimationID = 1;
+        for (float weight : { 0.0f, 1.0f })
+        {
+            state.blendWeight = weight;
+            cursors.assign(pController->getKeyCursorCount(state), 0);
+            pController->animateInstance(state, t, identity, cursors.data(), blended.data());
+            const std::vector<AffineTransform>& ref = (weight == 0) ? a : b;
+            for (uint32_t i = 0; i < kBoneCount; i++)
+            {
+                glm::mat4 expected = toMatrix(ref[i]);
+                glm::mat4 actual = toMatrix(blended[i]);
+                if (compareMatrices(&actual, &expected, 1) == false)
+                {
+                    return test_fail("Blend weight " + std::to_string(weight) + " doesn't match the animation");
+                }
+            }
+        }
+
+        // Half-way, the root bone's local translation is the average of the two
+        state.blendWeight = 0.5f;
+        cursors.assign(pController->getKeyCursorCount(state), 0);
+        pController->animateInstance(state, t, identity, cursors.data(), blended.data());
+        const glm::mat4 invOffset = inverse(bones[0].offset);
+        const vec3 mid = (vec3((toMatrix(a[0]) * invOffset)[3]) + vec3((toMatrix(b[0]) * invOffset)[3])) * 0.5f;
+        if (length(vec3((toMatrix(blended[0]) * invOffset)[3]) - mid) > 1e-3f)
+        {
+            return test_fail("Half-way blend is wrong");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestPerformance)
+{
+    std::mt19937 rng(2);
+    const uint32_t kBoneCount = 60;
+    const uint32_t kModelCounts[] = { 1000, 4000 };
+    const uint32_t kFrames = 20;
+    std::vector<Bone> bones = createSkeleton(kBoneCount, rng);
+    std::vector<Animation::AnimationSet> sets = createAnimationSets(kBoneCount, rng);
+    ThreadPool::SharedPtr pSingleThread = ThreadPool::create(1);
+
+    for (uint32_t modelCount : kModelCounts)
+    {
+        // Every model owns a copy of its animation data, like loaded models do
+        std::vector<std::vector<Animation::AnimationSet>> modelSets(modelCount, sets);
+        std::vector<AnimationController::UniquePtr> owners;
+        std::vector<AnimationController*> controllers;
+        for (uint32_t i = 0; i < modelCount; i++)
+        {
+            owners.push_back(createController(bones, sets, 20.0f + (i % 10)));
+            controllers.push_back(owners.back().get());
+        }
+        std::cout << modelCount << " models, " << kBoneCount << " bones" << std::endl;
+
+        std::vector<glm::mat4> result;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t frame = 0; frame < kFrames; frame++)
+        {
+            for (uint32_t i = 0; i < modelCount; i++)
+            {
+                animateReference(bones, modelSets[i], 20.0f + (i % 10), frame / 60.0, result);
+            }
+        }
+        std::cout << "    Reference: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kFrames << "ms" << std::endl;
+
+        for (ThreadPool* pPool : { pSingleThread.get(), ThreadPool::getDefault() })
+        {
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t frame = 0; frame < kFrames; frame++)
+            {
+                AnimationController::animate(controllers.data(), modelCount, frame / 60.0, pPool);
+            }
+            std::cout << "    " << (pPool == pSingleThread.get() ? "Single thread: " : "Thread pool: ") << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kFrames << "ms" << std::endl;
+        }
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestCompression)
+{
+    std::mt19937 rng(3);
+    const uint32_t kBoneCount = 20;
+    const uint32_t kFrameCount = 2000;
+    std::vector<Animation::AnimationSet> sets = createMocapSets(kBoneCount, kFrameCount, rng);
+    Animation::CompressionDesc desc;
+    Animation::UniquePtr pAnimation = Animation::create("Mocap", sets, float(kFrameCount), 1, desc);
+
+    const Animation::CompressionStats& stats = pAnimation->getCompressionStats();
+    if (stats.rawKeyCount != kBoneCount * kFrameCount * 3 || stats.keyCount >= stats.rawKeyCount / 4 || stats.compressedSize * 8 >= stats.rawSize)
+    {
+        return test_fail("Smooth clip wasn't compressed");
+    }
+    if (stats.maxTranslationError > desc.translationTolerance || stats.maxRotationError > desc.rotationTolerance || stats.maxScalingError > desc.scalingTolerance)
+    {
+        return test_fail("Compression error is larger than the tolerance");
+    }
+
+    // Between the keys, the error is bounded by the error at the kept keys
+    std::vector<uint32_t> keyCursors(pAnimation->getKeyCursorCount(), 0);
+    std::vector<BonePose> poses(kBoneCount);
+    std::uniform_real_distribution<double> randomTime(0, kFrameCount);
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        double time = (i < 250) ? i * 0.73 : randomTime(rng);
+        pAnimation->animate(time, keyCursors.data(), poses.data());
+        for (uint32_t b = 0; b < kBoneCount; b++)
+        {
+            float ticks = (float)time;
+            vec3 translation = sampleChannel(sets[b].translation, ticks, lerpVec3, float(kFrameCount));
+            quat rotation = sampleChannel(sets[b].rotation, ticks, slerpQuat, float(kFrameCount));
+            float angle = 2 * acos(glm::min(1.0f, abs(dot(rotation, poses[b].rotation))));
+            if (length(translation - poses[b].translation) > 2 * desc.translationTolerance || angle > 4 * desc.rotationTolerance || poses[b].scaling != vec3(1))
+            {
+                return test_fail("Compressed pose doesn't match the source at time " + std::to_string(time));
+            }
+        }
+    }
+
+    // A tighter tolerance keeps more keys
+    desc.translationTolerance = desc.rotationTolerance = desc.scalingTolerance = 1e-5f;
+    Animation::UniquePtr pPrecise = Animation::create("Mocap", sets, float(kFrameCount), 1, desc);
+    if (pPrecise->getCompressionStats().keyCount <= stats.keyCount || pPrecise->getCompressionStats().maxTranslationError > stats.maxTranslationError)
+    {
+        return test_fail("Tighter tolerance didn't improve the precision");
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestKeyReduction)
+{
+    // Constant channels collapse to a single key, linear ones to their end points
+    Animation::AnimationSet set;
+    set.boneID = 0;
+    for (uint32_t k = 0; k <= 100; k++)
+    {
+        float time = float(k);
+        set.translation.keys.push_back({ vec3(1, 2, 3) + vec3(0.5f, -1, 2) * time, time });
+        set.scaling.keys.push_back({ vec3(2), time });
+        set.rotation.keys.push_back({ glm::angleAxis(1.0f, vec3(0, 1, 0)), time });
+    }
+    Animation::UniquePtr pAnimation = Animation::create("Linear", { set }, 101, 1);
+    if (pAnimation->getCompressionStats().keyCount != 4)
+    {
+        return test_fail("Expected 4 keys after key reduction, got " + std::to_string(pAnimation->getCompressionStats().keyCount));
+    }
+
+    BonePose pose;
+    uint32_t keyCursors[3] = {};
+    pAnimation->animate(37.5, keyCursors, &pose);
+    if (length(pose.translation - (vec3(1, 2, 3) + vec3(0.5f, -1, 2) * 37.5f)) > 1e-3f || pose.scaling != vec3(2) || abs(dot(pose.rotation, glm::angleAxis(1.0f, vec3(0, 1, 0)))) < 0.99999f)
+    {
+        return test_fail("Reduced channels evaluate incorrectly");
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestCompressionPerformance)
+{
+    std::mt19937 rng(4);
+    const uint32_t kBoneCount = 60;
+    const uint32_t kFrameCount = 6000;
+    const uint32_t kEvaluationCount = 20000;
+    std::vector<Animation::AnimationSet> sets = createMocapSets(kBoneCount, kFrameCount, rng);
+    std::uniform_real_distribution<double> randomTime(0, kFrameCount);
+    std::vector<double> randomTimes(kEvaluationCount);
+    for (double& t : randomTimes)
+    {
+        t = randomTime(rng);
+    }
+
+    // A zero tolerance keeps the float values, the default one quantizes them and removes keys
+    for (float tolerance : { 0.0f, 1e-3f })
+    {
+        Animation::CompressionDesc desc;
+        desc.translationTolerance = desc.rotationTolerance = desc.scalingTolerance = tolerance;
+        Animation::UniquePtr pAnimation = Animation::create("Mocap", sets, float(kFrameCount), 30, desc);
+        const Animation::CompressionStats& stats = pAnimation->getCompressionStats();
+        std::cout << "Tolerance " << tolerance << ": " << stats.rawSize / 1024 << "KB -> " << stats.compressedSize / 1024 << "KB, ratio " << float(stats.rawSize) / stats.compressedSize << std::endl;
+
+        std::vector<uint32_t> keyCursors(pAnimation->getKeyCursorCount(), 0);
+        std::vector<BonePose> poses(kBoneCount);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kEvaluationCount; i++)
+        {
+            pAnimation->animate(i / 60.0, keyCursors.data(), poses.data());
+        }
+        double forward = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (double t : randomTimes)
+        {
+            pAnimation->animate(t / 30, keyCursors.data(), poses.data());
+        }
+        double random = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        std::cout << "    Playing forward: " << kEvaluationCount * kBoneCount / forward / 1000 << "M bones/s, random access: " << kEvaluationCount * kBoneCount / random / 1000 << "M bones/s" << std::endl;
+    }
+    return test_pass();
+}
+
+int main()
+{
+    AnimationTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
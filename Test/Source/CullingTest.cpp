@@ -0,0 +1,296 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CullingTest.h"
+#include "TestHelper.h"
+
+namespace
+{
+    const char* kSceneFile = "CityScene/Tiled_CityScene_20x20.fscene";
+    const uint32_t kNumViews = 100;
+    const uint32_t kNumBatchedBoxes = 1000000;
+
+    // Used when the city scene isn't available
+    const char* kProceduralModels[] = { "teapot.obj", "sphere.obj", "torus.obj", "box.obj" };
+    const uint32_t kProceduralGridSize = 50;
+    const float kProceduralSpacing = 10.0f;
+
+    // A grid of randomly rotated and scaled instances of the models which ship with the framework
+    Scene::SharedPtr createProceduralScene()
+    {
+        Scene::SharedPtr pScene = Scene::create();
+        for (const char* file : kProceduralModels)
+        {
+            Model::SharedPtr pModel = Model::createFromFile(file);
+            if (pModel == nullptr)
+            {
+                return nullptr;
+            }
+
+            for (uint32_t i = 0; i < kProceduralGridSize * kProceduralGridSize; i++)
+            {
+                vec3 translation = vec3(float(i % kProceduralGridSize), TestHelper::randFloatZeroToOne(), float(i / kProceduralGridSize)) * kProceduralSpacing;
+                vec3 rotation = vec3(TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne()) * 2.0f * glm::pi<float>();
+                vec3 scaling = vec3(0.5f + TestHelper::randFloatZeroToOne());
+                pScene->addModelInstance(pModel, std::string(file) + std::to_string(i), translation, rotation, scaling);
+            }
+        }
+        return pScene;
+    }
+
+    // The per-instance loop SceneRenderer used before the scene BVH
+    void cullLinear(const Scene* pScene, const Camera* pCamera, std::vector<SceneBVH::Leaf>& visible)
+    {
+        visible.clear();
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const Scene::ModelInstance* pInstance = pScene->getModelInstance(modelID, instanceID).get();
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        BoundingBox box = pModel->getMeshInstance(meshID, meshInstanceID)->getBoundingBox().transform(pInstance->getTransformMatrix());
+                        if (pCamera->isObjectCulled(box) == false)
+                        {
+                            SceneBVH::Leaf leaf;
+                            leaf.box = box;
+                            leaf.modelID = modelID;
+                            leaf.modelInstanceID = instanceID;
+                            leaf.meshID = meshID;
+                            leaf.meshInstanceID = meshInstanceID;
+                            visible.push_back(leaf);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CullingTest::addTests()
+{
+    addTestToList<TestSceneBVH>();
+    addTestToList<TestBatchedCulling>();
+}
+
+Camera::SharedPtr CullingTest::createRandomCamera(const BoundingBox& sceneBounds)
+{
+    Camera::SharedPtr pCamera = Camera::create();
+    vec3 pos = sceneBounds.getMinPos() + vec3(TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne()) * sceneBounds.getSize();
+    vec3 target = sceneBounds.getMinPos() + vec3(TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne()) * sceneBounds.getSize();
+    pCamera->setPosition(pos);
+    pCamera->setTarget(target);
+    pCamera->setUpVector(vec3(0, 1, 0));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, length(sceneBounds.getSize()));
+    return pCamera;
+}
+
+testing_func(CullingTest, TestSceneBVH)
+{
+    Scene::SharedPtr pScene;
+    std::string fullpath;
+    if (findFileInDataDirectories(kSceneFile, fullpath))
+    {
+        pScene = Scene::loadFromFile(fullpath);
+        if (pScene == nullptr)
+        {
+            return test_fail("Can't load " + std::string(kSceneFile));
+        }
+    }
+    else
+    {
+        std::cout << kSceneFile << " not found, using a procedural scene" << std::endl;
+        pScene = createProceduralScene();
+        if (pScene == nullptr)
+        {
+            return test_fail("Can't create the procedural scene");
+        }
+    }
+
+    const SceneBVH* pBVH = pScene->getBVH();
+    std::vector<SceneBVH::Leaf> linearVisible;
+    std::vector<uint32_t> bvhVisible;
+    float linearTime = 0;
+    float bvhTime = 0;
+
+    for (uint32_t view = 0; view < kNumViews; view++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(pBVH->getBounds());
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        cullLinear(pScene.get(), pCamera.get(), linearVisible);
+        CpuTimer::TimePoint mid = CpuTimer::getCurrentTimePoint();
+        pBVH = pScene->getBVH();
+        pBVH->cull(pCamera.get(), bvhVisible);
+        CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+
+        linearTime += CpuTimer::calcDuration(start, mid);
+        bvhTime += CpuTimer::calcDuration(mid, end);
+
+        // Node boxes enclose their leaves, so the hierarchy must produce exactly the same set as the linear loop
+        if (linearVisible.size() != bvhVisible.size())
+        {
+            return test_fail("BVH visible count doesn't match the linear culling loop");
+        }
+        for (size_t i = 0; i < bvhVisible.size(); i++)
+        {
+            const SceneBVH::Leaf& leaf = pBVH->getLeaf(bvhVisible[i]);
+            const SceneBVH::Leaf& ref = linearVisible[i];
+            if (leaf.modelID != ref.modelID || leaf.modelInstanceID != ref.modelInstanceID || leaf.meshID != ref.meshID || leaf.meshInstanceID != ref.meshInstanceID)
+            {
+                return test_fail("BVH visible list doesn't match the linear culling loop");
+            }
+        }
+    }
+
+    // Move an instance and make sure refitting picks it up
+    const Scene::ModelInstance::SharedPtr& pInstance = pScene->getModelInstance(0, 0);
+    pInstance->setTranslation(pInstance->getTranslation() + vec3(1000.0f), true);
+    pBVH = pScene->getBVH();
+    for (uint32_t leafID = 0; leafID < pBVH->getLeafCount(); leafID++)
+    {
+        const SceneBVH::Leaf& leaf = pBVH->getLeaf(leafID);
+        if (leaf.modelID == 0 && leaf.modelInstanceID == 0)
+        {
+            BoundingBox expected = pInstance->getObject()->getMeshInstance(leaf.meshID, leaf.meshInstanceID)->getBoundingBox().transform(pInstance->getTransformMatrix());
+            if ((expected == leaf.box) == false)
+            {
+                return test_fail("BVH wasn't refitted after an instance moved");
+            }
+        }
+    }
+
+    // Mesh instances can move on their own. Both the BVH and the transform buffer must pick that up.
+    const Model::MeshInstance::SharedPtr& pMeshInstance = pInstance->getObject()->getMeshInstance(0, 0);
+    pMeshInstance->setTranslation(pMeshInstance->getTranslation() + vec3(500.0f), true);
+    pBVH = pScene->getBVH();
+    const SceneTransformBuffer* pTransforms = pScene->getTransformBuffer();
+    for (uint32_t leafID = 0; leafID < pBVH->getLeafCount(); leafID++)
+    {
+        const SceneBVH::Leaf& leaf = pBVH->getLeaf(leafID);
+        if (leaf.modelID == 0 && leaf.meshID == 0 && leaf.meshInstanceID == 0)
+        {
+            const Scene::ModelInstance* pLeafInstance = pScene->getModelInstance(0, leaf.modelInstanceID).get();
+            BoundingBox expected = pMeshInstance->getBoundingBox().transform(pLeafInstance->getTransformMatrix());
+            if ((expected == leaf.box) == false)
+            {
+                return test_fail("BVH wasn't refitted after a mesh instance moved");
+            }
+            if (pTransforms->getTransform(leafID).worldMat != pLeafInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix())
+            {
+                return test_fail("Transform buffer wasn't updated after a mesh instance moved");
+            }
+        }
+    }
+
+    std::cout << "Scene BVH: " << pBVH->getLeafCount() << " mesh instances, " << pBVH->getNodeCount() << " nodes" << std::endl;
+    std::cout << "Linear culling: " << linearTime / kNumViews << "ms per view, BVH culling: " << bvhTime / kNumViews << "ms per view" << std::endl;
+    return test_pass();
+}
+
+testing_func(CullingTest, TestBatchedCulling)
+{
+    BoundingBox bounds = BoundingBox::fromMinMax(vec3(-1000.0f), vec3(1000.0f));
+    BoundingBoxSoA boxes;
+    boxes.resize(kNumBatchedBoxes);
+    for (uint32_t i = 0; i < kNumBatchedBoxes; i++)
+    {
+        BoundingBox box;
+        box.center = bounds.getMinPos() + vec3(TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne()) * bounds.getSize();
+        box.extent = vec3(TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne(), TestHelper::randFloatZeroToOne()) * 10.0f;
+        boxes.set(i, box);
+    }
+
+    // Odd count to exercise the remainder loop
+    const uint32_t count = kNumBatchedBoxes - 3;
+    std::vector<uint8_t> scalarMask(count);
+    std::vector<uint8_t> batchedMask(count);
+    float scalarTime = 0;
+    float sseTime = 0;
+    float avxTime = 0;
+
+    // Both widths are measured if the CPU supports AVX
+    const bool avxEnabled = Camera::isAvxCullingEnabled();
+    const bool avxSupported = isAvxSupported();
+
+    for (uint32_t view = 0; view < 10; view++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(bounds);
+        pCamera->getViewProjMatrix(); // Update the frustum outside of the timed region
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scalarMask[i] = pCamera->isObjectCulled(boxes.get(i)) ? 0 : 1;
+        }
+        scalarTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        for (bool avx : { false, true })
+        {
+            if (avx && avxSupported == false)
+            {
+                continue;
+            }
+
+            Camera::setAvxCullingEnabled(avx);
+            std::fill(batchedMask.begin(), batchedMask.end(), 2);
+            start = CpuTimer::getCurrentTimePoint();
+            pCamera->cullBoxes(boxes, 0, count, batchedMask.data());
+            (avx ? avxTime : sseTime) += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            if (scalarMask != batchedMask)
+            {
+                Camera::setAvxCullingEnabled(avxEnabled);
+                return test_fail(std::string("Batched culling result doesn't match Camera::isObjectCulled() with ") + (avx ? "AVX" : "SSE"));
+            }
+        }
+    }
+    Camera::setAvxCullingEnabled(avxEnabled);
+
+    std::cout << "Culling " << count << " boxes: scalar " << scalarTime / 10 << "ms, SSE " << sseTime / 10 << "ms";
+    if (avxSupported)
+    {
+        std::cout << ", AVX " << avxTime / 10 << "ms" << std::endl;
+    }
+    else
+    {
+        std::cout << ", AVX not supported by the CPU" << std::endl;
+    }
+    return test_pass();
+}
+
+int main()
+{
+    CullingTest ct;
+    ct.init(true);
+    ct.run();
+    return 0;
+}
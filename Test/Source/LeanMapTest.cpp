@@ -0,0 +1,204 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LeanMapTest.h"
+#include "Effects/NormalMap/LeanMap.h"
+#include <random>
+
+namespace
+{
+    const ResourceFormat kFormats[] = { ResourceFormat::RGBA8Unorm, ResourceFormat::BGRA8Unorm, ResourceFormat::BGRX8Unorm, ResourceFormat::RGBA8UnormSrgb, ResourceFormat::BGRA8UnormSrgb };
+
+    // Random normals, plus every byte value so that each entry of the decode tables is used
+    std::vector<uint8_t> createNormalMap(uint32_t width, uint32_t height, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data(width * height * 4);
+        for(size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (i < 1024) ? (uint8_t)(i / 4) : (uint8_t)(rng() & 0xff);
+        }
+        return data;
+    }
+
+    bool compareLeanData(const std::vector<vec4>& a, const std::vector<vec4>& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(vec4)) == 0;
+    }
+
+    std::vector<vec4> readLeanMap(const Texture* pLeanMap)
+    {
+        std::vector<uint8_t> data = gpDevice->getRenderContext()->readTextureSubresource(pLeanMap, 0);
+        std::vector<vec4> texels(pLeanMap->getWidth() * pLeanMap->getHeight());
+        std::memcpy(texels.data(), data.data(), std::min(data.size(), texels.size() * sizeof(vec4)));
+        return texels;
+    }
+}
+
+void LeanMapTest::addTests()
+{
+    addTestToList<TestMatchesReference>();
+    addTestToList<TestTextureAndFile>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(LeanMapTest, TestMatchesReference)
+{
+    // Widths which aren't a multiple of the SIMD width exercise the scalar tail
+    const uint32_t kWidths[] = { 1, 3, 4, 7, 64, 257 };
+    ThreadPool::SharedPtr pSingleThread = ThreadPool::create(1);
+    ThreadPool::SharedPtr pPool = ThreadPool::create(4);
+
+    for(ResourceFormat format : kFormats)
+    {
+        for(uint32_t width : kWidths)
+        {
+            const uint32_t height = 33;
+            std::vector<uint8_t> normalMap = createNormalMap(width, height, width);
+            std::vector<vec4> reference(width * height);
+            std::vector<vec4> result(width * height);
+
+            if(LeanMap::computeLeanDataReference(format, width, height, normalMap.data(), reference.data()) == false)
+            {
+                return test_fail("The reference implementation doesn't support the format");
+            }
+
+            for(ThreadPool* pTestPool : { pSingleThread.get(), pPool.get() })
+            {
+                if(LeanMap::computeLeanData(format, width, height, normalMap.data(), result.data(), pTestPool) == false)
+                {
+                    return test_fail("computeLeanData() doesn't support the format");
+                }
+                if(compareLeanData(reference, result) == false)
+                {
+                    return test_fail("LEAN map doesn't match the reference implementation for format " + to_string(format) + ", width " + std::to_string(width));
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t> normalMap = createNormalMap(4, 4, 0);
+    std::vector<vec4> result(16);
+    if(LeanMap::computeLeanData(ResourceFormat::R8Unorm, 4, 4, normalMap.data(), result.data()))
+    {
+        return test_fail("Unsupported format was accepted");
+    }
+    return test_pass();
+}
+
+testing_func(LeanMapTest, TestTextureAndFile)
+{
+    const uint32_t width = 67;
+    const uint32_t height = 31;
+    std::vector<uint8_t> normalMap = createNormalMap(width, height, 1);
+
+    // GPU readback of a texture
+    std::vector<vec4> reference(width * height);
+    LeanMap::computeLeanDataReference(ResourceFormat::RGBA8Unorm, width, height, normalMap.data(), reference.data());
+    Texture::SharedPtr pNormalMap = Texture::create2D(width, height, ResourceFormat::RGBA8Unorm, 1, 1, normalMap.data());
+    Texture::SharedPtr pLeanMap = LeanMap::createFromNormalMap(pNormalMap.get());
+    if(pLeanMap == nullptr || compareLeanData(reference, readLeanMap(pLeanMap.get())) == false)
+    {
+        return test_fail("LEAN map created from a texture doesn't match the reference implementation");
+    }
+
+    // CPU decoding of a file must match the texture loaded from the same file
+    const std::string filename = getExecutableDirectory() + "/LeanMapTest.png";
+    Bitmap::saveImage(filename, width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, normalMap.data());
+    for(bool isSrgb : { false, true })
+    {
+        Texture::SharedPtr pFileTexture = createTextureFromFile(filename, false, isSrgb);
+        Texture::SharedPtr pFromTexture = pFileTexture ? LeanMap::createFromNormalMap(pFileTexture.get()) : nullptr;
+        Texture::SharedPtr pFromFile = LeanMap::createFromNormalMapFile(filename, isSrgb);
+        if(pFromTexture == nullptr || pFromFile == nullptr)
+        {
+            std::remove(filename.c_str());
+            return test_fail("Failed to create the LEAN maps from " + filename);
+        }
+        if(compareLeanData(readLeanMap(pFromTexture.get()), readLeanMap(pFromFile.get())) == false)
+        {
+            std::remove(filename.c_str());
+            return test_fail(std::string("LEAN map created from the file doesn't match the one created from the texture") + (isSrgb ? " (sRGB)" : ""));
+        }
+    }
+
+    std::remove(filename.c_str());
+    return test_pass();
+}
+
+testing_func(LeanMapTest, TestPerformance)
+{
+    const uint32_t kSize = 4096;
+    std::vector<uint8_t> normalMap = createNormalMap(kSize, kSize, 2);
+    std::vector<vec4> reference(kSize * kSize);
+    std::vector<vec4> result(kSize * kSize);
+
+    for(ResourceFormat format : { ResourceFormat::RGBA8Unorm, ResourceFormat::RGBA8UnormSrgb })
+    {
+        std::cout << kSize << "x" << kSize << " " << to_string(format) << std::endl;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        LeanMap::computeLeanDataReference(format, kSize, kSize, normalMap.data(), reference.data());
+        std::cout << "    Reference: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms" << std::endl;
+
+        const uint32_t kThreadCounts[] = { 1, 2, 4, 8, 16 };
+        for(uint32_t threadCount : kThreadCounts)
+        {
+            ThreadPool::SharedPtr pPool = ThreadPool::create(threadCount);
+            start = CpuTimer::getCurrentTimePoint();
+            LeanMap::computeLeanData(format, kSize, kSize, normalMap.data(), result.data(), pPool.get());
+            std::cout << "    " << threadCount << " threads: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms" << std::endl;
+
+            if(compareLeanData(reference, result) == false)
+            {
+                return test_fail("LEAN map doesn't match the reference implementation");
+            }
+        }
+    }
+
+    // The whole process, including the readback and the upload of the LEAN map
+    Texture::SharedPtr pNormalMap = Texture::create2D(kSize, kSize, ResourceFormat::RGBA8Unorm, 1, 1, normalMap.data());
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Texture::SharedPtr pLeanMap = LeanMap::createFromNormalMap(pNormalMap.get());
+    std::cout << "createFromNormalMap(): " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms" << std::endl;
+
+    const std::string filename = getExecutableDirectory() + "/LeanMapTest.png";
+    Bitmap::saveImage(filename, kSize, kSize, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha | Bitmap::ExportFlags::Uncompressed, ResourceFormat::RGBA8Unorm, true, normalMap.data());
+    start = CpuTimer::getCurrentTimePoint();
+    pLeanMap = LeanMap::createFromNormalMapFile(filename);
+    std::cout << "createFromNormalMapFile(): " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms" << std::endl;
+    std::remove(filename.c_str());
+
+    return pLeanMap ? test_pass() : test_fail("Failed to create the LEAN map from " + filename);
+}
+
+int main()
+{
+    LeanMapTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
@@ -0,0 +1,217 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightClustersTest.h"
+#include "Graphics/Scene/LightClusters.h"
+#include <random>
+#include <algorithm>
+
+namespace
+{
+    Camera::SharedPtr createCamera()
+    {
+        Camera::SharedPtr pCamera = Camera::create();
+        pCamera->setPosition(vec3(0, 0, 0));
+        pCamera->setTarget(vec3(0.3f, 0.1f, -1));
+        pCamera->setUpVector(vec3(0, 1, 0));
+        pCamera->setAspectRatio(16.0f / 9.0f);
+        pCamera->setDepthRange(0.1f, 200);
+        return pCamera;
+    }
+
+    std::vector<Light::SharedPtr> createPointLights(uint32_t count, float extent, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> pos(-extent, extent);
+        std::uniform_real_distribution<float> intensity(0.25f, 1);
+        std::vector<Light::SharedPtr> lights;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            PointLight::SharedPtr pLight = PointLight::create();
+            pLight->setWorldPosition(vec3(pos(rng), pos(rng), pos(rng)));
+            pLight->setIntensity(vec3(intensity(rng), intensity(rng), intensity(rng)));
+            lights.push_back(pLight);
+        }
+        return lights;
+    }
+
+    // Mirrors getLightClusterIndex() in ShaderCommon.h
+    bool findCluster(const LightClusters* pClusters, const Camera* pCamera, const vec3& posW, uint32_t& cluster)
+    {
+        const LightClusterData& grid = pClusters->getData();
+        vec4 posH = pCamera->getViewProjMatrix() * vec4(posW, 1);
+        vec2 ndc = vec2(posH) / posH.w;
+        float depth = -(pCamera->getViewMatrix() * vec4(posW, 1)).z;
+        if (posH.w <= 0 || abs(ndc.x) > 1 || abs(ndc.y) > 1 || depth < pCamera->getNearPlane() || depth > pCamera->getFarPlane())
+        {
+            return false;
+        }
+
+        uint32_t x = glm::min(uint32_t(glm::clamp(ndc.x * 0.5f + 0.5f, 0.0f, 1.0f) * grid.tilesX), grid.tilesX - 1);
+        uint32_t y = glm::min(uint32_t(glm::clamp(ndc.y * 0.5f + 0.5f, 0.0f, 1.0f) * grid.tilesY), grid.tilesY - 1);
+        uint32_t slice = uint32_t(glm::clamp(log(depth / grid.nearZ) * grid.sliceScale, 0.0f, float(grid.slices - 1)));
+        cluster = pClusters->getClusterIndex(x, y, slice);
+        return true;
+    }
+}
+
+void LightClustersTest::addTests()
+{
+    addTestToList<TestConservativeBinning>();
+    addTestToList<TestGlobalLights>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(LightClustersTest, TestConservativeBinning)
+{
+    Camera::SharedPtr pCamera = createCamera();
+    std::vector<Light::SharedPtr> lights = createPointLights(500, 60, 0);
+    LightClusters::SharedPtr pClusters = LightClusters::create();
+    ThreadPool::SharedPtr pPool = ThreadPool::create(4);
+
+    for (ThreadPool* pTestPool : { (ThreadPool*)nullptr, pPool.get() })
+    {
+        pClusters->build(lights, pCamera.get(), pTestPool);
+
+        // The bounding spheres
+        for (uint32_t i = 0; i < (uint32_t)pClusters->getLights().size(); i++)
+        {
+            const LightData& data = pClusters->getLights()[i]->getData();
+            float radius = sqrt(glm::max(data.intensity.x, glm::max(data.intensity.y, data.intensity.z)) / pClusters->getIntensityCutoff());
+            const vec4& bounds = pClusters->getLightBounds(i);
+            if (bounds.w != 0 && abs(bounds.w - radius) > 1e-3f * radius)
+            {
+                return test_fail("Wrong light radius");
+            }
+        }
+
+        // Every light which reaches a point inside the frustum must be in the point's cluster
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> pos(-60, 60);
+        uint32_t testedPoints = 0;
+        for (uint32_t p = 0; p < 100000; p++)
+        {
+            vec3 posW(pos(rng), pos(rng), pos(rng));
+            uint32_t cluster;
+            if (findCluster(pClusters.get(), pCamera.get(), posW, cluster) == false)
+            {
+                continue;
+            }
+            testedPoints++;
+
+            const LightClusters::Range& range = pClusters->getClusterRange(cluster);
+            const uint32_t* pBegin = pClusters->getLightIndices().data() + range.first;
+            const uint32_t* pEnd = pBegin + range.count;
+            for (uint32_t i = 0; i < (uint32_t)pClusters->getLights().size(); i++)
+            {
+                const LightData& data = pClusters->getLights()[i]->getData();
+                float radius = sqrt(glm::max(data.intensity.x, glm::max(data.intensity.y, data.intensity.z)) / pClusters->getIntensityCutoff());
+                if (length(posW - data.worldPos) < radius * 0.999f && std::find(pBegin, pEnd, i) == pEnd)
+                {
+                    return test_fail("Light " + std::to_string(i) + " is missing from cluster " + std::to_string(cluster));
+                }
+            }
+        }
+
+        if (testedPoints < 1000)
+        {
+            return test_fail("Not enough points inside the frustum");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(LightClustersTest, TestGlobalLights)
+{
+    Camera::SharedPtr pCamera = createCamera();
+    std::vector<Light::SharedPtr> lights = createPointLights(10, 20, 2);
+    lights.insert(lights.begin() + 5, DirectionalLight::create());
+    lights.push_back(DirectionalLight::create());
+
+    LightClusters::SharedPtr pClusters = LightClusters::create(8, 4, 16);
+    pClusters->build(lights, pCamera.get());
+    if (pClusters->getData().globalLightCount != 2 || pClusters->getData().lightCount != 12)
+    {
+        return test_fail("Wrong light counts");
+    }
+    if (pClusters->getLights()[0] != lights[5].get() || pClusters->getLights()[1] != lights[11].get())
+    {
+        return test_fail("Directional lights should come first");
+    }
+    for (uint32_t index : pClusters->getLightIndices())
+    {
+        if (index < 2)
+        {
+            return test_fail("Directional lights shouldn't be binned");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(LightClustersTest, TestPerformance)
+{
+    Camera::SharedPtr pCamera = createCamera();
+    LightClusters::SharedPtr pClusters = LightClusters::create();
+    const uint32_t kLightCounts[] = { 1000, 2000, 5000, 10000 };
+    const uint32_t kRuns = 10;
+
+    for (uint32_t lightCount : kLightCounts)
+    {
+        std::vector<Light::SharedPtr> lights = createPointLights(lightCount, 100, lightCount);
+        std::cout << lightCount << " point lights" << std::endl;
+
+        for (ThreadPool* pPool : { (ThreadPool*)nullptr, ThreadPool::getDefault() })
+        {
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t run = 0; run < kRuns; run++)
+            {
+                pClusters->build(lights, pCamera.get(), pPool);
+            }
+            std::cout << "    " << (pPool ? "Thread pool: " : "Single thread: ") << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kRuns << "ms" << std::endl;
+        }
+
+        // The number of lights a pixel evaluates, compared with looping over all the lights
+        uint32_t maxCount = 0;
+        uint32_t usedClusters = 0;
+        for (uint32_t c = 0; c < pClusters->getClusterCount(); c++)
+        {
+            maxCount = glm::max(maxCount, pClusters->getClusterRange(c).count);
+            usedClusters += pClusters->getClusterRange(c).count ? 1 : 0;
+        }
+        float average = usedClusters ? (float)pClusters->getLightIndices().size() / usedClusters : 0;
+        std::cout << "    Lights per non-empty cluster: " << average << " average, " << maxCount << " max. " << pClusters->getLightIndices().size() << " indices" << std::endl;
+    }
+    return test_pass();
+}
+
+int main()
+{
+    LightClustersTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
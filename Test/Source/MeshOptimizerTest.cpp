@@ -0,0 +1,294 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshOptimizerTest.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+    const char* kModelFiles[] = { "sphere.obj", "torus.obj", "ogre/bs_rest.obj", "SanMiguel/san-miguel.bin", "CityScene/CityScene.bin" };
+
+    struct TestMesh
+    {
+        std::vector<uint32_t> indices;
+        std::vector<glm::vec3> positions;
+    };
+
+    // A displaced grid with shuffled triangles, the worst case for the vertex cache
+    TestMesh createGrid(uint32_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(-0.25f, 0.25f);
+
+        TestMesh mesh;
+        for(uint32_t y = 0; y <= size; y++)
+        {
+            for(uint32_t x = 0; x <= size; x++)
+            {
+                mesh.positions.push_back(glm::vec3((float)x, dist(rng), (float)y));
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for(uint32_t y = 0; y < size; y++)
+        {
+            for(uint32_t x = 0; x < size; x++)
+            {
+                uint32_t v0 = y * (size + 1) + x;
+                uint32_t v1 = v0 + 1;
+                uint32_t v2 = v0 + size + 1;
+                uint32_t v3 = v2 + 1;
+                triangles.push_back({ v0, v2, v1 });
+                triangles.push_back({ v1, v2, v3 });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+
+        for(const auto& t : triangles)
+        {
+            mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+        }
+        return mesh;
+    }
+
+    // Rotate each triangle so that it starts with its smallest index, which keeps the winding, and sort the triangles
+    std::vector<std::array<uint32_t, 3>> getCanonicalTriangles(const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        for(size_t i = 0; i < triangles.size(); i++)
+        {
+            std::array<uint32_t, 3> t = { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+            while(t[0] > t[1] || t[0] > t[2])
+            {
+                std::rotate(t.begin(), t.begin() + 1, t.end());
+            }
+            triangles[i] = t;
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // Adds the vertex cache statistics of all the triangle-list meshes of a model
+    MeshOptimizer::CacheStats getModelCacheStats(const Model* pModel)
+    {
+        MeshOptimizer::CacheStats total;
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            const Mesh* pMesh = pModel->getMesh(i).get();
+            if(pMesh->getVao()->getPrimitiveTopology() != Vao::Topology::TriangleList)
+            {
+                continue;
+            }
+
+            const Buffer::SharedPtr& pIB = pMesh->getVao()->getIndexBuffer();
+            const void* pData = pIB->map(Buffer::MapType::Read);
+            std::vector<uint32_t> indices(pMesh->getIndexCount());
+            if(pMesh->getVao()->getIndexBufferFormat() == ResourceFormat::R16Uint)
+            {
+                const uint16_t* pShortIndices = (const uint16_t*)pData;
+                indices.assign(pShortIndices, pShortIndices + indices.size());
+            }
+            else
+            {
+                std::memcpy(indices.data(), pData, indices.size() * sizeof(uint32_t));
+            }
+            pIB->unmap();
+
+            MeshOptimizer::CacheStats stats = MeshOptimizer::simulateVertexCache(indices.data(), (uint32_t)indices.size(), pMesh->getVertexCount());
+            total.triangleCount += stats.triangleCount;
+            total.vertexCount += stats.vertexCount;
+            total.missCount += stats.missCount;
+        }
+
+        total.acmr = total.triangleCount ? (float)total.missCount / (float)total.triangleCount : 0;
+        total.atvr = total.vertexCount ? (float)total.missCount / (float)total.vertexCount : 0;
+        return total;
+    }
+}
+
+void MeshOptimizerTest::addTests()
+{
+    addTestToList<TestTriangleOrder>();
+    addTestToList<TestVertexOrder>();
+    addTestToList<TestModelLoading>();
+}
+
+testing_func(MeshOptimizerTest, TestTriangleOrder)
+{
+    const uint32_t kGridSizes[] = { 1, 7, 100, 513 };
+    for(uint32_t size : kGridSizes)
+    {
+        TestMesh mesh = createGrid(size, size);
+        const uint32_t indexCount = (uint32_t)mesh.indices.size();
+        const uint32_t vertexCount = (uint32_t)mesh.positions.size();
+        MeshOptimizer::CacheStats before = MeshOptimizer::simulateVertexCache(mesh.indices.data(), indexCount, vertexCount);
+
+        // With and without the overdraw ordering
+        for(uint32_t usePositions = 0; usePositions < 2; usePositions++)
+        {
+            std::vector<uint32_t> optimized = mesh.indices;
+            const float* pPositions = usePositions ? (const float*)mesh.positions.data() : nullptr;
+            MeshOptimizer::optimizeTriangleOrder(optimized.data(), indexCount, vertexCount, pPositions, sizeof(glm::vec3));
+
+            if(getCanonicalTriangles(optimized) != getCanonicalTriangles(mesh.indices))
+            {
+                return test_fail("The optimized mesh has different triangles");
+            }
+
+            // The same mesh as a submesh in the middle of a larger shared vertex buffer must get the same order
+            const uint32_t baseVertex = 1000;
+            std::vector<glm::vec3> sharedPositions(baseVertex, glm::vec3(0));
+            sharedPositions.insert(sharedPositions.end(), mesh.positions.begin(), mesh.positions.end());
+            sharedPositions.resize(sharedPositions.size() + baseVertex, glm::vec3(0));
+            std::vector<uint32_t> submesh = mesh.indices;
+            for(auto& index : submesh)
+            {
+                index += baseVertex;
+            }
+            pPositions = usePositions ? (const float*)sharedPositions.data() : nullptr;
+            MeshOptimizer::optimizeTriangleOrder(submesh.data(), indexCount, (uint32_t)sharedPositions.size(), pPositions, sizeof(glm::vec3));
+            for(uint32_t i = 0; i < indexCount; i++)
+            {
+                if(submesh[i] != optimized[i] + baseVertex)
+                {
+                    return test_fail("Optimizing a submesh of a shared vertex buffer changed the result");
+                }
+            }
+
+            MeshOptimizer::CacheStats after = MeshOptimizer::simulateVertexCache(optimized.data(), indexCount, vertexCount);
+            std::cout << size << "x" << size << " grid" << (usePositions ? ", overdraw" : "") << ": ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+            if(size > 1 && after.acmr >= before.acmr)
+            {
+                return test_fail("The triangle order didn't improve the vertex cache efficiency");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestVertexOrder)
+{
+    TestMesh mesh = createGrid(100, 1);
+    const uint32_t indexCount = (uint32_t)mesh.indices.size();
+    const uint32_t vertexCount = (uint32_t)mesh.positions.size() + 1;
+
+    // Add a vertex which isn't referenced. It needs to end up last.
+    mesh.positions.push_back(glm::vec3(-1, -1, -1));
+
+    std::vector<uint32_t> indices = mesh.indices;
+    std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexOrder(indices.data(), indexCount, vertexCount);
+
+    std::vector<bool> used(vertexCount, false);
+    for(uint32_t newIndex : remap)
+    {
+        if(newIndex >= vertexCount || used[newIndex])
+        {
+            return test_fail("The vertex remap is not a permutation");
+        }
+        used[newIndex] = true;
+    }
+    if(remap.back() != vertexCount - 1)
+    {
+        return test_fail("An unreferenced vertex wasn't moved to the end");
+    }
+
+    std::vector<uint8_t> data((const uint8_t*)mesh.positions.data(), (const uint8_t*)(mesh.positions.data() + vertexCount));
+    MeshOptimizer::remapVertices(remap, sizeof(glm::vec3), data);
+    const glm::vec3* pRemapped = (const glm::vec3*)data.data();
+
+    // Each index needs to refer to the same position as before, and the vertices need to be fetched in order
+    uint32_t nextVertex = 0;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        if(pRemapped[indices[i]] != mesh.positions[mesh.indices[i]])
+        {
+            return test_fail("The remapped indices refer to different vertices");
+        }
+        if(indices[i] > nextVertex)
+        {
+            return test_fail("The vertices are not ordered by their first use");
+        }
+        nextVertex = std::max(nextVertex, indices[i] + 1);
+    }
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestModelLoading)
+{
+    for(const char* file : kModelFiles)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(file, fullpath) == false)
+        {
+            std::cout << "Skipping " << file << ", file not found" << std::endl;
+            continue;
+        }
+
+        Model::SharedPtr pModel = Model::createFromFile(fullpath.c_str());
+        Model::SharedPtr pOptimized = Model::createFromFile(fullpath.c_str(), Model::LoadFlags::OptimizeMeshes);
+        if(pModel == nullptr || pOptimized == nullptr)
+        {
+            return test_fail("Failed to load " + fullpath);
+        }
+        if(pModel->getMeshCount() != pOptimized->getMeshCount() || pModel->getIndexCount() != pOptimized->getIndexCount() || pModel->getVertexCount() != pOptimized->getVertexCount())
+        {
+            return test_fail("Optimizing the meshes of " + fullpath + " changed the model");
+        }
+
+        for(uint32_t i = 0; i < pOptimized->getMeshCount(); i++)
+        {
+            const Mesh* pMesh = pOptimized->getMesh(i).get();
+            ResourceFormat expected = (pMesh->getVertexCount() <= 0x10000) ? ResourceFormat::R16Uint : ResourceFormat::R32Uint;
+            if(pMesh->getVao()->getPrimitiveTopology() == Vao::Topology::TriangleList && pMesh->getVao()->getIndexBufferFormat() != expected)
+            {
+                return test_fail("Mesh " + std::to_string(i) + " of " + fullpath + " has the wrong index format");
+            }
+        }
+
+        MeshOptimizer::CacheStats before = getModelCacheStats(pModel.get());
+        MeshOptimizer::CacheStats after = getModelCacheStats(pOptimized.get());
+        std::cout << file << ": " << before.triangleCount << " triangles" << std::endl;
+        std::cout << "    ACMR " << before.acmr << " -> " << after.acmr << std::endl;
+        std::cout << "    ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+        if(after.acmr > before.acmr * 1.05f)
+        {
+            return test_fail("Optimizing the meshes of " + fullpath + " made the vertex cache efficiency worse");
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    MeshOptimizerTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
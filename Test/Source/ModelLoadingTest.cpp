@@ -0,0 +1,705 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ModelLoadingTest.h"
+#include "Graphics/Model/Loaders/BinaryModelImporter.h"
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/TextureCache.h"
+#include "Graphics/TextureBaker.h"
+#include "Utils/DDSHeader.h"
+#include <thread>
+#include <fstream>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+
+namespace
+{
+    // Large binary models. They are measured if they can be found in the data directories
+    const char* kModelFiles[] = { "SanMiguel/san-miguel.bin", "CityScene/CityScene.bin" };
+    const char* kSceneFile = "CityScene/Tiled_CityScene_20x20.fscene";
+    const uint32_t kThreadCounts[] = { 1, 2, 4, 8, 16 };
+
+    struct LoadStats
+    {
+        float loadTime = 0;
+        size_t peakWorkingSet = 0;  // Includes the mapped file pages
+        size_t peakPrivate = 0;     // Memory allocated by the loader
+        Model::SharedPtr pModel;
+    };
+
+    void getMemoryUsage(size_t& workingSet, size_t& privateBytes)
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters;
+        GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+        workingSet = counters.WorkingSetSize;
+        privateBytes = counters.PrivateUsage;
+    }
+
+    // The peak counters of the OS can't be reset, so the usage is sampled on a separate thread while the model loads
+    LoadStats loadModel(const std::string& filename, uint64_t mappingBudget)
+    {
+        BinaryModelImporter::setMappingBudget(mappingBudget);
+
+        LoadStats stats;
+        size_t baseWorkingSet, basePrivate;
+        getMemoryUsage(baseWorkingSet, basePrivate);
+
+        std::atomic<bool> loading(true);
+        std::thread sampler([&]()
+        {
+            while (loading)
+            {
+                size_t workingSet, privateBytes;
+                getMemoryUsage(workingSet, privateBytes);
+                stats.peakWorkingSet = std::max(stats.peakWorkingSet, workingSet - std::min(workingSet, baseWorkingSet));
+                stats.peakPrivate = std::max(stats.peakPrivate, privateBytes - std::min(privateBytes, basePrivate));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        stats.pModel = Model::createFromFile(filename.c_str());
+        stats.loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        loading = false;
+        sampler.join();
+        BinaryModelImporter::setMappingBudget(BinaryFileReader::kDefaultMappingBudget);
+        return stats;
+    }
+
+    bool compareModels(const Model* pStreamed, const Model* pMapped)
+    {
+        return pStreamed->getMeshCount() == pMapped->getMeshCount() &&
+            pStreamed->getInstanceCount() == pMapped->getInstanceCount() &&
+            pStreamed->getVertexCount() == pMapped->getVertexCount() &&
+            pStreamed->getIndexCount() == pMapped->getIndexCount() &&
+            pStreamed->getTextureCount() == pMapped->getTextureCount() &&
+            pStreamed->getBoundingBox().center == pMapped->getBoundingBox().center &&
+            pStreamed->getBoundingBox().extent == pMapped->getBoundingBox().extent;
+    }
+
+    // Uses models which ship with the framework. The teapot is referenced by two entries which share the model, the sphere entry modifies its model so it isn't shared
+    const char* kTestScene = R"({
+    "version": 2,
+    "models": [
+        {"file": "teapot.obj", "instances": [{"name": "Teapot 0", "translation": [1, 0, 0]}, {"name": "Teapot 1", "rotation": [0, 90, 0]}]},
+        {"file": "sphere.obj", "name": "Sphere", "instances": [{"name": "Sphere 0", "scaling": [2, 2, 2]}]},
+        {"file": "teapot.obj", "instances": [{"name": "Teapot 2", "translation": [0, 3, 0]}]},
+        {"file": "torus.obj"},
+        {"file": "box.obj", "instances": [{"name": "Box 0", "translation": [0, 0, -2]}]}
+    ],
+    "lights": [
+        {"name": "Sun", "type": "dir_light", "intensity": [1, 1, 1], "direction": [0.5, -1, 0]},
+        {"name": "Bulb", "type": "point_light", "intensity": [2, 2, 2], "pos": [0, 4, 0]}
+    ],
+    "include": ["Scenes/ogre.fscene"]
+})";
+
+    struct SceneLoadResult
+    {
+        Scene::SharedPtr pScene;
+        float loadTime = 0;
+    };
+
+    SceneLoadResult loadScene(const std::string& filename, Scene::LoadFlags flags)
+    {
+        // Reset the IDs so that both loads start from the same state
+        Model::resetGlobalIdCounter();
+
+        SceneLoadResult result;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        result.pScene = Scene::loadFromFile(filename, Model::LoadFlags::None, flags);
+        result.loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return result;
+    }
+
+    std::string compareScenes(const Scene* pSerial, const Scene* pConcurrent)
+    {
+        if (pSerial->getModelCount() != pConcurrent->getModelCount()) return "Model count mismatch";
+        for (uint32_t m = 0; m < pSerial->getModelCount(); m++)
+        {
+            const Model* pA = pSerial->getModel(m).get();
+            const Model* pB = pConcurrent->getModel(m).get();
+            if (pA->getId() != pB->getId() || pA->getName() != pB->getName()) return "Model " + std::to_string(m) + " mismatch";
+            if (pA->getMeshCount() != pB->getMeshCount()) return "Mesh count mismatch in model " + pA->getName();
+            for (uint32_t i = 0; i < pA->getMeshCount(); i++)
+            {
+                if (pA->getMesh(i)->getId() != pB->getMesh(i)->getId()) return "Mesh ID mismatch in model " + pA->getName();
+                if (pA->getMesh(i)->getMaterial()->getId() != pB->getMesh(i)->getMaterial()->getId()) return "Mesh material mismatch in model " + pA->getName();
+            }
+
+            if (pSerial->getModelInstanceCount(m) != pConcurrent->getModelInstanceCount(m)) return "Instance count mismatch in model " + pA->getName();
+            for (uint32_t i = 0; i < pSerial->getModelInstanceCount(m); i++)
+            {
+                const auto& pInstanceA = pSerial->getModelInstance(m, i);
+                const auto& pInstanceB = pConcurrent->getModelInstance(m, i);
+                if (pInstanceA->getName() != pInstanceB->getName() || pInstanceA->getTransformMatrix() != pInstanceB->getTransformMatrix())
+                {
+                    return "Instance " + pInstanceA->getName() + " mismatch";
+                }
+            }
+        }
+
+        if (pSerial->getMaterialCount() != pConcurrent->getMaterialCount()) return "Material count mismatch";
+        for (uint32_t i = 0; i < pSerial->getMaterialCount(); i++)
+        {
+            if (pSerial->getMaterial(i)->getId() != pConcurrent->getMaterial(i)->getId()) return "Material ID mismatch";
+        }
+
+        if (pSerial->getLightCount() != pConcurrent->getLightCount()) return "Light count mismatch";
+        for (uint32_t i = 0; i < pSerial->getLightCount(); i++)
+        {
+            if (pSerial->getLight(i)->getName() != pConcurrent->getLight(i)->getName()) return "Light " + std::to_string(i) + " mismatch";
+        }
+        return "";
+    }
+
+    void printStageTimes(uint32_t threadCount, float totalTime)
+    {
+        ModelImporter::Stats stats = ModelImporter::getStats();
+        std::cout << "    " << threadCount << " threads: total " << totalTime << "ms, parse " << stats.parseTime << "ms, decode " << stats.decodeTime << "ms, create " << stats.createTime << "ms" << std::endl;
+    }
+
+    void printCacheStats(const std::string& label, float totalTime)
+    {
+        TextureCache::Stats stats = TextureCache::getStats();
+        std::cout << "    " << label << totalTime << "ms, " << stats.hitCount << " hits, " << stats.missCount << " misses, saved " << (stats.savedBytes >> 20) << "MB" << std::endl;
+    }
+
+    Texture::SharedPtr getNormalMap(const Model* pModel)
+    {
+        return pModel->getMeshCount() ? pModel->getMesh(0)->getMaterial()->getNormalMap() : nullptr;
+    }
+
+    template<typename T>
+    float measureLoad(bool useBakedFiles, const std::function<T()>& load, T& result)
+    {
+        TextureBaker::setEnabled(useBakedFiles);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        result = load();
+        float loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        TextureBaker::setEnabled(true);
+        return loadTime;
+    }
+
+    std::vector<uint8_t> readFile(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& filename, const std::vector<uint8_t>& data)
+    {
+        std::ofstream file(filename, std::ios::binary);
+        file.write((const char*)data.data(), data.size());
+    }
+
+    void removeFiles(const std::vector<std::string>& files)
+    {
+        for (const auto& file : files)
+        {
+            std::remove(file.c_str());
+        }
+    }
+}
+
+void ModelLoadingTest::addTests()
+{
+    addTestToList<TestMappedLoading>();
+    addTestToList<TestCorruptedImageHeader>();
+    addTestToList<TestParallelDecode>();
+    addTestToList<TestConcurrentSceneLoading>();
+    addTestToList<TestTextureCache>();
+    addTestToList<TestTextureBaking>();
+}
+
+testing_func(ModelLoadingTest, TestMappedLoading)
+{
+    // Always measure a small model, exported from a mesh which ships with the framework
+    std::vector<std::string> files;
+    Model::SharedPtr pSource = Model::createFromFile("sphere.obj");
+    if (pSource == nullptr)
+    {
+        return test_fail("Can't load the source model");
+    }
+    const std::string exported = getExecutableDirectory() + "/ModelLoadingTest.bin";
+    pSource->exportToBinaryFile(exported);
+    files.push_back(exported);
+
+    for (const char* file : kModelFiles)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(file, fullpath))
+        {
+            files.push_back(fullpath);
+        }
+        else
+        {
+            std::cout << "Skipping " << file << ", file not found" << std::endl;
+        }
+    }
+
+    for (const auto& file : files)
+    {
+        LoadStats streamed = loadModel(file, 0);
+        LoadStats mapped = loadModel(file, BinaryFileReader::kDefaultMappingBudget);
+
+        std::cout << file << std::endl;
+        std::cout << "    Streamed: " << streamed.loadTime << "ms, peak working set " << (streamed.peakWorkingSet >> 20) << "MB, peak private " << (streamed.peakPrivate >> 20) << "MB" << std::endl;
+        std::cout << "    Mapped:   " << mapped.loadTime << "ms, peak working set " << (mapped.peakWorkingSet >> 20) << "MB, peak private " << (mapped.peakPrivate >> 20) << "MB" << std::endl;
+
+        if (streamed.pModel == nullptr || mapped.pModel == nullptr)
+        {
+            return test_fail("Failed to load " + file);
+        }
+        if (compareModels(streamed.pModel.get(), mapped.pModel.get()) == false)
+        {
+            return test_fail("Mapped and streamed loading of " + file + " created different models");
+        }
+    }
+
+    std::remove(exported.c_str());
+    return test_pass();
+}
+
+testing_func(ModelLoadingTest, TestCorruptedImageHeader)
+{
+    // The ogre model has textures, so the exported file contains binary images
+    Model::SharedPtr pSource = Model::createFromFile("ogre/bs_rest.obj");
+    if (pSource == nullptr || pSource->getTextureCount() == 0)
+    {
+        return test_fail("Can't load the source model");
+    }
+    const std::string exported = getExecutableDirectory() + "/ModelLoadingTest.bin";
+    const std::string corrupted = getExecutableDirectory() + "/ModelLoadingTestCorrupted.bin";
+    pSource->exportToBinaryFile(exported);
+    std::vector<uint8_t> data = readFile(exported);
+    bool exportLoads = Model::createFromFile(exported.c_str()) != nullptr;
+    std::remove(exported.c_str());
+    if (exportLoads == false)
+    {
+        return test_fail("Can't load the exported model");
+    }
+
+    // A version 2 image header is the tag followed by version, width, height, bpp, channel count, format ID and data size
+    const char* kTag = "BinImage";
+    auto it = std::search(data.begin(), data.end(), kTag, kTag + 8);
+    if (it == data.end())
+    {
+        return test_fail("The exported file doesn't contain a binary image");
+    }
+    const size_t widthOffset = (it - data.begin()) + 8 + sizeof(int32_t);
+    const size_t dataSizeOffset = widthOffset + 5 * sizeof(int32_t);
+
+    struct Corruption
+    {
+        const char* desc;
+        size_t offset;
+        int32_t value;
+    };
+    const Corruption kCorruptions[] =
+    {
+        { "data size smaller than the image", dataSizeOffset, 4 },
+        { "data size larger than the file", dataSizeOffset, 0x7fffffff },
+        { "image larger than the data size", widthOffset, 0x4000 },
+    };
+
+    // The loader reports the errors, don't block on them
+    bool showBox = Logger::isBoxShownOnError();
+    Logger::showBoxOnError(false);
+    for (const auto& c : kCorruptions)
+    {
+        std::vector<uint8_t> corruptedData = data;
+        memcpy(&corruptedData[c.offset], &c.value, sizeof(c.value));
+        writeFile(corrupted, corruptedData);
+        Model::SharedPtr pModel = Model::createFromFile(corrupted.c_str());
+        std::remove(corrupted.c_str());
+        if (pModel != nullptr)
+        {
+            Logger::showBoxOnError(showBox);
+            return test_fail(std::string("A binary image with a ") + c.desc + " was accepted");
+        }
+    }
+    Logger::showBoxOnError(showBox);
+    return test_pass();
+}
+
+testing_func(ModelLoadingTest, TestParallelDecode)
+{
+    // The Assimp importer and the binary importer are both measured using the small model. It's the reference for the large ones.
+    std::vector<std::string> files = { "sphere.obj" };
+    Model::SharedPtr pSource = Model::createFromFile("sphere.obj");
+    if (pSource == nullptr)
+    {
+        return test_fail("Can't load the source model");
+    }
+    const std::string exported = getExecutableDirectory() + "/ModelLoadingTest.bin";
+    pSource->exportToBinaryFile(exported);
+    files.push_back(exported);
+
+    for (const char* file : kModelFiles)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(file, fullpath))
+        {
+            files.push_back(fullpath);
+        }
+        else
+        {
+            std::cout << "Skipping " << file << ", file not found" << std::endl;
+        }
+    }
+
+    for (const auto& file : files)
+    {
+        std::cout << file << std::endl;
+        Model::SharedPtr pReference;
+        for (uint32_t threadCount : kThreadCounts)
+        {
+            ModelImporter::setThreadPool(ThreadPool::create(threadCount));
+            ModelImporter::resetStats();
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            Model::SharedPtr pModel = Model::createFromFile(file.c_str());
+            float totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            if (pModel == nullptr)
+            {
+                ModelImporter::setThreadPool(nullptr);
+                return test_fail("Failed to load " + file);
+            }
+            printStageTimes(threadCount, totalTime);
+
+            // The result must not depend on the number of threads
+            if (pReference == nullptr)
+            {
+                pReference = pModel;
+            }
+            else if (compareModels(pReference.get(), pModel.get()) == false)
+            {
+                ModelImporter::setThreadPool(nullptr);
+                return test_fail("Loading " + file + " with " + std::to_string(threadCount) + " threads created a different model");
+            }
+        }
+    }
+
+    // A scene loads many models, the stage times are accumulated over all of them
+    std::string sceneFile;
+    if (findFileInDataDirectories(kSceneFile, sceneFile))
+    {
+        std::cout << kSceneFile << std::endl;
+        for (uint32_t threadCount : kThreadCounts)
+        {
+            ModelImporter::setThreadPool(ThreadPool::create(threadCount));
+            ModelImporter::resetStats();
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            Scene::SharedPtr pScene = Scene::loadFromFile(sceneFile);
+            float totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            if (pScene == nullptr)
+            {
+                ModelImporter::setThreadPool(nullptr);
+                return test_fail("Failed to load " + sceneFile);
+            }
+            printStageTimes(threadCount, totalTime);
+        }
+    }
+    else
+    {
+        std::cout << "Skipping " << kSceneFile << ", file not found" << std::endl;
+    }
+
+    ModelImporter::setThreadPool(nullptr);
+    std::remove(exported.c_str());
+    return test_pass();
+}
+
+testing_func(ModelLoadingTest, TestConcurrentSceneLoading)
+{
+    const std::string testScene = getExecutableDirectory() + "/ModelLoadingTest.fscene";
+    {
+        std::ofstream file(testScene);
+        file << kTestScene;
+    }
+
+    std::vector<std::string> files = { testScene };
+    std::string fullpath;
+    if (findFileInDataDirectories(kSceneFile, fullpath))
+    {
+        files.push_back(fullpath);
+    }
+    else
+    {
+        std::cout << "Skipping " << kSceneFile << ", file not found" << std::endl;
+    }
+
+    for (const auto& file : files)
+    {
+        SceneLoadResult serial = loadScene(file, Scene::LoadFlags::SerialModelLoading);
+        SceneLoadResult concurrent = loadScene(file, Scene::LoadFlags::None);
+
+        std::cout << file << std::endl;
+        std::cout << "    Serial:     " << serial.loadTime << "ms" << std::endl;
+        std::cout << "    Concurrent: " << concurrent.loadTime << "ms" << std::endl;
+
+        if (serial.pScene == nullptr || concurrent.pScene == nullptr)
+        {
+            return test_fail("Failed to load " + file);
+        }
+
+        std::string mismatch = compareScenes(serial.pScene.get(), concurrent.pScene.get());
+        if (mismatch.empty() == false)
+        {
+            return test_fail("Serial and concurrent loading of " + file + " created different scenes. " + mismatch);
+        }
+    }
+
+    // The second teapot entry shares the model of the first one
+    Scene::SharedPtr pScene = loadScene(testScene, Scene::LoadFlags::None).pScene;
+    uint32_t teapotInstances = 0;
+    for (uint32_t m = 0; m < pScene->getModelCount(); m++)
+    {
+        if (pScene->getModel(m)->getName() == "teapot")
+        {
+            teapotInstances += pScene->getModelInstanceCount(m);
+        }
+    }
+    std::remove(testScene.c_str());
+
+    if (teapotInstances != 3 || pScene->getModelCount() != 5)
+    {
+        return test_fail("Model entries referencing the same file weren't merged");
+    }
+    return test_pass();
+}
+
+testing_func(ModelLoadingTest, TestTextureCache)
+{
+    // The ogre blend-shapes are different models which use the same material file
+    const char* kFiles[] = { "ogre/bs_rest.obj", "ogre/bs_smile.obj" };
+    TextureCache::setEnabled(true);
+    Model::SharedPtr pFirst = Model::createFromFile(kFiles[0]);
+    Model::SharedPtr pSecond = Model::createFromFile(kFiles[1]);
+    if (pFirst == nullptr || pSecond == nullptr)
+    {
+        return test_fail("Can't load the ogre models");
+    }
+    if (getNormalMap(pFirst.get()) == nullptr || getNormalMap(pFirst.get()) != getNormalMap(pSecond.get()))
+    {
+        return test_fail("Models referencing the same texture file don't share the texture");
+    }
+
+    // Images embedded in binary files are shared by content
+    const std::string exported = getExecutableDirectory() + "/ModelLoadingTest.bin";
+    pFirst->exportToBinaryFile(exported);
+    Model::SharedPtr pBinary = Model::createFromFile(exported.c_str());
+    Model::SharedPtr pBinaryCopy = Model::createFromFile(exported.c_str());
+    std::remove(exported.c_str());
+    if (pBinary == nullptr || pBinaryCopy == nullptr)
+    {
+        return test_fail("Can't load the exported model");
+    }
+    if (getNormalMap(pBinary.get()) == nullptr || getNormalMap(pBinary.get()) != getNormalMap(pBinaryCopy.get()))
+    {
+        return test_fail("Loading the same binary model twice didn't share the embedded texture");
+    }
+
+    // Textures are only kept alive by their users
+    std::weak_ptr<Texture> pReleased = getNormalMap(pBinary.get());
+    pBinary = nullptr;
+    pBinaryCopy = nullptr;
+    if (pReleased.expired() == false)
+    {
+        return test_fail("The cache keeps released textures alive");
+    }
+
+    // When disabled, every model gets its own textures
+    TextureCache::setEnabled(false);
+    Model::SharedPtr pUncached = Model::createFromFile(kFiles[0]);
+    TextureCache::setEnabled(true);
+    if (pUncached == nullptr || getNormalMap(pUncached.get()) == getNormalMap(pFirst.get()))
+    {
+        return test_fail("The disabled cache returned a texture");
+    }
+
+    // The tiled scene references the same textures from every tile
+    std::string sceneFile;
+    if (findFileInDataDirectories(kSceneFile, sceneFile))
+    {
+        std::cout << kSceneFile << std::endl;
+        for (bool enabled : { false, true })
+        {
+            TextureCache::setEnabled(enabled);
+            TextureCache::resetStats();
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            Scene::SharedPtr pScene = Scene::loadFromFile(sceneFile);
+            float totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            if (pScene == nullptr)
+            {
+                TextureCache::setEnabled(true);
+                return test_fail("Failed to load " + sceneFile);
+            }
+            printCacheStats(enabled ? "Cached:   " : "Uncached: ", totalTime);
+        }
+        TextureCache::setEnabled(true);
+    }
+    else
+    {
+        std::cout << "Skipping " << kSceneFile << ", file not found" << std::endl;
+    }
+
+    return test_pass();
+}
+
+testing_func(ModelLoadingTest, TestTextureBaking)
+{
+    // Every load has to create its own textures
+    TextureCache::setEnabled(false);
+    const char* kModelFile = "ogre/bs_rest.obj";
+    std::function<Model::SharedPtr()> loadModel = [&]() { return Model::createFromFile(kModelFile); };
+
+    for (TextureBaker::Flags flags : { TextureBaker::Flags::None, TextureBaker::Flags::Compress })
+    {
+        Model::SharedPtr pCold;
+        float coldTime = measureLoad(false, loadModel, pCold);
+        if (pCold == nullptr || getNormalMap(pCold.get()) == nullptr)
+        {
+            TextureCache::setEnabled(true);
+            return test_fail("Can't load the ogre model");
+        }
+
+        std::vector<std::string> bakedFiles = TextureBaker::bakeModel(pCold.get(), flags);
+        Model::SharedPtr pWarm;
+        float warmTime = measureLoad(true, loadModel, pWarm);
+        removeFiles(bakedFiles);
+
+        std::cout << kModelFile << (is_set(flags, TextureBaker::Flags::Compress) ? " (compressed)" : "") << std::endl;
+        std::cout << "    Source files: " << coldTime << "ms" << std::endl;
+        std::cout << "    Baked files:  " << warmTime << "ms" << std::endl;
+
+        // The baked texture must match the one which was created from the source
+        Texture::SharedPtr pSource = getNormalMap(pCold.get());
+        Texture::SharedPtr pBaked = pWarm ? getNormalMap(pWarm.get()) : nullptr;
+        if (pBaked == nullptr || pBaked->getWidth() != pSource->getWidth() || pBaked->getHeight() != pSource->getHeight() || pBaked->getMipCount() != pSource->getMipCount())
+        {
+            TextureCache::setEnabled(true);
+            return test_fail("The baked texture doesn't match the source");
+        }
+
+        bool isCompressed = isCompressedFormat(pBaked->getFormat());
+        if (isCompressed != is_set(flags, TextureBaker::Flags::Compress) || isSrgbFormat(pBaked->getFormat()) != isSrgbFormat(pSource->getFormat()))
+        {
+            TextureCache::setEnabled(true);
+            return test_fail("The baked texture has the wrong format");
+        }
+    }
+
+    // A baked file is ignored once its source changes
+    std::string sourceFile;
+    Model::SharedPtr pModel = loadModel();
+    Texture::SharedPtr pNormalMap = getNormalMap(pModel.get());
+    findFileInDataDirectories(pNormalMap->getSourceFilename(), sourceFile);
+    std::vector<std::string> bakedFiles = TextureBaker::bakeModel(pModel.get());
+    bool wasValid = TextureBaker::hasBakedFile(sourceFile, false);
+    std::string bakedFile = TextureBaker::getBakedFilename(sourceFile, false);
+    {
+        // Overwrite the source timestamp, which is stored in the 4th reserved word of the DDS header
+        std::fstream file(bakedFile, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(uint32_t) + offsetof(DdsHelper::DdsHeader, reserved) + 3 * sizeof(uint32_t));
+        uint32_t timestamp = 0;
+        file.write((const char*)&timestamp, sizeof(timestamp));
+    }
+    bool isStale = TextureBaker::hasBakedFile(sourceFile, false) == false;
+    removeFiles(bakedFiles);
+    if (wasValid == false || isStale == false)
+    {
+        TextureCache::setEnabled(true);
+        return test_fail("Baked files aren't validated against their source");
+    }
+
+    // Baking with a different compression mode replaces the baked file, baking with the same mode doesn't
+    bakedFiles = TextureBaker::bakeModel(pModel.get());
+    bool written = false;
+    bool rebaked = TextureBaker::bakeTexture(sourceFile, false, TextureBaker::Flags::Compress, &written) && written;
+    bool matchesMode = TextureBaker::hasBakedFile(sourceFile, false, TextureBaker::Flags::Compress) && TextureBaker::hasBakedFile(sourceFile, false, TextureBaker::Flags::None) == false;
+    bool kept = TextureBaker::bakeTexture(sourceFile, false, TextureBaker::Flags::Compress, &written) && written == false;
+    removeFiles(bakedFiles);
+    if (rebaked == false || matchesMode == false || kept == false)
+    {
+        TextureCache::setEnabled(true);
+        return test_fail("Baked files aren't validated against the compression mode");
+    }
+
+    // Cold and warm load of the tiled scene
+    std::string sceneFile;
+    if (findFileInDataDirectories(kSceneFile, sceneFile))
+    {
+        std::function<Scene::SharedPtr()> loadScene = [&]() { return Scene::loadFromFile(sceneFile); };
+        Scene::SharedPtr pScene;
+        float coldTime = measureLoad(false, loadScene, pScene);
+        if (pScene == nullptr)
+        {
+            TextureCache::setEnabled(true);
+            return test_fail("Failed to load " + sceneFile);
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        bakedFiles = TextureBaker::bakeScene(pScene.get());
+        float bakeTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        pScene = nullptr;
+
+        float warmTime = measureLoad(true, loadScene, pScene);
+        removeFiles(bakedFiles);
+
+        std::cout << kSceneFile << std::endl;
+        std::cout << "    Cold: " << coldTime << "ms" << std::endl;
+        std::cout << "    Bake: " << bakeTime << "ms, " << bakedFiles.size() << " files" << std::endl;
+        std::cout << "    Warm: " << warmTime << "ms" << std::endl;
+    }
+    else
+    {
+        std::cout << "Skipping " << kSceneFile << ", file not found" << std::endl;
+    }
+
+    TextureCache::setEnabled(true);
+    return test_pass();
+}
+
+int main()
+{
+    ModelLoadingTest mlt;
+    mlt.init(true);
+    mlt.run();
+    return 0;
+}
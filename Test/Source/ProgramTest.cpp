@@ -0,0 +1,287 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramTest.h"
+#include <thread>
+#include <set>
+
+namespace
+{
+    const uint32_t kPermutationCount = 8;
+    const uint32_t kFramesPerPermutation = 4;
+    const uint32_t kCycleCount = 2;
+    const float kSpikeThresholdMs = 4.f;
+    const uint32_t kToggleCount = 1000000;
+
+    struct FrameStats
+    {
+        float maxTime = 0;
+        uint32_t spikeCount = 0;
+    };
+
+    Program::DefineList getPermutation(uint32_t i)
+    {
+        Program::DefineList defines;
+        defines.add("_LIGHT_COUNT", std::to_string(i + 1));
+        return defines;
+    }
+
+    // Simulates a render loop which switches permutations every few frames, timing the getActiveVersion() call of each frame
+    FrameStats cyclePermutations(const GraphicsProgram::SharedPtr& pProgram)
+    {
+        FrameStats stats;
+        for (uint32_t frame = 0; frame < kPermutationCount * kFramesPerPermutation * kCycleCount; frame++)
+        {
+            pProgram->replaceAllDefines(getPermutation((frame / kFramesPerPermutation) % kPermutationCount));
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            pProgram->getActiveVersion();
+            float frameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            stats.maxTime = std::max(stats.maxTime, frameTime);
+            stats.spikeCount += (frameTime > kSpikeThresholdMs) ? 1 : 0;
+
+            // The rest of the frame
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+        return stats;
+    }
+
+    GraphicsProgram::SharedPtr createProgram(bool async)
+    {
+        GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Permutations.ps.hlsl", getPermutation(0));
+        pProgram->setAsyncCompilation(async);
+        pProgram->getActiveVersion();
+        return pProgram;
+    }
+
+    // Checks that every permutation has its own version
+    bool verifyPermutations(const GraphicsProgram::SharedPtr& pProgram)
+    {
+        std::set<const ProgramVersion*> versions;
+        for (uint32_t i = 0; i < kPermutationCount; i++)
+        {
+            pProgram->replaceAllDefines(getPermutation(i));
+            const ProgramVersion* pVersion = pProgram->getActiveVersion().get();
+            if (pVersion == nullptr)
+            {
+                return false;
+            }
+            versions.insert(pVersion);
+        }
+        return versions.size() == kPermutationCount;
+    }
+}
+
+void ProgramTest::addTests()
+{
+    addTestToList<TestFrameSpikes>();
+    addTestToList<TestPrewarm>();
+    addTestToList<TestTryGetVersion>();
+    addTestToList<TestDefineToggleBenchmark>();
+}
+
+testing_func(ProgramTest, TestFrameSpikes)
+{
+    // Make sure the versions are really compiled
+    ShaderCache::SharedPtr pCache = ShaderCache::getActive();
+    ShaderCache::setActive(nullptr);
+
+    GraphicsProgram::SharedPtr pSyncProgram = createProgram(false);
+    FrameStats syncStats = cyclePermutations(pSyncProgram);
+
+    // A missing version is queued, and the previous version is returned until it's ready
+    GraphicsProgram::SharedPtr pAsyncProgram = createProgram(true);
+    ProgramVersion::SharedConstPtr pPrevious = pAsyncProgram->getActiveVersion();
+    pAsyncProgram->replaceAllDefines(getPermutation(1));
+    ProgramVersion::SharedConstPtr pCurrent = pAsyncProgram->getActiveVersion();
+    uint32_t pendingCount = pAsyncProgram->getPendingVersionCount();
+    pAsyncProgram->waitForPendingVersions();
+
+    FrameStats asyncStats = cyclePermutations(pAsyncProgram);
+    pAsyncProgram->waitForPendingVersions();
+    ShaderCache::setActive(pCache);
+
+    // Timings depend on the machine, they are only reported
+    std::cout << "Synchronous: max frame time " << syncStats.maxTime << "ms, " << syncStats.spikeCount << " spikes" << std::endl;
+    std::cout << "Asynchronous: max frame time " << asyncStats.maxTime << "ms, " << asyncStats.spikeCount << " spikes" << std::endl;
+
+    if (pCurrent != pPrevious || pendingCount != 1)
+    {
+        return test_fail("Asynchronous compilation didn't return the previous version while compiling the new one");
+    }
+    if (pAsyncProgram->getPendingVersionCount() != 0 || verifyPermutations(pAsyncProgram) == false)
+    {
+        return test_fail("Asynchronous compilation didn't create all the permutations");
+    }
+
+    return test_pass();
+}
+
+testing_func(ProgramTest, TestPrewarm)
+{
+    ShaderCache::SharedPtr pCache = ShaderCache::getActive();
+    ShaderCache::setActive(nullptr);
+
+    // Pre-warming works in synchronous mode as well
+    GraphicsProgram::SharedPtr pProgram = createProgram(false);
+    std::vector<Program::DefineList> permutations;
+    for (uint32_t i = 1; i < kPermutationCount; i++)
+    {
+        permutations.push_back(getPermutation(i));
+    }
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    pProgram->prewarm(permutations);
+    uint32_t pendingCount = pProgram->getPendingVersionCount();
+    pProgram->waitForPendingVersions();
+    float prewarmTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // The render loop must find every version built
+    bool allBuilt = true;
+    for (const auto& defines : permutations)
+    {
+        allBuilt = allBuilt && (pProgram->tryGetVersion(defines) != nullptr);
+    }
+
+    FrameStats stats = cyclePermutations(pProgram);
+    ShaderCache::setActive(pCache);
+
+    std::cout << "Pre-warmed " << pendingCount << " versions in " << prewarmTime << "ms. Max frame time " << stats.maxTime << "ms, " << stats.spikeCount << " spikes" << std::endl;
+
+    if (pendingCount != kPermutationCount - 1 || pProgram->getPendingVersionCount() != 0)
+    {
+        return test_fail("Unexpected number of pending versions");
+    }
+    if (allBuilt == false)
+    {
+        return test_fail("Pre-warmed permutations weren't built before they were used");
+    }
+    if (verifyPermutations(pProgram) == false)
+    {
+        return test_fail("Pre-warming didn't create all the permutations");
+    }
+
+    return test_pass();
+}
+
+testing_func(ProgramTest, TestTryGetVersion)
+{
+    ShaderCache::SharedPtr pCache = ShaderCache::getActive();
+    ShaderCache::setActive(nullptr);
+
+    GraphicsProgram::SharedPtr pProgram = createProgram(false);
+    const ProgramVersion* pActive = pProgram->getActiveVersion().get();
+
+    // A version which wasn't built is queued instead of compiled on the calling thread
+    ProgramVersion::SharedConstPtr pVersion = pProgram->tryGetVersion(getPermutation(1));
+    uint32_t pendingCount = pProgram->getPendingVersionCount();
+    pProgram->waitForPendingVersions();
+    ProgramVersion::SharedConstPtr pBuilt = pProgram->tryGetVersion(getPermutation(1));
+    ShaderCache::setActive(pCache);
+
+    if (pVersion != nullptr || pendingCount != 1)
+    {
+        return test_fail("tryGetVersion() didn't queue the missing version");
+    }
+    if (pBuilt == nullptr || pBuilt.get() == pActive)
+    {
+        return test_fail("tryGetVersion() didn't return the built version");
+    }
+    if (pProgram->getActiveVersion().get() != pActive || pProgram->tryGetVersion(getPermutation(0)).get() != pActive)
+    {
+        return test_fail("tryGetVersion() changed the active version");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramTest, TestDefineToggleBenchmark)
+{
+    GraphicsProgram::SharedPtr pProgram = createProgram(false);
+    const ProgramVersion* pDefault = pProgram->getActiveVersion().get();
+    const std::string name = "_TOGGLED_DEFINE";
+    const std::string value = "1";
+    pProgram->addDefine(name, value);
+    const ProgramVersion* pToggled = pProgram->getActiveVersion().get();
+    pProgram->removeDefine(name);
+
+    // Both versions are built, so this only measures the define and version lookup
+    bool valid = true;
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kToggleCount; i++)
+    {
+        pProgram->addDefine(name, value);
+        valid = valid && (pProgram->getActiveVersion().get() == pToggled);
+        pProgram->removeDefine(name);
+        valid = valid && (pProgram->getActiveVersion().get() == pDefault);
+    }
+    float stringTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    const Program::Define define = Program::createDefine(name, value);
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kToggleCount; i++)
+    {
+        pProgram->addDefine(define);
+        valid = valid && (pProgram->getActiveVersion().get() == pToggled);
+        pProgram->removeDefine(define);
+        valid = valid && (pProgram->getActiveVersion().get() == pDefault);
+    }
+    float internedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Reference - the define list keyed lookup the program used to do
+    std::map<const Program::DefineList, const ProgramVersion*> versionMap;
+    Program::DefineList defines = getPermutation(0);
+    versionMap[defines] = pDefault;
+    defines.add(name, value);
+    versionMap[defines] = pToggled;
+    defines = getPermutation(0);
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kToggleCount; i++)
+    {
+        defines.add(name, value);
+        valid = valid && (versionMap.find(defines)->second == pToggled);
+        defines.remove(name);
+        valid = valid && (versionMap.find(defines)->second == pDefault);
+    }
+    float mapTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << kToggleCount << " add/remove/getActiveVersion cycles: string defines " << stringTime << "ms, interned defines " << internedTime << "ms, define-list map reference " << mapTime << "ms" << std::endl;
+
+    if (pDefault == pToggled || valid == false)
+    {
+        return test_fail("Toggling a define returned the wrong program version");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ProgramTest pt;
+    pt.init(true);
+    pt.run();
+    return 0;
+}
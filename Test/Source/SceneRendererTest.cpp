@@ -0,0 +1,296 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneRendererTest.h"
+
+namespace
+{
+    const char* kSceneFile = "CityScene/Tiled_CityScene_20x20.fscene";
+    const uint32_t kMaxInstanceCount = 64;
+    const uint32_t kAnimatedInstanceCount = 100000;
+    const uint32_t kInstancesPerPath = 100;
+    const uint32_t kAnimationFrames = 20;
+
+    struct DrawStats
+    {
+        uint32_t instanceCount = 0;
+        uint32_t drawCount = 0;
+        uint32_t materialBindCount = 0;
+    };
+
+    // Counts what SceneRenderer emitted before the draw list: models in load order, batching only inside a model instance and resetting the material per model instance
+    DrawStats countUnsortedDraws(const Scene* pScene)
+    {
+        DrawStats stats;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                if (pScene->getModelInstance(modelID, instanceID)->isVisible() == false)
+                {
+                    continue;
+                }
+
+                const Material* pLastMaterial = nullptr;
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    uint32_t activeInstances = 0;
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        if (pModel->getMeshInstance(meshID, meshInstanceID)->isVisible())
+                        {
+                            activeInstances++;
+                        }
+                    }
+
+                    stats.instanceCount += activeInstances;
+                    const uint32_t drawCount = (activeInstances + kMaxInstanceCount - 1) / kMaxInstanceCount;
+                    stats.drawCount += drawCount;
+                    const Material* pMaterial = pModel->getMesh(meshID)->getMaterial().get();
+                    if (drawCount > 0 && pMaterial != pLastMaterial)
+                    {
+                        stats.materialBindCount++;
+                        pLastMaterial = pMaterial;
+                    }
+                }
+            }
+        }
+        return stats;
+    }
+}
+
+void SceneRendererTest::addTests()
+{
+    addTestToList<TestDrawList>();
+    addTestToList<TestTransformBuffer>();
+    addTestToList<TestParallelTransforms>();
+}
+
+testing_func(SceneRendererTest, TestDrawList)
+{
+    Scene::SharedPtr pScene = Scene::loadFromFile(kSceneFile);
+    if (pScene == nullptr)
+    {
+        return test_fail("Can't load " + std::string(kSceneFile));
+    }
+
+    const DrawStats before = countUnsortedDraws(pScene.get());
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    SceneDrawList::SharedPtr pDrawList = SceneDrawList::create();
+    pDrawList->build(pScene.get(), nullptr, false, kMaxInstanceCount);
+    CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+
+    if (pDrawList->getItemCount() != before.instanceCount)
+    {
+        return test_fail("Draw list doesn't contain all the visible mesh instances");
+    }
+
+    // Every draw must be a run of instances of a single mesh, within the instance limit
+    uint32_t itemCount = 0;
+    uint64_t lastKey = 0;
+    for (const auto& draw : pDrawList->getDraws())
+    {
+        if (draw.itemCount == 0 || draw.itemCount > kMaxInstanceCount || draw.firstItem != itemCount)
+        {
+            return test_fail("Invalid draw range");
+        }
+
+        const Mesh* pMesh = pDrawList->getItem(draw.firstItem).pMesh;
+        for (uint32_t i = draw.firstItem; i < draw.firstItem + draw.itemCount; i++)
+        {
+            const SceneDrawList::Item& item = pDrawList->getItem(i);
+            if (item.pMesh != pMesh)
+            {
+                return test_fail("Draw merges instances of different meshes");
+            }
+            if (item.sortKey < lastKey)
+            {
+                return test_fail("Draw list is not sorted");
+            }
+            lastKey = item.sortKey;
+        }
+        itemCount += draw.itemCount;
+    }
+
+    if (pDrawList->getDrawCount() > before.drawCount || pDrawList->getMaterialChangeCount() > before.materialBindCount)
+    {
+        return test_fail("Draw list emits more state changes than the unsorted loop");
+    }
+
+    std::cout << "Draws: " << before.drawCount << " -> " << pDrawList->getDrawCount() << std::endl;
+    std::cout << "Material binds: " << before.materialBindCount << " -> " << pDrawList->getMaterialChangeCount() << std::endl;
+    std::cout << "Draw list build time: " << CpuTimer::calcDuration(start, end) << "ms" << std::endl;
+
+    return test_pass();
+}
+
+testing_func(SceneRendererTest, TestTransformBuffer)
+{
+    Scene::SharedPtr pScene = Scene::loadFromFile(kSceneFile);
+    if (pScene == nullptr)
+    {
+        return test_fail("Can't load " + std::string(kSceneFile));
+    }
+
+    const SceneTransformBuffer* pTransforms = pScene->getTransformBuffer();
+    const SceneBVH* pBVH = pScene->getBVH();
+    const uint32_t instanceCount = pBVH->getLeafCount();
+    if (pTransforms->getInstanceCount() != instanceCount || pTransforms->getLastUploadSize() != instanceCount * sizeof(SceneTransformBuffer::InstanceTransform))
+    {
+        return test_fail("The initial update must upload every mesh instance");
+    }
+
+    // A static scene doesn't upload anything
+    pTransforms = pScene->getTransformBuffer();
+    const size_t staticUploadSize = pTransforms->getLastUploadSize();
+    if (staticUploadSize != 0)
+    {
+        return test_fail("Static scene uploaded transforms");
+    }
+
+    // Moving an instance only uploads its own slots
+    const Scene::ModelInstance::SharedPtr& pInstance = pScene->getModelInstance(0, 0);
+    pInstance->setTranslation(pInstance->getTranslation() + vec3(10.0f), true);
+    pTransforms = pScene->getTransformBuffer();
+
+    uint32_t movedCount = 0;
+    for (uint32_t slot = 0; slot < instanceCount; slot++)
+    {
+        const SceneBVH::Leaf& leaf = pBVH->getLeaf(slot);
+        const Scene::ModelInstance* pModelInstance = pScene->getModelInstance(leaf.modelID, leaf.modelInstanceID).get();
+        const glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pModelInstance->getObject()->getMeshInstance(leaf.meshID, leaf.meshInstanceID)->getTransformMatrix();
+        if (pTransforms->getTransform(slot).worldMat != worldMat)
+        {
+            return test_fail("Transform buffer doesn't match the instance matrices");
+        }
+        movedCount += (pModelInstance == pInstance.get()) ? 1 : 0;
+    }
+
+    const size_t movedUploadSize = pTransforms->getLastUploadSize();
+    if (movedUploadSize != movedCount * sizeof(SceneTransformBuffer::InstanceTransform))
+    {
+        return test_fail("Moving an instance uploaded unrelated transforms");
+    }
+
+    // Before the transform buffer, every drawn instance wrote its world and normal matrices into the per-mesh CB. Now only its slot is written.
+    const size_t matrixSize = sizeof(glm::mat4) + sizeof(glm::mat3x4);
+    std::cout << "Bytes uploaded per frame, static scene: " << instanceCount * matrixSize << " -> " << instanceCount * sizeof(uint32_t) + staticUploadSize << std::endl;
+    std::cout << "Bytes uploaded per frame, one moving instance: " << instanceCount * matrixSize << " -> " << instanceCount * sizeof(uint32_t) + movedUploadSize << std::endl;
+
+    return test_pass();
+}
+
+testing_func(SceneRendererTest, TestParallelTransforms)
+{
+    Scene::SharedPtr pCityScene = Scene::loadFromFile(kSceneFile);
+    if (pCityScene == nullptr)
+    {
+        return test_fail("Can't load " + std::string(kSceneFile));
+    }
+
+    // Animate a lot of instances of a single model along paths
+    Scene::SharedPtr pScene = Scene::create();
+    const Model::SharedPtr& pModel = pCityScene->getModel(0);
+    for (uint32_t i = 0; i < kAnimatedInstanceCount; i++)
+    {
+        pScene->addModelInstance(pModel, "Instance" + std::to_string(i), vec3(float(i % 1000), 0, float(i / 1000)));
+    }
+
+    for (uint32_t i = 0; i < kAnimatedInstanceCount / kInstancesPerPath; i++)
+    {
+        ObjectPath::SharedPtr pPath = ObjectPath::create();
+        pPath->addKeyFrame(0, vec3(0, 0, float(i)), vec3(0, 0, float(i) + 1), vec3(0, 1, 0));
+        pPath->addKeyFrame(1, vec3(10, 5, float(i)), vec3(10, 4, float(i) + 1), vec3(0, 1, 0));
+        pPath->addKeyFrame(2, vec3(0, 0, float(i)), vec3(1, 0, float(i) + 1), vec3(0, 1, 0));
+        pPath->setAnimationRepeat(true);
+        for (uint32_t j = 0; j < kInstancesPerPath; j++)
+        {
+            pPath->attachObject(pScene->getModelInstance(0, i * kInstancesPerPath + j));
+        }
+        pScene->addPath(pPath);
+    }
+
+    auto animate = [&pScene](uint32_t frame, ThreadPool* pPool)
+    {
+        for (uint32_t i = 0; i < pScene->getPathCount(); i++)
+        {
+            pScene->getPath(i)->animate(frame * 0.1);
+        }
+        pScene->updateTransforms(pPool);
+    };
+
+    // Serial reference
+    ThreadPool::SharedPtr pSerialPool = ThreadPool::create(1);
+    animate(0, pSerialPool.get());
+    const SceneTransformBuffer* pTransforms = pScene->getTransformBuffer();
+    std::vector<glm::mat4> reference(pTransforms->getInstanceCount());
+    for (uint32_t i = 0; i < (uint32_t)reference.size(); i++)
+    {
+        reference[i] = pTransforms->getTransform(i).worldMat;
+    }
+
+    const uint32_t maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreadCount))
+    {
+        ThreadPool::SharedPtr pPool = ThreadPool::create(threadCount);
+        float time = 0;
+        for (uint32_t frame = 1; frame <= kAnimationFrames; frame++)
+        {
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            animate(frame, pPool.get());
+            time += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+
+        // Go back to the reference frame and compare
+        animate(0, pPool.get());
+        for (uint32_t i = 0; i < (uint32_t)reference.size(); i++)
+        {
+            if (pTransforms->getTransform(i).worldMat != reference[i])
+            {
+                return test_fail("Parallel transform update doesn't match the serial update");
+            }
+        }
+
+        std::cout << "Updating " << kAnimatedInstanceCount << " animated instances with " << threadCount << " threads: " << time / kAnimationFrames << "ms per frame" << std::endl;
+        if (threadCount == maxThreadCount)
+        {
+            break;
+        }
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    SceneRendererTest srt;
+    srt.init(true);
+    srt.run();
+    return 0;
+}
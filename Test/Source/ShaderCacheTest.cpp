@@ -0,0 +1,110 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ShaderCacheTest.h"
+
+namespace
+{
+    const uint32_t kPermutationCount = 8;
+
+    // Creates and links all the permutations, similar to what an application does on startup
+    float compilePermutations(std::vector<GraphicsProgram::SharedPtr>& programs)
+    {
+        programs.clear();
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kPermutationCount; i++)
+        {
+            Program::DefineList defines;
+            defines.add("_LIGHT_COUNT", std::to_string(i + 1));
+            GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "CacheTest.ps.hlsl", defines);
+            pProgram->getActiveVersion();
+            programs.push_back(pProgram);
+        }
+        return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+}
+
+void ShaderCacheTest::addTests()
+{
+    addTestToList<TestStartup>();
+}
+
+testing_func(ShaderCacheTest, TestStartup)
+{
+    ShaderCache::SharedPtr pCache = ShaderCache::create(getExecutableDirectory() + "/ShaderCacheTest");
+    if (pCache == nullptr)
+    {
+        return test_fail("Can't create the shader cache");
+    }
+    pCache->clear();
+    ShaderCache::setActive(pCache);
+
+    // Cold start, everything is compiled
+    std::vector<GraphicsProgram::SharedPtr> coldPrograms;
+    float coldTime = compilePermutations(coldPrograms);
+    ShaderCache::Stats coldStats = pCache->getStats();
+    pCache->resetStats();
+
+    // Warm start, everything should be loaded from the cache
+    std::vector<GraphicsProgram::SharedPtr> warmPrograms;
+    float warmTime = compilePermutations(warmPrograms);
+    ShaderCache::Stats warmStats = pCache->getStats();
+    ShaderCache::setActive(nullptr);
+
+    std::cout << "Cold start: " << coldStats.hitCount << " hits, " << coldStats.missCount << " misses, " << coldTime << "ms" << std::endl;
+    std::cout << "Warm start: " << warmStats.hitCount << " hits, " << warmStats.missCount << " misses, " << warmTime << "ms, saved " << warmStats.savedTime << "ms of compilation" << std::endl;
+
+    if (coldStats.hitCount != 0 || coldStats.missCount == 0)
+    {
+        return test_fail("Cold start should only have misses");
+    }
+    if (warmStats.missCount != 0 || warmStats.hitCount != coldStats.missCount)
+    {
+        return test_fail("Warm start should only have hits");
+    }
+
+    // Programs created from cached blobs must reflect the same layout
+    for (uint32_t i = 0; i < kPermutationCount; i++)
+    {
+        const auto& pColdCB = coldPrograms[i]->getActiveVersion()->getReflector()->getBufferDesc("PerFrameCB", ProgramReflection::BufferReflection::Type::Constant);
+        const auto& pWarmCB = warmPrograms[i]->getActiveVersion()->getReflector()->getBufferDesc("PerFrameCB", ProgramReflection::BufferReflection::Type::Constant);
+        if (pColdCB == nullptr || pWarmCB == nullptr || pColdCB->getRequiredSize() != pWarmCB->getRequiredSize())
+        {
+            return test_fail("Cached program reflection doesn't match the compiled program");
+        }
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    ShaderCacheTest sct;
+    sct.init(true);
+    sct.run();
+    return 0;
+}
@@ -0,0 +1,219 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "StateObjectCacheTest.h"
+#include "Graphics/StateObjectCache.h"
+#include <atomic>
+#include <thread>
+#include <random>
+
+namespace
+{
+    // Records the descriptor and the creating thread without creating an API object, so the tests measure the cache rather than the driver
+    class MockStateObject
+    {
+    public:
+        using SharedPtr = std::shared_ptr<MockStateObject>;
+        using Desc = GraphicsStateObject::Desc;
+
+        static SharedPtr create(const Desc& desc)
+        {
+            sCreateCount++;
+            SharedPtr pObject = SharedPtr(new MockStateObject());
+            pObject->desc = desc;
+            pObject->threadId = std::this_thread::get_id();
+            return pObject;
+        }
+
+        Desc desc;
+        std::thread::id threadId;
+        static std::atomic<uint32_t> sCreateCount;
+    };
+    std::atomic<uint32_t> MockStateObject::sCreateCount;
+
+    using MockCache = StateObjectCache<MockStateObject>;
+
+    // The states a typical frame switches between. Every combination of them is a separate descriptor.
+    std::vector<GraphicsStateObject::Desc> createDescs(uint32_t countPerState)
+    {
+        std::vector<BlendState::SharedPtr> blendStates;
+        std::vector<RasterizerState::SharedPtr> rasterizerStates;
+        std::vector<DepthStencilState::SharedPtr> depthStencilStates;
+        std::vector<VertexLayout::SharedPtr> layouts;
+        for (uint32_t i = 0; i < countPerState; i++)
+        {
+            blendStates.push_back(BlendState::create(BlendState::Desc()));
+            rasterizerStates.push_back(RasterizerState::create(RasterizerState::Desc()));
+            depthStencilStates.push_back(DepthStencilState::create(DepthStencilState::Desc()));
+            layouts.push_back(VertexLayout::create());
+        }
+
+        std::vector<GraphicsStateObject::Desc> descs;
+        for (const auto& pBlend : blendStates)
+        {
+            for (const auto& pRaster : rasterizerStates)
+            {
+                for (const auto& pDepth : depthStencilStates)
+                {
+                    for (const auto& pLayout : layouts)
+                    {
+                        for (auto primType : { GraphicsStateObject::PrimitiveType::Triangle, GraphicsStateObject::PrimitiveType::Line })
+                        {
+                            GraphicsStateObject::Desc desc;
+                            desc.setBlendState(pBlend).setRasterizerState(pRaster).setDepthStencilState(pDepth).setVertexLayout(pLayout).setPrimitiveType(primType);
+                            descs.push_back(desc);
+                        }
+                    }
+                }
+            }
+        }
+        return descs;
+    }
+}
+
+void StateObjectCacheTest::addTests()
+{
+    addTestToList<TestLookup>();
+    addTestToList<TestPrewarm>();
+    addTestToList<TestLookupPerformance>();
+}
+
+testing_func(StateObjectCacheTest, TestLookup)
+{
+    std::vector<GraphicsStateObject::Desc> descs = createDescs(4);
+    MockCache::SharedPtr pCache = MockCache::create();
+    MockStateObject::sCreateCount = 0;
+
+    std::vector<MockStateObject::SharedPtr> objects;
+    for (const auto& desc : descs)
+    {
+        objects.push_back(pCache->get(desc));
+        if ((objects.back()->desc == desc) == false)
+        {
+            return test_fail("State object doesn't match the descriptor");
+        }
+    }
+    if (MockStateObject::sCreateCount != descs.size() || pCache->getSize() != descs.size())
+    {
+        return test_fail("Expected one state object per descriptor");
+    }
+
+    // Looking up the same combinations again, in a different order, returns the existing objects
+    std::vector<uint32_t> order(descs.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(0));
+    for (uint32_t i : order)
+    {
+        if (pCache->get(descs[i]) != objects[i])
+        {
+            return test_fail("Lookup returned a different state object");
+        }
+    }
+    if (MockStateObject::sCreateCount != descs.size())
+    {
+        return test_fail("State objects were created again");
+    }
+    return test_pass();
+}
+
+testing_func(StateObjectCacheTest, TestPrewarm)
+{
+    std::vector<GraphicsStateObject::Desc> descs = createDescs(3);
+    MockCache::SharedPtr pCache = MockCache::create();
+    MockStateObject::sCreateCount = 0;
+
+    pCache->prewarm(descs);
+    pCache->prewarm(descs);
+    if (pCache->getSize() != descs.size())
+    {
+        return test_fail("Prewarming the same descriptors twice added entries");
+    }
+
+    for (const auto& desc : descs)
+    {
+        MockStateObject::SharedPtr pObject = pCache->get(desc);
+        if ((pObject->desc == desc) == false || pObject->threadId == std::this_thread::get_id())
+        {
+            return test_fail("State object wasn't created in the background");
+        }
+    }
+    if (MockStateObject::sCreateCount != descs.size())
+    {
+        return test_fail("Prewarmed state objects were created again");
+    }
+    return test_pass();
+}
+
+testing_func(StateObjectCacheTest, TestLookupPerformance)
+{
+    const uint32_t kLookupCount = 1000000;
+    for (uint32_t countPerState : { 2, 4, 6 })
+    {
+        std::vector<GraphicsStateObject::Desc> descs = createDescs(countPerState);
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> randomDesc(0, (uint32_t)descs.size() - 1);
+        std::vector<uint32_t> sequence(kLookupCount);
+        for (auto& i : sequence)
+        {
+            i = randomDesc(rng);
+        }
+        std::cout << descs.size() << " combinations" << std::endl;
+
+        // Reference: compare against every descriptor created so far, like the old state graph did on a miss
+        std::vector<std::pair<GraphicsStateObject::Desc, MockStateObject::SharedPtr>> list;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i : sequence)
+        {
+            auto it = std::find_if(list.begin(), list.end(), [&desc = descs[i]](const auto& entry) { return entry.first == desc; });
+            if (it == list.end())
+            {
+                list.push_back({ descs[i], MockStateObject::create(descs[i]) });
+            }
+        }
+        std::cout << "    Linear scan: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1000000 / kLookupCount << "ns per lookup" << std::endl;
+
+        MockCache::SharedPtr pCache = MockCache::create();
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i : sequence)
+        {
+            pCache->get(descs[i]);
+        }
+        std::cout << "    Hashed cache: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1000000 / kLookupCount << "ns per lookup" << std::endl;
+    }
+    return test_pass();
+}
+
+int main()
+{
+    StateObjectCacheTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
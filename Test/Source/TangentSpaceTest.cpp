@@ -0,0 +1,267 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TangentSpaceTest.h"
+#include "Graphics/Model/TangentSpace.h"
+#include <random>
+
+namespace
+{
+    struct TestMesh
+    {
+        std::vector<uint32_t> indices;
+        std::vector<glm::vec4> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texCrd;
+
+        TangentSpace::MeshData getData(uint32_t positionStride, bool useTexCrd) const
+        {
+            TangentSpace::MeshData data;
+            data.pIndices = indices.data();
+            data.indexCount = (uint32_t)indices.size();
+            data.vertexCount = (uint32_t)normals.size();
+            data.pPositions = (const float*)positions.data();
+            data.positionStride = positionStride;
+            data.pNormals = normals.data();
+            data.pTexCrd = useTexCrd ? texCrd.data() : nullptr;
+            return data;
+        }
+    };
+
+    // A grid with random displacements, shuffled triangles and a few degenerate cases, so that vertices are shared by triangles processed by different threads
+    TestMesh createGrid(uint32_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+        TestMesh mesh;
+        for(uint32_t y = 0; y <= size; y++)
+        {
+            for(uint32_t x = 0; x <= size; x++)
+            {
+                mesh.positions.push_back(glm::vec4((float)x + dist(rng), dist(rng), (float)y + dist(rng), 1));
+                mesh.normals.push_back(glm::normalize(glm::vec3(dist(rng), 1, dist(rng))));
+                mesh.texCrd.push_back(glm::vec2((float)x, (float)y) / (float)size);
+            }
+        }
+
+        // Degenerate texture coordinates and a zero normal
+        for(uint32_t i = 0; i < (uint32_t)mesh.texCrd.size(); i += 97)
+        {
+            mesh.texCrd[i] = mesh.texCrd[std::min(i + 1, (uint32_t)mesh.texCrd.size() - 1)];
+        }
+        mesh.normals[size / 2] = glm::vec3(0, 0, 0);
+
+        std::vector<uint32_t> quads(size * size);
+        for(uint32_t i = 0; i < (uint32_t)quads.size(); i++)
+        {
+            quads[i] = i;
+        }
+        std::shuffle(quads.begin(), quads.end(), rng);
+
+        for(uint32_t quad : quads)
+        {
+            uint32_t x = quad % size;
+            uint32_t y = quad / size;
+            uint32_t v0 = y * (size + 1) + x;
+            uint32_t v1 = v0 + 1;
+            uint32_t v2 = v0 + size + 1;
+            uint32_t v3 = v2 + 1;
+            mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+
+        // A triangle which references the same vertex twice, and a vertex which isn't referenced
+        mesh.indices.insert(mesh.indices.end(), { 0, 0, size + 1 });
+        mesh.positions.push_back(glm::vec4(0, 0, 0, 1));
+        mesh.normals.push_back(glm::vec3(0, 1, 0));
+        mesh.texCrd.push_back(glm::vec2(0, 0));
+        return mesh;
+    }
+
+    // Vertices with a zero normal end up with NaNs. The payload of a NaN depends on the operand order the compiler picked, so any NaN matches any other NaN
+    bool compareBitangent(const glm::vec3& a, const glm::vec3& b)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            if(a[i] != b[i] && (std::isnan(a[i]) == false || std::isnan(b[i]) == false))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool compareBitangents(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+    {
+        if(a.size() != b.size())
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < a.size(); i++)
+        {
+            if(compareBitangent(a[i], b[i]) == false)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void TangentSpaceTest::addTests()
+{
+    addTestToList<TestMatchesReference>();
+    addTestToList<TestWelding>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(TangentSpaceTest, TestMatchesReference)
+{
+    // Sizes which leave a partial group of triangles and which are split into several chunks
+    const uint32_t kSizes[] = { 1, 7, 100, 513 };
+    for(uint32_t size : kSizes)
+    {
+        TestMesh mesh = createGrid(size, size);
+        for(bool useTexCrd : { true, false })
+        {
+            // vec4 positions check the position stride
+            TangentSpace::MeshData data = mesh.getData(sizeof(glm::vec4), useTexCrd);
+
+            // The unreferenced vertices must be left untouched, so start with the same garbage
+            std::vector<glm::vec3> reference(data.vertexCount, glm::vec3(7, 7, 7));
+            std::vector<glm::vec3> result(data.vertexCount, glm::vec3(7, 7, 7));
+            TangentSpace::generateBitangentsReference(data, reference.data());
+            TangentSpace::generateBitangents(data, result.data());
+
+            if(compareBitangents(reference, result) == false)
+            {
+                return test_fail("Bitangents don't match the reference implementation for a grid of size " + std::to_string(size));
+            }
+        }
+    }
+
+    // Single-threaded pool
+    TestMesh mesh = createGrid(64, 0);
+    TangentSpace::MeshData data = mesh.getData(sizeof(glm::vec4), true);
+    std::vector<glm::vec3> reference(data.vertexCount);
+    std::vector<glm::vec3> result(data.vertexCount);
+    TangentSpace::generateBitangentsReference(data, reference.data());
+    ThreadPool::SharedPtr pPool = ThreadPool::create(1);
+    TangentSpace::generateBitangents(data, result.data(), TangentSpace::Flags::None, pPool.get());
+    if(compareBitangents(reference, result) == false)
+    {
+        return test_fail("Bitangents don't match the reference implementation when using a single thread");
+    }
+
+    return test_pass();
+}
+
+testing_func(TangentSpaceTest, TestWelding)
+{
+    // Split every vertex of the grid into one copy per triangle corner, like exporters often do
+    TestMesh grid = createGrid(50, 1);
+    TestMesh split;
+    for(uint32_t index : grid.indices)
+    {
+        split.indices.push_back((uint32_t)split.normals.size());
+        split.positions.push_back(grid.positions[index]);
+        split.normals.push_back(grid.normals[index]);
+        split.texCrd.push_back(grid.texCrd[index]);
+    }
+
+    TangentSpace::MeshData gridData = grid.getData(sizeof(glm::vec4), true);
+    TangentSpace::MeshData splitData = split.getData(sizeof(glm::vec4), true);
+    std::vector<glm::vec3> reference(gridData.vertexCount);
+    std::vector<glm::vec3> welded(splitData.vertexCount);
+    TangentSpace::generateBitangents(gridData, reference.data());
+    TangentSpace::generateBitangents(splitData, welded.data(), TangentSpace::Flags::WeldVertices);
+
+    // Welding the split mesh gives the same result as the shared mesh, as long as the grid has no identical vertices with different indices
+    for(size_t i = 0; i < grid.indices.size(); i++)
+    {
+        if(compareBitangent(welded[i], reference[grid.indices[i]]) == false)
+        {
+            return test_fail("Welded bitangents don't match the bitangents of the shared vertices");
+        }
+    }
+
+    // Without welding every corner keeps the bitangent of its own triangle
+    std::vector<glm::vec3> unwelded(splitData.vertexCount);
+    TangentSpace::generateBitangents(splitData, unwelded.data());
+    if(compareBitangents(welded, unwelded))
+    {
+        return test_fail("Welding didn't change the result");
+    }
+
+    return test_pass();
+}
+
+testing_func(TangentSpaceTest, TestPerformance)
+{
+    // ~4M triangles
+    TestMesh mesh = createGrid(1448, 2);
+    TangentSpace::MeshData data = mesh.getData(sizeof(glm::vec4), true);
+    std::vector<glm::vec3> reference(data.vertexCount);
+    std::vector<glm::vec3> result(data.vertexCount);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    TangentSpace::generateBitangentsReference(data, reference.data());
+    float referenceTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << data.indexCount / 3 << " triangles" << std::endl;
+    std::cout << "    Reference: " << referenceTime << "ms" << std::endl;
+
+    const uint32_t kThreadCounts[] = { 1, 2, 4, 8, 16 };
+    for(uint32_t threadCount : kThreadCounts)
+    {
+        ThreadPool::SharedPtr pPool = ThreadPool::create(threadCount);
+        start = CpuTimer::getCurrentTimePoint();
+        TangentSpace::generateBitangents(data, result.data(), TangentSpace::Flags::None, pPool.get());
+        float time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        std::cout << "    " << threadCount << " threads: " << time << "ms" << std::endl;
+
+        if(compareBitangents(reference, result) == false)
+        {
+            return test_fail("Bitangents don't match the reference implementation");
+        }
+    }
+
+    start = CpuTimer::getCurrentTimePoint();
+    TangentSpace::generateBitangents(data, result.data(), TangentSpace::Flags::WeldVertices);
+    std::cout << "    Welded: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms" << std::endl;
+
+    return test_pass();
+}
+
+int main()
+{
+    TangentSpaceTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
@@ -0,0 +1,296 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureLoadingTest.h"
+#include "Graphics/TextureHelper.h"
+#include "Utils/DDSHeader.h"
+#include <thread>
+#include <fstream>
+#include <atomic>
+#include <random>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+
+using namespace DdsHelper;
+
+namespace
+{
+    const uint32_t kDdsMagicNumber = 0x20534444;
+
+    struct DdsDesc
+    {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;         // Non-zero for volume textures
+        uint32_t arraySize;     // Zero for legacy files
+        uint32_t mipCount;
+        bool isCubemap;
+        DXGI_FORMAT dxgiFormat; // Used by DX10 files
+        uint32_t fourCC;        // Used by legacy files
+        uint32_t bytesPerBlock;
+        uint32_t blockSize;
+        bool generateMips;
+    };
+
+    const DdsDesc kDdsFiles[] =
+    {
+        //  name                         width height depth array mips  cube   dxgiFormat                          fourCC                bpb  block  generateMips
+        { "TextureLoadingTest2D.dds",      256,  128,    0,    1,   9, false, DXGI_FORMAT_R8G8B8A8_UNORM,        0,                      4,   1,   false },
+        { "TextureLoadingTestBC1.dds",     128,   64,    0,    0,   8, false, DXGI_FORMAT_UNKNOWN,           MAKEFOURCC('D', 'X', 'T', '1'), 8,   4,   false },
+        { "TextureLoadingTestOdd.dds",     100,   37,    0,    1,   7, false, DXGI_FORMAT_R8G8B8A8_UNORM,        0,                      4,   1,   false },
+        { "TextureLoadingTestArray.dds",    64,   64,    0,    3,   7, false, DXGI_FORMAT_R16G16B16A16_FLOAT,    0,                      8,   1,   false },
+        { "TextureLoadingTestGenMips.dds", 128,  128,    0,    2,   1, false, DXGI_FORMAT_R8G8B8A8_UNORM,        0,                      4,   1,   true },
+        { "TextureLoadingTestCube.dds",     64,   64,    0,    1,   7, true,  DXGI_FORMAT_R8G8B8A8_UNORM,        0,                      4,   1,   false },
+        { "TextureLoadingTestCubeArray.dds", 32,  32,    0,    2,   6, true,  DXGI_FORMAT_BC3_UNORM,             0,                     16,   4,   false },
+        { "TextureLoadingTestLegacyCube.dds", 32, 32,    0,    0,   6, true,  DXGI_FORMAT_UNKNOWN,             113,                      8,   1,   false },
+        { "TextureLoadingTest3D.dds",       32,   16,    8,    0,   6, false, DXGI_FORMAT_UNKNOWN,             113,                      8,   1,   false },
+    };
+
+    size_t getSubresourceSize(const DdsDesc& desc, uint32_t mip)
+    {
+        uint32_t width = (std::max(desc.width >> mip, 1U) + desc.blockSize - 1) / desc.blockSize;
+        uint32_t height = (std::max(desc.height >> mip, 1U) + desc.blockSize - 1) / desc.blockSize;
+        uint32_t depth = desc.depth ? std::max(desc.depth >> mip, 1U) : 1;
+        return (size_t)width * height * depth * desc.bytesPerBlock;
+    }
+
+    // Writes a DDS file filled with random data
+    std::string writeDdsFile(const DdsDesc& desc)
+    {
+        DdsHeader header = {};
+        header.headerSize = sizeof(DdsHeader);
+        header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask;
+        header.width = desc.width;
+        header.height = desc.height;
+        header.depth = desc.depth;
+        header.mipCount = desc.mipCount;
+        header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+        header.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+        header.caps[0] = DdsHeader::kCapsTextureMask | DdsHeader::kCapsMipMapMask | DdsHeader::kCapsComplexMask;
+
+        DdsHeaderDX10 dx10Header = {};
+        uint32_t sliceCount = desc.isCubemap ? 6 : 1;
+        if(desc.arraySize)
+        {
+            header.pixelFormat.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+            dx10Header.dxgiFormat = desc.dxgiFormat;
+            dx10Header.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+            dx10Header.miscFlag = desc.isCubemap ? DdsHeaderDX10::kCubeMapMask : 0;
+            dx10Header.arraySize = desc.arraySize;
+            sliceCount *= desc.arraySize;
+        }
+        else
+        {
+            header.pixelFormat.fourCC = desc.fourCC;
+            if(desc.depth)
+            {
+                header.flags |= DdsHeader::kDepthMask;
+                header.caps[1] = DdsHeader::kCaps2VolumeMask;
+            }
+            if(desc.isCubemap)
+            {
+                header.caps[1] = DdsHeader::kCaps2CubeMapMask | DdsHeader::kCaps2CubeMapPosXMask | DdsHeader::kCaps2CubeMapNegXMask | DdsHeader::kCaps2CubeMapPosYMask |
+                    DdsHeader::kCaps2CubeMapNegYMask | DdsHeader::kCaps2CubeMapPosZMask | DdsHeader::kCaps2CubeMapNegZMask;
+            }
+        }
+
+        size_t dataSize = 0;
+        for(uint32_t mip = 0; mip < desc.mipCount; mip++)
+        {
+            dataSize += getSubresourceSize(desc, mip);
+        }
+        dataSize *= sliceCount;
+
+        // Half-floats are kept finite, so that the generated mips can't contain NaNs
+        std::mt19937 rng((uint32_t)dataSize);
+        std::vector<uint16_t> data((dataSize + 1) / 2);
+        for(auto& d : data)
+        {
+            d = (uint16_t)(rng() & 0x3BFF);
+        }
+
+        std::string filename = getExecutableDirectory() + "\\" + desc.name;
+        std::ofstream file(filename, std::ios::binary);
+        file.write((const char*)&kDdsMagicNumber, sizeof(kDdsMagicNumber));
+        file.write((const char*)&header, sizeof(header));
+        if(desc.arraySize)
+        {
+            file.write((const char*)&dx10Header, sizeof(dx10Header));
+        }
+        file.write((const char*)data.data(), dataSize);
+        return filename;
+    }
+
+    bool compareTextures(const Texture* pStreamed, const Texture* pReference)
+    {
+        if(pStreamed->getType() != pReference->getType() ||
+            pStreamed->getFormat() != pReference->getFormat() ||
+            pStreamed->getWidth() != pReference->getWidth() ||
+            pStreamed->getHeight() != pReference->getHeight() ||
+            pStreamed->getDepth() != pReference->getDepth() ||
+            pStreamed->getArraySize() != pReference->getArraySize() ||
+            pStreamed->getMipCount() != pReference->getMipCount() ||
+            pStreamed->getBindFlags() != pReference->getBindFlags())
+        {
+            return false;
+        }
+
+        uint32_t sliceCount = pReference->getArraySize() * ((pReference->getType() == Texture::Type::TextureCube) ? 6 : 1);
+        uint32_t subresourceCount = sliceCount * pReference->getMipCount();
+        auto& pContext = gpDevice->getRenderContext();
+        for(uint32_t i = 0; i < subresourceCount; i++)
+        {
+            if(pContext->readTextureSubresource(pStreamed, i) != pContext->readTextureSubresource(pReference, i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void getPrivateBytes(size_t& privateBytes)
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters;
+        GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+        privateBytes = counters.PrivateUsage;
+    }
+
+    struct LoadStats
+    {
+        float loadTime = 0;
+        size_t peakPrivate = 0;
+    };
+
+    // The peak counters of the OS can't be reset, so the usage is sampled on a separate thread while the texture loads
+    LoadStats loadTexture(const std::string& filename, bool streamed)
+    {
+        LoadStats stats;
+        size_t basePrivate;
+        getPrivateBytes(basePrivate);
+
+        std::atomic<bool> loading(true);
+        std::thread sampler([&]()
+        {
+            while (loading)
+            {
+                size_t privateBytes;
+                getPrivateBytes(privateBytes);
+                stats.peakPrivate = std::max(stats.peakPrivate, privateBytes - std::min(privateBytes, basePrivate));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        Texture::SharedPtr pTexture = createTextureFromDDSFile(filename, false, Texture::BindFlags::ShaderResource, streamed);
+        gpDevice->getRenderContext()->flush(true);
+        stats.loadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        loading = false;
+        sampler.join();
+        return stats;
+    }
+}
+
+void TextureLoadingTest::addTests()
+{
+    addTestToList<TestStreamedDds>();
+    addTestToList<TestStreamedDdsMemory>();
+}
+
+testing_func(TextureLoadingTest, TestStreamedDds)
+{
+    for(const auto& desc : kDdsFiles)
+    {
+        std::string filename = writeDdsFile(desc);
+        Texture::SharedPtr pStreamed = createTextureFromDDSFile(filename, desc.generateMips, Texture::BindFlags::ShaderResource, true);
+        Texture::SharedPtr pReference = createTextureFromDDSFile(filename, desc.generateMips, Texture::BindFlags::ShaderResource, false);
+        std::remove(filename.c_str());
+
+        if(pStreamed == nullptr || pReference == nullptr)
+        {
+            return test_fail(std::string("Can't load ") + desc.name);
+        }
+
+        if(compareTextures(pStreamed.get(), pReference.get()) == false)
+        {
+            return test_fail(std::string("Streamed texture doesn't match the reference for ") + desc.name);
+        }
+    }
+
+    // Truncated files are rejected instead of reading past the end of the mapping
+    const DdsDesc& desc = kDdsFiles[0];
+    std::string filename = writeDdsFile(desc);
+    std::vector<char> data;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size() - 1);
+    }
+    Texture::SharedPtr pTruncated = createTextureFromDDSFile(filename, false, Texture::BindFlags::ShaderResource, true);
+    std::remove(filename.c_str());
+    if(pTruncated)
+    {
+        return test_fail("Truncated DDS file was loaded");
+    }
+
+    return test_pass();
+}
+
+testing_func(TextureLoadingTest, TestStreamedDdsMemory)
+{
+    // 4K RGBA8 with a full mip-chain, ~85MB of data
+    const DdsDesc desc = { "TextureLoadingTestLarge.dds", 4096, 4096, 0, 1, 13, false, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 4, 1, false };
+    std::string filename = writeDdsFile(desc);
+
+    LoadStats reference = loadTexture(filename, false);
+    LoadStats streamed = loadTexture(filename, true);
+    std::remove(filename.c_str());
+
+    std::cout << desc.name << std::endl;
+    std::cout << "    In-memory: " << reference.loadTime << "ms, peak private " << (reference.peakPrivate >> 20) << "MB" << std::endl;
+    std::cout << "    Streamed:  " << streamed.loadTime << "ms, peak private " << (streamed.peakPrivate >> 20) << "MB" << std::endl;
+
+    // The streamed path doesn't hold a copy of the file, so its peak is bounded by the upload buffers
+    if(streamed.peakPrivate > reference.peakPrivate)
+    {
+        return test_fail("Streamed loading allocated more memory than the in-memory loader");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    TextureLoadingTest tlt;
+    tlt.init(true);
+    tlt.run();
+    return 0;
+}
@@ -0,0 +1,413 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UploadHeapTest.h"
+#include <random>
+#include <algorithm>
+
+namespace
+{
+    // CPU-only replacement for GpuFence. The "GPU" completes values when the test tells it to
+    struct MockFence
+    {
+        uint64_t cpuValue = 0;
+        uint64_t gpuValue = 0;
+
+        uint64_t getCpuValue() const { return cpuValue; }
+        uint64_t getGpuValue() const { return gpuValue; }
+        uint64_t signal() { return ++cpuValue; }
+    };
+
+    using MockRingAllocator = RingAllocator<MockFence>;
+    const size_t kInvalid = MockRingAllocator::kInvalidOffset;
+
+    // Stands in for an upload buffer. The ID identifies the page, the size tells pages and dedicated buffers apart
+    struct MockPage
+    {
+        uint32_t id = 0;
+        size_t size = 0;
+    };
+
+    using MockPagedAllocator = PagedRingAllocator<MockFence, MockPage>;
+
+    struct LiveRange
+    {
+        size_t offset;
+        size_t size;
+        uint64_t fenceValue;
+    };
+
+    bool overlaps(const LiveRange& a, const LiveRange& b)
+    {
+        return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+    }
+}
+
+void UploadHeapTest::addTests()
+{
+    addTestToList<TestRingAllocation>();
+    addTestToList<TestRingRecycling>();
+    addTestToList<TestRingStress>();
+    addTestToList<TestPagedAllocation>();
+    addTestToList<TestBufferUpdate>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(UploadHeapTest, TestRingAllocation)
+{
+    MockFence fence;
+    MockRingAllocator ring(1024, &fence);
+
+    if (ring.allocate(100) != 0 || ring.allocate(10, 256) != 256 || ring.allocate(1) != 266)
+    {
+        return test_fail("Allocations are not linear or not aligned");
+    }
+    if (ring.getUsedSize() != 267 || ring.getPayloadSize() != 111)
+    {
+        return test_fail("Wrong used size");
+    }
+    if (ring.allocate(0) != kInvalid || ring.allocate(1025) != kInvalid)
+    {
+        return test_fail("Empty and oversized allocations should fail");
+    }
+
+    // Fill the rest of the ring. Nothing was released, so the next allocation has nowhere to go
+    if (ring.allocate(1024 - 267) != 267 || ring.getUsedSize() != 1024)
+    {
+        return test_fail("Failed to fill the ring");
+    }
+    if (ring.allocate(1) != kInvalid)
+    {
+        return test_fail("Allocation succeeded on a full ring");
+    }
+    return test_pass();
+}
+
+testing_func(UploadHeapTest, TestRingRecycling)
+{
+    MockFence fence;
+    MockRingAllocator ring(1024, &fence);
+
+    // Frame 0 takes the first half, frame 1 the second one
+    ring.allocate(512);
+    fence.signal();
+    ring.allocate(400);
+    fence.signal();
+
+    // The GPU didn't finish anything yet
+    ring.releaseCompleted();
+    if (ring.allocate(200) != kInvalid || ring.getUsedSize() != 912)
+    {
+        return test_fail("Ranges were recycled before the GPU was done with them");
+    }
+
+    // Frame 0 is done. The allocation doesn't fit at the end of the ring, so it wraps and the last 112 bytes are wasted
+    fence.gpuValue = 1;
+    ring.releaseCompleted();
+    if (ring.getUsedSize() != 400)
+    {
+        return test_fail("Frame 0 wasn't recycled");
+    }
+    if (ring.allocate(200) != 0 || ring.getWrapCount() != 1 || ring.getUsedSize() != 712 || ring.getPayloadSize() != 600)
+    {
+        return test_fail("Allocation didn't wrap around to the start of the ring");
+    }
+
+    // Only the range between the head and frame 1 is free
+    if (ring.allocate(313) != kInvalid || ring.allocate(312) != 200)
+    {
+        return test_fail("Wrapped allocation overlaps in-flight data");
+    }
+    fence.signal();
+
+    // Frame 1 is done. The wrap-around padding belongs to frame 2, so it's still in use
+    fence.gpuValue = 2;
+    ring.releaseCompleted();
+    if (ring.getUsedSize() != 624 || ring.getPayloadSize() != 512)
+    {
+        return test_fail("Frame 1 wasn't recycled");
+    }
+
+    // Once everything completed the ring restarts from the beginning
+    fence.gpuValue = 3;
+    ring.releaseCompleted();
+    if (ring.getUsedSize() != 0 || ring.getPayloadSize() != 0 || ring.allocate(1024) != 0)
+    {
+        return test_fail("Ring wasn't reset after all the allocations completed");
+    }
+    return test_pass();
+}
+
+testing_func(UploadHeapTest, TestRingStress)
+{
+    const size_t kCapacity = 64 * 1024;
+    const size_t kAlignments[] = { 1, 4, 256, 512 };
+    const uint64_t kLatency = 3;
+    std::mt19937 rng(0);
+
+    MockFence fence;
+    MockRingAllocator ring(kCapacity, &fence);
+    std::vector<LiveRange> live;
+
+    for (uint32_t frame = 0; frame < 10000; frame++)
+    {
+        uint32_t allocCount = rng() % 16;
+        for (uint32_t i = 0; i < allocCount; i++)
+        {
+            size_t size = 1 + rng() % 4096;
+            size_t alignment = kAlignments[rng() % arraysize(kAlignments)];
+            size_t offset = ring.allocate(size, alignment);
+            if (offset == kInvalid)
+            {
+                continue;
+            }
+
+            LiveRange range = { offset, size, fence.getCpuValue() };
+            if ((offset % alignment) != 0 || offset + size > kCapacity)
+            {
+                return test_fail("Invalid allocation");
+            }
+            for (const auto& other : live)
+            {
+                if (overlaps(range, other))
+                {
+                    return test_fail("Allocation overlaps a range which is still in-flight");
+                }
+            }
+            live.push_back(range);
+        }
+
+        // Submit the frame. The GPU runs a few frames behind
+        fence.signal();
+        fence.gpuValue = (fence.cpuValue > kLatency) ? fence.cpuValue - kLatency : 0;
+        ring.releaseCompleted();
+        live.erase(std::remove_if(live.begin(), live.end(), [&fence](const LiveRange& r) { return r.fenceValue < fence.gpuValue; }), live.end());
+
+        size_t payload = 0;
+        for (const auto& r : live)
+        {
+            payload += r.size;
+        }
+        if (payload != ring.getPayloadSize() || ring.getUsedSize() < payload || ring.getUsedSize() > kCapacity)
+        {
+            return test_fail("Ring's bookkeeping doesn't match the live allocations");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(UploadHeapTest, TestPagedAllocation)
+{
+    const size_t kPageSize = 1024;
+    MockFence fence;
+    uint32_t createCount = 0;
+    uint32_t releaseCount = 0;
+    {
+        MockPagedAllocator allocator(kPageSize, &fence, [&](size_t size) { MockPage page; page.id = createCount++; page.size = size; return page; }, [&](MockPage&) { releaseCount++; });
+
+        // Every page is filled by a single allocation, so the allocator grows by a page each time
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            MockPagedAllocator::Allocation alloc = allocator.allocate(kPageSize);
+            if (alloc.pPage == nullptr || alloc.pPage->id != i || alloc.offset != 0)
+            {
+                return test_fail("The allocator didn't grow when all the pages were in-flight");
+            }
+        }
+        if (allocator.getPageCount() != 4 || allocator.getActivePage().id != 3)
+        {
+            return test_fail("Wrong page count after growing");
+        }
+
+        // Requests larger than a page get a dedicated buffer, which doesn't count as a page
+        MockPagedAllocator::Allocation dedicated = allocator.allocate(kPageSize * 4);
+        if (dedicated.pPage == nullptr || dedicated.pPage->size != kPageSize * 4 || allocator.getDedicatedBufferCount() != 1 || allocator.getPageCount() != 4)
+        {
+            return test_fail("Oversized allocation didn't get a dedicated buffer");
+        }
+
+        // Once the GPU is done, the dedicated buffer is released. The pages are recycled, but they weren't idle long enough to be released
+        fence.signal();
+        fence.gpuValue = 1;
+        allocator.releaseCompleted();
+        if (allocator.getDedicatedBufferCount() != 0 || releaseCount != 1 || allocator.getPageCount() != 4)
+        {
+            return test_fail("Dedicated buffer wasn't retired after the fence passed");
+        }
+
+        // Allocate from the active page, so it stays in use while the others go idle
+        MockPagedAllocator::Allocation alloc = allocator.allocate(kPageSize / 2);
+        if (alloc.pPage == nullptr || alloc.pPage->id != 3)
+        {
+            return test_fail("Allocation didn't use the recycled active page");
+        }
+        while (fence.getCpuValue() < MockPagedAllocator::kIdlePageFenceCount * 2)
+        {
+            fence.signal();
+        }
+
+        // Page 2 was last used at fence value 0. Page 3 was used at 1, so it's kept one more signal. Its index drops, but it stays active
+        fence.gpuValue = MockPagedAllocator::kIdlePageFenceCount + 1;
+        allocator.releaseCompleted();
+        if (allocator.getPageCount() != 3 || releaseCount != 2 || allocator.getActivePage().id != 3)
+        {
+            return test_fail("Idle page wasn't trimmed, or the active page moved");
+        }
+
+        // Now the active page is idle too. The retained pages are never released
+        fence.gpuValue = fence.getCpuValue();
+        allocator.releaseCompleted();
+        if (allocator.getPageCount() != MockPagedAllocator::kRetainedPageCount || releaseCount != 3 || allocator.getActivePage().id != 0)
+        {
+            return test_fail("Idle pages weren't trimmed down to the retained pages");
+        }
+        if (allocator.allocate(kPageSize).pPage == nullptr || allocator.getPageCount() != MockPagedAllocator::kRetainedPageCount)
+        {
+            return test_fail("Allocation failed after trimming");
+        }
+    }
+
+    if (createCount != 5 || releaseCount != createCount)
+    {
+        return test_fail("Not all the pages were released");
+    }
+    return test_pass();
+}
+
+testing_func(UploadHeapTest, TestBufferUpdate)
+{
+    // The large update doesn't fit in an upload heap page, so it goes through a dedicated buffer
+    const uint32_t kElementCount = 1024 * 1024;
+    const uint32_t kUpdates[][2] = { { 100, 64 }, { 1000, 768 * 1024 } };  // Offset and size in elements
+
+    std::vector<uint32_t> expected(kElementCount);
+    for (uint32_t i = 0; i < kElementCount; i++)
+    {
+        expected[i] = i;
+    }
+    Buffer::SharedPtr pBuffer = Buffer::create(kElementCount * sizeof(uint32_t), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, expected.data());
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+
+    for (const auto& update : kUpdates)
+    {
+        std::vector<uint32_t> data(update[1]);
+        for (uint32_t i = 0; i < update[1]; i++)
+        {
+            data[i] = 0x80000000 | (update[0] + i * 3);
+        }
+        pContext->updateBuffer(pBuffer.get(), data.data(), update[0] * sizeof(uint32_t), update[1] * sizeof(uint32_t));
+        std::copy(data.begin(), data.end(), expected.begin() + update[0]);
+    }
+
+    // map() copies the buffer to a staging resource and waits for the GPU
+    const uint32_t* pData = (const uint32_t*)pBuffer->map(Buffer::MapType::Read);
+    bool match = std::equal(expected.begin(), expected.end(), pData);
+    pBuffer->unmap();
+    if (match == false)
+    {
+        return test_fail("Buffer content doesn't match after updates at non-zero offsets");
+    }
+    return test_pass();
+}
+
+testing_func(UploadHeapTest, TestPerformance)
+{
+    const size_t kCapacity = 4 * 1024 * 1024;
+    const uint32_t kFrames = 10000;
+    const uint32_t kAllocsPerFrame = 100;
+    std::mt19937 rng(1);
+
+    // Allocation rate and fragmentation of the ring itself, with the GPU running 2 frames behind
+    for (size_t alignment : { 1, 256, 512 })
+    {
+        MockFence fence;
+        MockRingAllocator ring(kCapacity, &fence);
+        uint64_t allocCount = 0;
+        uint64_t failCount = 0;
+        double fragmentation = 0;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t frame = 0; frame < kFrames; frame++)
+        {
+            for (uint32_t i = 0; i < kAllocsPerFrame; i++)
+            {
+                size_t size = 16 + rng() % 8192;
+                (ring.allocate(size, alignment) == kInvalid) ? failCount++ : allocCount++;
+            }
+            fence.signal();
+            fence.gpuValue = (fence.cpuValue > 2) ? fence.cpuValue - 2 : 0;
+            ring.releaseCompleted();
+            if (ring.getUsedSize())
+            {
+                fragmentation += 1.0 - (double)ring.getPayloadSize() / (double)ring.getUsedSize();
+            }
+        }
+        double ms = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        std::cout << "RingAllocator, alignment " << alignment << ": " << (uint64_t)((allocCount + failCount) / (ms / 1000.0)) << " allocations/sec, ";
+        std::cout << "padding " << (fragmentation / kFrames) * 100 << "% of the used memory, " << ring.getWrapCount() << " wrap-arounds, " << failCount << " failed allocations" << std::endl;
+    }
+
+    // Staging cost of CopyContext::updateBuffer(), compared with creating an upload buffer for every update
+    const uint32_t kUpdates = 10000;
+    const size_t kUpdateSize = 256;
+    std::vector<uint8_t> data(kUpdateSize, 0xab);
+    Buffer::SharedPtr pBuffer = Buffer::create(kUpdateSize * 16, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr);
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    pContext->flush(true);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kUpdates; i++)
+    {
+        // This is what updateBuffer() used to do
+        Buffer::SharedPtr pUpload = Buffer::create(kUpdateSize, Resource::BindFlags::None, Buffer::CpuAccess::Write, data.data());
+        uint64_t srcOffset = pUpload->getGpuAddress() - pUpload->getApiHandle()->GetGPUVirtualAddress();
+        pContext->resourceBarrier(pBuffer.get(), Resource::State::CopyDest);
+        pContext->getLowLevelData()->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), (i % 16) * kUpdateSize, pUpload->getApiHandle(), srcOffset, kUpdateSize);
+        pContext->setPendingCommands(true);
+    }
+    std::cout << "Buffer per update: " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms for " << kUpdates << " updates" << std::endl;
+    pContext->flush(true);
+
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kUpdates; i++)
+    {
+        pContext->updateBuffer(pBuffer.get(), data.data(), (i % 16) * kUpdateSize, kUpdateSize);
+    }
+    std::cout << "CopyContext::updateBuffer(): " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) << "ms for " << kUpdates << " updates" << std::endl;
+    pContext->flush(true);
+
+    return test_pass();
+}
+
+int main()
+{
+    UploadHeapTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
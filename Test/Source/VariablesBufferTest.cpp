@@ -0,0 +1,140 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VariablesBufferTest.h"
+
+namespace
+{
+    const uint32_t kUpdateCount = 10000;
+}
+
+void VariablesBufferTest::addTests()
+{
+    addTestToList<TestLayoutCreate>();
+    addTestToList<TestLayoutBenchmark>();
+}
+
+testing_func(VariablesBufferTest, TestLayoutCreate)
+{
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "LayoutTest.ps.hlsl");
+    GraphicsVars::SharedPtr pVars = GraphicsVars::create(pProgram->getActiveVersion()->getReflector());
+    ConstantBuffer::SharedPtr pCB = pVars["PerFrameCB"];
+    const auto& pReflector = pCB->getBufferReflector();
+
+    // A struct which matches the shader declaration is a single range
+    VariablesBufferLayout::SharedPtr pLightLayout = Light::createBindingLayout(pReflector, "gPointLight");
+    if (pLightLayout == nullptr || pLightLayout->getRangeCount() != 1)
+    {
+        return test_fail("Light layout should be a single range");
+    }
+    if (pLightLayout->getDstBegin() != pCB->getVariableOffset("gPointLight.worldPos") || pLightLayout->getDstEnd() - pLightLayout->getDstBegin() != Light::getShaderStructSize())
+    {
+        return test_fail("Light layout doesn't match the variable offset");
+    }
+
+    // Fields which are adjacent both in the struct and in the buffer should be merged, regardless of the order they were specified in
+    std::vector<VariablesBufferLayout::Field> fields;
+    fields.push_back({"gDirLight.worldDir", offsetof(LightData, worldDir), sizeof(glm::vec3)});
+    fields.push_back({"gDirLight.worldPos", offsetof(LightData, worldPos), sizeof(glm::vec3) + sizeof(uint32_t)});
+    fields.push_back({"gAmbient", sizeof(LightData), sizeof(glm::vec3)});
+    VariablesBufferLayout::SharedPtr pFieldLayout = VariablesBufferLayout::create(pReflector, fields);
+    if (pFieldLayout == nullptr || pFieldLayout->getRangeCount() != 2)
+    {
+        return test_fail("Adjacent fields weren't merged");
+    }
+    if (pFieldLayout->getRange(0).dstOffset != pCB->getVariableOffset("gDirLight.worldPos") || pFieldLayout->getRange(1).dstOffset != pCB->getVariableOffset("gAmbient"))
+    {
+        return test_fail("Layout ranges don't match the variable offsets");
+    }
+    if (pFieldLayout->getRequiredSrcSize() != sizeof(LightData) + sizeof(glm::vec3))
+    {
+        return test_fail("Wrong layout source size");
+    }
+
+    // Unknown variables should fail
+    if (VariablesBufferLayout::create(pReflector, "gNotAVariable", sizeof(float)) != nullptr)
+    {
+        return test_fail("Layout was created for a variable which doesn't exist");
+    }
+
+    return test_pass();
+}
+
+testing_func(VariablesBufferTest, TestLayoutBenchmark)
+{
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "LayoutTest.ps.hlsl");
+    GraphicsVars::SharedPtr pVars = GraphicsVars::create(pProgram->getActiveVersion()->getReflector());
+    ConstantBuffer::SharedPtr pFrameCB = pVars["PerFrameCB"];
+    ConstantBuffer::SharedPtr pMaterialCB = pVars["InternalPerMaterialCB"];
+
+    std::vector<Material::SharedPtr> materials;
+    std::vector<PointLight::SharedPtr> lights;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        Material::SharedPtr pMaterial = Material::create("Material" + std::to_string(i));
+        pMaterial->setLayerAlbedo(0, glm::vec4(float(i) / 64.f));
+        materials.push_back(pMaterial);
+        PointLight::SharedPtr pLight = PointLight::create();
+        pLight->setWorldPosition(glm::vec3(float(i)));
+        lights.push_back(pLight);
+    }
+
+    // By name, resolving the variables on every update
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kUpdateCount; i++)
+    {
+        materials[i % materials.size()]->setIntoProgramVars(pVars.get(), pMaterialCB.get(), "gMaterial");
+        lights[i % lights.size()]->setIntoConstantBuffer(pFrameCB.get(), "gPointLight");
+    }
+    float nameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Using layouts resolved once
+    start = CpuTimer::getCurrentTimePoint();
+    Material::BindingLayout materialLayout = Material::createBindingLayout(pVars->getReflection().get(), pMaterialCB->getBufferReflector(), "gMaterial");
+    VariablesBufferLayout::SharedPtr pLightLayout = Light::createBindingLayout(pFrameCB->getBufferReflector(), "gPointLight");
+    if (materialLayout.pCbLayout == nullptr || pLightLayout == nullptr)
+    {
+        return test_fail("Can't create the binding layouts");
+    }
+    for (uint32_t i = 0; i < kUpdateCount; i++)
+    {
+        materials[i % materials.size()]->setIntoProgramVars(pVars.get(), pMaterialCB.get(), materialLayout);
+        lights[i % lights.size()]->setIntoConstantBuffer(pFrameCB.get(), pLightLayout.get());
+    }
+    float layoutTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << kUpdateCount << " material and light updates by name: " << nameTime << "ms, using binding layouts: " << layoutTime << "ms" << std::endl;
+    return test_pass();
+}
+
+int main()
+{
+    VariablesBufferTest vbt;
+    vbt.init(true);
+    vbt.run();
+    return 0;
+}
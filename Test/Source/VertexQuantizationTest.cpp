@@ -0,0 +1,298 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VertexQuantizationTest.h"
+#include "Graphics/Model/VertexQuantization.h"
+#include <random>
+
+namespace
+{
+    const char* kModelFiles[] = { "sphere.obj", "torus.obj", "ogre/bs_rest.obj", "SanMiguel/san-miguel.bin", "CityScene/CityScene.bin" };
+    const Model::LoadFlags kQuantizeFlags = Model::LoadFlags::QuantizeVertexAttributes | Model::LoadFlags::QuantizePositions;
+
+    struct ErrorStats
+    {
+        uint64_t vertexCount = 0;
+        float positionError = 0;        // Relative to the diagonal of the mesh's bounding box
+        float normalError = 0;          // In degrees
+        float bitangentError = 0;       // In degrees
+        float texCrdError = 0;
+    };
+
+    float calcAngle(const glm::vec3& a, const glm::vec3& b)
+    {
+        float la = glm::length(a);
+        float lb = glm::length(b);
+        if(la == 0 || lb == 0)
+        {
+            return 0;
+        }
+        return glm::degrees(glm::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f)));
+    }
+
+    std::vector<uint8_t> readVertexBuffer(const Buffer::SharedPtr& pBuffer)
+    {
+        std::vector<uint8_t> data(pBuffer->getSize());
+        std::memcpy(data.data(), pBuffer->map(Buffer::MapType::Read), data.size());
+        pBuffer->unmap();
+        return data;
+    }
+
+    // Compares the vertex buffers of two loads of the same model and accumulates the errors
+    bool compareMeshes(const Mesh* pMesh, const Mesh* pQuantized, ErrorStats& stats)
+    {
+        const Vao* pVao = pMesh->getVao().get();
+        const Vao* pQuantizedVao = pQuantized->getVao().get();
+        VertexQuantization::PositionTransform identity;
+        VertexQuantization::PositionTransform positionTransform;
+        positionTransform.scale = pQuantized->getPositionScale();
+        positionTransform.offset = pQuantized->getPositionOffset();
+        const float diagonal = glm::length(pMesh->getBoundingBox().getSize());
+
+        stats.vertexCount += pQuantized->getVertexCount();
+
+        const uint32_t kLocations[] = { VERTEX_POSITION_LOC, VERTEX_NORMAL_LOC, VERTEX_BITANGENT_LOC, VERTEX_TEXCOORD_LOC };
+        for(uint32_t location : kLocations)
+        {
+            Vao::ElementDesc desc = pVao->getElementIndexByLocation(location);
+            Vao::ElementDesc quantizedDesc = pQuantizedVao->getElementIndexByLocation(location);
+            if(desc.vbIndex == Vao::ElementDesc::kInvalidIndex || quantizedDesc.vbIndex == Vao::ElementDesc::kInvalidIndex)
+            {
+                if(desc.vbIndex != quantizedDesc.vbIndex)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(desc.vbIndex).get();
+            const VertexBufferLayout* pQuantizedLayout = pQuantizedVao->getVertexLayout()->getBufferLayout(quantizedDesc.vbIndex).get();
+            std::vector<uint8_t> data = readVertexBuffer(pVao->getVertexBuffer(desc.vbIndex));
+            std::vector<uint8_t> quantizedData = readVertexBuffer(pQuantizedVao->getVertexBuffer(quantizedDesc.vbIndex));
+
+            for(uint32_t v = 0; v < pMesh->getVertexCount(); v++)
+            {
+                glm::vec4 ref = VertexQuantization::decodeElement(pLayout->getElementFormat(desc.elementIndex), data.data() + (size_t)v * pLayout->getStride() + pLayout->getElementOffset(desc.elementIndex), identity);
+                glm::vec4 val = VertexQuantization::decodeElement(pQuantizedLayout->getElementFormat(quantizedDesc.elementIndex), quantizedData.data() + (size_t)v * pQuantizedLayout->getStride() + pQuantizedLayout->getElementOffset(quantizedDesc.elementIndex), positionTransform);
+
+                switch(location)
+                {
+                case VERTEX_POSITION_LOC:
+                    stats.positionError = std::max(stats.positionError, (diagonal > 0) ? glm::length(glm::vec3(val) - glm::vec3(ref)) / diagonal : 0);
+                    break;
+                case VERTEX_NORMAL_LOC:
+                    stats.normalError = std::max(stats.normalError, calcAngle(glm::vec3(ref), glm::vec3(val)));
+                    break;
+                case VERTEX_BITANGENT_LOC:
+                    stats.bitangentError = std::max(stats.bitangentError, calcAngle(glm::vec3(ref), glm::vec3(val)));
+                    break;
+                case VERTEX_TEXCOORD_LOC:
+                    stats.texCrdError = std::max(stats.texCrdError, glm::length(glm::vec2(val) - glm::vec2(ref)));
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    uint64_t getVertexBytes(const Model* pModel)
+    {
+        uint64_t bytes = 0;
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            const Mesh* pMesh = pModel->getMesh(i).get();
+            const Vao* pVao = pMesh->getVao().get();
+            for(uint32_t b = 0; b < pVao->getVertexBuffersCount(); b++)
+            {
+                if(pVao->getVertexBuffer(b))
+                {
+                    bytes += (uint64_t)pVao->getVertexLayout()->getBufferLayout(b)->getStride() * pMesh->getVertexCount();
+                }
+            }
+        }
+        return bytes;
+    }
+}
+
+void VertexQuantizationTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestModelQuantization>();
+}
+
+testing_func(VertexQuantizationTest, TestRoundTrip)
+{
+    const uint32_t kVertexCount = 10000;
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::vector<glm::vec3> positions(kVertexCount);
+    std::vector<glm::vec3> normals(kVertexCount);
+    std::vector<glm::vec2> texCrd(kVertexCount);
+    for(uint32_t i = 0; i < kVertexCount; i++)
+    {
+        positions[i] = glm::vec3(dist(rng) * 100, dist(rng), dist(rng) * 0.01f + 5);
+        normals[i] = glm::normalize(glm::vec3(dist(rng), dist(rng), dist(rng)) + glm::vec3(0, 0, 1e-3f));
+        texCrd[i] = glm::vec2(dist(rng) * 4, dist(rng));
+    }
+
+    VertexQuantization::PositionTransform transform = VertexQuantization::calcPositionTransform((const float*)positions.data(), sizeof(glm::vec3), kVertexCount);
+
+    struct Element
+    {
+        uint32_t location;
+        ResourceFormat format;
+        ResourceFormat expectedFormat;
+        const float* pData;
+        uint32_t stride;
+    };
+    const Element kElements[] =
+    {
+        { VERTEX_POSITION_LOC, ResourceFormat::RGB32Float, ResourceFormat::RGBA16Unorm, (const float*)positions.data(), sizeof(glm::vec3) },
+        { VERTEX_NORMAL_LOC, ResourceFormat::RGB32Float, ResourceFormat::RGB10A2Unorm, (const float*)normals.data(), sizeof(glm::vec3) },
+        { VERTEX_TEXCOORD_LOC, ResourceFormat::RG32Float, ResourceFormat::RG16Float, (const float*)texCrd.data(), sizeof(glm::vec2) },
+    };
+
+    for(const Element& e : kElements)
+    {
+        VertexBufferLayout::SharedPtr pLayout = VertexBufferLayout::create();
+        pLayout->addElement("ELEMENT", 0, e.format, 1, e.location);
+        std::vector<uint8_t> data((const uint8_t*)e.pData, (const uint8_t*)e.pData + (size_t)e.stride * kVertexCount);
+        VertexBufferLayout::SharedConstPtr pQuantized = VertexQuantization::quantizeBuffer(pLayout, kQuantizeFlags, transform, data);
+
+        if(pQuantized->getElementFormat(0) != e.expectedFormat || data.size() != (size_t)pQuantized->getStride() * kVertexCount)
+        {
+            return test_fail("Element at location " + std::to_string(e.location) + " was quantized to the wrong format");
+        }
+
+        for(uint32_t i = 0; i < kVertexCount; i++)
+        {
+            const float* pRef = (const float*)((const uint8_t*)e.pData + (size_t)i * e.stride);
+            glm::vec4 val = VertexQuantization::decodeElement(pQuantized->getElementFormat(0), data.data() + (size_t)i * pQuantized->getStride(), transform);
+            switch(e.location)
+            {
+            case VERTEX_POSITION_LOC:
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    // Half a quantization step, plus float rounding
+                    float maxError = transform.scale[c] / 65535.0f * 0.5f + 1e-5f * (std::abs(pRef[c]) + transform.scale[c]);
+                    if(std::abs(val[c] - pRef[c]) > maxError)
+                    {
+                        return test_fail("Position error is too large");
+                    }
+                }
+                break;
+            case VERTEX_NORMAL_LOC:
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    if(std::abs(val[c] - pRef[c]) > 1.0f / 1023.0f + 1e-6f)
+                    {
+                        return test_fail("Normal error is too large");
+                    }
+                }
+                break;
+            case VERTEX_TEXCOORD_LOC:
+                for(uint32_t c = 0; c < 2; c++)
+                {
+                    // Half floats have an 11-bit mantissa
+                    if(std::abs(val[c] - pRef[c]) > std::abs(pRef[c]) / 2048.0f + 1e-7f)
+                    {
+                        return test_fail("Texture coordinate error is too large");
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    // Elements which aren't quantized keep their layout and data
+    VertexBufferLayout::SharedPtr pColorLayout = VertexBufferLayout::create();
+    pColorLayout->addElement(VERTEX_DIFFUSE_COLOR_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_DIFFUSE_COLOR_LOC);
+    std::vector<uint8_t> colors((const uint8_t*)normals.data(), (const uint8_t*)(normals.data() + kVertexCount));
+    std::vector<uint8_t> original = colors;
+    if(VertexQuantization::quantizeBuffer(pColorLayout, kQuantizeFlags, transform, colors) != pColorLayout || colors != original)
+    {
+        return test_fail("Colors shouldn't be quantized");
+    }
+
+    return test_pass();
+}
+
+testing_func(VertexQuantizationTest, TestModelQuantization)
+{
+    for(const char* file : kModelFiles)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(file, fullpath) == false)
+        {
+            std::cout << "Skipping " << file << ", file not found" << std::endl;
+            continue;
+        }
+
+        Model::SharedPtr pModel = Model::createFromFile(fullpath.c_str());
+        Model::SharedPtr pQuantized = Model::createFromFile(fullpath.c_str(), kQuantizeFlags);
+        if(pModel == nullptr || pQuantized == nullptr)
+        {
+            return test_fail("Failed to load " + fullpath);
+        }
+        if(pModel->getMeshCount() != pQuantized->getMeshCount())
+        {
+            return test_fail("Quantizing " + fullpath + " changed the number of meshes");
+        }
+
+        ErrorStats stats;
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            if(compareMeshes(pModel->getMesh(i).get(), pQuantized->getMesh(i).get(), stats) == false)
+            {
+                return test_fail("Quantizing mesh " + std::to_string(i) + " of " + fullpath + " changed its vertex layout");
+            }
+        }
+
+        uint64_t originalBytes = getVertexBytes(pModel.get());
+        uint64_t quantizedBytes = getVertexBytes(pQuantized.get());
+        std::cout << file << ": " << stats.vertexCount << " vertices" << std::endl;
+        std::cout << "    Bytes per vertex " << (float)originalBytes / (float)stats.vertexCount << " -> " << (float)quantizedBytes / (float)stats.vertexCount << std::endl;
+        std::cout << "    Max position error " << stats.positionError * 100 << "% of the bounding box diagonal" << std::endl;
+        std::cout << "    Max normal error " << stats.normalError << " degrees, max bitangent error " << stats.bitangentError << " degrees" << std::endl;
+        std::cout << "    Max texture coordinate error " << stats.texCrdError << std::endl;
+
+        if(quantizedBytes >= originalBytes)
+        {
+            return test_fail("Quantizing " + fullpath + " didn't reduce the vertex size");
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    VertexQuantizationTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}